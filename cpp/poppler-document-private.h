@@ -27,6 +27,7 @@
 #include "GooString.h"
 #include "PDFDoc.h"
 #include "GlobalParams.h"
+#include "TextIndex.h"
 
 #include <vector>
 
@@ -51,6 +52,10 @@ public:
     int raw_doc_data_length;
     bool is_locked;
     std::vector<embedded_file *> embedded_files;
+    std::unique_ptr<TextIndex> text_index;
+    // unique for every document_private, even when one is allocated where
+    // another one was freed, so that renderers can tell them apart
+    unsigned long long serial;
 
 private:
     document_private();
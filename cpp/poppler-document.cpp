@@ -35,6 +35,7 @@
 #include "poppler-embedded-file-private.h"
 #include "poppler-page-private.h"
 #include "poppler-private.h"
+#include "poppler-resource-private.h"
 #include "poppler-toc-private.h"
 
 #include "Catalog.h"
@@ -43,8 +44,10 @@
 #include "GlobalParams.h"
 #include "Link.h"
 #include "Outline.h"
+#include "UTF.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <memory>
 
@@ -70,7 +73,11 @@ document_private::document_private(const char *file_data, int file_data_length,
     doc = new PDFDoc(memstr, GooString(owner_password.c_str()), GooString(user_password.c_str()));
 }
 
-document_private::document_private() : GlobalParamsIniter(detail::error_function), doc(nullptr), raw_doc_data(nullptr), raw_doc_data_length(0), is_locked(false) { }
+document_private::document_private() : GlobalParamsIniter(detail::error_function), doc(nullptr), raw_doc_data(nullptr), raw_doc_data_length(0), is_locked(false)
+{
+    static std::atomic<unsigned long long> next_serial(0);
+    serial = next_serial++;
+}
 
 document_private::~document_private()
 {
@@ -1033,6 +1040,27 @@ std::vector<font_info> document::fonts() const
     return result;
 }
 
+/**
+ Lists the fonts, images, color spaces and shadings of the %document.
+
+ The resources of the pages, and of the form XObjects, patterns, Type 3
+ fonts and annotation appearances they use, are walked without reading any
+ content stream; every shared object is only looked at once, so this is
+ fast even for big documents.
+
+ \since 24.08
+ */
+std::vector<resource_info> document::resources() const
+{
+    std::vector<resource_info> result;
+    ResourceScanner scanner(d->doc);
+    scanner.scan(1, d->doc->getNumPages());
+    for (const ResourceInfo &ri : scanner.getResources()) {
+        result.push_back(resource_info(*new resource_info_private(ri)));
+    }
+    return result;
+}
+
 /**
  Creates a new font iterator.
 
@@ -1172,6 +1200,104 @@ bool document::save_a_copy(const std::string &file_name) const
     return d->doc->saveWithoutChangesAs(fname) == errNone;
 }
 
+/**
+ Builds a full-text index of the %document.
+
+ Every page is laid out once, and its words are recorded (normalized and
+ case folded) together with their bounding boxes, so that
+ search_text_index() can answer queries for the whole %document without
+ laying out the pages again.
+
+ \returns true on success, false on failure
+
+ \see load_text_index, save_text_index, search_text_index
+ \since 24.08
+ */
+bool document::create_text_index()
+{
+    if (d->is_locked) {
+        return false;
+    }
+
+    d->text_index = TextIndex::create(d->doc);
+    return true;
+}
+
+/**
+ Loads a full-text index previously written with save_text_index().
+
+ The index is only accepted if it was created for a %document with the
+ same PDF ID and file size as this one (for documents without ID, for the
+ same file contents).
+
+ \returns true on success, false on failure
+
+ \since 24.08
+ */
+bool document::load_text_index(const std::string &file_name)
+{
+    if (d->is_locked) {
+        return false;
+    }
+
+    std::unique_ptr<TextIndex> index = TextIndex::load(file_name.c_str(), d->doc);
+    if (!index || index->getNumPages() != d->doc->getNumPages()) {
+        return false;
+    }
+    d->text_index = std::move(index);
+    return true;
+}
+
+/**
+ Saves the full-text index of the %document to file \p file_name, tagged
+ with the PDF ID and file size of the %document.
+
+ \returns true on success, false on failure (including when there is no
+          index yet)
+
+ \since 24.08
+ */
+bool document::save_text_index(const std::string &file_name) const
+{
+    if (!d->text_index) {
+        return false;
+    }
+
+    return d->text_index->save(file_name.c_str(), d->doc);
+}
+
+/**
+ Searches the full-text index of the %document for the phrase \p text.
+
+ Matching is case insensitive and ignores punctuation. If \p prefix is
+ true the last word of \p text only needs to be a prefix of a word in
+ the %document.
+
+ \returns the matches, as pairs of a page index and the bounding box of
+          the match on that page (in the same coordinates as
+          page::text_list()); empty if there is no index
+
+ \see create_text_index, load_text_index
+ \since 24.08
+ */
+std::vector<std::pair<int, rectf>> document::search_text_index(const ustring &text, bool prefix) const
+{
+    std::vector<std::pair<int, rectf>> result;
+
+    if (!d->text_index || text.empty()) {
+        return result;
+    }
+
+    const byte_array utf8 = text.to_utf8();
+    Unicode *ucs4;
+    const int len = utf8ToUCS4(std::string(utf8.begin(), utf8.end()).c_str(), &ucs4);
+    for (const TextIndex::Match &match : d->text_index->find(ucs4, len, prefix)) {
+        result.emplace_back(match.page - 1, rectf(match.xMin, match.yMin, match.xMax - match.xMin, match.yMax - match.yMin));
+    }
+    gfree(ucs4);
+    return result;
+}
+
 /**
  Tries to load a PDF %document from the specified file.
 
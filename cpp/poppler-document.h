@@ -24,8 +24,11 @@
 
 #include "poppler-global.h"
 #include "poppler-font.h"
+#include "poppler-rectangle.h"
+#include "poppler-resource.h"
 
 #include <map>
+#include <utility>
 
 namespace poppler {
 
@@ -112,6 +115,7 @@ public:
 
     std::vector<font_info> fonts() const;
     font_iterator *create_font_iterator(int start_page = 0) const;
+    std::vector<resource_info> resources() const;
 
     toc *create_toc() const;
 
@@ -125,6 +129,11 @@ public:
     bool save(const std::string &file_name) const;
     bool save_a_copy(const std::string &file_name) const;
 
+    bool create_text_index();
+    bool load_text_index(const std::string &file_name);
+    bool save_text_index(const std::string &file_name) const;
+    std::vector<std::pair<int, rectf>> search_text_index(const ustring &text, bool prefix = false) const;
+
     static document *load_from_file(const std::string &file_name, const std::string &owner_password = std::string(), const std::string &user_password = std::string());
     static document *load_from_data(byte_array *file_data, const std::string &owner_password = std::string(), const std::string &user_password = std::string());
     static document *load_from_raw_data(const char *file_data, int file_data_length, const std::string &owner_password = std::string(), const std::string &user_password = std::string());
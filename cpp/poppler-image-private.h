@@ -35,6 +35,7 @@ public:
 
     static image_private *create_data(int width, int height, image::format_enum format);
     static image_private *create_data(char *data, int width, int height, image::format_enum format);
+    static image adopt_data(char *data, int width, int height, image::format_enum format);
 
     int ref;
     char *data;
@@ -157,6 +157,21 @@ image_private *image_private::create_data(char *data, int width, int height, ima
     return d;
 }
 
+// Makes an image owning <data>, which must have been allocated with
+// malloc() and have the row size of the format; <data> is freed if the
+// image cannot be created.
+image image_private::adopt_data(char *data, int width, int height, image::format_enum format)
+{
+    image img;
+    img.d = create_data(data, width, height, format);
+    if (img.d) {
+        img.d->own_data = true;
+    } else {
+        std::free(data);
+    }
+    return img;
+}
+
 /**
  \class poppler::image poppler-image.h "poppler/cpp/poppler-image.h"
 
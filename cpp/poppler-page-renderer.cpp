@@ -29,6 +29,7 @@
 #include "poppler-document-private.h"
 #include "poppler-page-private.h"
 #include "poppler-image.h"
+#include "poppler-image-private.h"
 
 #include <config.h>
 #include <poppler-config.h>
@@ -37,20 +38,50 @@
 #include "SplashOutputDev.h"
 #include "splash/SplashBitmap.h"
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
 using namespace poppler;
 
 class poppler::page_renderer_private
 {
 public:
-    page_renderer_private() : paper_color(0xffffffff), hints(0), image_format(image::format_enum::format_argb32), line_mode(page_renderer::line_mode_enum::line_default) { }
+    page_renderer_private()
+        : paper_color(0xffffffff),
+          hints(0),
+          image_format(image::format_enum::format_argb32),
+          line_mode(page_renderer::line_mode_enum::line_default),
+          output_dev_doc(0),
+          output_dev_paper_color(0),
+          output_dev_hints(0),
+          output_dev_image_format(image::format_enum::format_invalid),
+          output_dev_line_mode(page_renderer::line_mode_enum::line_default)
+    {
+    }
 
     static bool conv_color_mode(image::format_enum mode, SplashColorMode &splash_mode);
     static bool conv_line_mode(page_renderer::line_mode_enum mode, SplashThinLineMode &splash_mode);
+    static int row_bytes(image::format_enum format, int width);
+
+    std::unique_ptr<SplashOutputDev> create_output_dev(SplashColorMode color_mode, SplashThinLineMode thin_line_mode, PDFDoc *pdfdoc) const;
+    SplashBitmap *render(const page *p, double xres, double yres, int x, int y, int w, int h, rotation_enum rotate);
 
     argb paper_color;
     unsigned int hints;
     image::format_enum image_format;
     page_renderer::line_mode_enum line_mode;
+
+    // the output device of the last render, with its font caches; it is
+    // kept while the document and the settings stay the same
+    std::mutex output_dev_mutex;
+    std::unique_ptr<SplashOutputDev> output_dev;
+    unsigned long long output_dev_doc;
+    argb output_dev_paper_color;
+    unsigned int output_dev_hints;
+    image::format_enum output_dev_image_format;
+    page_renderer::line_mode_enum output_dev_line_mode;
 };
 
 bool page_renderer_private::conv_color_mode(image::format_enum mode, SplashColorMode &splash_mode)
@@ -95,6 +126,80 @@ bool page_renderer_private::conv_line_mode(page_renderer::line_mode_enum mode, S
     return true;
 }
 
+// The number of bytes of a row of pixels, without padding.
+int page_renderer_private::row_bytes(image::format_enum format, int width)
+{
+    switch (format) {
+    case image::format_enum::format_mono:
+        return (width + 7) >> 3;
+    case image::format_enum::format_gray8:
+        return width;
+    case image::format_enum::format_rgb24:
+    case image::format_enum::format_bgr24:
+        return width * 3;
+    case image::format_enum::format_argb32:
+        return width * 4;
+    default:
+        return 0;
+    }
+}
+
+std::unique_ptr<SplashOutputDev> page_renderer_private::create_output_dev(SplashColorMode color_mode, SplashThinLineMode thin_line_mode, PDFDoc *pdfdoc) const
+{
+    SplashColor bgColor;
+    bgColor[0] = paper_color & 0xff;
+    bgColor[1] = (paper_color >> 8) & 0xff;
+    bgColor[2] = (paper_color >> 16) & 0xff;
+    // pad the rows like poppler::image does, so the bitmap data can be
+    // handed over as it is
+    const int row_pad = color_mode == splashModeMono1 ? 1 : 4;
+    auto dev = std::make_unique<SplashOutputDev>(color_mode, row_pad, false, bgColor, true, thin_line_mode);
+    dev->setFontAntialias(hints & page_renderer::text_antialiasing ? true : false);
+    dev->setVectorAntialias(hints & page_renderer::antialiasing ? true : false);
+    dev->setFreeTypeHinting(hints & page_renderer::text_hinting ? true : false, false);
+    dev->startDoc(pdfdoc);
+    return dev;
+}
+
+// Renders the page, returning the bitmap (to be deleted by the caller)
+// or nullptr on errors.
+SplashBitmap *page_renderer_private::render(const page *p, double xres, double yres, int x, int y, int w, int h, rotation_enum rotate)
+{
+    if (!p) {
+        return nullptr;
+    }
+
+    page_private *pp = page_private::get(p);
+    PDFDoc *pdfdoc = pp->doc->doc;
+
+    SplashColorMode colorMode;
+    SplashThinLineMode lineMode;
+
+    if (!conv_color_mode(image_format, colorMode) || !conv_line_mode(line_mode, lineMode)) {
+        return nullptr;
+    }
+
+    // another thread is rendering with this renderer: use a device of
+    // our own, as it was done before devices were kept
+    std::unique_lock<std::mutex> lock(output_dev_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        std::unique_ptr<SplashOutputDev> dev = create_output_dev(colorMode, lineMode, pdfdoc);
+        pdfdoc->displayPageSlice(dev.get(), pp->index + 1, xres, yres, int(rotate) * 90, false, true, false, x, y, w, h, nullptr, nullptr, nullptr, nullptr, true);
+        return dev->takeBitmap();
+    }
+
+    if (!output_dev || output_dev_doc != pp->doc->serial || output_dev_paper_color != paper_color || output_dev_hints != hints || output_dev_image_format != image_format || output_dev_line_mode != line_mode) {
+        output_dev = create_output_dev(colorMode, lineMode, pdfdoc);
+        output_dev_doc = pp->doc->serial;
+        output_dev_paper_color = paper_color;
+        output_dev_hints = hints;
+        output_dev_image_format = image_format;
+        output_dev_line_mode = line_mode;
+    }
+    pdfdoc->displayPageSlice(output_dev.get(), pp->index + 1, xres, yres, int(rotate) * 90, false, true, false, x, y, w, h, nullptr, nullptr, nullptr, nullptr, true);
+    return output_dev->takeBitmap();
+}
+
 /**
  \class poppler::page_renderer poppler-page-renderer.h "poppler/cpp/poppler-renderer.h"
 
@@ -111,6 +216,12 @@ bool page_renderer_private::conv_line_mode(page_renderer::line_mode_enum mode, S
 
 /**
  Constructs a new %page renderer.
+
+ The renderer keeps its output device, with the fonts and glyphs loaded so
+ far, between calls of render_page() and render_page_into() for pages of the
+ same %document, as long as no setting changes; rendering many pages or
+ thumbnails of a %document with the same renderer is faster than with a new
+ renderer for each one.
  */
 page_renderer::page_renderer() : d(new page_renderer_private()) { }
 
@@ -254,39 +365,63 @@ void page_renderer::set_line_mode(page_renderer::line_mode_enum mode)
  */
 image page_renderer::render_page(const page *p, double xres, double yres, int x, int y, int w, int h, rotation_enum rotate) const
 {
-    if (!p) {
+    std::unique_ptr<SplashBitmap> bitmap(d->render(p, xres, yres, x, y, w, h, rotate));
+    if (!bitmap || !bitmap->getDataPtr()) {
         return image();
     }
 
-    page_private *pp = page_private::get(p);
-    PDFDoc *pdfdoc = pp->doc->doc;
+    // the rendered data becomes the image data, without a copy
+    const int bw = bitmap->getWidth();
+    const int bh = bitmap->getHeight();
+    return image_private::adopt_data(reinterpret_cast<char *>(bitmap->takeData()), bw, bh, d->image_format);
+}
 
-    SplashColorMode colorMode;
-    SplashThinLineMode lineMode;
+/**
+ Render the specified page into a buffer.
 
-    if (!d->conv_color_mode(d->image_format, colorMode) || !d->conv_line_mode(d->line_mode, lineMode)) {
-        return image();
-    }
+ This functions renders an area of the specified page following the specified
+ parameters, writing the pixels directly into \p data in the current
+ image_format(); this is useful to render into memory owned by somebody else,
+ like a texture or a window surface.
 
-    SplashColor bgColor;
-    bgColor[0] = d->paper_color & 0xff;
-    bgColor[1] = (d->paper_color >> 8) & 0xff;
-    bgColor[2] = (d->paper_color >> 16) & 0xff;
-    SplashOutputDev splashOutputDev(colorMode, 4, false, bgColor, true, lineMode);
-    splashOutputDev.setFontAntialias(d->hints & text_antialiasing ? true : false);
-    splashOutputDev.setVectorAntialias(d->hints & antialiasing ? true : false);
-    splashOutputDev.setFreeTypeHinting(d->hints & text_hinting ? true : false, false);
-    splashOutputDev.startDoc(pdfdoc);
-    pdfdoc->displayPageSlice(&splashOutputDev, pp->index + 1, xres, yres, int(rotate) * 90, false, true, false, x, y, w, h, nullptr, nullptr, nullptr, nullptr, true);
-
-    SplashBitmap *bitmap = splashOutputDev.getBitmap();
-    const int bw = bitmap->getWidth();
-    const int bh = bitmap->getHeight();
+ If the page ends before the area, the part of \p data past the page is left
+ untouched.
+
+ \param p the page to render
+ \param data the buffer to render into
+ \param width the width in pixels of the area to render
+ \param height the height in pixels of the area to render
+ \param bytes_per_row the distance in bytes between the starts of two rows
+                      in \p data
+ \param xres the X resolution, in dot per inch (DPI)
+ \param yres the Y resolution, in dot per inch (DPI)
+ \param x the X top-left coordinate of the area, in pixels
+ \param y the Y top-left coordinate of the area, in pixels
+ \param rotate the rotation to apply when rendering the page
+
+ \returns whether the rendering succeeded
+
+ \since 24.08
+ */
+bool page_renderer::render_page_into(const page *p, char *data, int width, int height, int bytes_per_row, double xres, double yres, int x, int y, rotation_enum rotate) const
+{
+    const int width_bytes = page_renderer_private::row_bytes(d->image_format, width);
+    if (!data || width <= 0 || height <= 0 || width_bytes <= 0 || bytes_per_row < width_bytes) {
+        return false;
+    }
 
-    SplashColorPtr data_ptr = bitmap->getDataPtr();
+    std::unique_ptr<SplashBitmap> bitmap(d->render(p, xres, yres, x, y, width, height, rotate));
+    if (!bitmap || !bitmap->getDataPtr()) {
+        return false;
+    }
 
-    const image img(reinterpret_cast<char *>(data_ptr), bw, bh, d->image_format);
-    return img.copy();
+    const SplashColorPtr src = bitmap->getDataPtr();
+    const int src_bytes = std::min(width_bytes, page_renderer_private::row_bytes(d->image_format, bitmap->getWidth()));
+    const int rows = std::min(height, bitmap->getHeight());
+    for (int row = 0; row < rows; ++row) {
+        std::memcpy(data + (size_t)row * bytes_per_row, src + (size_t)row * bitmap->getRowSize(), src_bytes);
+    }
+    return true;
 }
 
 /**
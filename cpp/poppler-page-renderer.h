@@ -64,6 +64,7 @@ public:
     void set_line_mode(line_mode_enum mode);
 
     image render_page(const page *p, double xres = 72.0, double yres = 72.0, int x = -1, int y = -1, int w = -1, int h = -1, rotation_enum rotate = rotate_0) const;
+    bool render_page_into(const page *p, char *data, int width, int height, int bytes_per_row, double xres = 72.0, double yres = 72.0, int x = 0, int y = 0, rotation_enum rotate = rotate_0) const;
 
     static bool can_render();
 
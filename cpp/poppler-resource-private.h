@@ -0,0 +1,59 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef POPPLER_RESOURCE_PRIVATE_H
+#define POPPLER_RESOURCE_PRIVATE_H
+
+#include "poppler-resource.h"
+
+#include "ResourceInfo.h"
+
+namespace poppler {
+
+class resource_info_private
+{
+public:
+    resource_info_private() : kind(resource_info::font), is_embedded(false), width(0), height(0), bpc(0) { }
+    explicit resource_info_private(const ResourceInfo &ri)
+        : kind((resource_info::kind_enum)ri.getKind()),
+          name(ri.getName()),
+          type(ri.getType()),
+          font_name(ri.getFontName()),
+          is_embedded(ri.getEmbedded()),
+          width(ri.getWidth()),
+          height(ri.getHeight()),
+          bpc(ri.getBitsPerComponent())
+    {
+        // page indexes are 0-based in the cpp API
+        for (int page : ri.getPages()) {
+            pages.push_back(page - 1);
+        }
+    }
+
+    resource_info::kind_enum kind;
+    std::string name;
+    std::string type;
+    std::string font_name;
+    bool is_embedded;
+    int width;
+    int height;
+    int bpc;
+    std::vector<int> pages;
+};
+
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/**
+ \file poppler-resource.h
+ */
+#include "poppler-resource.h"
+
+#include "poppler-resource-private.h"
+
+using namespace poppler;
+
+/**
+ \class poppler::resource_info poppler-resource.h "poppler/cpp/poppler-resource.h"
+
+ A font, image, color space or shading in the resources of a PDF
+ %document, together with the pages using it.
+
+ \see document::resources
+ \since 24.08
+ */
+
+/**
+ \enum poppler::resource_info::kind_enum
+
+ The kind of a resource.
+*/
+
+resource_info::resource_info() : d(new resource_info_private()) { }
+
+resource_info::resource_info(resource_info_private &dd) : d(&dd) { }
+
+/**
+ Copy constructor.
+ */
+resource_info::resource_info(const resource_info &ri) : d(new resource_info_private(*ri.d)) { }
+
+/**
+ Destructor.
+ */
+resource_info::~resource_info()
+{
+    delete d;
+}
+
+/**
+ \returns the kind of the resource
+ */
+resource_info::kind_enum resource_info::kind() const
+{
+    return d->kind;
+}
+
+/**
+ \returns the name the resource was first found under in a resource
+          dictionary, e.g. "F1"
+ */
+std::string resource_info::name() const
+{
+    return d->name;
+}
+
+/**
+ \returns for fonts, the font subtype (of the descendant font for Type 0
+          fonts); for images and color spaces, the color space family
+          ("ImageMask" for stencil masks); for shadings, the shading type,
+          e.g. "axial"
+ */
+std::string resource_info::type() const
+{
+    return d->type;
+}
+
+/**
+ \returns the base name of a font, empty for other resources
+ */
+std::string resource_info::font_name() const
+{
+    return d->font_name;
+}
+
+/**
+ \returns whether a font is embedded in the %document
+ */
+bool resource_info::is_embedded() const
+{
+    return d->is_embedded;
+}
+
+/**
+ \returns the width of an image, 0 for other resources
+ */
+int resource_info::width() const
+{
+    return d->width;
+}
+
+/**
+ \returns the height of an image, 0 for other resources
+ */
+int resource_info::height() const
+{
+    return d->height;
+}
+
+/**
+ \returns the number of bits per component of an image, 0 for other
+          resources
+ */
+int resource_info::bits_per_component() const
+{
+    return d->bpc;
+}
+
+/**
+ \returns the indexes of the pages using the resource, in increasing order
+ */
+std::vector<int> resource_info::pages() const
+{
+    return d->pages;
+}
+
+/**
+ Assignment operator.
+ */
+resource_info &resource_info::operator=(const resource_info &ri)
+{
+    if (this != &ri) {
+        *d = *ri.d;
+    }
+    return *this;
+}
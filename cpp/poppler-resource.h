@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef POPPLER_RESOURCE_H
+#define POPPLER_RESOURCE_H
+
+#include "poppler-global.h"
+
+#include <vector>
+
+namespace poppler {
+
+class resource_info_private;
+
+class POPPLER_CPP_EXPORT resource_info
+{
+public:
+    enum kind_enum
+    {
+        font,
+        image,
+        color_space,
+        shading
+    };
+
+    resource_info();
+    resource_info(const resource_info &ri);
+    ~resource_info();
+
+    kind_enum kind() const;
+    std::string name() const;
+    std::string type() const;
+    std::string font_name() const;
+    bool is_embedded() const;
+    int width() const;
+    int height() const;
+    int bits_per_component() const;
+    std::vector<int> pages() const;
+
+    resource_info &operator=(const resource_info &ri);
+
+private:
+    explicit resource_info(resource_info_private &dd);
+
+    resource_info_private *d;
+    friend class document;
+};
+
+}
+
+#endif
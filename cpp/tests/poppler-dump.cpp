@@ -53,6 +53,7 @@ bool show_perm = false;
 bool show_metadata = false;
 bool show_toc = false;
 bool show_fonts = false;
+bool show_resources = false;
 bool show_embedded_files = false;
 bool show_pages = false;
 bool show_destinations = false;
@@ -69,6 +70,7 @@ static const ArgDesc the_args[] = { { "--show-all", argFlag, &show_all, 0, "show
                                     { "--show-metadata", argFlag, &show_metadata, 0, "show document metadata" },
                                     { "--show-toc", argFlag, &show_toc, 0, "show the TOC" },
                                     { "--show-fonts", argFlag, &show_fonts, 0, "show the document fonts" },
+                                    { "--show-resources", argFlag, &show_resources, 0, "show the document fonts, images, color spaces and shadings" },
                                     { "--show-embedded-files", argFlag, &show_embedded_files, 0, "show the document-level embedded files" },
                                     { "--show-pages", argFlag, &show_pages, 0, "show pages information" },
                                     { "--show-destinations", argFlag, &show_destinations, 0, "show named destinations" },
@@ -270,6 +272,42 @@ static void print_fonts(poppler::document *doc)
     std::cout << std::endl;
 }
 
+static std::string out_resource_kind(poppler::resource_info::kind_enum kind)
+{
+    switch (kind) {
+    case poppler::resource_info::font:
+        return "font";
+    case poppler::resource_info::image:
+        return "image";
+    case poppler::resource_info::color_space:
+        return "color space";
+    case poppler::resource_info::shading:
+        return "shading";
+    }
+    return "<unknown resource kind>";
+}
+
+static void print_resources(poppler::document *doc)
+{
+    std::cout << "Document resources:" << std::endl;
+    const std::vector<poppler::resource_info> rl = doc->resources();
+    if (!rl.empty()) {
+        const std::ios_base::fmtflags f = std::cout.flags();
+        std::left(std::cout);
+        for (const poppler::resource_info &ri : rl) {
+            std::cout << " " << std::setw(11) << out_resource_kind(ri.kind()) << " " << std::setw(out_width + 10) << (ri.font_name().empty() ? ri.name() : ri.font_name()) << " " << std::setw(15) << ri.type() << " pages:";
+            for (int page : ri.pages()) {
+                std::cout << " " << page;
+            }
+            std::cout << std::endl;
+        }
+        std::cout.flags(f);
+    } else {
+        std::cout << "<no resources>" << std::endl;
+    }
+    std::cout << std::endl;
+}
+
 static void print_embedded_files(poppler::document *doc)
 {
     std::cout << "Document embedded files:" << std::endl;
@@ -493,6 +531,9 @@ int main(int argc, char *argv[])
     if (show_fonts) {
         print_fonts(doc.get());
     }
+    if (show_resources) {
+        print_resources(doc.get());
+    }
     if (show_embedded_files) {
         print_embedded_files(doc.get());
     }
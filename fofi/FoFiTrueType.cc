@@ -659,6 +659,21 @@ bool FoFiTrueType::getCFFBlock(char **start, int *length) const
     return true;
 }
 
+void FoFiTrueType::setGlyphSubset(const std::set<int> &gids)
+{
+    glyphSubset.clear();
+    if (gids.empty()) {
+        return;
+    }
+    glyphSubset.resize(nGlyphs + 1, false);
+    glyphSubset[0] = true;
+    for (int gid : gids) {
+        if (gid >= 0 && gid < nGlyphs) {
+            glyphSubset[gid] = true;
+        }
+    }
+}
+
 int *FoFiTrueType::getCIDToGIDMap(int *nCIDs) const
 {
     char *start;
@@ -1166,8 +1181,57 @@ void FoFiTrueType::cvtSfnts(FoFiOutputFunc outputFunc, void *outputStream, const
     }
     locaTable[nGlyphs].len = 0;
     std::sort(locaTable.begin(), locaTable.end(), cmpTrueTypeLocaIdxFunctor());
+
+    // with a glyph subset, add the components of the composite glyphs
+    // in it (components can be composite themselves, hence the stack)
+    std::vector<bool> keep = glyphSubset;
+    if (!keep.empty()) {
+        glyfPos = tables[seekTable("glyf")].offset;
+        std::vector<int> todo;
+        for (i = 0; i < nGlyphs; ++i) {
+            if (keep[i]) {
+                todo.push_back(i);
+            }
+        }
+        while (!todo.empty()) {
+            const int gid = todo.back();
+            todo.pop_back();
+            pos = glyfPos + locaTable[gid].origOffset;
+            const int end = pos + locaTable[gid].len;
+            bool glyphOk = true;
+            if (locaTable[gid].len < 10 || getS16BE(pos, &glyphOk) >= 0) {
+                continue;
+            }
+            pos += 10;
+            int flags = 0x0020;
+            while ((flags & 0x0020) && pos + 4 <= end && glyphOk) {
+                flags = getU16BE(pos, &glyphOk);
+                const int component = getU16BE(pos + 2, &glyphOk);
+                if (glyphOk && component < nGlyphs && !keep[component]) {
+                    keep[component] = true;
+                    todo.push_back(component);
+                }
+                pos += 4 + ((flags & 0x0001) ? 4 : 2);
+                if (flags & 0x0008) {
+                    pos += 2;
+                } else if (flags & 0x0040) {
+                    pos += 4;
+                } else if (flags & 0x0080) {
+                    pos += 8;
+                }
+            }
+        }
+    }
+
     pos = 0;
     for (i = 0; i <= nGlyphs; ++i) {
+        if (locaTable[i].len > 0) {
+            *maxUsedGlyph = i;
+            // glyphs outside the subset keep their number, but no outline
+            if (!keep.empty() && !keep[i]) {
+                locaTable[i].len = 0;
+            }
+        }
         locaTable[i].newOffset = pos;
 
         int newPos;
@@ -1179,9 +1243,6 @@ void FoFiTrueType::cvtSfnts(FoFiOutputFunc outputFunc, void *outputStream, const
                 pos += 4 - (pos & 3);
             }
         }
-        if (locaTable[i].len > 0) {
-            *maxUsedGlyph = i;
-        }
     }
 
     // construct the new 'loca' table
@@ -32,6 +32,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <set>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -152,6 +153,13 @@ public:
     // Otherwise returns false.  (Only useful for OpenType CFF fonts).
     bool getCFFBlock(char **start, int *length) const;
 
+    // Only write the outlines of the glyphs in <gids> (and of .notdef
+    // and the components of composite glyphs) when converting to Type
+    // 42, CID Type 2 or TrueType based Type 0 fonts.  The other glyphs
+    // are left empty, so glyph numbers don't change.  An empty set
+    // writes all glyphs again.  (Not useful for OpenType CFF fonts.)
+    void setGlyphSubset(const std::set<int> &gids);
+
     // setup vert/vrt2 GSUB for default lang
     int setupGSUB(const char *scriptName);
 
@@ -181,6 +189,7 @@ private:
     int bbox[4];
     std::unordered_map<std::string, int> nameToGID;
     bool openTypeCFF;
+    std::vector<bool> glyphSubset; // glyphs to write, empty for all of them
 
     bool parsedOk;
     int faceIndex;
@@ -30,6 +30,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <map>
+#include <string>
 #include "goo/gmem.h"
 #include "goo/gstrtod.h"
 #include "goo/GooLikely.h"
@@ -81,6 +84,7 @@ FoFiType1C::FoFiType1C(const unsigned char *fileA, int lenA, bool freeFileDataA)
     fdSelect = nullptr;
     charset = nullptr;
     charsetLength = 0;
+    seacChars[0] = seacChars[1] = -1;
 }
 
 FoFiType1C::~FoFiType1C()
@@ -410,10 +414,47 @@ void FoFiType1C::convertToType1(const char *psName, const char **newEncoding, bo
         subrIdx.pos = -1;
     }
 
+    // with a subset, also keep the base and accent glyphs of the
+    // accented characters, which Type 1 seac finds by name
+    std::vector<bool> keep = glyphSubset;
+    if (!keep.empty()) {
+        std::map<std::string, int> nameToGID;
+        for (i = 0; i < nGlyphs && i < charsetLength; ++i) {
+            ok = true;
+            getString(charset[i], buf2, &ok);
+            if (ok) {
+                nameToGID.emplace(buf2, i);
+            }
+        }
+        for (i = 0; i < nGlyphs; ++i) {
+            ok = true;
+            getIndexVal(&charStringsIdx, i, &val, &ok);
+            if (!keep[i] || !ok) {
+                continue;
+            }
+            GooString charBuf;
+            std::set<int> offsetBeingParsed;
+            seacChars[0] = seacChars[1] = -1;
+            cvtGlyph(val.pos, val.len, &charBuf, &subrIdx, &privateDicts[0], true, offsetBeingParsed);
+            for (const int code : seacChars) {
+                if (code >= 0 && code < 256 && fofiType1StandardEncoding[code]) {
+                    const auto it = nameToGID.find(fofiType1StandardEncoding[code]);
+                    if (it != nameToGID.end()) {
+                        keep[it->second] = true;
+                    }
+                }
+            }
+        }
+    }
+
     // write the CharStrings
-    buf = GooString::format("2 index /CharStrings {0:d} dict dup begin\n", nGlyphs);
+    const int nKept = keep.empty() ? nGlyphs : std::count(keep.begin(), keep.end(), true);
+    buf = GooString::format("2 index /CharStrings {0:d} dict dup begin\n", nKept);
     eexecWrite(&eb, buf.c_str());
     for (i = 0; i < nGlyphs; ++i) {
+        if (!keep.empty() && !keep[i]) {
+            continue;
+        }
         ok = true;
         getIndexVal(&charStringsIdx, i, &val, &ok);
         if (ok && i < charsetLength) {
@@ -440,6 +481,23 @@ void FoFiType1C::convertToType1(const char *psName, const char **newEncoding, bo
     (*outputFunc)(outputStream, "cleartomark\n", 12);
 }
 
+void FoFiType1C::setGlyphSubset(const std::set<int> &gids)
+{
+    glyphSubset.clear();
+    if (gids.empty()) {
+        return;
+    }
+    glyphSubset.resize(nGlyphs, false);
+    if (nGlyphs > 0) {
+        glyphSubset[0] = true;
+    }
+    for (int gid : gids) {
+        if (gid >= 0 && gid < nGlyphs) {
+            glyphSubset[gid] = true;
+        }
+    }
+}
+
 void FoFiType1C::convertToCIDType0(const char *psName, const int *codeMap, int nCodes, FoFiOutputFunc outputFunc, void *outputStream)
 {
     int *cidMap;
@@ -1222,6 +1280,8 @@ void FoFiType1C::cvtGlyph(int offset, int nBytes, GooString *charBuf, const Type
                     openPath = false;
                 }
                 if (nOps == 4) {
+                    seacChars[0] = (int)ops[2].num;
+                    seacChars[1] = (int)ops[3].num;
                     cvtNum(0, false, charBuf);
                     cvtNum(ops[0].num, ops[0].isFP, charBuf);
                     cvtNum(ops[1].num, ops[1].isFP, charBuf);
@@ -31,6 +31,7 @@
 #include "poppler_private_export.h"
 
 #include <set>
+#include <vector>
 
 class GooString;
 
@@ -188,6 +189,13 @@ public:
     // it will be used as the PostScript font name.
     void convertToType1(const char *psName, const char **newEncoding, bool ascii, FoFiOutputFunc outputFunc, void *outputStream);
 
+    // Only write the charstrings of the glyphs in <gids> (and of
+    // .notdef and the base and accent glyphs of accented characters)
+    // when converting to Type 1.  The other glyphs are left out of the
+    // CharStrings dictionary.  An empty set writes all glyphs again.
+    // This is only useful with 8-bit fonts.
+    void setGlyphSubset(const std::set<int> &gids);
+
     // Convert to a Type 0 CIDFont, suitable for embedding in a
     // PostScript file.  <psName> will be used as the PostScript font
     // name.  There are three cases for the CID-to-GID mapping:
@@ -258,6 +266,9 @@ private:
     int nHints; // number of hints for the current glyph
     bool firstOp; // true if we haven't hit the first op yet
     bool openPath; // true if there is an unclosed path
+    int seacChars[2]; // standard codes of the base and accent of the last seac
+
+    std::vector<bool> glyphSubset; // glyphs to write, empty for all of them
 };
 
 #endif
@@ -365,6 +365,31 @@ static inline gboolean stream_is_memory_buffer_or_local_file(GInputStream *strea
  * Since: 0.22
  */
 PopplerDocument *poppler_document_new_from_stream(GInputStream *stream, goffset length, const char *password, GCancellable *cancellable, GError **error)
+{
+    return poppler_document_new_from_stream_full(stream, length, password, 0, cancellable, error);
+}
+
+/**
+ * poppler_document_new_from_stream_full:
+ * @stream: a #GInputStream to read from
+ * @length: the stream length, or -1 if not known
+ * @password: (allow-none): password to unlock the file with, or %NULL
+ * @cache_size: the maximum number of bytes of @stream to keep in memory, or 0 for no limit
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Like poppler_document_new_from_stream(), but bounds the memory used to
+ * cache the contents of @stream, for streams that are not in memory or in
+ * a local file. Data that is dropped from the cache is read from @stream
+ * again when it is needed, or, if it can't be (for instance when @length
+ * is -1 and the whole stream has to be read to find it), kept in a
+ * temporary file.
+ *
+ * Returns: (transfer full): a new #PopplerDocument, or %NULL
+ *
+ * Since: 24.08.0
+ */
+PopplerDocument *poppler_document_new_from_stream_full(GInputStream *stream, goffset length, const char *password, gsize cache_size, GCancellable *cancellable, GError **error)
 {
     PDFDoc *newDoc;
     BaseStream *str;
@@ -389,7 +414,7 @@ PopplerDocument *poppler_document_new_from_stream(GInputStream *stream, goffset
         }
         str = new PopplerInputStream(stream, cancellable, 0, false, length, Object(objNull));
     } else {
-        CachedFile *cachedFile = new CachedFile(new PopplerCachedFileLoader(stream, cancellable, length));
+        CachedFile *cachedFile = new CachedFile(new PopplerCachedFileLoader(stream, cancellable, length), cache_size, cache_size > 0);
         str = new CachedFileStream(cachedFile, 0, false, cachedFile->getLength(), Object(objNull));
     }
 
@@ -301,6 +301,8 @@ PopplerDocument *poppler_document_new_from_bytes(GBytes *bytes, const char *pass
 POPPLER_PUBLIC
 PopplerDocument *poppler_document_new_from_stream(GInputStream *stream, goffset length, const char *password, GCancellable *cancellable, GError **error);
 POPPLER_PUBLIC
+PopplerDocument *poppler_document_new_from_stream_full(GInputStream *stream, goffset length, const char *password, gsize cache_size, GCancellable *cancellable, GError **error);
+POPPLER_PUBLIC
 PopplerDocument *poppler_document_new_from_gfile(GFile *file, const char *password, GCancellable *cancellable, GError **error);
 #ifndef G_OS_WIN32
 POPPLER_PUBLIC
@@ -2462,6 +2462,47 @@ static gboolean word_text_attributes_equal(const TextWord *a, gint ai, const Tex
     return (ar == br && ag == bg && ab == bb);
 }
 
+/**
+ * poppler_page_get_word_at_point:
+ * @page: A #PopplerPage
+ * @x: x coordinate of the point, in points
+ * @y: y coordinate of the point, in points
+ * @area: (out) (optional): return location for the bounding box of the word
+ *
+ * Hit-tests the text of @page at the given point, using the same
+ * coordinate space as poppler_page_get_text_layout(). The text of
+ * the page is extracted and indexed once, so repeated calls are cheap.
+ *
+ * Return value: (transfer full) (nullable): a newly allocated string with
+ *   the word under the point, or %NULL if there is no text there.
+ *   Free with g_free().
+ *
+ * Since: 24.08.0
+ **/
+char *poppler_page_get_word_at_point(PopplerPage *page, gdouble x, gdouble y, PopplerRectangle *area)
+{
+    TextPage *text;
+    TextWord *word;
+
+    g_return_val_if_fail(POPPLER_IS_PAGE(page), NULL);
+
+    text = poppler_page_get_text_page(page);
+    word = text->findWordAt(x, y);
+    if (!word) {
+        return nullptr;
+    }
+
+    if (area) {
+        word->getBBox(&area->x1, &area->y1, &area->x2, &area->y2);
+    }
+
+    GooString *word_text = word->getText();
+    char *result = g_strdup(word_text->c_str());
+    delete word_text;
+
+    return result;
+}
+
 /**
  * poppler_page_get_text_attributes:
  * @page: A #PopplerPage
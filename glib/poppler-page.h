@@ -106,6 +106,8 @@ gboolean poppler_page_get_text_layout(PopplerPage *page, PopplerRectangle **rect
 POPPLER_PUBLIC
 gboolean poppler_page_get_text_layout_for_area(PopplerPage *page, PopplerRectangle *area, PopplerRectangle **rectangles, guint *n_rectangles);
 POPPLER_PUBLIC
+char *poppler_page_get_word_at_point(PopplerPage *page, gdouble x, gdouble y, PopplerRectangle *area);
+POPPLER_PUBLIC
 GList *poppler_page_get_text_attributes(PopplerPage *page);
 POPPLER_PUBLIC
 void poppler_page_free_text_attributes(GList *list);
@@ -0,0 +1,535 @@
+/* poppler-tile-renderer.cc: glib interface to poppler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+#include <cmath>
+#include <list>
+#include <map>
+#include <tuple>
+
+#include "poppler-tile-renderer.h"
+#include "poppler-private.h"
+
+/**
+ * SECTION:poppler-tile-renderer
+ * @short_description: Rendering pages as grids of tiles
+ * @title: PopplerTileRenderer
+ *
+ * A #PopplerTileRenderer renders the pages of a #PopplerDocument as grids
+ * of square tiles, so that a viewer only has to render the tiles that are
+ * visible, for instance when zooming into a large page.
+ *
+ * At a given scale, a page of `width` x `height` points is
+ * `ceil (width * scale)` x `ceil (height * scale)` pixels, split into tiles
+ * of the tile size of the renderer starting at the top left corner;
+ * the tiles of the last column and row are cut at the edges of the page.
+ *
+ * Recently rendered tiles are kept in a cache, which is limited by the
+ * number of bytes of the tiles and drops the least recently used ones
+ * first. Tiles are rendered one at a time; in-flight tiles can be cancelled
+ * with a #GCancellable.
+ */
+
+typedef struct _PopplerTileRendererClass PopplerTileRendererClass;
+struct _PopplerTileRendererClass
+{
+    GObjectClass parent_class;
+};
+
+#define POPPLER_TILE_RENDERER_DEFAULT_CACHE_SIZE (64 << 20)
+
+struct PopplerTileKey
+{
+    int page;
+    double scale;
+    int column;
+    int row;
+
+    bool operator<(const PopplerTileKey &other) const { return std::tie(page, scale, column, row) < std::tie(other.page, other.scale, other.column, other.row); }
+};
+
+struct PopplerTile
+{
+    PopplerTileKey key;
+    cairo_surface_t *surface;
+    gsize size;
+};
+
+/* The rendered tiles, most recently used first */
+struct PopplerTileCache
+{
+    std::list<PopplerTile> tiles;
+    std::map<PopplerTileKey, std::list<PopplerTile>::iterator> index;
+    gsize size = POPPLER_TILE_RENDERER_DEFAULT_CACHE_SIZE;
+    gsize used = 0;
+};
+
+struct _PopplerTileRenderer
+{
+    /*< private >*/
+    GObject parent_instance;
+    PopplerDocument *document;
+    gint tile_size;
+
+    /* Only used with render_mutex locked */
+    CairoOutputDev *output_dev;
+    GMutex render_mutex;
+
+    PopplerTileCache *cache;
+    GMutex cache_mutex;
+};
+
+typedef struct
+{
+    PopplerPage *page;
+    double scale;
+    int column;
+    int row;
+} PopplerTileRequest;
+
+G_DEFINE_TYPE(PopplerTileRenderer, poppler_tile_renderer, G_TYPE_OBJECT)
+
+static void poppler_tile_renderer_finalize(GObject *object)
+{
+    PopplerTileRenderer *renderer = POPPLER_TILE_RENDERER(object);
+
+    poppler_tile_renderer_clear_cache(renderer);
+    delete renderer->cache;
+    renderer->cache = nullptr;
+
+    delete renderer->output_dev;
+    renderer->output_dev = nullptr;
+
+    if (renderer->document) {
+        g_object_unref(renderer->document);
+        renderer->document = nullptr;
+    }
+
+    g_mutex_clear(&renderer->render_mutex);
+    g_mutex_clear(&renderer->cache_mutex);
+
+    G_OBJECT_CLASS(poppler_tile_renderer_parent_class)->finalize(object);
+}
+
+static void poppler_tile_renderer_init(PopplerTileRenderer *renderer)
+{
+    renderer->cache = new PopplerTileCache;
+    g_mutex_init(&renderer->render_mutex);
+    g_mutex_init(&renderer->cache_mutex);
+}
+
+static void poppler_tile_renderer_class_init(PopplerTileRendererClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->finalize = poppler_tile_renderer_finalize;
+}
+
+/**
+ * poppler_tile_renderer_new:
+ * @document: a #PopplerDocument
+ * @tile_size: the width and height of the tiles, in pixels
+ *
+ * Creates a new #PopplerTileRenderer rendering the pages of @document as
+ * tiles of @tile_size x @tile_size pixels.
+ *
+ * Returns: (transfer full): a new #PopplerTileRenderer, use g_object_unref() to free it
+ *
+ * Since: 24.08.0
+ **/
+PopplerTileRenderer *poppler_tile_renderer_new(PopplerDocument *document, gint tile_size)
+{
+    PopplerTileRenderer *renderer;
+
+    g_return_val_if_fail(POPPLER_IS_DOCUMENT(document), NULL);
+    g_return_val_if_fail(tile_size > 0, NULL);
+
+    renderer = POPPLER_TILE_RENDERER(g_object_new(POPPLER_TYPE_TILE_RENDERER, nullptr));
+    renderer->document = (PopplerDocument *)g_object_ref(document);
+    renderer->tile_size = tile_size;
+    /* A device of its own, so that tiles can be rendered in a thread while
+     * the document renders pages in another one */
+    renderer->output_dev = new CairoOutputDev();
+    renderer->output_dev->startDoc(document->doc);
+
+    return renderer;
+}
+
+/**
+ * poppler_tile_renderer_get_tile_size:
+ * @renderer: a #PopplerTileRenderer
+ *
+ * Returns: the width and height of the tiles rendered by @renderer, in pixels
+ *
+ * Since: 24.08.0
+ **/
+gint poppler_tile_renderer_get_tile_size(PopplerTileRenderer *renderer)
+{
+    g_return_val_if_fail(POPPLER_IS_TILE_RENDERER(renderer), 0);
+
+    return renderer->tile_size;
+}
+
+static void _poppler_tile_cache_trim(PopplerTileCache *cache, gsize size)
+{
+    while (cache->used > size) {
+        PopplerTile &tile = cache->tiles.back();
+        cache->used -= tile.size;
+        cairo_surface_destroy(tile.surface);
+        cache->index.erase(tile.key);
+        cache->tiles.pop_back();
+    }
+}
+
+/**
+ * poppler_tile_renderer_set_cache_size:
+ * @renderer: a #PopplerTileRenderer
+ * @cache_size: the maximum size of the cached tiles, in bytes
+ *
+ * Sets how many bytes of rendered tiles @renderer keeps, dropping the least
+ * recently used tiles if the cache is larger. A @cache_size of 0 disables
+ * the cache. The default is 64 MiB.
+ *
+ * Since: 24.08.0
+ **/
+void poppler_tile_renderer_set_cache_size(PopplerTileRenderer *renderer, gsize cache_size)
+{
+    g_return_if_fail(POPPLER_IS_TILE_RENDERER(renderer));
+
+    g_mutex_lock(&renderer->cache_mutex);
+    renderer->cache->size = cache_size;
+    _poppler_tile_cache_trim(renderer->cache, cache_size);
+    g_mutex_unlock(&renderer->cache_mutex);
+}
+
+/**
+ * poppler_tile_renderer_get_cache_size:
+ * @renderer: a #PopplerTileRenderer
+ *
+ * Returns: the maximum size of the tiles cached by @renderer, in bytes
+ *
+ * Since: 24.08.0
+ **/
+gsize poppler_tile_renderer_get_cache_size(PopplerTileRenderer *renderer)
+{
+    gsize cache_size;
+
+    g_return_val_if_fail(POPPLER_IS_TILE_RENDERER(renderer), 0);
+
+    g_mutex_lock(&renderer->cache_mutex);
+    cache_size = renderer->cache->size;
+    g_mutex_unlock(&renderer->cache_mutex);
+
+    return cache_size;
+}
+
+/**
+ * poppler_tile_renderer_clear_cache:
+ * @renderer: a #PopplerTileRenderer
+ *
+ * Drops all the tiles cached by @renderer, for instance after the document
+ * was modified.
+ *
+ * Since: 24.08.0
+ **/
+void poppler_tile_renderer_clear_cache(PopplerTileRenderer *renderer)
+{
+    g_return_if_fail(POPPLER_IS_TILE_RENDERER(renderer));
+
+    g_mutex_lock(&renderer->cache_mutex);
+    _poppler_tile_cache_trim(renderer->cache, 0);
+    g_mutex_unlock(&renderer->cache_mutex);
+}
+
+static void _poppler_tile_renderer_get_page_size(PopplerPage *page, double scale, int *width, int *height)
+{
+    double page_width, page_height;
+
+    poppler_page_get_size(page, &page_width, &page_height);
+    *width = (int)ceil(page_width * scale);
+    *height = (int)ceil(page_height * scale);
+}
+
+/**
+ * poppler_tile_renderer_get_grid_size:
+ * @renderer: a #PopplerTileRenderer
+ * @page: a #PopplerPage of the document of @renderer
+ * @scale: the scale the page is rendered at; 1.0 is 72 pixels per inch
+ * @n_columns: (out) (allow-none): return location for the number of columns of tiles
+ * @n_rows: (out) (allow-none): return location for the number of rows of tiles
+ *
+ * Gets the number of tiles covering @page at @scale.
+ *
+ * Since: 24.08.0
+ **/
+void poppler_tile_renderer_get_grid_size(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint *n_columns, gint *n_rows)
+{
+    int width, height;
+
+    g_return_if_fail(POPPLER_IS_TILE_RENDERER(renderer));
+    g_return_if_fail(POPPLER_IS_PAGE(page));
+    g_return_if_fail(page->document == renderer->document);
+    g_return_if_fail(scale > 0);
+
+    _poppler_tile_renderer_get_page_size(page, scale, &width, &height);
+    if (n_columns != nullptr) {
+        *n_columns = (width + renderer->tile_size - 1) / renderer->tile_size;
+    }
+    if (n_rows != nullptr) {
+        *n_rows = (height + renderer->tile_size - 1) / renderer->tile_size;
+    }
+}
+
+static cairo_surface_t *_poppler_tile_renderer_lookup(PopplerTileRenderer *renderer, const PopplerTileKey &key)
+{
+    cairo_surface_t *surface = nullptr;
+
+    g_mutex_lock(&renderer->cache_mutex);
+    PopplerTileCache *cache = renderer->cache;
+    auto it = cache->index.find(key);
+    if (it != cache->index.end()) {
+        cache->tiles.splice(cache->tiles.begin(), cache->tiles, it->second);
+        surface = cairo_surface_reference(it->second->surface);
+    }
+    g_mutex_unlock(&renderer->cache_mutex);
+
+    return surface;
+}
+
+static void _poppler_tile_renderer_insert(PopplerTileRenderer *renderer, const PopplerTileKey &key, cairo_surface_t *surface)
+{
+    const gsize size = (gsize)cairo_image_surface_get_stride(surface) * cairo_image_surface_get_height(surface);
+
+    g_mutex_lock(&renderer->cache_mutex);
+    PopplerTileCache *cache = renderer->cache;
+    if (size <= cache->size && cache->index.find(key) == cache->index.end()) {
+        _poppler_tile_cache_trim(cache, cache->size - size);
+        cache->tiles.push_front({ key, cairo_surface_reference(surface), size });
+        cache->index[key] = cache->tiles.begin();
+        cache->used += size;
+    }
+    g_mutex_unlock(&renderer->cache_mutex);
+}
+
+/**
+ * poppler_tile_renderer_lookup_tile:
+ * @renderer: a #PopplerTileRenderer
+ * @page: a #PopplerPage of the document of @renderer
+ * @scale: the scale the page is rendered at; 1.0 is 72 pixels per inch
+ * @column: the column of the tile
+ * @row: the row of the tile
+ *
+ * Gets a tile from the cache of @renderer, without rendering it.
+ *
+ * Returns: (transfer full) (nullable): the tile, or %NULL if it is not cached.
+ * Use cairo_surface_destroy() to free it.
+ *
+ * Since: 24.08.0
+ **/
+cairo_surface_t *poppler_tile_renderer_lookup_tile(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row)
+{
+    g_return_val_if_fail(POPPLER_IS_TILE_RENDERER(renderer), NULL);
+    g_return_val_if_fail(POPPLER_IS_PAGE(page), NULL);
+    g_return_val_if_fail(page->document == renderer->document, NULL);
+
+    return _poppler_tile_renderer_lookup(renderer, { page->index, scale, column, row });
+}
+
+static bool poppler_tile_renderer_abort_cb(void *user_data)
+{
+    return g_cancellable_is_cancelled((GCancellable *)user_data);
+}
+
+static cairo_surface_t *_poppler_tile_renderer_render(PopplerTileRenderer *renderer, PopplerPage *page, double scale, int column, int row, GCancellable *cancellable, GError **error)
+{
+    const PopplerTileKey key = { page->index, scale, column, row };
+    cairo_surface_t *surface;
+    int page_width, page_height;
+    int x, y, width, height;
+
+    surface = _poppler_tile_renderer_lookup(renderer, key);
+    if (surface) {
+        return surface;
+    }
+
+    _poppler_tile_renderer_get_page_size(page, scale, &page_width, &page_height);
+    x = column * renderer->tile_size;
+    y = row * renderer->tile_size;
+    if (column < 0 || row < 0 || x >= page_width || y >= page_height) {
+        g_set_error(error, POPPLER_ERROR, POPPLER_ERROR_INVALID, "Tile %d,%d is not on the page", column, row);
+        return nullptr;
+    }
+    width = MIN(renderer->tile_size, page_width - x);
+    height = MIN(renderer->tile_size, page_height - y);
+
+    g_mutex_lock(&renderer->render_mutex);
+
+    /* The tile may have been rendered while waiting for the lock */
+    surface = _poppler_tile_renderer_lookup(renderer, key);
+    if (!surface && !g_cancellable_set_error_if_cancelled(cancellable, error)) {
+        cairo_t *cairo;
+
+        surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        cairo = cairo_create(surface);
+        renderer->output_dev->setCairo(cairo);
+        renderer->output_dev->setPrinting(false);
+        renderer->document->doc->displayPageSlice(renderer->output_dev, page->index + 1, 72.0 * scale, 72.0 * scale, 0, false, /* useMediaBox */
+                                                  true, /* Crop */
+                                                  false, x, y, width, height, cancellable ? poppler_tile_renderer_abort_cb : nullptr, cancellable, nullptr, nullptr,
+                                                  true /* copyXRef: the document may be read by another thread meanwhile */);
+        renderer->output_dev->setCairo(nullptr);
+        cairo_destroy(cairo);
+        cairo_surface_flush(surface);
+
+        if (g_cancellable_set_error_if_cancelled(cancellable, error)) {
+            /* Partially rendered, not cached */
+            cairo_surface_destroy(surface);
+            surface = nullptr;
+        } else {
+            _poppler_tile_renderer_insert(renderer, key, surface);
+        }
+    }
+
+    g_mutex_unlock(&renderer->render_mutex);
+
+    return surface;
+}
+
+/**
+ * poppler_tile_renderer_render_tile:
+ * @renderer: a #PopplerTileRenderer
+ * @page: a #PopplerPage of the document of @renderer
+ * @scale: the scale the page is rendered at; 1.0 is 72 pixels per inch
+ * @column: the column of the tile
+ * @row: the row of the tile
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Gets the tile of @page at @column, @row and @scale from the cache of
+ * @renderer, or renders it. The tile is an image surface of format
+ * %CAIRO_FORMAT_ARGB32, transparent where nothing is drawn, as with
+ * poppler_page_render(); it is smaller than the tile size in the last
+ * column and row.
+ *
+ * If @cancellable is cancelled, possibly from another thread while the
+ * tile is being rendered, %NULL is returned with a %G_IO_ERROR_CANCELLED
+ * error, and the tile is not cached.
+ *
+ * Returns: (transfer full) (nullable): the tile, or %NULL with @error set.
+ * Use cairo_surface_destroy() to free it.
+ *
+ * Since: 24.08.0
+ **/
+cairo_surface_t *poppler_tile_renderer_render_tile(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row, GCancellable *cancellable, GError **error)
+{
+    g_return_val_if_fail(POPPLER_IS_TILE_RENDERER(renderer), NULL);
+    g_return_val_if_fail(POPPLER_IS_PAGE(page), NULL);
+    g_return_val_if_fail(page->document == renderer->document, NULL);
+    g_return_val_if_fail(scale > 0, NULL);
+    g_return_val_if_fail(cancellable == nullptr || G_IS_CANCELLABLE(cancellable), NULL);
+
+    return _poppler_tile_renderer_render(renderer, page, scale, column, row, cancellable, error);
+}
+
+static void poppler_tile_request_free(PopplerTileRequest *request)
+{
+    g_object_unref(request->page);
+    g_free(request);
+}
+
+static void _poppler_tile_renderer_render_thread(GTask *task, PopplerTileRenderer *renderer, PopplerTileRequest *request, GCancellable *cancellable)
+{
+    cairo_surface_t *surface;
+    GError *error = nullptr;
+
+    surface = _poppler_tile_renderer_render(renderer, request->page, request->scale, request->column, request->row, cancellable, &error);
+    if (surface) {
+        g_task_return_pointer(task, surface, (GDestroyNotify)cairo_surface_destroy);
+    } else {
+        g_task_return_error(task, error);
+    }
+}
+
+/**
+ * poppler_tile_renderer_render_tile_async:
+ * @renderer: a #PopplerTileRenderer
+ * @page: a #PopplerPage of the document of @renderer
+ * @scale: the scale the page is rendered at; 1.0 is 72 pixels per inch
+ * @column: the column of the tile
+ * @row: the row of the tile
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: a #GAsyncReadyCallback to call when the tile is ready
+ * @user_data: user data used by callback function
+ *
+ * Asynchronous version of poppler_tile_renderer_render_tile(): the tile is
+ * rendered in a thread, unless it is cached. Cancelling @cancellable stops
+ * rendering the tile. Finish with poppler_tile_renderer_render_tile_finish().
+ *
+ * Since: 24.08.0
+ **/
+void poppler_tile_renderer_render_tile_async(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data)
+{
+    PopplerTileRequest *request;
+    cairo_surface_t *surface;
+    GTask *task;
+
+    g_return_if_fail(POPPLER_IS_TILE_RENDERER(renderer));
+    g_return_if_fail(POPPLER_IS_PAGE(page));
+    g_return_if_fail(page->document == renderer->document);
+    g_return_if_fail(scale > 0);
+    g_return_if_fail(cancellable == nullptr || G_IS_CANCELLABLE(cancellable));
+
+    task = g_task_new(renderer, cancellable, callback, user_data);
+    g_task_set_source_tag(task, poppler_tile_renderer_render_tile_async);
+
+    surface = _poppler_tile_renderer_lookup(renderer, { page->index, scale, column, row });
+    if (surface) {
+        g_task_return_pointer(task, surface, (GDestroyNotify)cairo_surface_destroy);
+        g_object_unref(task);
+        return;
+    }
+
+    request = g_new(PopplerTileRequest, 1);
+    request->page = (PopplerPage *)g_object_ref(page);
+    request->scale = scale;
+    request->column = column;
+    request->row = row;
+    g_task_set_task_data(task, request, (GDestroyNotify)poppler_tile_request_free);
+
+    g_task_run_in_thread(task, (GTaskThreadFunc)_poppler_tile_renderer_render_thread);
+    g_object_unref(task);
+}
+
+/**
+ * poppler_tile_renderer_render_tile_finish:
+ * @renderer: a #PopplerTileRenderer
+ * @result: a #GAsyncResult
+ * @error: (allow-none): Return location for an error, or %NULL
+ *
+ * Finishes poppler_tile_renderer_render_tile_async().
+ *
+ * Returns: (transfer full) (nullable): the tile, or %NULL with @error set.
+ * Use cairo_surface_destroy() to free it.
+ *
+ * Since: 24.08.0
+ **/
+cairo_surface_t *poppler_tile_renderer_render_tile_finish(PopplerTileRenderer *renderer, GAsyncResult *result, GError **error)
+{
+    g_return_val_if_fail(g_task_is_valid(result, renderer), NULL);
+
+    return (cairo_surface_t *)g_task_propagate_pointer(G_TASK(result), error);
+}
@@ -0,0 +1,58 @@
+/* poppler-tile-renderer.h: glib interface to poppler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __POPPLER_TILE_RENDERER_H__
+#define __POPPLER_TILE_RENDERER_H__
+
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <cairo.h>
+#include "poppler.h"
+
+G_BEGIN_DECLS
+
+#define POPPLER_TYPE_TILE_RENDERER (poppler_tile_renderer_get_type())
+#define POPPLER_TILE_RENDERER(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), POPPLER_TYPE_TILE_RENDERER, PopplerTileRenderer))
+#define POPPLER_IS_TILE_RENDERER(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj), POPPLER_TYPE_TILE_RENDERER))
+
+POPPLER_PUBLIC
+GType poppler_tile_renderer_get_type(void) G_GNUC_CONST;
+
+POPPLER_PUBLIC
+PopplerTileRenderer *poppler_tile_renderer_new(PopplerDocument *document, gint tile_size);
+POPPLER_PUBLIC
+gint poppler_tile_renderer_get_tile_size(PopplerTileRenderer *renderer);
+POPPLER_PUBLIC
+void poppler_tile_renderer_set_cache_size(PopplerTileRenderer *renderer, gsize cache_size);
+POPPLER_PUBLIC
+gsize poppler_tile_renderer_get_cache_size(PopplerTileRenderer *renderer);
+POPPLER_PUBLIC
+void poppler_tile_renderer_clear_cache(PopplerTileRenderer *renderer);
+POPPLER_PUBLIC
+void poppler_tile_renderer_get_grid_size(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint *n_columns, gint *n_rows);
+POPPLER_PUBLIC
+cairo_surface_t *poppler_tile_renderer_lookup_tile(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row);
+POPPLER_PUBLIC
+cairo_surface_t *poppler_tile_renderer_render_tile(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row, GCancellable *cancellable, GError **error);
+POPPLER_PUBLIC
+void poppler_tile_renderer_render_tile_async(PopplerTileRenderer *renderer, PopplerPage *page, gdouble scale, gint column, gint row, GCancellable *cancellable, GAsyncReadyCallback callback, gpointer user_data);
+POPPLER_PUBLIC
+cairo_surface_t *poppler_tile_renderer_render_tile_finish(PopplerTileRenderer *renderer, GAsyncResult *result, GError **error);
+
+G_END_DECLS
+
+#endif /* __POPPLER_TILE_RENDERER_H__ */
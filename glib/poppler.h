@@ -223,6 +223,7 @@ typedef struct _PopplerSignatureInfo PopplerSignatureInfo;
 typedef struct _PopplerAnnotStamp PopplerAnnotStamp;
 typedef struct _PopplerCertificateInfo PopplerCertificateInfo;
 typedef struct _PopplerSigningData PopplerSigningData;
+typedef struct _PopplerTileRenderer PopplerTileRenderer;
 
 /**
  * PopplerBackend:
@@ -259,5 +260,6 @@ G_END_DECLS
 #include "poppler-movie.h"
 #include "poppler-media.h"
 #include "poppler-structure-element.h"
+#include "poppler-tile-renderer.h"
 
 #endif /* __POPPLER_GLIB_H__ */
@@ -86,6 +86,29 @@ int main(int argc, char *argv[])
     g_assert_cmpuint(n_glyph_areas, ==, n_utf8_chars);
     g_print("Test: OK ('layout glyph areas' match amount of 'utf8 characters')\n");
 
+    /* Every glyph area returned by poppler_page_get_text_layout() must hit
+     * a word whose area contains it */
+    g_print("Hit-test glyph areas with poppler_page_get_word_at_point()\n");
+    for (guint i = 0; i < n_glyph_areas; i++) {
+        PopplerRectangle word_area;
+        gdouble x = (areas[i].x1 + areas[i].x2) / 2;
+        gdouble y = (areas[i].y1 + areas[i].y2) / 2;
+        char *word;
+
+        if (g_unichar_isspace(g_utf8_get_char(g_utf8_offset_to_pointer(text, i)))) {
+            continue;
+        }
+        word = poppler_page_get_word_at_point(page, x, y, &word_area);
+        g_assert_nonnull(word);
+        g_assert_cmpfloat(word_area.x1, <=, x);
+        g_assert_cmpfloat(word_area.x2, >=, x);
+        g_assert_cmpfloat(word_area.y1, <=, y);
+        g_assert_cmpfloat(word_area.y2, >=, y);
+        g_free(word);
+    }
+    g_assert_null(poppler_page_get_word_at_point(page, -10, -10, NULL));
+    g_print("Test: OK (every glyph area hits a word)\n");
+
     /* Cleanup vars for next test */
     g_clear_object(&page);
     g_clear_object(&doc);
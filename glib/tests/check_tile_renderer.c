@@ -0,0 +1,239 @@
+/*
+ * testing program for PopplerTileRenderer
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <poppler.h>
+
+#define TILE_SIZE 128
+#define TILE_BYTES (TILE_SIZE * 4 * TILE_SIZE)
+
+/*
+ * A document with a page of 400x300 points drawing a rectangle, and a
+ * page drawing half a million rectangles, which takes a while to render.
+ */
+static PopplerDocument *make_document(void)
+{
+    GString *data, *slow;
+    GArray *offsets;
+    GBytes *bytes;
+    PopplerDocument *doc;
+    GError *err = NULL;
+    const char *fast = "0 0 1 rg 10 10 380 280 re f";
+    char *objects[6];
+    gsize xref_offset;
+    guint i;
+
+    slow = g_string_new(NULL);
+    for (i = 0; i < 500000; i++) {
+        g_string_append(slow, "0 0 1 1 re f\n");
+    }
+
+    objects[0] = g_strdup("<< /Type /Catalog /Pages 2 0 R >>");
+    objects[1] = g_strdup("<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 2 /MediaBox [0 0 400 300] >>");
+    objects[2] = g_strdup("<< /Type /Page /Parent 2 0 R /Contents 5 0 R >>");
+    objects[3] = g_strdup("<< /Type /Page /Parent 2 0 R /Contents 6 0 R >>");
+    objects[4] = g_strdup_printf("<< /Length %" G_GSIZE_FORMAT " >>\nstream\n%s\nendstream", (gsize)strlen(fast), fast);
+    objects[5] = g_strdup_printf("<< /Length %" G_GSIZE_FORMAT " >>\nstream\n%s\nendstream", slow->len, slow->str);
+    g_string_free(slow, TRUE);
+
+    data = g_string_new("%PDF-1.4\n");
+    offsets = g_array_new(FALSE, FALSE, sizeof(gsize));
+    for (i = 0; i < G_N_ELEMENTS(objects); i++) {
+        g_array_append_val(offsets, data->len);
+        g_string_append_printf(data, "%u 0 obj\n%s\nendobj\n", i + 1, objects[i]);
+        g_free(objects[i]);
+    }
+    xref_offset = data->len;
+    g_string_append_printf(data, "xref\n0 %u\n0000000000 65535 f \n", offsets->len + 1);
+    for (i = 0; i < offsets->len; i++) {
+        g_string_append_printf(data, "%010" G_GSIZE_FORMAT " 00000 n \n", g_array_index(offsets, gsize, i));
+    }
+    g_string_append_printf(data, "trailer\n<< /Size %u /Root 1 0 R >>\nstartxref\n%" G_GSIZE_FORMAT "\n%%%%EOF\n", offsets->len + 1, xref_offset);
+    g_array_free(offsets, TRUE);
+
+    bytes = g_string_free_to_bytes(data);
+    doc = poppler_document_new_from_bytes(bytes, NULL, &err);
+    g_bytes_unref(bytes);
+    if (doc == NULL) {
+        g_printerr("error opening the test document: %s\n", err->message);
+        g_error_free(err);
+        exit(EXIT_FAILURE);
+    }
+    return doc;
+}
+
+static void check_grid_size(PopplerTileRenderer *renderer, PopplerPage *page)
+{
+    gint n_columns, n_rows;
+
+    g_print("Grid size\n");
+
+    /* 400x300 pixels */
+    poppler_tile_renderer_get_grid_size(renderer, page, 1.0, &n_columns, &n_rows);
+    g_assert_cmpint(n_columns, ==, 4);
+    g_assert_cmpint(n_rows, ==, 3);
+
+    /* 200x150 pixels */
+    poppler_tile_renderer_get_grid_size(renderer, page, 0.5, &n_columns, &n_rows);
+    g_assert_cmpint(n_columns, ==, 2);
+    g_assert_cmpint(n_rows, ==, 2);
+
+    /* 100x75 pixels */
+    poppler_tile_renderer_get_grid_size(renderer, page, 0.25, &n_columns, &n_rows);
+    g_assert_cmpint(n_columns, ==, 1);
+    g_assert_cmpint(n_rows, ==, 1);
+}
+
+static cairo_surface_t *render(PopplerTileRenderer *renderer, PopplerPage *page, gint column, gint row)
+{
+    cairo_surface_t *tile;
+    GError *err = NULL;
+
+    tile = poppler_tile_renderer_render_tile(renderer, page, 1.0, column, row, NULL, &err);
+    g_assert_no_error(err);
+    g_assert_nonnull(tile);
+    return tile;
+}
+
+static gboolean is_cached(PopplerTileRenderer *renderer, PopplerPage *page, gint column, gint row)
+{
+    cairo_surface_t *tile = poppler_tile_renderer_lookup_tile(renderer, page, 1.0, column, row);
+
+    if (tile == NULL) {
+        return FALSE;
+    }
+    cairo_surface_destroy(tile);
+    return TRUE;
+}
+
+static void check_cache_hit(PopplerTileRenderer *renderer, PopplerPage *page)
+{
+    cairo_surface_t *tile, *cached;
+
+    g_print("Cache hit\n");
+
+    g_assert_false(is_cached(renderer, page, 3, 2));
+    tile = render(renderer, page, 3, 2);
+    /* the last column and row are cut at the edges of the page */
+    g_assert_cmpint(cairo_image_surface_get_width(tile), ==, 400 - 3 * TILE_SIZE);
+    g_assert_cmpint(cairo_image_surface_get_height(tile), ==, 300 - 2 * TILE_SIZE);
+
+    cached = poppler_tile_renderer_lookup_tile(renderer, page, 1.0, 3, 2);
+    g_assert_true(cached == tile);
+    cairo_surface_destroy(cached);
+    cached = render(renderer, page, 3, 2);
+    g_assert_true(cached == tile);
+    cairo_surface_destroy(cached);
+    cairo_surface_destroy(tile);
+
+    /* another scale is another tile */
+    g_assert_null(poppler_tile_renderer_lookup_tile(renderer, page, 2.0, 3, 2));
+}
+
+static void check_cache_trim(PopplerTileRenderer *renderer, PopplerPage *page)
+{
+    g_print("Cache trimming\n");
+
+    poppler_tile_renderer_clear_cache(renderer);
+    poppler_tile_renderer_set_cache_size(renderer, 2 * TILE_BYTES);
+    g_assert_cmpuint(poppler_tile_renderer_get_cache_size(renderer), ==, 2 * TILE_BYTES);
+
+    /* whole tiles of TILE_BYTES each */
+    cairo_surface_destroy(render(renderer, page, 0, 0));
+    cairo_surface_destroy(render(renderer, page, 1, 0));
+    /* makes 0,0 the most recently used */
+    g_assert_true(is_cached(renderer, page, 0, 0));
+    cairo_surface_destroy(render(renderer, page, 2, 0));
+    g_assert_false(is_cached(renderer, page, 1, 0));
+    g_assert_true(is_cached(renderer, page, 0, 0));
+    g_assert_true(is_cached(renderer, page, 2, 0));
+
+    /* keeps 2,0, used after 0,0 by the lookup above */
+    poppler_tile_renderer_set_cache_size(renderer, TILE_BYTES);
+    g_assert_false(is_cached(renderer, page, 0, 0));
+    g_assert_true(is_cached(renderer, page, 2, 0));
+
+    poppler_tile_renderer_set_cache_size(renderer, 0);
+    g_assert_false(is_cached(renderer, page, 2, 0));
+    cairo_surface_destroy(render(renderer, page, 0, 0));
+    g_assert_false(is_cached(renderer, page, 0, 0));
+}
+
+#define CANCEL_DELAY 10000
+
+static gpointer cancel_thread(gpointer data)
+{
+    g_usleep(CANCEL_DELAY);
+    g_cancellable_cancel(G_CANCELLABLE(data));
+    return NULL;
+}
+
+static void check_cancel(PopplerTileRenderer *renderer, PopplerPage *slow_page)
+{
+    GCancellable *cancellable;
+    cairo_surface_t *tile;
+    GThread *thread;
+    GError *err = NULL;
+    gint64 start;
+
+    g_print("Cancellation\n");
+
+    poppler_tile_renderer_set_cache_size(renderer, 16 * TILE_BYTES);
+
+    /* cancelled before rendering */
+    cancellable = g_cancellable_new();
+    g_cancellable_cancel(cancellable);
+    tile = poppler_tile_renderer_render_tile(renderer, slow_page, 1.0, 0, 0, cancellable, &err);
+    g_assert_null(tile);
+    g_assert_error(err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_clear_error(&err);
+    g_object_unref(cancellable);
+
+    /* cancelled from another thread while rendering */
+    cancellable = g_cancellable_new();
+    start = g_get_monotonic_time();
+    thread = g_thread_new("cancel", cancel_thread, cancellable);
+    tile = poppler_tile_renderer_render_tile(renderer, slow_page, 1.0, 0, 0, cancellable, &err);
+    /* returned after the cancellation, so it was rendering meanwhile */
+    g_assert_cmpint(g_get_monotonic_time() - start, >=, CANCEL_DELAY);
+    g_thread_join(thread);
+    g_assert_null(tile);
+    g_assert_error(err, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_clear_error(&err);
+    g_object_unref(cancellable);
+
+    /* partially rendered tiles aren't cached */
+    g_assert_false(is_cached(renderer, slow_page, 0, 0));
+}
+
+/*
+ * main
+ */
+int main(int argc, char *argv[])
+{
+    PopplerDocument *doc;
+    PopplerTileRenderer *renderer;
+    PopplerPage *page, *slow_page;
+
+    doc = make_document();
+    page = poppler_document_get_page(doc, 0);
+    slow_page = poppler_document_get_page(doc, 1);
+    renderer = poppler_tile_renderer_new(doc, TILE_SIZE);
+    g_assert_cmpint(poppler_tile_renderer_get_tile_size(renderer), ==, TILE_SIZE);
+
+    check_grid_size(renderer, page);
+    check_cache_hit(renderer, page);
+    check_cache_trim(renderer, page);
+    check_cancel(renderer, slow_page);
+
+    g_clear_object(&renderer);
+    g_clear_object(&slow_page);
+    g_clear_object(&page);
+    g_clear_object(&doc);
+
+    return EXIT_SUCCESS;
+}
@@ -30,11 +30,13 @@ class POPPLER_PRIVATE_EXPORT NetPBMWriter : public ImgWriter
 public:
     /* RGB        - 3 bytes/pixel
      * MONOCHROME - 8 pixels/byte
+     * GRAY       - 1 byte/pixel
      */
     enum Format
     {
         RGB,
-        MONOCHROME
+        MONOCHROME,
+        GRAY
     };
 
     explicit NetPBMWriter(Format formatA = RGB);
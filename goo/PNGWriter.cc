@@ -21,12 +21,29 @@
 #    include <zlib.h>
 #    include <cstdlib>
 #    include <cstring>
+#    include <deque>
+#    include <future>
+#    include <vector>
 
 #    include "poppler/Error.h"
 #    include "goo/gmem.h"
 
 #    include <png.h>
 
+// Raw image bytes per band in the multi-threaded encoder
+static const size_t pngBandSize = 1024 * 1024;
+
+namespace {
+
+struct PNGBand
+{
+    std::vector<unsigned char> data; // raw deflate output
+    uLong adler; // adler32 of the filtered rows
+    size_t filteredLength;
+};
+
+}
+
 struct PNGWriterPrivate
 {
     explicit PNGWriterPrivate(PNGWriter::Format f) : format(f) { }
@@ -38,6 +55,24 @@ struct PNGWriterPrivate
     int icc_data_size = 0;
     char *icc_name = nullptr;
     bool sRGB_profile = false;
+    int compressionLevel = Z_BEST_COMPRESSION;
+    PNGWriter::Filter filter = PNGWriter::FilterDefault;
+    int nThreads = 1;
+
+    // multi-threaded encoder state
+    size_t rowBytes = 0;
+    int bpp = 0; // bytes per complete pixel, at least 1
+    int height = 0;
+    int rowsQueued = 0;
+    std::vector<unsigned char> band; // raw rows of the band being filled
+    std::vector<unsigned char> prevRow; // last raw row of the previous band
+    std::deque<std::future<PNGBand>> pending;
+    bool headerWritten = false;
+    uLong adler = 1;
+
+    bool queueRow(const unsigned char *row);
+    bool queueBand(bool last);
+    bool writeBand(PNGBand band);
 
     PNGWriterPrivate(const PNGWriterPrivate &) = delete;
     PNGWriterPrivate &operator=(const PNGWriterPrivate &) = delete;
@@ -73,6 +108,195 @@ void PNGWriter::setSRGBProfile()
     priv->sRGB_profile = true;
 }
 
+void PNGWriter::setCompressionLevel(int level)
+{
+    priv->compressionLevel = level;
+}
+
+void PNGWriter::setFilter(Filter filter)
+{
+    priv->filter = filter;
+}
+
+void PNGWriter::setNumThreads(int n)
+{
+    priv->nThreads = n;
+}
+
+//------------------------------------------------------------------------
+// multi-threaded encoder
+//------------------------------------------------------------------------
+
+static inline int paethPredictor(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+// Filter <row> with filter type <type> (0-4) into <out>, which gets the
+// filter type byte first.  Returns the sum of the absolute values of
+// the filtered bytes taken as signed, the usual heuristic for picking
+// a filter.
+static unsigned long filterRow(int type, const unsigned char *row, const unsigned char *prev, size_t rowBytes, int bpp, unsigned char *out)
+{
+    unsigned long sum = 0;
+
+    out[0] = type;
+    for (size_t i = 0; i < rowBytes; ++i) {
+        const int a = i >= (size_t)bpp ? row[i - bpp] : 0;
+        const int b = prev ? prev[i] : 0;
+        const int c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+        int pred;
+        switch (type) {
+        case 1:
+            pred = a;
+            break;
+        case 2:
+            pred = b;
+            break;
+        case 3:
+            pred = (a + b) / 2;
+            break;
+        case 4:
+            pred = paethPredictor(a, b, c);
+            break;
+        default:
+            pred = 0;
+            break;
+        }
+        const unsigned char v = row[i] - pred;
+        out[i + 1] = v;
+        sum += v < 128 ? v : 256 - v;
+    }
+
+    return sum;
+}
+
+// Filter and deflate a band of rows.  The output is a raw deflate stream
+// that ends on a byte boundary without a final block (unless <last>), so
+// the bands can simply be concatenated.
+static PNGBand compressBand(std::vector<unsigned char> rows, std::vector<unsigned char> prevRow, size_t rowBytes, int bpp, PNGWriter::Filter filter, int level, bool last)
+{
+    PNGBand result;
+    const size_t nRows = rows.size() / rowBytes;
+    std::vector<unsigned char> filtered(nRows * (rowBytes + 1));
+    std::vector<unsigned char> candidate(filter == PNGWriter::FilterAdaptive ? rowBytes + 1 : 0);
+
+    for (size_t y = 0; y < nRows; ++y) {
+        const unsigned char *row = rows.data() + y * rowBytes;
+        const unsigned char *prev = y > 0 ? row - rowBytes : (prevRow.empty() ? nullptr : prevRow.data());
+        unsigned char *out = filtered.data() + y * (rowBytes + 1);
+        if (filter == PNGWriter::FilterAdaptive) {
+            unsigned long best = filterRow(0, row, prev, rowBytes, bpp, out);
+            for (int type = 1; type <= 4; ++type) {
+                const unsigned long sum = filterRow(type, row, prev, rowBytes, bpp, candidate.data());
+                if (sum < best) {
+                    best = sum;
+                    memcpy(out, candidate.data(), rowBytes + 1);
+                }
+            }
+        } else {
+            filterRow(filter - PNGWriter::FilterNone, row, prev, rowBytes, bpp, out);
+        }
+    }
+
+    result.filteredLength = filtered.size();
+    result.adler = adler32(adler32(0L, nullptr, 0), filtered.data(), filtered.size());
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, filter == PNGWriter::FilterNone ? Z_DEFAULT_STRATEGY : Z_FILTERED) != Z_OK) {
+        return result;
+    }
+    result.data.resize(deflateBound(&zs, filtered.size()) + 16);
+    zs.next_in = filtered.data();
+    zs.avail_in = filtered.size();
+    zs.next_out = result.data.data();
+    zs.avail_out = result.data.size();
+    const int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((last ? ret == Z_STREAM_END : ret == Z_OK) && zs.avail_in == 0) {
+        result.data.resize(result.data.size() - zs.avail_out);
+    } else {
+        result.data.clear();
+    }
+    deflateEnd(&zs);
+
+    return result;
+}
+
+// Writes a chunk, in a function of its own as libpng reports errors with
+// longjmp.
+static bool writeChunk(png_structp png_ptr, const char *name, const unsigned char *data, size_t length)
+{
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        error(errInternal, -1, "Error writing png {0:s} chunk", name);
+        return false;
+    }
+    png_write_chunk(png_ptr, (png_const_bytep)name, data, length);
+    return true;
+}
+
+bool PNGWriterPrivate::queueRow(const unsigned char *row)
+{
+    band.insert(band.end(), row, row + rowBytes);
+    ++rowsQueued;
+    if (rowsQueued == height) {
+        return queueBand(true);
+    }
+    if (band.size() >= pngBandSize) {
+        return queueBand(false);
+    }
+    return true;
+}
+
+bool PNGWriterPrivate::queueBand(bool last)
+{
+    std::vector<unsigned char> lastRow(band.end() - rowBytes, band.end());
+    pending.push_back(std::async(std::launch::async, compressBand, std::move(band), std::move(prevRow), rowBytes, bpp, filter, compressionLevel, last));
+    band.clear();
+    prevRow = std::move(lastRow);
+
+    while (!pending.empty() && ((int)pending.size() >= nThreads || last)) {
+        PNGBand done = pending.front().get();
+        pending.pop_front();
+        if (!writeBand(std::move(done))) {
+            return false;
+        }
+    }
+
+    if (last) {
+        const unsigned char trailer[4] = { (unsigned char)(adler >> 24), (unsigned char)(adler >> 16), (unsigned char)(adler >> 8), (unsigned char)adler };
+        return writeChunk(png_ptr, "IDAT", trailer, sizeof(trailer));
+    }
+    return true;
+}
+
+bool PNGWriterPrivate::writeBand(PNGBand b)
+{
+    if (b.data.empty()) {
+        error(errInternal, -1, "png band compression failed");
+        return false;
+    }
+
+    if (!headerWritten) {
+        // zlib header: deflate with a 32K window, and the level hint
+        const int levelHint = compressionLevel < 2 ? 0 : compressionLevel < 6 ? 1 : compressionLevel == 6 ? 2 : 3;
+        unsigned char header[2] = { 0x78, (unsigned char)(levelHint << 6) };
+        header[1] += 31 - ((header[0] << 8) + header[1]) % 31;
+        b.data.insert(b.data.begin(), header, header + 2);
+        headerWritten = true;
+    }
+    adler = adler32_combine(adler, b.adler, b.filteredLength);
+
+    return writeChunk(png_ptr, "IDAT", b.data.data(), b.data.size());
+}
+
 bool PNGWriter::init(FILE *f, int width, int height, double hDPI, double vDPI)
 {
     /* libpng changed the png_set_iCCP() prototype in 1.5.0 */
@@ -120,7 +344,29 @@ bool PNGWriter::init(FILE *f, int width, int height, double hDPI, double vDPI)
     }
 
     // Set up the type of PNG image and the compression level
-    png_set_compression_level(priv->png_ptr, Z_BEST_COMPRESSION);
+    png_set_compression_level(priv->png_ptr, priv->compressionLevel);
+    switch (priv->filter) {
+    case FilterDefault:
+        break;
+    case FilterNone:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+        break;
+    case FilterSub:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+        break;
+    case FilterUp:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_UP);
+        break;
+    case FilterAverage:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_AVG);
+        break;
+    case FilterPaeth:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_PAETH);
+        break;
+    case FilterAdaptive:
+        png_set_filter(priv->png_ptr, PNG_FILTER_TYPE_BASE, PNG_ALL_FILTERS);
+        break;
+    }
 
     // Silence silly gcc
     png_byte bit_depth = -1;
@@ -165,12 +411,33 @@ bool PNGWriter::init(FILE *f, int width, int height, double hDPI, double vDPI)
         return false;
     }
 
+    if (priv->nThreads > 1) {
+        const int bitDepth = png_get_bit_depth(priv->png_ptr, priv->info_ptr);
+        const int bitsPerPixel = bitDepth * png_get_channels(priv->png_ptr, priv->info_ptr);
+        priv->rowBytes = ((size_t)width * bitsPerPixel + 7) / 8;
+        priv->bpp = (bitsPerPixel + 7) / 8;
+        priv->height = height;
+        if (priv->filter == FilterDefault) {
+            // what libpng does: adaptive filtering, except for low bit depths
+            priv->filter = bitDepth < 8 ? FilterNone : FilterAdaptive;
+        }
+    }
+
     return true;
 }
 
 bool PNGWriter::writePointers(unsigned char **rowPointers, int rowCount)
 {
-    png_write_image(priv->png_ptr, rowPointers);
+    if (priv->nThreads > 1) {
+        for (int y = 0; y < rowCount; ++y) {
+            if (!priv->queueRow(rowPointers[y])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    png_write_rows(priv->png_ptr, rowPointers, rowCount);
     /* write bytes */
     if (setjmp(png_jmpbuf(priv->png_ptr))) {
         error(errInternal, -1, "Error during writing bytes");
@@ -182,6 +449,10 @@ bool PNGWriter::writePointers(unsigned char **rowPointers, int rowCount)
 
 bool PNGWriter::writeRow(unsigned char **row)
 {
+    if (priv->nThreads > 1) {
+        return priv->queueRow(*row);
+    }
+
     // Write the row to the file
     png_write_rows(priv->png_ptr, row, 1);
     if (setjmp(png_jmpbuf(priv->png_ptr))) {
@@ -194,6 +465,15 @@ bool PNGWriter::writeRow(unsigned char **row)
 
 bool PNGWriter::close()
 {
+    if (priv->nThreads > 1) {
+        if (priv->rowsQueued != priv->height) {
+            error(errInternal, -1, "PNGWriter::close: only {0:d} of {1:d} rows written", priv->rowsQueued, priv->height);
+            return false;
+        }
+        // png_write_end() insists on writing the image data itself
+        return writeChunk(priv->png_ptr, "IEND", nullptr, 0);
+    }
+
     /* end write */
     png_write_end(priv->png_ptr, priv->info_ptr);
     if (setjmp(png_jmpbuf(priv->png_ptr))) {
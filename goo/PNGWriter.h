@@ -43,6 +43,20 @@ public:
         RGB48
     };
 
+    // Row filter applied before compression.  FilterDefault lets libpng
+    // choose (adaptive, but no filtering for MONOCHROME); FilterAdaptive
+    // picks the best of the five filters for each row.
+    enum Filter
+    {
+        FilterDefault,
+        FilterNone,
+        FilterSub,
+        FilterUp,
+        FilterAverage,
+        FilterPaeth,
+        FilterAdaptive
+    };
+
     explicit PNGWriter(Format format = RGB);
     ~PNGWriter() override;
 
@@ -52,6 +66,15 @@ public:
     void setICCProfile(const char *name, unsigned char *data, int size);
     void setSRGBProfile();
 
+    // zlib compression level, 0-9.  Defaults to 9.
+    void setCompressionLevel(int level);
+    void setFilter(Filter filter);
+
+    // With more than one thread the image is split in bands of rows that
+    // are filtered and deflated independently, each on its own thread,
+    // and joined into a single zlib stream.  Must be called before init().
+    void setNumThreads(int n);
+
     bool init(FILE *f, int width, int height, double hDPI, double vDPI) override;
 
     bool writePointers(unsigned char **rowPointers, int rowCount) override;
@@ -208,10 +208,11 @@ bool TiffWriter::writePointers(unsigned char **rowPointers, int rowCount)
     // Write all rows to the file
 
     for (int row = 0; row < rowCount; row++) {
-        if (TIFFWriteScanline(priv->f, rowPointers[row], row, 0) < 0) {
-            fprintf(stderr, "TiffWriter: Error writing tiff row %d\n", row);
+        if (TIFFWriteScanline(priv->f, rowPointers[row], priv->curRow, 0) < 0) {
+            fprintf(stderr, "TiffWriter: Error writing tiff row %d\n", priv->curRow);
             return false;
         }
+        priv->curRow++;
     }
 
     return true;
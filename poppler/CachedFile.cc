@@ -12,35 +12,50 @@
 //========================================================================
 
 #include <config.h>
+#include "goo/gfile.h"
 #include "CachedFile.h"
 
+#include <algorithm>
+
 //------------------------------------------------------------------------
 // CachedFile
 //------------------------------------------------------------------------
 
-CachedFile::CachedFile(CachedFileLoader *cacheLoader)
+CachedFile::CachedFile(CachedFileLoader *cacheLoader, size_t memoryLimitA, bool spillToFile)
 {
     loader = cacheLoader;
 
     streamPos = 0;
-    chunks = new std::vector<Chunk>();
     length = 0;
+    residentChunks = 0;
+    memoryLimit = memoryLimitA;
+    spill = spillToFile;
+    spillFile = nullptr;
+    prefetchStop = false;
 
     length = loader->init(this);
     refCnt = 1;
 
-    if (length != ((size_t)-1)) {
-        chunks->resize(length / CachedFileChunkSize + 1);
-    } else {
+    if (length == ((size_t)-1)) {
         error(errInternal, -1, "Failed to initialize file cache.");
-        chunks->resize(0);
     }
 }
 
 CachedFile::~CachedFile()
 {
+    if (prefetchThread.joinable()) {
+        {
+            std::scoped_lock lock { mutex };
+            prefetchStop = true;
+        }
+        prefetchCond.notify_one();
+        prefetchThread.join();
+    }
+
     delete loader;
-    delete chunks;
+    if (spillFile) {
+        fclose(spillFile);
+    }
 }
 
 void CachedFile::incRefCnt()
@@ -78,7 +93,52 @@ int CachedFile::seek(long int offset, int origin)
     return 0;
 }
 
-int CachedFile::cache(const std::vector<ByteRange> &origRanges)
+int CachedFile::cache(const std::vector<ByteRange> &ranges)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    const int ret = cacheRanges(ranges, lock, true);
+    evictChunks();
+    return ret;
+}
+
+void CachedFile::prefetch(const std::vector<ByteRange> &ranges)
+{
+    if (ranges.empty()) {
+        return;
+    }
+
+    {
+        std::scoped_lock lock { mutex };
+        prefetchQueue.push_back(ranges);
+        if (!prefetchThread.joinable()) {
+            prefetchThread = std::thread(&CachedFile::prefetchLoop, this);
+        }
+    }
+    prefetchCond.notify_one();
+}
+
+void CachedFile::prefetchLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        prefetchCond.wait(lock, [this] { return prefetchStop || !prefetchQueue.empty(); });
+        if (prefetchStop) {
+            return;
+        }
+        const std::vector<ByteRange> ranges = std::move(prefetchQueue.front());
+        prefetchQueue.pop_front();
+        // What a reader is loading meanwhile is left to it
+        cacheRanges(ranges, lock, false);
+        evictChunks();
+    }
+}
+
+// Loads the chunks of <origRanges> that aren't cached.  <lock> holds mutex,
+// and is released while the loader runs: the chunks being loaded are marked
+// chunkStateLoading meanwhile, so that other threads neither load them too
+// nor read them.  If <waitForLoading> is true, also waits for the chunks of
+// the ranges that other threads are loading.
+int CachedFile::cacheRanges(const std::vector<ByteRange> &origRanges, std::unique_lock<std::mutex> &lock, bool waitForLoading)
 {
     std::vector<int> loadChunks;
     int numChunks = length / CachedFileChunkSize + 1;
@@ -98,6 +158,7 @@ int CachedFile::cache(const std::vector<ByteRange> &origRanges)
     for (int i = 0; i < numChunks; ++i) {
         chunkNeeded[i] = false;
     }
+    std::vector<int> loadingChunks;
     for (const ByteRange &r : *ranges) {
 
         if (r.length == 0) {
@@ -116,8 +177,11 @@ int CachedFile::cache(const std::vector<ByteRange> &origRanges)
         startChunk = start / CachedFileChunkSize;
         endChunk = end / CachedFileChunkSize;
         for (int chunk = startChunk; chunk <= endChunk; chunk++) {
-            if ((*chunks)[chunk].state == chunkStateNew) {
+            const ChunkState state = getChunkState(chunk);
+            if (state == chunkStateNew) {
                 chunkNeeded[chunk] = true;
+            } else if (state == chunkStateLoading) {
+                loadingChunks.push_back(chunk);
             }
         }
     }
@@ -136,6 +200,9 @@ int CachedFile::cache(const std::vector<ByteRange> &origRanges)
         while ((++chunk != numChunks) && chunkNeeded[chunk]) {
             loadChunks.push_back(chunk);
         }
+        for (int i = startChunk; i < chunk; ++i) {
+            chunks[i].state = chunkStateLoading;
+        }
         endChunk = chunk - 1;
 
         range.offset = startChunk * CachedFileChunkSize;
@@ -144,16 +211,52 @@ int CachedFile::cache(const std::vector<ByteRange> &origRanges)
         chunk_ranges.push_back(range);
     }
 
+    int ret = 0;
     if (chunk_ranges.size() > 0) {
-        CachedFileWriter writer = CachedFileWriter(this, &loadChunks);
-        return loader->load(chunk_ranges, &writer);
+        lock.unlock();
+        {
+            std::scoped_lock loaderLock { loaderMutex };
+            CachedFileWriter writer = CachedFileWriter(this, &loadChunks);
+            ret = loader->load(chunk_ranges, &writer);
+        }
+        lock.lock();
+
+        // forget what the loader didn't write, for the next read to retry
+        for (int i : loadChunks) {
+            const auto it = chunks.find(i);
+            if (it != chunks.end() && it->second.state == chunkStateLoading) {
+                if (it->second.data) {
+                    --residentChunks;
+                }
+                chunks.erase(it);
+            }
+        }
+        loadedCond.notify_all();
     }
 
-    return 0;
+    if (waitForLoading) {
+        loadedCond.wait(lock, [&] { return std::none_of(loadingChunks.begin(), loadingChunks.end(), [this](int i) { return getChunkState(i) == chunkStateLoading; }); });
+    }
+
+    return ret;
+}
+
+// Whether all the data in [<offset>, <offset> + <rangeLength>) can be read
+bool CachedFile::isCached(size_t offset, size_t rangeLength) const
+{
+    for (size_t chunk = offset / CachedFileChunkSize; chunk <= (offset + rangeLength - 1) / CachedFileChunkSize; ++chunk) {
+        const ChunkState state = getChunkState(chunk);
+        if (state != chunkStateLoaded && state != chunkStateSpilled) {
+            return false;
+        }
+    }
+    return true;
 }
 
 size_t CachedFile::read(void *ptr, size_t unitsize, size_t count)
 {
+    std::unique_lock<std::mutex> lock(mutex);
+
     size_t bytes = unitsize * count;
     if (length < (streamPos + bytes)) {
         bytes = length - streamPos;
@@ -163,10 +266,14 @@ size_t CachedFile::read(void *ptr, size_t unitsize, size_t count)
         return 0;
     }
 
-    // Load data
-    if (cache(streamPos, bytes) != 0) {
-        return 0;
-    }
+    // Load data.  While the lock was released for the loader, the prefetch
+    // thread may have evicted chunks loaded before, or failed to load the
+    // ones we waited for.
+    do {
+        if (cache(streamPos, bytes, lock) != 0) {
+            return 0;
+        }
+    } while (!isCached(streamPos, bytes));
 
     // Copy data to buffer
     size_t toCopy = bytes;
@@ -179,23 +286,116 @@ size_t CachedFile::read(void *ptr, size_t unitsize, size_t count)
             len = toCopy;
         }
 
-        memcpy(ptr, (*chunks)[chunk].data + offset, len);
+        memcpy(ptr, getChunkData(chunk) + offset, len);
         streamPos += len;
         toCopy -= len;
         ptr = (char *)ptr + len;
     }
 
+    // Only now that the whole range has been copied, chunks may be dropped
+    evictChunks();
+
     return bytes;
 }
 
-int CachedFile::cache(size_t rangeOffset, size_t rangeLength)
+int CachedFile::cache(size_t rangeOffset, size_t rangeLength, std::unique_lock<std::mutex> &lock)
 {
     std::vector<ByteRange> r;
     ByteRange range;
     range.offset = rangeOffset;
     range.length = rangeLength;
     r.push_back(range);
-    return cache(r);
+    return cacheRanges(r, lock, true);
+}
+
+CachedFile::ChunkState CachedFile::getChunkState(size_t chunk) const
+{
+    const auto it = chunks.find(chunk);
+    return it == chunks.end() ? chunkStateNew : it->second.state;
+}
+
+// Returns the data of <chunk>, bringing it into memory if needed, and
+// marks it as most recently used.
+char *CachedFile::getChunkData(size_t chunk)
+{
+    Chunk &c = chunks[chunk];
+
+    if (!c.data) {
+        c.data = std::make_unique<char[]>(CachedFileChunkSize);
+        ++residentChunks;
+        if (c.state == chunkStateSpilled) {
+            if (unspillChunk(chunk, c.data.get())) {
+                setChunkLoaded(chunk, c.reloadable);
+            } else {
+                error(errIO, -1, "Failed to read chunk {0:uld} back from the file cache", (unsigned long)chunk);
+                c.state = chunkStateNew;
+            }
+        }
+    }
+    if (c.inLru) {
+        lru.splice(lru.end(), lru, c.lruPos);
+    }
+
+    return c.data.get();
+}
+
+void CachedFile::setChunkLoaded(size_t chunk, bool reloadable)
+{
+    Chunk &c = chunks[chunk];
+
+    c.state = chunkStateLoaded;
+    c.reloadable = reloadable;
+    if (memoryLimit > 0 && !c.inLru && (reloadable || spill)) {
+        c.lruPos = lru.insert(lru.end(), chunk);
+        c.inLru = true;
+    }
+}
+
+// Drops least recently used chunks from memory until we are back under the
+// memory limit.  Chunks are written to the spill file if there is one, or
+// else simply forgotten, to be loaded again on the next access.
+void CachedFile::evictChunks()
+{
+    if (memoryLimit == 0) {
+        return;
+    }
+
+    while (residentChunks * CachedFileChunkSize > memoryLimit && !lru.empty()) {
+        const size_t chunk = lru.front();
+        lru.pop_front();
+
+        const auto it = chunks.find(chunk);
+        Chunk &c = it->second;
+        c.inLru = false;
+        if (spill && spillChunk(chunk, c.data.get())) {
+            c.data.reset();
+            c.state = chunkStateSpilled;
+            --residentChunks;
+        } else if (c.reloadable) {
+            chunks.erase(it);
+            --residentChunks;
+        }
+        // otherwise the data can't be recovered once dropped, so keep it
+    }
+}
+
+bool CachedFile::spillChunk(size_t chunk, const char *data)
+{
+    if (!spillFile) {
+        spillFile = tmpfile();
+        if (!spillFile) {
+            error(errIO, -1, "Couldn't create a temporary file for the file cache");
+            spill = false;
+            return false;
+        }
+    }
+
+    return Gfseek(spillFile, (Goffset)chunk * CachedFileChunkSize, SEEK_SET) == 0 && fwrite(data, 1, CachedFileChunkSize, spillFile) == CachedFileChunkSize;
+}
+
+bool CachedFile::unspillChunk(size_t chunk, char *data)
+{
+    return Gfseek(spillFile, (Goffset)chunk * CachedFileChunkSize, SEEK_SET) == 0 && fread(data, 1, CachedFileChunkSize, spillFile) == CachedFileChunkSize;
 }
 
 //------------------------------------------------------------------------
@@ -227,6 +427,9 @@ size_t CachedFileWriter::write(const char *ptr, size_t size)
         return 0;
     }
 
+    // the loader runs without the lock when called from CachedFile::cacheRanges
+    std::scoped_lock lock { cachedFile->mutex };
+
     while (len) {
         if (chunks) {
             if (offset == CachedFileChunkSize) {
@@ -242,13 +445,9 @@ size_t CachedFileWriter::write(const char *ptr, size_t size)
             chunk = cachedFile->length / CachedFileChunkSize;
         }
 
-        if (chunk >= cachedFile->chunks->size()) {
-            cachedFile->chunks->resize(chunk + 1);
-        }
-
         nfree = CachedFileChunkSize - offset;
         ncopy = (len >= nfree) ? nfree : len;
-        memcpy(&((*cachedFile->chunks)[chunk].data[offset]), cp, ncopy);
+        memcpy(cachedFile->getChunkData(chunk) + offset, cp, ncopy);
         len -= ncopy;
         cp += ncopy;
         offset += ncopy;
@@ -259,12 +458,19 @@ size_t CachedFileWriter::write(const char *ptr, size_t size)
         }
 
         if (offset == CachedFileChunkSize) {
-            (*cachedFile->chunks)[chunk].state = CachedFile::chunkStateLoaded;
+            cachedFile->setChunkLoaded(chunk, chunks != nullptr);
         }
     }
 
     if ((chunk == (cachedFile->length / CachedFileChunkSize)) && (offset == (cachedFile->length % CachedFileChunkSize))) {
-        (*cachedFile->chunks)[chunk].state = CachedFile::chunkStateLoaded;
+        cachedFile->setChunkLoaded(chunk, chunks != nullptr);
+    }
+
+    // While a stream is appended the data only ever grows, so keep it
+    // within the limits as we go.  Chunks loaded on request are only
+    // evicted once the request is served.
+    if (!chunks) {
+        cachedFile->evictChunks();
     }
 
     return written;
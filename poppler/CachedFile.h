@@ -21,6 +21,14 @@
 #include "Object.h"
 #include "Stream.h"
 
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 //------------------------------------------------------------------------
@@ -37,6 +45,13 @@ class CachedFileLoader;
 // In the constructor, you specify a CachedFileLoader that handles loading
 // the data from the document. The CachedFile requests no more data then it
 // needs from the CachedFileLoader.
+//
+// Only the chunks that have been loaded are kept in memory.  A memory limit
+// can be given to bound that further: once it is exceeded the least recently
+// used chunks are dropped, and loaded again when they are read.  Data that
+// the loader can't fetch again (such as a stream read in init()) is only
+// dropped if spilling to a temporary file is enabled, in which case evicted
+// chunks are written there and read back from it instead.
 //------------------------------------------------------------------------
 
 class POPPLER_PRIVATE_EXPORT CachedFile
@@ -45,7 +60,10 @@ class POPPLER_PRIVATE_EXPORT CachedFile
     friend class CachedFileWriter;
 
 public:
-    explicit CachedFile(CachedFileLoader *cacheLoader);
+    // <memoryLimit> is the number of bytes of cached data to keep in
+    // memory, 0 for no limit.  If <spillToFile> is true, chunks evicted
+    // from memory are kept in a temporary file.
+    explicit CachedFile(CachedFileLoader *cacheLoader, size_t memoryLimit = 0, bool spillToFile = false);
 
     CachedFile(const CachedFile &) = delete;
     CachedFile &operator=(const CachedFile &) = delete;
@@ -57,6 +75,11 @@ public:
     size_t write(const char *ptr, size_t size, size_t fromByte);
     int cache(const std::vector<ByteRange> &ranges);
 
+    // Like cache(), but the ranges are loaded on a background thread and
+    // the call returns immediately.  Reads that need data that is being
+    // prefetched wait for it, other reads don't.
+    void prefetch(const std::vector<ByteRange> &ranges);
+
     // Reference counting.
     void incRefCnt();
     void decRefCnt();
@@ -67,23 +90,57 @@ private:
     enum ChunkState
     {
         chunkStateNew = 0,
-        chunkStateLoaded
+        chunkStateLoading, // being loaded by another thread
+        chunkStateLoaded,
+        chunkStateSpilled // loaded, but only kept in the spill file
     };
 
-    typedef struct
+    struct Chunk
     {
-        ChunkState state;
-        char data[CachedFileChunkSize];
-    } Chunk;
+        ChunkState state = chunkStateNew;
+        bool reloadable = false; // the loader can fetch it again
+        bool inLru = false;
+        std::list<size_t>::iterator lruPos;
+        std::unique_ptr<char[]> data; // nullptr unless in memory
+    };
+
+    int cache(size_t offset, size_t length, std::unique_lock<std::mutex> &lock);
+    int cacheRanges(const std::vector<ByteRange> &ranges, std::unique_lock<std::mutex> &lock, bool waitForLoading);
+    bool isCached(size_t offset, size_t rangeLength) const;
 
-    int cache(size_t offset, size_t length);
+    ChunkState getChunkState(size_t chunk) const;
+    char *getChunkData(size_t chunk);
+    void setChunkLoaded(size_t chunk, bool reloadable);
+    void evictChunks();
+    bool spillChunk(size_t chunk, const char *data);
+    bool unspillChunk(size_t chunk, char *data);
 
     CachedFileLoader *loader;
 
     size_t length;
     size_t streamPos;
 
-    std::vector<Chunk> *chunks;
+    std::unordered_map<size_t, Chunk> chunks; // by chunk index
+    size_t residentChunks; // chunks with their data in memory
+
+    size_t memoryLimit; // 0 for no limit
+    std::list<size_t> lru; // evictable chunks, least recently used first
+    bool spill;
+    FILE *spillFile;
+
+    // Guards the chunks against the prefetch thread.  It isn't held while
+    // the loader runs, so reads of cached data don't wait for it.
+    std::mutex mutex;
+    // Signalled when chunks stop being chunkStateLoading
+    std::condition_variable loadedCond;
+    // Serializes the calls to the loader, only ever taken without mutex
+    std::mutex loaderMutex;
+
+    void prefetchLoop();
+    std::thread prefetchThread;
+    std::condition_variable prefetchCond;
+    std::deque<std::vector<ByteRange>> prefetchQueue; // guarded by mutex
+    bool prefetchStop;
 
     int refCnt; // reference count
 };
@@ -95,6 +95,16 @@ unsigned long CairoFont::getGlyph(CharCode code, const Unicode *u, int uLen)
 }
 
 double CairoFont::getSubstitutionCorrection(const std::shared_ptr<GfxFont> &gfxFont)
+{
+    // updateFont() asks for every font change, and measuring the
+    // substituted font is costly: it is computed once per font.  'm' is
+    // the only glyph measured here; cairo caches the extents of the
+    // glyphs it draws in its scaled fonts.
+    std::call_once(substitutionCorrectionOnce, [this, &gfxFont] { substitutionCorrection = computeSubstitutionCorrection(gfxFont); });
+    return substitutionCorrection;
+}
+
+double CairoFont::computeSubstitutionCorrection(const std::shared_ptr<GfxFont> &gfxFont)
 {
     double w1, w2, w3;
     CharCode code;
@@ -70,6 +70,12 @@ protected:
 
     bool substitute;
     bool printing;
+
+private:
+    double computeSubstitutionCorrection(const std::shared_ptr<GfxFont> &gfxFont);
+
+    std::once_flag substitutionCorrectionOnce;
+    double substitutionCorrection = 1.0;
 };
 
 //------------------------------------------------------------------------
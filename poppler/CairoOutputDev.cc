@@ -142,7 +142,8 @@ CairoOutputDev::CairoOutputDev()
 
     fontEngine = nullptr;
     fontEngine_owner = false;
-    glyphs = nullptr;
+    glyphsRender = 0;
+    inString = false;
     fill_pattern = nullptr;
     fill_color = {};
     stroke_pattern = nullptr;
@@ -217,6 +218,8 @@ CairoOutputDev::~CairoOutputDev()
 
 void CairoOutputDev::setCairo(cairo_t *c)
 {
+    flushGlyphs();
+
     if (cairo != nullptr) {
         cairo_status_t status = cairo_status(cairo);
         if (status) {
@@ -408,6 +411,8 @@ void CairoOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA)
 
 void CairoOutputDev::endPage()
 {
+    flushGlyphs();
+
     if (textPage) {
         textPage->endPage();
         textPage->coalesce(true, 0, false);
@@ -416,6 +421,8 @@ void CairoOutputDev::endPage()
 
 void CairoOutputDev::beginForm(Object *obj, Ref id)
 {
+    flushGlyphs();
+
     if (logicalStruct && isPDF()) {
         structParentsStack.push_back(currentStructParents);
 
@@ -430,6 +437,8 @@ void CairoOutputDev::beginForm(Object *obj, Ref id)
 
 void CairoOutputDev::endForm(Object *obj, Ref id)
 {
+    flushGlyphs();
+
     if (logicalStruct && isPDF()) {
         currentStructParents = structParentsStack.back();
         structParentsStack.pop_back();
@@ -755,6 +764,8 @@ void CairoOutputDev::startType3Render(GfxState *state, XRef *xrefA)
 
 void CairoOutputDev::saveState(GfxState *state)
 {
+    flushGlyphs();
+
     LOG(printf("save\n"));
     cairo_save(cairo);
     if (cairo_shape) {
@@ -784,6 +795,8 @@ void CairoOutputDev::saveState(GfxState *state)
 
 void CairoOutputDev::restoreState(GfxState *state)
 {
+    flushGlyphs();
+
     LOG(printf("restore\n"));
     cairo_restore(cairo);
     if (cairo_shape) {
@@ -829,6 +842,8 @@ void CairoOutputDev::restoreState(GfxState *state)
 
 void CairoOutputDev::updateAll(GfxState *state)
 {
+    flushGlyphs();
+
     updateLineDash(state);
     updateLineJoin(state);
     updateLineCap(state);
@@ -848,6 +863,8 @@ void CairoOutputDev::updateAll(GfxState *state)
 
 void CairoOutputDev::setDefaultCTM(const double *ctm)
 {
+    flushGlyphs();
+
     cairo_matrix_t matrix;
     matrix.xx = ctm[0];
     matrix.yx = ctm[1];
@@ -866,6 +883,8 @@ void CairoOutputDev::setDefaultCTM(const double *ctm)
 
 void CairoOutputDev::updateCTM(GfxState *state, double m11, double m12, double m21, double m22, double m31, double m32)
 {
+    flushGlyphs();
+
     cairo_matrix_t matrix, invert_matrix;
     matrix.xx = m11;
     matrix.yx = m12;
@@ -901,6 +920,8 @@ void CairoOutputDev::updateCTM(GfxState *state, double m11, double m12, double m
 
 void CairoOutputDev::updateLineDash(GfxState *state)
 {
+    flushGlyphs();
+
     double dashStart;
 
     const std::vector<double> &dashPattern = state->getLineDash(&dashStart);
@@ -912,11 +933,15 @@ void CairoOutputDev::updateLineDash(GfxState *state)
 
 void CairoOutputDev::updateFlatness(GfxState *state)
 {
+    flushGlyphs();
+
     // cairo_set_tolerance (cairo, state->getFlatness());
 }
 
 void CairoOutputDev::updateLineJoin(GfxState *state)
 {
+    flushGlyphs();
+
     switch (state->getLineJoin()) {
     case 0:
         cairo_set_line_join(cairo, CAIRO_LINE_JOIN_MITER);
@@ -935,6 +960,8 @@ void CairoOutputDev::updateLineJoin(GfxState *state)
 
 void CairoOutputDev::updateLineCap(GfxState *state)
 {
+    flushGlyphs();
+
     switch (state->getLineCap()) {
     case 0:
         cairo_set_line_cap(cairo, CAIRO_LINE_CAP_BUTT);
@@ -953,6 +980,8 @@ void CairoOutputDev::updateLineCap(GfxState *state)
 
 void CairoOutputDev::updateMiterLimit(GfxState *state)
 {
+    flushGlyphs();
+
     cairo_set_miter_limit(cairo, state->getMiterLimit());
     if (cairo_shape) {
         cairo_set_miter_limit(cairo_shape, state->getMiterLimit());
@@ -961,6 +990,8 @@ void CairoOutputDev::updateMiterLimit(GfxState *state)
 
 void CairoOutputDev::updateLineWidth(GfxState *state)
 {
+    flushGlyphs();
+
     LOG(printf("line width: %f\n", state->getLineWidth()));
     adjusted_stroke_width = false;
     double width = state->getLineWidth();
@@ -999,6 +1030,8 @@ void CairoOutputDev::updateLineWidth(GfxState *state)
 
 void CairoOutputDev::updateFillColor(GfxState *state)
 {
+    flushGlyphs();
+
     if (inUncoloredPattern) {
         return;
     }
@@ -1016,6 +1049,7 @@ void CairoOutputDev::updateFillColor(GfxState *state)
 
 void CairoOutputDev::updateStrokeColor(GfxState *state)
 {
+    flushGlyphs();
 
     if (inUncoloredPattern) {
         return;
@@ -1034,6 +1068,8 @@ void CairoOutputDev::updateStrokeColor(GfxState *state)
 
 void CairoOutputDev::updateFillOpacity(GfxState *state)
 {
+    flushGlyphs();
+
     double opacity = fill_opacity;
 
     if (inUncoloredPattern) {
@@ -1056,6 +1092,8 @@ void CairoOutputDev::updateFillOpacity(GfxState *state)
 
 void CairoOutputDev::updateStrokeOpacity(GfxState *state)
 {
+    flushGlyphs();
+
     double opacity = stroke_opacity;
 
     if (inUncoloredPattern) {
@@ -1078,6 +1116,8 @@ void CairoOutputDev::updateStrokeOpacity(GfxState *state)
 
 void CairoOutputDev::updateFillColorStop(GfxState *state, double offset)
 {
+    flushGlyphs();
+
     if (inUncoloredPattern) {
         return;
     }
@@ -1097,6 +1137,8 @@ void CairoOutputDev::updateFillColorStop(GfxState *state, double offset)
 
 void CairoOutputDev::updateBlendMode(GfxState *state)
 {
+    flushGlyphs();
+
     switch (state->getBlendMode()) {
     default:
     case gfxBlendNormal:
@@ -1153,6 +1195,8 @@ void CairoOutputDev::updateBlendMode(GfxState *state)
 
 void CairoOutputDev::updateFont(GfxState *state)
 {
+    flushGlyphs();
+
     cairo_font_face_t *font_face;
     cairo_matrix_t matrix, invert_matrix;
 
@@ -1304,6 +1348,8 @@ void CairoOutputDev::doPath(cairo_t *c, GfxState *state, const GfxPath *path)
 
 void CairoOutputDev::stroke(GfxState *state)
 {
+    flushGlyphs();
+
     if (t3_render_state == Type3RenderMask) {
         GfxGray gray;
         state->getFillGray(&gray);
@@ -1335,6 +1381,8 @@ void CairoOutputDev::stroke(GfxState *state)
 
 void CairoOutputDev::fill(GfxState *state)
 {
+    flushGlyphs();
+
     if (t3_render_state == Type3RenderMask) {
         GfxGray gray;
         state->getFillGray(&gray);
@@ -1373,6 +1421,8 @@ void CairoOutputDev::fill(GfxState *state)
 
 void CairoOutputDev::eoFill(GfxState *state)
 {
+    flushGlyphs();
+
     doPath(cairo, state, state->getPath());
     cairo_set_fill_rule(cairo, CAIRO_FILL_RULE_EVEN_ODD);
     cairo_set_source(cairo, fill_pattern);
@@ -1396,6 +1446,8 @@ void CairoOutputDev::eoFill(GfxState *state)
 
 bool CairoOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog *cat, GfxTilingPattern *tPat, const double *mat, int x0, int y0, int x1, int y1, double xStep, double yStep)
 {
+    flushGlyphs();
+
     PDFRectangle box;
     Gfx *gfx;
     cairo_pattern_t *pattern;
@@ -1524,6 +1576,8 @@ bool CairoOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog *cat,
 
 bool CairoOutputDev::functionShadedFill(GfxState *state, GfxFunctionShading *shading)
 {
+    flushGlyphs();
+
     // Function shaded fills are subdivided to rectangles that are the
     // following size in device space.  Note when printing this size is
     // in points.
@@ -1612,6 +1666,8 @@ bool CairoOutputDev::functionShadedFill(GfxState *state, GfxFunctionShading *sha
 
 bool CairoOutputDev::axialShadedFill(GfxState *state, GfxAxialShading *shading, double tMin, double tMax)
 {
+    flushGlyphs();
+
     double x0, y0, x1, y1;
     double dx, dy;
 
@@ -1641,6 +1697,8 @@ bool CairoOutputDev::axialShadedSupportExtend(GfxState *state, GfxAxialShading *
 
 bool CairoOutputDev::radialShadedFill(GfxState *state, GfxRadialShading *shading, double sMin, double sMax)
 {
+    flushGlyphs();
+
     double x0, y0, r0, x1, y1, r1;
     double dx, dy, dr;
     cairo_matrix_t matrix;
@@ -1681,6 +1739,8 @@ bool CairoOutputDev::radialShadedSupportExtend(GfxState *state, GfxRadialShading
 
 bool CairoOutputDev::gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriangleShading *shading)
 {
+    flushGlyphs();
+
     double x0, y0, x1, y1, x2, y2;
     GfxColor color[3];
     int i, j;
@@ -1730,6 +1790,8 @@ bool CairoOutputDev::gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriang
 
 bool CairoOutputDev::patchMeshShadedFill(GfxState *state, GfxPatchMeshShading *shading)
 {
+    flushGlyphs();
+
     int i, j, k;
 
     cairo_pattern_destroy(fill_pattern);
@@ -1809,6 +1871,8 @@ bool CairoOutputDev::patchMeshShadedFill(GfxState *state, GfxPatchMeshShading *s
 
 void CairoOutputDev::clip(GfxState *state)
 {
+    flushGlyphs();
+
     doPath(cairo, state, state->getPath());
     cairo_set_fill_rule(cairo, CAIRO_FILL_RULE_WINDING);
     cairo_clip(cairo);
@@ -1822,6 +1886,8 @@ void CairoOutputDev::clip(GfxState *state)
 
 void CairoOutputDev::eoClip(GfxState *state)
 {
+    flushGlyphs();
+
     doPath(cairo, state, state->getPath());
     cairo_set_fill_rule(cairo, CAIRO_FILL_RULE_EVEN_ODD);
     cairo_clip(cairo);
@@ -1835,6 +1901,8 @@ void CairoOutputDev::eoClip(GfxState *state)
 
 void CairoOutputDev::clipToStrokePath(GfxState *state)
 {
+    flushGlyphs();
+
     LOG(printf("clip-to-stroke-path\n"));
     strokePathClip = (StrokePathClip *)gmalloc(sizeof(*strokePathClip));
     strokePathClip->path = state->getPath()->copy();
@@ -1869,6 +1937,18 @@ void CairoOutputDev::fillToStrokePathClip(GfxState *state)
     cairo_restore(cairo);
 }
 
+// The render mode the glyphs of the current string are drawn with
+static int getGlyphsRender(GfxState *state)
+{
+    int render = state->getRender();
+    if (state->getFont()->getType() == fontType3 && render != 7) {
+        // If the current font is a type 3 font, we should ignore the text rendering mode
+        // (and use the default of 0) as long as we are going to either fill or stroke.
+        render = 0;
+    }
+    return render;
+}
+
 void CairoOutputDev::beginString(GfxState *state, const GooString *s)
 {
     int len = s->getLength();
@@ -1881,43 +1961,48 @@ void CairoOutputDev::beginString(GfxState *state, const GooString *s)
         return;
     }
 
-    glyphs = (cairo_glyph_t *)gmallocn(len, sizeof(cairo_glyph_t));
-    glyphCount = 0;
+    // the pending glyphs are shown together with this string unless the
+    // render mode changes, see drawChar(); anything else that affects
+    // them flushes them before it happens
+    inString = true;
+
+    glyphs.reserve(glyphs.size() + len);
     if (use_show_text_glyphs) {
-        clusters = (cairo_text_cluster_t *)gmallocn(len, sizeof(cairo_text_cluster_t));
-        clusterCount = 0;
-        utf8Max = len * 2; // start with twice the number of glyphs. we will realloc if we need more.
-        utf8 = (char *)gmalloc(utf8Max);
-        utf8Count = 0;
+        clusters.reserve(clusters.size() + len);
+        utf8.reserve(utf8.size() + len * 2);
     }
 }
 
 void CairoOutputDev::drawChar(GfxState *state, double x, double y, double dx, double dy, double originX, double originY, CharCode code, int nBytes, const Unicode *u, int uLen)
 {
-    if (currentFont) {
-        glyphs[glyphCount].index = currentFont->getGlyph(code, u, uLen);
-        glyphs[glyphCount].x = x - originX;
-        glyphs[glyphCount].y = y - originY;
-        glyphCount++;
+    if (currentFont && inString) {
+        // the render mode is only known here: Gfx switches pattern filled
+        // text to clipping after beginString()
+        const int render = getGlyphsRender(state);
+        if (render != glyphsRender) {
+            flushGlyphs();
+            glyphsRender = render;
+        }
+
+        cairo_glyph_t glyph;
+        glyph.index = currentFont->getGlyph(code, u, uLen);
+        glyph.x = x - originX;
+        glyph.y = y - originY;
+        glyphs.push_back(glyph);
         if (use_show_text_glyphs) {
             const UnicodeMap *utf8Map = globalParams->getUtf8Map();
-            if (utf8Max - utf8Count < uLen * 6) {
-                // utf8 encoded characters can be up to 6 bytes
-                if (utf8Max > uLen * 6) {
-                    utf8Max *= 2;
-                } else {
-                    utf8Max += 2 * uLen * 6;
-                }
-                utf8 = (char *)grealloc(utf8, utf8Max);
-            }
-            clusters[clusterCount].num_bytes = 0;
+            cairo_text_cluster_t cluster;
+            cluster.num_bytes = 0;
+            cluster.num_glyphs = 1;
             for (int i = 0; i < uLen; i++) {
-                int size = utf8Map->mapUnicode(u[i], utf8 + utf8Count, utf8Max - utf8Count);
-                utf8Count += size;
-                clusters[clusterCount].num_bytes += size;
+                // utf8 encoded characters can be up to 6 bytes
+                const size_t utf8Count = utf8.size();
+                utf8.resize(utf8Count + 6);
+                int size = utf8Map->mapUnicode(u[i], utf8.data() + utf8Count, 6);
+                utf8.resize(utf8Count + size);
+                cluster.num_bytes += size;
             }
-            clusters[clusterCount].num_glyphs = 1;
-            clusterCount++;
+            clusters.push_back(cluster);
         }
     }
 
@@ -1929,42 +2014,44 @@ void CairoOutputDev::drawChar(GfxState *state, double x, double y, double dx, do
 
 void CairoOutputDev::endString(GfxState *state)
 {
-    int render;
-
-    if (!currentFont) {
-        return;
-    }
-
     // endString can be called without a corresponding beginString. If this
-    // happens glyphs will be null so don't draw anything, just return.
+    // happens don't draw anything, just return.
     // XXX: OutputDevs should probably not have to deal with this...
-    if (!glyphs) {
+    if (!currentFont || !inString) {
         return;
     }
+    inString = false;
 
-    // ignore empty strings and invisible text -- this is used by
-    // Acrobat Capture
-    render = state->getRender();
-    if (render == 3 || glyphCount == 0 || !text_matrix_valid) {
-        goto finish;
+    // the glyphs are drawn by flushGlyphs(), together with those of the
+    // following strings with the same font and state: each cairo call
+    // has a significant cost, and a TJ array or a line of text is often
+    // split in many short strings
+}
+
+void CairoOutputDev::flushGlyphs()
+{
+    if (glyphs.empty()) {
+        return;
     }
 
-    if (state->getFont()->getType() == fontType3 && render != 7) {
-        // If the current font is a type 3 font, we should ignore the text rendering mode
-        // (and use the default of 0) as long as we are going to either fill or stroke.
-        render = 0;
+    const int glyphCount = glyphs.size();
+    const int render = glyphsRender;
+
+    // ignore invisible text -- this is used by Acrobat Capture
+    if (render == 3 || !text_matrix_valid || !cairo) {
+        goto finish;
     }
 
     if (!(render & 1)) {
         LOG(printf("fill string\n"));
         cairo_set_source(cairo, fill_pattern);
         if (use_show_text_glyphs) {
-            cairo_show_text_glyphs(cairo, utf8, utf8Count, glyphs, glyphCount, clusters, clusterCount, (cairo_text_cluster_flags_t)0);
+            cairo_show_text_glyphs(cairo, utf8.data(), utf8.size(), glyphs.data(), glyphCount, clusters.data(), clusters.size(), (cairo_text_cluster_flags_t)0);
         } else {
-            cairo_show_glyphs(cairo, glyphs, glyphCount);
+            cairo_show_glyphs(cairo, glyphs.data(), glyphCount);
         }
         if (cairo_shape) {
-            cairo_show_glyphs(cairo_shape, glyphs, glyphCount);
+            cairo_show_glyphs(cairo_shape, glyphs.data(), glyphCount);
         }
     }
 
@@ -1972,10 +2059,10 @@ void CairoOutputDev::endString(GfxState *state)
     if ((render & 3) == 1 || (render & 3) == 2) {
         LOG(printf("stroke string\n"));
         cairo_set_source(cairo, stroke_pattern);
-        cairo_glyph_path(cairo, glyphs, glyphCount);
+        cairo_glyph_path(cairo, glyphs.data(), glyphCount);
         cairo_stroke(cairo);
         if (cairo_shape) {
-            cairo_glyph_path(cairo_shape, glyphs, glyphCount);
+            cairo_glyph_path(cairo_shape, glyphs.data(), glyphCount);
             cairo_stroke(cairo_shape);
         }
     }
@@ -1995,7 +2082,7 @@ void CairoOutputDev::endString(GfxState *state)
         }
 
         // append the glyph path
-        cairo_glyph_path(cairo, glyphs, glyphCount);
+        cairo_glyph_path(cairo, glyphs.data(), glyphCount);
 
         // move the path back into textClipPath
         // and clear the current path
@@ -2007,18 +2094,14 @@ void CairoOutputDev::endString(GfxState *state)
     }
 
 finish:
-    gfree(glyphs);
-    glyphs = nullptr;
-    if (use_show_text_glyphs) {
-        gfree(clusters);
-        clusters = nullptr;
-        gfree(utf8);
-        utf8 = nullptr;
-    }
+    glyphs.clear();
+    clusters.clear();
+    utf8.clear();
 }
 
 bool CairoOutputDev::beginType3Char(GfxState *state, double x, double y, double dx, double dy, CharCode code, const Unicode *u, int uLen)
 {
+    flushGlyphs();
 
     cairo_save(cairo);
     cairo_matrix_t matrix;
@@ -2076,6 +2159,8 @@ void CairoOutputDev::beginTextObject(GfxState *state) { }
 
 void CairoOutputDev::endTextObject(GfxState *state)
 {
+    flushGlyphs();
+
     if (textClipPath) {
         // clip the accumulated text path
         cairo_append_path(cairo, textClipPath);
@@ -2133,6 +2218,8 @@ static cairo_surface_t *cairo_surface_create_similar_clip(cairo_t *cairo, cairo_
 
 void CairoOutputDev::beginTransparencyGroup(GfxState * /*state*/, const double * /*bbox*/, GfxColorSpace *blendingColorSpace, bool /*isolated*/, bool knockout, bool forSoftMask)
 {
+    flushGlyphs();
+
     /* push color space */
     ColorSpaceStack *css = new ColorSpaceStack;
     css->cs = blendingColorSpace;
@@ -2180,6 +2267,8 @@ void CairoOutputDev::beginTransparencyGroup(GfxState * /*state*/, const double *
 
 void CairoOutputDev::endTransparencyGroup(GfxState * /*state*/)
 {
+    flushGlyphs();
+
     if (group) {
         cairo_pattern_destroy(group);
     }
@@ -2197,6 +2286,8 @@ void CairoOutputDev::endTransparencyGroup(GfxState * /*state*/)
 
 void CairoOutputDev::paintTransparencyGroup(GfxState * /*state*/, const double * /*bbox*/)
 {
+    flushGlyphs();
+
     LOG(printf("paint transparency group\n"));
 
     cairo_save(cairo);
@@ -2264,6 +2355,8 @@ static int luminocity(uint32_t x)
 /* XXX: do we need to deal with shape here? */
 void CairoOutputDev::setSoftMask(GfxState *state, const double *bbox, bool alpha, Function *transferFunc, GfxColor *backdropColor)
 {
+    flushGlyphs();
+
     cairo_pattern_destroy(mask);
 
     LOG(printf("set softMask\n"));
@@ -2400,6 +2493,8 @@ void CairoOutputDev::popTransparencyGroup()
 
 void CairoOutputDev::clearSoftMask(GfxState * /*state*/)
 {
+    flushGlyphs();
+
     if (mask) {
         cairo_pattern_destroy(mask);
     }
@@ -2499,6 +2594,7 @@ cairo_filter_t CairoOutputDev::getFilterForSurface(cairo_surface_t *image, bool
 
 void CairoOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool interpolate, bool inlineImg)
 {
+    flushGlyphs();
 
     /* FIXME: Doesn't the image mask support any colorspace? */
     cairo_set_source(cairo, fill_pattern);
@@ -2544,6 +2640,7 @@ void CairoOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str, in
 
 void CairoOutputDev::setSoftMaskFromImageMask(GfxState *state, Object *ref, Stream *str, int width, int height, bool invert, bool inlineImg, double *baseMatrix)
 {
+    flushGlyphs();
 
     /* FIXME: Doesn't the image mask support any colorspace? */
     cairo_set_source(cairo, fill_pattern);
@@ -2603,6 +2700,8 @@ void CairoOutputDev::setSoftMaskFromImageMask(GfxState *state, Object *ref, Stre
 
 void CairoOutputDev::unsetSoftMaskFromImageMask(GfxState *state, double *baseMatrix)
 {
+    flushGlyphs();
+
     double bbox[4] = { 0, 0, 1, 1 }; // dummy
 
     endTransparencyGroup(state);
@@ -2723,6 +2822,8 @@ cleanup:
 
 void CairoOutputDev::drawMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight, bool maskInvert, bool maskInterpolate)
 {
+    flushGlyphs();
+
     ImageStream *maskImgStr, *imgStr;
     ptrdiff_t row_stride;
     unsigned char *maskBuffer, *buffer;
@@ -2899,6 +3000,8 @@ static inline void applyMask(unsigned int *imagePointer, int length, GfxRGB matt
 void CairoOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, Stream *maskStr, int maskWidth, int maskHeight, GfxImageColorMap *maskColorMap,
                                          bool maskInterpolate)
 {
+    flushGlyphs();
+
     ImageStream *maskImgStr, *imgStr;
     ptrdiff_t row_stride, mask_row_stride;
     unsigned char *maskBuffer, *buffer;
@@ -3451,6 +3554,8 @@ RescaleDrawImage::~RescaleDrawImage() = default;
 
 void CairoOutputDev::drawImage(GfxState *state, Object *ref, Stream *str, int widthA, int heightA, GfxImageColorMap *colorMap, bool interpolate, const int *maskColors, bool inlineImg)
 {
+    flushGlyphs();
+
     cairo_surface_t *image;
     cairo_pattern_t *pattern, *maskPattern;
     cairo_matrix_t matrix;
@@ -3551,6 +3656,9 @@ void CairoOutputDev::beginMarkedContent(const char *name, Dict *properties)
         return;
     }
 
+    // the glyphs belong to the content before the tag
+    flushGlyphs();
+
     if (strcmp(name, "Artifact") == 0) {
         markedContentStack.emplace_back(name);
 #if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 18, 0)
@@ -3587,6 +3695,9 @@ void CairoOutputDev::endMarkedContent(GfxState *state)
         return;
     }
 
+    // the glyphs belong to the content before the tag
+    flushGlyphs();
+
     if (markedContentStack.size() == 0) {
         return;
     }
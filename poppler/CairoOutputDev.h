@@ -276,6 +276,7 @@ protected:
     bool getStreamData(Stream *str, char **buffer, int *length);
     void setMimeData(GfxState *state, Stream *str, Object *ref, GfxImageColorMap *colorMap, cairo_surface_t *image, int height);
     void fillToStrokePathClip(GfxState *state);
+    void flushGlyphs();
     void alignStrokeCoords(const GfxSubpath *subpath, int i, double *x, double *y);
     AnnotLink *findLinkObject(const StructElement *elem);
     void quadToCairoRect(AnnotQuadrilaterals *quads, int idx, double destPageHeight, cairo_rectangle_t *rect);
@@ -331,13 +332,13 @@ protected:
     bool printing;
     bool use_show_text_glyphs;
     bool text_matrix_valid;
-    cairo_glyph_t *glyphs;
-    int glyphCount;
-    cairo_text_cluster_t *clusters;
-    int clusterCount;
-    char *utf8;
-    int utf8Count;
-    int utf8Max;
+    // glyphs of the strings not shown yet: consecutive strings with the
+    // same render mode <glyphsRender> are shown together by flushGlyphs()
+    std::vector<cairo_glyph_t> glyphs;
+    std::vector<cairo_text_cluster_t> clusters;
+    std::vector<char> utf8;
+    int glyphsRender;
+    bool inString; // between beginString() and endString()
     cairo_path_t *textClipPath;
     bool inUncoloredPattern; // inside a uncolored pattern (PaintType = 2)
     Type3RenderType t3_render_state;
@@ -75,6 +75,11 @@
 
 #define catalogLocker() const std::scoped_lock locker(mutex)
 
+// Pages further than this from the ones loaded so far are looked up
+// using the /Count entries of the page tree instead of walking it.
+// Those aren't always right, so small jumps still walk the tree.
+static const std::size_t pageTreeWalkLimit = 256;
+
 Catalog::Catalog(PDFDoc *docA)
 {
     ok = true;
@@ -198,6 +203,9 @@ Page *Catalog::getPage(int i)
 
     catalogLocker();
     if (std::size_t(i) > pages.size()) {
+        if (std::size_t(i) > pages.size() + pageTreeWalkLimit && cachePageAhead(i)) {
+            return pagesAhead[i].first.get();
+        }
         bool cached = cachePageTree(i);
         if (cached == false) {
             return nullptr;
@@ -214,6 +222,9 @@ Ref *Catalog::getPageRef(int i)
 
     catalogLocker();
     if (std::size_t(i) > pages.size()) {
+        if (std::size_t(i) > pages.size() + pageTreeWalkLimit && cachePageAhead(i)) {
+            return &pagesAhead[i].second;
+        }
         bool cached = cachePageTree(i);
         if (cached == false) {
             return nullptr;
@@ -313,11 +324,27 @@ bool Catalog::cachePageTree(int page)
 
         Object kid = kids.arrayGet(kidsIdx);
         if (kid.isDict("Page") || (kid.isDict() && !kid.getDict()->hasKey("Kids"))) {
-            PageAttrs *attrs = new PageAttrs(attrsList->back(), kid.getDict());
-            auto p = std::make_unique<Page>(doc, pages.size() + 1, std::move(kid), kidRef.getRef(), attrs, form);
-            if (!p->isOk()) {
-                error(errSyntaxError, -1, "Failed to create page (page {0:uld})", pages.size() + 1);
-                return false;
+            const int pageNum = pages.size() + 1;
+            std::unique_ptr<Page> p;
+            const auto ahead = pagesAhead.find(pageNum);
+            if (ahead != pagesAhead.end()) {
+                if (ahead->second.second == kidRef.getRef()) {
+                    p = std::move(ahead->second.first);
+                } else {
+                    error(errSyntaxWarning, -1, "Page count in pages object is incorrect (page {0:d})", pageNum);
+                    pageTreeCountsBad = true;
+                    // the page may still be in use
+                    stalePages.push_back(std::move(ahead->second.first));
+                }
+                pagesAhead.erase(ahead);
+            }
+            if (!p) {
+                PageAttrs *attrs = new PageAttrs(attrsList->back(), kid.getDict());
+                p = std::make_unique<Page>(doc, pageNum, std::move(kid), kidRef.getRef(), attrs, form);
+                if (!p->isOk()) {
+                    error(errSyntaxError, -1, "Failed to create page (page {0:uld})", pages.size() + 1);
+                    return false;
+                }
             }
 
             if (pages.size() >= std::size_t(numPages)) {
@@ -326,6 +353,7 @@ bool Catalog::cachePageTree(int page)
             }
 
             pages.emplace_back(std::move(p), kidRef.getRef());
+            addPageNum(kidRef.getRef(), pageNum);
 
             kidsIdxList->back()++;
 
@@ -345,16 +373,239 @@ bool Catalog::cachePageTree(int page)
     return false;
 }
 
+bool Catalog::cachePageAhead(int page)
+{
+    if (pagesAhead.count(page)) {
+        return true;
+    }
+    if (pageTreeCountsBad || page > getNumPages()) {
+        return false;
+    }
+    if (!findPageInTree(page)) {
+        // don't try again, cachePageTree will load the pages
+        pageTreeCountsBad = true;
+        return false;
+    }
+    return true;
+}
+
+bool Catalog::findPageInTree(int page)
+{
+    Object catDict = xref->getCatalog();
+    if (!catDict.isDict()) {
+        return false;
+    }
+    const Object &nodeRef = catDict.dictLookupNF("Pages");
+    if (!nodeRef.isRef()) {
+        return false;
+    }
+    Object node = catDict.dictLookup("Pages");
+    if (!node.isDict()) {
+        return false;
+    }
+
+    // Walk down from the root, skipping the subtrees before <page> by
+    // their /Count.  Give up on anything the sequential walk in
+    // cachePageTree would handle differently.
+    std::vector<Ref> ancestors = { nodeRef.getRef() };
+    std::vector<std::unique_ptr<PageAttrs>> attrs;
+    attrs.push_back(std::make_unique<PageAttrs>(nullptr, node.getDict()));
+    int index = page; // 1-based index of the page within node
+    while (true) {
+        Object kids = node.dictLookup("Kids");
+        if (!kids.isArray()) {
+            return false;
+        }
+
+        Object next;
+        Ref nextRef;
+        bool nextIsPage = false;
+        int total = 0;
+        for (int i = 0; i < kids.arrayGetLength(); ++i) {
+            const Object &kidRef = kids.arrayGetNF(i);
+            if (!kidRef.isRef()) {
+                return false;
+            }
+            for (const Ref &ancestor : ancestors) {
+                if (ancestor == kidRef.getRef()) {
+                    return false;
+                }
+            }
+            Object kid = kids.arrayGet(i);
+            int count;
+            const bool isPage = kid.isDict("Page") || (kid.isDict() && !kid.getDict()->hasKey("Kids"));
+            if (isPage) {
+                count = 1;
+            } else if (kid.isDict()) {
+                Object kidCount = kid.dictLookup("Count");
+                if (!kidCount.isInt() || kidCount.getInt() < 0) {
+                    return false;
+                }
+                count = kidCount.getInt();
+            } else {
+                // skipped by the sequential walk too
+                continue;
+            }
+
+            if (next.isNone() && index > total && index <= total + count) {
+                next = std::move(kid);
+                nextRef = kidRef.getRef();
+                nextIsPage = isPage;
+                index -= total;
+            }
+            total += count;
+        }
+
+        // the counts of the kids have to add up to the count of the node
+        if (next.isNone()) {
+            return false;
+        }
+        if (ancestors.size() == 1) {
+            if (total != numPages) {
+                return false;
+            }
+        } else {
+            Object nodeCount = node.dictLookup("Count");
+            if (!nodeCount.isInt() || total != nodeCount.getInt()) {
+                return false;
+            }
+        }
+
+        if (nextIsPage) {
+            PageAttrs *pageAttrs = new PageAttrs(attrs.back().get(), next.getDict());
+            auto p = std::make_unique<Page>(doc, page, std::move(next), nextRef, pageAttrs, form);
+            if (!p->isOk()) {
+                return false;
+            }
+            pagesAhead.emplace(page, std::make_pair(std::move(p), nextRef));
+            return true;
+        }
+        ancestors.push_back(nextRef);
+        attrs.push_back(std::make_unique<PageAttrs>(attrs.back().get(), next.getDict()));
+        node = std::move(next);
+    }
+}
+
+int Catalog::findPageFromParents(const Ref pageRef)
+{
+    Object catDict = xref->getCatalog();
+    if (!catDict.isDict()) {
+        return 0;
+    }
+    const Object &rootRef = catDict.dictLookupNF("Pages");
+    if (!rootRef.isRef()) {
+        return 0;
+    }
+
+    // add up the counts of the kids before the page and before each of
+    // its ancestors.  The counts of all the kids of each ancestor have to
+    // add up to its own count, and anything cachePageTree could number
+    // differently (kids that are neither a page leaf nor a node with a
+    // valid count) makes us give up.
+    int page = 1;
+    Ref ref = pageRef;
+    Object node = xref->fetch(pageRef);
+    for (int depth = 0; depth < 100; ++depth) {
+        if (!node.isDict()) {
+            return 0;
+        }
+        // only a leaf is a page, as in cachePageTree, not a Pages node
+        if (depth == 0 && !node.isDict("Page") && node.getDict()->hasKey("Kids")) {
+            return 0;
+        }
+        const Object &parentRef = node.dictLookupNF("Parent");
+        if (!parentRef.isRef()) {
+            return depth > 0 && ref == rootRef.getRef() ? page : 0;
+        }
+        Object parent = node.dictLookup("Parent");
+        if (!parent.isDict()) {
+            return 0;
+        }
+        Object kids = parent.dictLookup("Kids");
+        Object parentCount = parent.dictLookup("Count");
+        if (!kids.isArray() || !parentCount.isInt()) {
+            return 0;
+        }
+        bool found = false;
+        int total = 0;
+        for (int i = 0; i < kids.arrayGetLength(); ++i) {
+            const Object &kidRef = kids.arrayGetNF(i);
+            if (!kidRef.isRef()) {
+                return 0;
+            }
+            if (kidRef.getRef() == ref) {
+                if (found) {
+                    // the same kid twice
+                    return 0;
+                }
+                found = true;
+                page += total;
+            }
+            Object kid = kids.arrayGet(i);
+            if (kid.isDict("Page") || (kid.isDict() && !kid.getDict()->hasKey("Kids"))) {
+                total++;
+            } else if (kid.isDict()) {
+                Object count = kid.dictLookup("Count");
+                if (!count.isInt() || count.getInt() < 0) {
+                    return 0;
+                }
+                total += count.getInt();
+            } else {
+                return 0;
+            }
+        }
+        if (!found || total != parentCount.getInt()) {
+            return 0;
+        }
+        ref = parentRef.getRef();
+        node = std::move(parent);
+    }
+    return 0;
+}
+
+void Catalog::addPageNum(const Ref pageRef, int page)
+{
+    // a page object may be used more than once, keep the first one
+    pageNums.emplace(pageRef, page);
+}
+
 int Catalog::findPage(const Ref pageRef)
 {
+    catalogLocker();
     const int count = getNumPages();
 
-    for (int i = 0; i < count; ++i) {
-        Ref *ref = getPageRef(i + 1);
-        if (ref != nullptr && *ref == pageRef) {
-            return i + 1;
+    auto it = pageNums.find(pageRef);
+    if (it != pageNums.end()) {
+        return it->second;
+    }
+
+    // Looking a few pages up through their parents is cheaper than
+    // loading the whole page tree, resolving many of them isn't.
+    if (!pageTreeCountsBad && std::size_t(count) > pages.size() + pageTreeWalkLimit && pagesFoundFromParents < 32) {
+        const int page = findPageFromParents(pageRef);
+        if (page >= 1) {
+            // check the result against the page if it is loaded already
+            Ref loadedRef = Ref::INVALID();
+            if (std::size_t(page) <= pages.size()) {
+                loadedRef = pages[page - 1].second;
+            } else if (const auto ahead = pagesAhead.find(page); ahead != pagesAhead.end()) {
+                loadedRef = ahead->second.second;
+            }
+            if (page <= count && (loadedRef == Ref::INVALID() || loadedRef == pageRef)) {
+                pagesFoundFromParents++;
+                return page;
+            }
+            // don't trust the counts again, find the page the slow way
+            error(errSyntaxWarning, -1, "Page count in pages object is incorrect (page {0:d})", page);
+            pageTreeCountsBad = true;
         }
     }
+
+    cachePageTree(count);
+    it = pageNums.find(pageRef);
+    if (it != pageNums.end()) {
+        return it->second;
+    }
     return 0;
 }
 
@@ -807,6 +1058,7 @@ int Catalog::getNumPages()
                     auto p = std::make_unique<Page>(doc, 1, std::move(pagesDict), pageRef, new PageAttrs(nullptr, pageDict), form);
                     if (p->isOk()) {
                         pages.emplace_back(std::move(p), pageRef);
+                        addPageNum(pageRef, 1);
 
                         numPages = 1;
                     } else {
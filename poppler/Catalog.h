@@ -49,6 +49,7 @@
 
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 class PDFDoc;
@@ -272,6 +273,11 @@ private:
     PDFDoc *doc;
     XRef *xref; // the xref table for this PDF file
     std::vector<std::pair<std::unique_ptr<Page>, Ref>> pages;
+    std::unordered_map<int, std::pair<std::unique_ptr<Page>, Ref>> pagesAhead; // pages found through the page tree counts, ahead of pages
+    std::vector<std::unique_ptr<Page>> stalePages; // pages of pagesAhead that the walk of the page tree didn't confirm
+    std::unordered_map<Ref, int> pageNums; // page number of the pages in pages
+    bool pageTreeCountsBad = false; // the page tree counts can't be used to find pages
+    int pagesFoundFromParents = 0; // calls to findPage answered by findPageFromParents
     std::vector<Object> *pagesList;
     std::vector<Ref> *pagesRefList;
     std::vector<PageAttrs *> *attrsList;
@@ -299,6 +305,10 @@ private:
     Object additionalActions; // page additional actions
 
     bool cachePageTree(int page); // Cache first <page> pages.
+    bool cachePageAhead(int page); // Cache page <page> alone, using the page tree counts.
+    bool findPageInTree(int page);
+    int findPageFromParents(const Ref pageRef); // Page number of <pageRef> according to its parents' counts.
+    void addPageNum(const Ref pageRef, int page);
     Object *findDestInTree(Object *tree, GooString *name, Object *obj);
 
     Object *getNames();
@@ -25,8 +25,15 @@ class CurlPDFDocBuilder : public PDFDocBuilder
 {
 
 public:
+    // At most <cacheMemoryLimitA> bytes of downloaded data are kept in
+    // memory, 0 for no limit; dropped data is downloaded again if needed.
+    explicit CurlPDFDocBuilder(size_t cacheMemoryLimitA = 0) : cacheMemoryLimit(cacheMemoryLimitA) { }
+
     std::unique_ptr<PDFDoc> buildPDFDoc(const GooString &uri, const std::optional<GooString> &ownerPassword = {}, const std::optional<GooString> &userPassword = {}, void *guiDataA = nullptr) override;
     bool supports(const GooString &uri) override;
+
+private:
+    size_t cacheMemoryLimit;
 };
 
 #endif /* CURLPDFDOCBUILDER_H */
@@ -51,7 +51,7 @@ std::unique_ptr<PDFDoc> FileDescriptorPDFDocBuilder::buildPDFDoc(const GooString
         return {};
     }
 
-    CachedFile *cachedFile = new CachedFile(new FILECacheLoader(file));
+    CachedFile *cachedFile = new CachedFile(new FILECacheLoader(file), cacheMemoryLimit, cacheMemoryLimit > 0);
     return std::make_unique<PDFDoc>(new CachedFileStream(cachedFile, 0, false, cachedFile->getLength(), Object(objNull)), ownerPassword, userPassword);
 }
 
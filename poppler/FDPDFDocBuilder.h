@@ -26,11 +26,18 @@ class FileDescriptorPDFDocBuilder : public PDFDocBuilder
 {
 
 public:
+    // At most <cacheMemoryLimitA> bytes of the file are kept in memory, 0
+    // for no limit.  As the file is read in one go, the rest is kept in a
+    // temporary file.
+    explicit FileDescriptorPDFDocBuilder(size_t cacheMemoryLimitA = 0) : cacheMemoryLimit(cacheMemoryLimitA) { }
+
     std::unique_ptr<PDFDoc> buildPDFDoc(const GooString &uri, const std::optional<GooString> &ownerPassword = {}, const std::optional<GooString> &userPassword = {}, void *guiDataA = nullptr) override;
     bool supports(const GooString &uri) override;
 
 private:
     int parseFdFromUri(const GooString &uri);
+
+    size_t cacheMemoryLimit;
 };
 
 #endif /* FDPDFDOCBUILDER_H */
@@ -139,6 +139,7 @@ Hints::Hints(BaseStream *str, Linearization *linearization, XRef *xref, Security
         memset(pageObjectNum, 0, nPages * sizeof(int));
     }
 
+    nSharedGroups = 0;
     groupLength = nullptr;
     groupOffset = nullptr;
     groupHasSignature = nullptr;
@@ -380,7 +381,7 @@ bool Hints::readSharedObjectsTable(Stream *str)
 
     const unsigned int nSharedGroupsFirst = sbr.readBits(32);
 
-    const unsigned int nSharedGroups = sbr.readBits(32);
+    nSharedGroups = sbr.readBits(32);
 
     const unsigned int nBitsNumObjects = sbr.readBits(16);
 
@@ -476,32 +477,55 @@ bool Hints::isOk() const
     return ok;
 }
 
-Goffset Hints::getPageOffset(int page)
+// Index of <page> in the page offset hint table, which lists the first
+// page before all the others, or -1 for a bogus page number.
+int Hints::getPageIndex(int page) const
 {
     if ((page < 1) || (page > nPages)) {
-        return 0;
+        return -1;
     }
 
     if (page - 1 > pageFirst) {
-        return pageOffset[page - 1];
+        return page - 1;
     } else if (page - 1 < pageFirst) {
-        return pageOffset[page];
+        return page;
     } else {
-        return pageOffset[0];
+        return 0;
     }
 }
 
+Goffset Hints::getPageOffset(int page)
+{
+    const int index = getPageIndex(page);
+    return index < 0 ? 0 : pageOffset[index];
+}
+
 int Hints::getPageObjectNum(int page)
 {
-    if ((page < 1) || (page > nPages)) {
-        return 0;
+    const int index = getPageIndex(page);
+    return index < 0 ? 0 : pageObjectNum[index];
+}
+
+std::vector<ByteRange> Hints::getPageRanges(int page)
+{
+    std::vector<ByteRange> ranges;
+
+    const int index = getPageIndex(page);
+    if (!ok || index < 0) {
+        return ranges;
     }
 
-    if (page - 1 > pageFirst) {
-        return pageObjectNum[page - 1];
-    } else if (page - 1 < pageFirst) {
-        return pageObjectNum[page];
-    } else {
-        return pageObjectNum[0];
+    if (pageLength[index] > 0) {
+        ranges.push_back({ (size_t)pageOffset[index], pageLength[index] });
     }
+    if (groupOffset && groupLength) {
+        for (unsigned int i = 0; i < numSharedObject[index]; i++) {
+            const unsigned int group = sharedObjectId[index][i];
+            if (group < nSharedGroups && groupLength[group] > 0) {
+                ranges.push_back({ groupOffset[group], groupLength[group] });
+            }
+        }
+    }
+
+    return ranges;
 }
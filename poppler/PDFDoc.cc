@@ -64,8 +64,10 @@
 #include <config.h>
 #include <poppler-config.h>
 
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <cstdarg>
 #include <clocale>
 #include <cstdio>
 #include <cerrno>
@@ -77,6 +79,7 @@
 #include <iomanip>
 #include <regex>
 #include <sstream>
+#include <unordered_map>
 #include <sys/stat.h>
 #include "goo/glibc.h"
 #include "goo/gstrtod.h"
@@ -86,6 +89,7 @@
 #include "GlobalParams.h"
 #include "Page.h"
 #include "Catalog.h"
+#include "CachedFile.h"
 #include "Stream.h"
 #include "XRef.h"
 #include "Linearization.h"
@@ -825,7 +829,7 @@ Hints *PDFDoc::getHints()
     return hints;
 }
 
-int PDFDoc::savePageAs(const GooString &name, int pageNo)
+int PDFDoc::savePageAs(const GooString &name, int pageNo, XRef *srcXRef)
 {
     FILE *f;
 
@@ -833,16 +837,19 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
         return errFileChangedSinceOpen;
     }
 
-    int rootNum = getXRef()->getNumObjects() + 1;
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
+    int rootNum = srcXRef->getNumObjects() + 1;
 
     // Make sure that special flags are set, because we are going to read
     // all objects, including Unencrypted ones.
-    xref->scanSpecialFlags();
+    srcXRef->scanSpecialFlags();
 
     unsigned char *fileKey;
     CryptAlgorithm encAlgorithm;
     int keyLength;
-    xref->getEncryptionParameters(&fileKey, &encAlgorithm, &keyLength);
+    srcXRef->getEncryptionParameters(&fileKey, &encAlgorithm, &keyLength);
 
     if (pageNo < 1 || pageNo > getNumPages() || !getCatalog()->getPage(pageNo)) {
         error(errInternal, -1, "Illegal pageNo: {0:d}({1:d})", pageNo, getNumPages());
@@ -852,9 +859,10 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     if (getCatalog()->getPage(pageNo)->isCropped()) {
         cropBox = getCatalog()->getPage(pageNo)->getCropBox();
     }
-    replacePageDict(pageNo, getCatalog()->getPage(pageNo)->getRotate(), getCatalog()->getPage(pageNo)->getMediaBox(), cropBox);
-    Ref *refPage = getCatalog()->getPageRef(pageNo);
-    Object page = getXRef()->fetch(*refPage);
+    replacePageDict(pageNo, getCatalog()->getPage(pageNo)->getRotate(), getCatalog()->getPage(pageNo)->getMediaBox(), cropBox, srcXRef);
+    // copied, other threads may load more of the page tree meanwhile
+    const Ref refPage = *getCatalog()->getPageRef(pageNo);
+    Object page = srcXRef->fetch(refPage);
 
     if (!(f = openFile(name.c_str(), "wb"))) {
         error(errIO, -1, "Couldn't open file '{0:t}'", &name);
@@ -864,30 +872,30 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     const std::unique_ptr<FILE, FILECloser> fileCloser(f);
     const std::unique_ptr<OutStream> outStr = std::make_unique<FileOutStream>(f, 0);
 
-    const std::unique_ptr<XRef> yRef = std::make_unique<XRef>(getXRef()->getTrailerDict());
+    const std::unique_ptr<XRef> yRef = std::make_unique<XRef>(srcXRef->getTrailerDict());
 
     if (secHdlr != nullptr && !secHdlr->isUnencrypted()) {
         yRef->setEncryption(secHdlr->getPermissionFlags(), secHdlr->getOwnerPasswordOk(), fileKey, keyLength, secHdlr->getEncVersion(), secHdlr->getEncRevision(), encAlgorithm);
     }
-    const std::unique_ptr<XRef> countRef = std::make_unique<XRef>();
-    Object *trailerObj = getXRef()->getTrailerDict();
+    std::vector<bool> markedObjects;
+    Object *trailerObj = srcXRef->getTrailerDict();
     if (trailerObj->isDict()) {
-        markPageObjects(trailerObj->getDict(), yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+        markPageObjects(trailerObj->getDict(), yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
     }
     yRef->add(0, 65535, 0, false);
     writeHeader(outStr.get(), getPDFMajorVersion(), getPDFMinorVersion());
 
     // get and mark info dict
-    Object infoObj = getXRef()->getDocInfo();
+    Object infoObj = srcXRef->getDocInfo();
     if (infoObj.isDict()) {
         Dict *infoDict = infoObj.getDict();
-        markPageObjects(infoDict, yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+        markPageObjects(infoDict, yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
         if (trailerObj->isDict()) {
             Dict *trailerDict = trailerObj->getDict();
             const Object &ref = trailerDict->lookupNF("Info");
             if (ref.isRef()) {
                 yRef->add(ref.getRef(), 0, true);
-                if (getXRef()->getEntry(ref.getRef().num)->type == xrefEntryCompressed) {
+                if (srcXRef->getEntry(ref.getRef().num)->type == xrefEntryCompressed) {
                     yRef->getEntry(ref.getRef().num)->type = xrefEntryCompressed;
                 }
             }
@@ -895,7 +903,7 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     }
 
     // get and mark output intents etc.
-    Object catObj = getXRef()->getCatalog();
+    Object catObj = srcXRef->getCatalog();
     if (!catObj.isDict()) {
         error(errSyntaxError, -1, "XRef's Catalog is not a dictionary");
         return errOpenFile;
@@ -908,14 +916,14 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     }
     Object afObj = catDict->lookupNF("AcroForm").copy();
     if (!afObj.isNull()) {
-        markAcroForm(&afObj, yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+        markAcroForm(&afObj, yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
     }
     Dict *pagesDict = pagesObj.getDict();
     Object resourcesObj = pagesDict->lookup("Resources");
     if (resourcesObj.isDict()) {
-        markPageObjects(resourcesObj.getDict(), yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+        markPageObjects(resourcesObj.getDict(), yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
     }
-    if (!markPageObjects(catDict, yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2)) {
+    if (!markPageObjects(catDict, yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef)) {
         error(errSyntaxError, -1, "markPageObjects failed");
         return errDamaged;
     }
@@ -929,16 +937,16 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
         Object *resourceDictObject = getCatalog()->getPage(pageNo)->getResourceDictObject();
         if (resourceDictObject->isDict()) {
             resourcesObj = resourceDictObject->copy();
-            markPageObjects(resourcesObj.getDict(), yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+            markPageObjects(resourcesObj.getDict(), yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
         }
     }
-    markPageObjects(pageDict, yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+    markPageObjects(pageDict, yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
     Object annotsObj = pageDict->lookupNF("Annots").copy();
     if (!annotsObj.isNull()) {
-        markAnnotations(&annotsObj, yRef.get(), countRef.get(), 0, refPage->num, rootNum + 2);
+        markAnnotations(&annotsObj, yRef.get(), &markedObjects, 0, refPage.num, rootNum + 2, srcXRef);
     }
     yRef->markUnencrypted();
-    writePageObjects(outStr.get(), yRef.get(), 0);
+    writePageObjects(outStr.get(), yRef.get(), 0, false, -1, srcXRef);
 
     yRef->add(rootNum, 0, outStr->getPos(), true);
     outStr->printf("%d 0 obj\n", rootNum);
@@ -951,7 +959,7 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
             }
             Object value = catDict->getValNF(j).copy();
             outStr->printf("/%s ", key);
-            writeObject(&value, outStr.get(), getXRef(), 0, nullptr, cryptRC4, 0, 0, 0);
+            writeObject(&value, outStr.get(), srcXRef, 0, nullptr, cryptRC4, 0, 0, 0);
         }
     }
     outStr->printf(">>\nendobj\n");
@@ -961,7 +969,7 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     outStr->printf("<< /Type /Pages /Kids [ %d 0 R ] /Count 1 ", rootNum + 2);
     if (resourcesObj.isDict()) {
         outStr->printf("/Resources ");
-        writeObject(&resourcesObj, outStr.get(), getXRef(), 0, nullptr, cryptRC4, 0, 0, 0);
+        writeObject(&resourcesObj, outStr.get(), srcXRef, 0, nullptr, cryptRC4, 0, 0, 0);
     }
     outStr->printf(">>\n");
     outStr->printf("endobj\n");
@@ -979,7 +987,7 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
             outStr->printf("/Parent %d 0 R", rootNum + 1);
         } else {
             outStr->printf("/%s ", key);
-            writeObject(&value, outStr.get(), getXRef(), 0, nullptr, cryptRC4, 0, 0, 0);
+            writeObject(&value, outStr.get(), srcXRef, 0, nullptr, cryptRC4, 0, 0, 0);
         }
     }
     outStr->printf(" >>\nendobj\n");
@@ -988,8 +996,8 @@ int PDFDoc::savePageAs(const GooString &name, int pageNo)
     Ref ref;
     ref.num = rootNum;
     ref.gen = 0;
-    Object trailerDict = createTrailerDict(rootNum + 3, false, 0, &ref, getXRef(), name.c_str(), uxrefOffset);
-    writeXRefTableTrailer(std::move(trailerDict), yRef.get(), false /* do not write unnecessary entries */, uxrefOffset, outStr.get(), getXRef());
+    Object trailerDict = createTrailerDict(rootNum + 3, false, 0, &ref, srcXRef, name.c_str(), uxrefOffset);
+    writeXRefTableTrailer(std::move(trailerDict), yRef.get(), false /* do not write unnecessary entries */, uxrefOffset, outStr.get(), srcXRef);
 
     outStr->close();
 
@@ -1031,6 +1039,34 @@ int PDFDoc::saveAs(OutStream *outStr, PDFWriteMode mode)
     return errNone;
 }
 
+int PDFDoc::saveAs(const GooString &name, const PDFRewriteOptions &options)
+{
+    FILE *f;
+    OutStream *outStr;
+    int res;
+
+    if (!(f = openFile(name.c_str(), "wb"))) {
+        error(errIO, -1, "Couldn't open file '{0:t}'", &name);
+        return errOpenFile;
+    }
+    outStr = new FileOutStream(f, 0);
+    res = saveAs(outStr, options);
+    delete outStr;
+    fclose(f);
+    return res;
+}
+
+int PDFDoc::saveAs(OutStream *outStr, const PDFRewriteOptions &options)
+{
+    if (file && file->modificationTimeChangedSinceOpen()) {
+        return errFileChangedSinceOpen;
+    }
+
+    saveCompleteRewrite(outStr, options);
+
+    return errNone;
+}
+
 int PDFDoc::saveWithoutChangesAs(const GooString &name)
 {
     FILE *f;
@@ -1152,7 +1188,193 @@ void PDFDoc::saveIncrementalUpdate(OutStream *outStr)
     delete uxref;
 }
 
-void PDFDoc::saveCompleteRewrite(OutStream *outStr)
+namespace {
+
+// Collects objects for an object stream (PDF 1.5)
+class ObjectStreamBuilder
+{
+public:
+    // The number of objects put in a single object stream
+    static const int maxObjects = 100;
+
+    int getCount() const { return count; }
+
+    // Append <obj>, stored as object <ref>, and return its index in
+    // the object stream
+    int add(Object *obj, Ref ref, XRef *xref)
+    {
+        if (count > 0) {
+            data.put('\n');
+        }
+        header.append(std::to_string(ref.num)).append(" ").append(std::to_string(data.getPos())).append(" ");
+        PDFDoc::writeObject(obj, &data, xref, 0, nullptr, cryptRC4, 0, ref);
+        return count++;
+    }
+
+    // Return the object stream holding the objects added so far, and
+    // start a new one
+    Object take(XRef *xref)
+    {
+        const std::string body = data.takeString();
+        const size_t length = header.size() + body.size();
+        char *buf = (char *)gmalloc(length);
+        memcpy(buf, header.data(), header.size());
+        memcpy(buf + header.size(), body.data(), body.size());
+
+        Dict *dict = new Dict(xref);
+        dict->add("Type", Object(objName, "ObjStm"));
+        dict->add("N", Object(count));
+        dict->add("First", Object((int)header.size()));
+        dict->add("Filter", Object(objName, "FlateDecode"));
+
+        header.clear();
+        count = 0;
+
+        return Object(static_cast<Stream *>(new AutoFreeMemStream(buf, 0, length, Object(dict))));
+    }
+
+private:
+    int count = 0;
+    std::string header;
+    StringOutStream data;
+};
+
+}
+
+// Return a Flate compressed copy of <str>, which has no filter
+static Object makeCompressedStream(Stream *str, XRef *xref)
+{
+    std::vector<char> data;
+    str->reset();
+    for (int c = str->getChar(); c != EOF; c = str->getChar()) {
+        data.push_back(c);
+    }
+    str->close();
+
+    char *buf = (char *)gmalloc(std::max<size_t>(data.size(), 1));
+    memcpy(buf, data.data(), data.size());
+    Dict *dict = str->getDict()->copy(xref);
+    dict->set("Filter", Object(objName, "FlateDecode"));
+    dict->remove("DecodeParms");
+    return Object(static_cast<Stream *>(new AutoFreeMemStream(buf, 0, data.size(), Object(dict))));
+}
+
+// Find the streams that have the same dictionary and data as a stream
+// with a lower object number.  Returns a map from the object number of
+// each duplicate to the reference of the stream that is kept.
+static std::unordered_map<int, Ref> findDuplicateStreams(XRef *xref)
+{
+    std::unordered_map<int, Ref> duplicates;
+    std::unordered_map<size_t, std::vector<Ref>> streamsByHash;
+
+    auto serialize = [xref](Ref ref) {
+        StringOutStream out;
+        Object obj = xref->fetch(ref, 1 /* recursion */);
+        if (obj.isStream()) {
+            PDFDoc::writeObject(&obj, &out, xref, 0, nullptr, cryptRC4, 0, ref);
+        }
+        return out.takeString();
+    };
+
+    for (int i = 0; i < xref->getNumObjects(); i++) {
+        XRefEntry *e = xref->getEntry(i);
+        if (e->type != xrefEntryUncompressed || e->getFlag(XRefEntry::DontRewrite) || e->getFlag(XRefEntry::Unencrypted)) {
+            continue;
+        }
+        const Ref ref = { i, e->gen };
+        const std::string data = serialize(ref);
+        if (data.empty()) {
+            continue;
+        }
+        std::vector<Ref> &candidates = streamsByHash[std::hash<std::string> {}(data)];
+        bool found = false;
+        for (const Ref &candidate : candidates) {
+            if (serialize(candidate) == data) {
+                duplicates.emplace(i, candidate);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            candidates.push_back(ref);
+        }
+    }
+
+    return duplicates;
+}
+
+// Replace the references to duplicated streams in <obj>.  Arrays and
+// dictionaries are copied before being changed, stream dictionaries
+// are changed in place.  Returns true if anything was replaced.
+static bool replaceDuplicateRefs(Object *obj, const std::unordered_map<int, Ref> &duplicates, XRef *xref, int recursion = 0)
+{
+    if (recursion > 100) {
+        return false;
+    }
+
+    switch (obj->getType()) {
+    case objRef: {
+        const auto it = duplicates.find(obj->getRefNum());
+        if (it == duplicates.end()) {
+            return false;
+        }
+        *obj = Object(it->second);
+        return true;
+    }
+    case objArray: {
+        Array *array = obj->getArray();
+        std::vector<Object> elems;
+        bool changed = false;
+        for (int i = 0; i < array->getLength(); i++) {
+            elems.push_back(array->getNF(i).copy());
+            changed |= replaceDuplicateRefs(&elems.back(), duplicates, xref, recursion + 1);
+        }
+        if (!changed) {
+            return false;
+        }
+        Array *newArray = new Array(xref);
+        for (Object &elem : elems) {
+            newArray->add(std::move(elem));
+        }
+        *obj = Object(newArray);
+        return true;
+    }
+    case objDict: {
+        Dict *dict = obj->getDict();
+        Dict *newDict = nullptr;
+        for (int i = 0; i < dict->getLength(); i++) {
+            Object val = dict->getValNF(i).copy();
+            if (replaceDuplicateRefs(&val, duplicates, xref, recursion + 1)) {
+                if (!newDict) {
+                    newDict = dict->copy(xref);
+                }
+                newDict->set(dict->getKey(i), std::move(val));
+            }
+        }
+        if (!newDict) {
+            return false;
+        }
+        *obj = Object(newDict);
+        return true;
+    }
+    case objStream: {
+        Dict *dict = obj->getStream()->getDict();
+        bool changed = false;
+        for (int i = 0; i < dict->getLength(); i++) {
+            Object val = dict->getValNF(i).copy();
+            if (replaceDuplicateRefs(&val, duplicates, xref, recursion + 1)) {
+                dict->set(dict->getKey(i), std::move(val));
+                changed = true;
+            }
+        }
+        return changed;
+    }
+    default:
+        return false;
+    }
+}
+
+void PDFDoc::saveCompleteRewrite(OutStream *outStr, const PDFRewriteOptions &options)
 {
     // Make sure that special flags are set, because we are going to read
     // all objects, including Unencrypted ones.
@@ -1163,52 +1385,101 @@ void PDFDoc::saveCompleteRewrite(OutStream *outStr)
     int keyLength;
     xref->getEncryptionParameters(&fileKey, &encAlgorithm, &keyLength);
 
-    writeHeader(outStr, getPDFMajorVersion(), getPDFMinorVersion());
+    int minorVersion = getPDFMinorVersion();
+    if (options.useObjectStreams && getPDFMajorVersion() == 1 && minorVersion < 5) {
+        minorVersion = 5;
+    }
+    writeHeader(outStr, getPDFMajorVersion(), minorVersion);
     XRef *uxref = new XRef();
     uxref->add(0, 65535, 0, false);
     xref->lock();
+
+    std::unordered_map<int, Ref> duplicates;
+    if (options.deduplicateStreams) {
+        duplicates = findDuplicateStreams(xref);
+    }
+
+    // object streams and the xref stream are numbered after the
+    // objects of the document
+    int nextObjNum = xref->getNumObjects();
+    ObjectStreamBuilder objStream;
+    Ref objStreamRef = Ref::INVALID();
+    auto writeObjectStream = [&]() {
+        Object obj1 = objStream.take(getXRef());
+        Goffset offset = writeObjectHeader(&objStreamRef, outStr);
+        writeObject(&obj1, outStr, fileKey, encAlgorithm, keyLength, objStreamRef);
+        writeObjectFooter(outStr);
+        uxref->add(objStreamRef, offset, true);
+    };
+
     for (int i = 0; i < xref->getNumObjects(); i++) {
         Ref ref;
-        XRefEntryType type = xref->getEntry(i)->type;
+        XRefEntry *entry = xref->getEntry(i);
+        XRefEntryType type = entry->type;
         if (type == xrefEntryFree) {
             ref.num = i;
-            ref.gen = xref->getEntry(i)->gen;
+            ref.gen = entry->gen;
             /* the XRef class adds a lot of irrelevant free entries, we only want the significant one
                 and we don't want the one with num=0 because it has already been added (gen = 65535)*/
             if (ref.gen > 0 && ref.num > 0) {
                 uxref->add(ref, 0, false);
             }
-        } else if (xref->getEntry(i)->getFlag(XRefEntry::DontRewrite)) {
+        } else if (entry->getFlag(XRefEntry::DontRewrite) || duplicates.count(i)) {
             // This entry must not be written, put a free entry instead (with incremented gen)
             ref.num = i;
-            ref.gen = xref->getEntry(i)->gen + 1;
+            ref.gen = entry->gen + 1;
             uxref->add(ref, 0, false);
-        } else if (type == xrefEntryUncompressed) {
+        } else if (type == xrefEntryUncompressed || type == xrefEntryCompressed) {
             ref.num = i;
-            ref.gen = xref->getEntry(i)->gen;
+            ref.gen = type == xrefEntryCompressed ? 0 : entry->gen; // compressed entries have gen == 0
+            // Write unencrypted objects in unencrypted form
+            const bool unencrypted = type == xrefEntryUncompressed && entry->getFlag(XRefEntry::Unencrypted);
             Object obj1 = xref->fetch(ref, 1 /* recursion */);
+            if (!duplicates.empty()) {
+                replaceDuplicateRefs(&obj1, duplicates, getXRef());
+            }
+            if (options.compressStreams && obj1.isStream() && obj1.streamGetDict()->lookup("Filter").isNull() && !obj1.streamGetDict()->lookup("Type").isName("Metadata")) {
+                obj1 = makeCompressedStream(obj1.getStream(), getXRef());
+            }
+
+            if (options.useObjectStreams && !obj1.isStream() && ref.gen == 0 && !unencrypted) {
+                if (objStream.getCount() == 0) {
+                    objStreamRef = { nextObjNum++, 0 };
+                }
+                uxref->addCompressed(ref.num, objStreamRef.num, objStream.add(&obj1, ref, getXRef()));
+                if (objStream.getCount() == ObjectStreamBuilder::maxObjects) {
+                    writeObjectStream();
+                }
+                continue;
+            }
+
             Goffset offset = writeObjectHeader(&ref, outStr);
-            // Write unencrypted objects in unencrypted form
-            if (xref->getEntry(i)->getFlag(XRefEntry::Unencrypted)) {
+            if (unencrypted) {
                 writeObject(&obj1, outStr, nullptr, cryptRC4, 0, 0, 0);
             } else {
                 writeObject(&obj1, outStr, fileKey, encAlgorithm, keyLength, ref);
             }
             writeObjectFooter(outStr);
             uxref->add(ref, offset, true);
-        } else if (type == xrefEntryCompressed) {
-            ref.num = i;
-            ref.gen = 0; // compressed entries have gen == 0
-            Object obj1 = xref->fetch(ref, 1 /* recursion */);
-            Goffset offset = writeObjectHeader(&ref, outStr);
-            writeObject(&obj1, outStr, fileKey, encAlgorithm, keyLength, ref);
-            writeObjectFooter(outStr);
-            uxref->add(ref, offset, true);
         }
     }
+    if (objStream.getCount() > 0) {
+        writeObjectStream();
+    }
     xref->unlock();
     Goffset uxrefOffset = outStr->getPos();
-    writeXRefTableTrailer(uxrefOffset, uxref, true /* write all entries */, uxref->getNumObjects(), outStr, false /* complete rewrite */);
+    if (options.useObjectStreams) {
+        // object streams can only be referenced from an xref stream
+        Ref uxrefStreamRef = { nextObjNum++, 0 };
+        uxref->add(uxrefStreamRef, uxrefOffset, true);
+        const char *fileNameA = fileName ? fileName->c_str() : nullptr;
+        Ref rootRef = { getXRef()->getRootNum(), getXRef()->getRootGen() };
+        Object trailerDict = createTrailerDict(nextObjNum, false, 0, &rootRef, getXRef(), fileNameA, getFileSize());
+        trailerDict.dictSet("Filter", Object(objName, "FlateDecode"));
+        writeXRefStreamTrailer(std::move(trailerDict), uxref, &uxrefStreamRef, uxrefOffset, outStr, getXRef());
+    } else {
+        writeXRefTableTrailer(uxrefOffset, uxref, true /* write all entries */, uxref->getNumObjects(), outStr, false /* complete rewrite */);
+    }
     delete uxref;
 }
 
@@ -1654,6 +1925,15 @@ void PDFDoc::writeXRefStreamTrailer(Object &&trailerDict, XRef *uxref, Ref *uxre
 void PDFDoc::writeXRefTableTrailer(Goffset uxrefOffset, XRef *uxref, bool writeAllEntries, int uxrefSize, OutStream *outStr, bool incrUpdate)
 {
     const char *fileNameA = fileName ? fileName->c_str() : nullptr;
+    Ref ref;
+    ref.num = getXRef()->getRootNum();
+    ref.gen = getXRef()->getRootGen();
+    Object trailerDict = createTrailerDict(uxrefSize, incrUpdate, getStartXRef(), &ref, getXRef(), fileNameA, getFileSize());
+    writeXRefTableTrailer(std::move(trailerDict), uxref, writeAllEntries, uxrefOffset, outStr, getXRef());
+}
+
+Goffset PDFDoc::getFileSize()
+{
     // file size (doesn't include the trailer)
     unsigned int fileSize = 0;
     int c;
@@ -1662,11 +1942,7 @@ void PDFDoc::writeXRefTableTrailer(Goffset uxrefOffset, XRef *uxref, bool writeA
         fileSize++;
     }
     str->close();
-    Ref ref;
-    ref.num = getXRef()->getRootNum();
-    ref.gen = getXRef()->getRootGen();
-    Object trailerDict = createTrailerDict(uxrefSize, incrUpdate, getStartXRef(), &ref, getXRef(), fileNameA, fileSize);
-    writeXRefTableTrailer(std::move(trailerDict), uxref, writeAllEntries, uxrefOffset, outStr, getXRef());
+    return fileSize;
 }
 
 void PDFDoc::writeHeader(OutStream *outStr, int major, int minor)
@@ -1675,48 +1951,39 @@ void PDFDoc::writeHeader(OutStream *outStr, int major, int minor)
     outStr->printf("%%%c%c%c%c\n", 0xE2, 0xE3, 0xCF, 0xD3);
 }
 
-bool PDFDoc::markDictionary(Dict *dict, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts)
+bool PDFDoc::markDictionary(Dict *dict, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef)
 {
-    bool deleteSet = false;
-    if (!alreadyMarkedDicts) {
-        alreadyMarkedDicts = new std::set<Dict *>;
-        deleteSet = true;
-    }
-
-    if (alreadyMarkedDicts->find(dict) != alreadyMarkedDicts->end()) {
-        error(errSyntaxWarning, -1, "PDFDoc::markDictionary: Found recursive dicts");
-        if (deleteSet) {
-            delete alreadyMarkedDicts;
-        }
-        return true;
-    } else {
-        alreadyMarkedDicts->insert(dict);
-    }
-
     for (int i = 0; i < dict->getLength(); i++) {
         const char *key = dict->getKey(i);
         if (strcmp(key, "Annots") != 0) {
             Object obj1 = dict->getValNF(i).copy();
-            const bool success = markObject(&obj1, xRef, countRef, numOffset, oldRefNum, newRefNum, alreadyMarkedDicts);
+            const bool success = markObject(&obj1, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
             if (unlikely(!success)) {
                 return false;
             }
         } else {
             Object annotsObj = dict->getValNF(i).copy();
             if (!annotsObj.isNull()) {
-                markAnnotations(&annotsObj, xRef, countRef, 0, oldRefNum, newRefNum, alreadyMarkedDicts);
+                markAnnotations(&annotsObj, xRef, markedObjects, 0, oldRefNum, newRefNum, srcXRef);
             }
         }
     }
 
-    if (deleteSet) {
-        delete alreadyMarkedDicts;
-    }
+    return true;
+}
 
+bool PDFDoc::setMarked(std::vector<bool> *markedObjects, int num)
+{
+    if (num >= (int)markedObjects->size()) {
+        markedObjects->resize(num + 1);
+    } else if ((*markedObjects)[num]) {
+        return false;
+    }
+    (*markedObjects)[num] = true;
     return true;
 }
 
-bool PDFDoc::markObject(Object *obj, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts)
+bool PDFDoc::markObject(Object *obj, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef)
 {
     Array *array;
 
@@ -1725,49 +1992,44 @@ bool PDFDoc::markObject(Object *obj, XRef *xRef, XRef *countRef, unsigned int nu
         array = obj->getArray();
         for (int i = 0; i < array->getLength(); i++) {
             Object obj1 = array->getNF(i).copy();
-            const bool success = markObject(&obj1, xRef, countRef, numOffset, oldRefNum, newRefNum, alreadyMarkedDicts);
+            const bool success = markObject(&obj1, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
             if (unlikely(!success)) {
                 return false;
             }
         }
         break;
     case objDict: {
-        const bool success = markDictionary(obj->getDict(), xRef, countRef, numOffset, oldRefNum, newRefNum, alreadyMarkedDicts);
+        const bool success = markDictionary(obj->getDict(), xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
         if (unlikely(!success)) {
             return false;
         }
     } break;
     case objStream: {
         Stream *stream = obj->getStream();
-        const bool success = markDictionary(stream->getDict(), xRef, countRef, numOffset, oldRefNum, newRefNum, alreadyMarkedDicts);
+        const bool success = markDictionary(stream->getDict(), xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
         if (unlikely(!success)) {
             return false;
         }
     } break;
     case objRef: {
         if (obj->getRef().num + (int)numOffset >= xRef->getNumObjects() || xRef->getEntry(obj->getRef().num + numOffset)->type == xrefEntryFree) {
-            if (getXRef()->getEntry(obj->getRef().num)->type == xrefEntryFree) {
+            if (srcXRef->getEntry(obj->getRef().num)->type == xrefEntryFree) {
                 return true; // already marked as free => should be replaced
             }
             const bool success = xRef->add(obj->getRef().num + numOffset, obj->getRef().gen, 0, true);
             if (unlikely(!success)) {
                 return false;
             }
-            if (getXRef()->getEntry(obj->getRef().num)->type == xrefEntryCompressed) {
+            if (srcXRef->getEntry(obj->getRef().num)->type == xrefEntryCompressed) {
                 xRef->getEntry(obj->getRef().num + numOffset)->type = xrefEntryCompressed;
             }
         }
-        if (obj->getRef().num + (int)numOffset >= countRef->getNumObjects() || countRef->getEntry(obj->getRef().num + numOffset)->type == xrefEntryFree) {
-            countRef->add(obj->getRef().num + numOffset, 1, 0, true);
-        } else {
-            XRefEntry *entry = countRef->getEntry(obj->getRef().num + numOffset);
-            entry->gen++;
-            if (entry->gen > 9) {
-                break;
-            }
+        // the objects used by an already marked object are marked too
+        if (!setMarked(markedObjects, obj->getRef().num + numOffset)) {
+            break;
         }
-        Object obj1 = getXRef()->fetch(obj->getRef());
-        const bool success = markObject(&obj1, xRef, countRef, numOffset, oldRefNum, newRefNum);
+        Object obj1 = srcXRef->fetch(obj->getRef());
+        const bool success = markObject(&obj1, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
         if (unlikely(!success)) {
             return false;
         }
@@ -1779,10 +2041,13 @@ bool PDFDoc::markObject(Object *obj, XRef *xRef, XRef *countRef, unsigned int nu
     return true;
 }
 
-bool PDFDoc::replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBox, const PDFRectangle *cropBox)
+bool PDFDoc::replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBox, const PDFRectangle *cropBox, XRef *srcXRef)
 {
-    Ref *refPage = getCatalog()->getPageRef(pageNo);
-    Object page = getXRef()->fetch(*refPage);
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
+    const Ref refPage = *getCatalog()->getPageRef(pageNo);
+    Object page = srcXRef->fetch(refPage);
     if (!page.isDict()) {
         return false;
     }
@@ -1794,7 +2059,7 @@ bool PDFDoc::replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBo
     pageDict->remove("BleedBox");
     pageDict->remove("TrimBox");
     pageDict->remove("Rotate");
-    Array *mediaBoxArray = new Array(getXRef());
+    Array *mediaBoxArray = new Array(srcXRef);
     mediaBoxArray->add(Object(mediaBox->x1));
     mediaBoxArray->add(Object(mediaBox->y1));
     mediaBoxArray->add(Object(mediaBox->x2));
@@ -1803,7 +2068,7 @@ bool PDFDoc::replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBo
     Object trimBoxObject = mediaBoxObject.copy();
     pageDict->add("MediaBox", std::move(mediaBoxObject));
     if (cropBox != nullptr) {
-        Array *cropBoxArray = new Array(getXRef());
+        Array *cropBoxArray = new Array(srcXRef);
         cropBoxArray->add(Object(cropBox->x1));
         cropBoxArray->add(Object(cropBox->y1));
         cropBoxArray->add(Object(cropBox->x2));
@@ -1814,12 +2079,15 @@ bool PDFDoc::replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBo
     }
     pageDict->add("TrimBox", std::move(trimBoxObject));
     pageDict->add("Rotate", Object(rotate));
-    getXRef()->setModifiedObject(&page, *refPage);
+    srcXRef->setModifiedObject(&page, refPage);
     return true;
 }
 
-bool PDFDoc::markPageObjects(Dict *pageDict, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts)
+bool PDFDoc::markPageObjects(Dict *pageDict, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef)
 {
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
     pageDict->remove("OpenAction");
     pageDict->remove("Outlines");
     pageDict->remove("StructTreeRoot");
@@ -1828,7 +2096,7 @@ bool PDFDoc::markPageObjects(Dict *pageDict, XRef *xRef, XRef *countRef, unsigne
         const char *key = pageDict->getKey(n);
         Object value = pageDict->getValNF(n).copy();
         if (strcmp(key, "Parent") != 0 && strcmp(key, "Pages") != 0 && strcmp(key, "AcroForm") != 0 && strcmp(key, "Annots") != 0 && strcmp(key, "P") != 0 && strcmp(key, "Root") != 0) {
-            const bool success = markObject(&value, xRef, countRef, numOffset, oldRefNum, newRefNum, alreadyMarkedDicts);
+            const bool success = markObject(&value, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
             if (unlikely(!success)) {
                 return false;
             }
@@ -1837,10 +2105,13 @@ bool PDFDoc::markPageObjects(Dict *pageDict, XRef *xRef, XRef *countRef, unsigne
     return true;
 }
 
-bool PDFDoc::markAnnotations(Object *annotsObj, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldPageNum, int newPageNum, std::set<Dict *> *alreadyMarkedDicts)
+bool PDFDoc::markAnnotations(Object *annotsObj, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldPageNum, int newPageNum, XRef *srcXRef)
 {
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
     bool modified = false;
-    Object annots = annotsObj->fetch(getXRef());
+    Object annots = annotsObj->fetch(srcXRef);
     if (annots.isArray()) {
         Array *array = annots.getArray();
         for (int i = array->getLength() - 1; i >= 0; i--) {
@@ -1858,12 +2129,12 @@ bool PDFDoc::markAnnotations(Object *annotsObj, XRef *xRef, XRef *countRef, unsi
                                 r.num = newPageNum;
                                 r.gen = 0;
                                 dict->set("P", Object(r));
-                                getXRef()->setModifiedObject(&obj1, obj3.getRef());
+                                srcXRef->setModifiedObject(&obj1, obj3.getRef());
                             }
                         } else if (obj2.getRef().num == newPageNum) {
                             continue;
                         } else {
-                            Object page = getXRef()->fetch(obj2.getRef());
+                            Object page = srcXRef->fetch(obj2.getRef());
                             if (page.isDict()) {
                                 Dict *pageDict = page.getDict();
                                 Object pagetype = pageDict->lookup("Type");
@@ -1877,106 +2148,100 @@ bool PDFDoc::markAnnotations(Object *annotsObj, XRef *xRef, XRef *countRef, unsi
                         }
                     }
                 }
-                markPageObjects(dict, xRef, countRef, numOffset, oldPageNum, newPageNum, alreadyMarkedDicts);
+                markPageObjects(dict, xRef, markedObjects, numOffset, oldPageNum, newPageNum, srcXRef);
             }
             obj1 = array->getNF(i).copy();
             if (obj1.isRef()) {
                 if (obj1.getRef().num + (int)numOffset >= xRef->getNumObjects() || xRef->getEntry(obj1.getRef().num + numOffset)->type == xrefEntryFree) {
-                    if (getXRef()->getEntry(obj1.getRef().num)->type == xrefEntryFree) {
+                    if (srcXRef->getEntry(obj1.getRef().num)->type == xrefEntryFree) {
                         continue; // already marked as free => should be replaced
                     }
                     xRef->add(obj1.getRef().num + numOffset, obj1.getRef().gen, 0, true);
-                    if (getXRef()->getEntry(obj1.getRef().num)->type == xrefEntryCompressed) {
+                    if (srcXRef->getEntry(obj1.getRef().num)->type == xrefEntryCompressed) {
                         xRef->getEntry(obj1.getRef().num + numOffset)->type = xrefEntryCompressed;
                     }
                 }
-                if (obj1.getRef().num + (int)numOffset >= countRef->getNumObjects() || countRef->getEntry(obj1.getRef().num + numOffset)->type == xrefEntryFree) {
-                    countRef->add(obj1.getRef().num + numOffset, 1, 0, true);
-                } else {
-                    XRefEntry *entry = countRef->getEntry(obj1.getRef().num + numOffset);
-                    entry->gen++;
-                }
+                setMarked(markedObjects, obj1.getRef().num + numOffset);
             }
         }
     }
     if (annotsObj->isRef()) {
         if (annotsObj->getRef().num + (int)numOffset >= xRef->getNumObjects() || xRef->getEntry(annotsObj->getRef().num + numOffset)->type == xrefEntryFree) {
-            if (getXRef()->getEntry(annotsObj->getRef().num)->type == xrefEntryFree) {
+            if (srcXRef->getEntry(annotsObj->getRef().num)->type == xrefEntryFree) {
                 return modified; // already marked as free => should be replaced
             }
             xRef->add(annotsObj->getRef().num + numOffset, annotsObj->getRef().gen, 0, true);
-            if (getXRef()->getEntry(annotsObj->getRef().num)->type == xrefEntryCompressed) {
+            if (srcXRef->getEntry(annotsObj->getRef().num)->type == xrefEntryCompressed) {
                 xRef->getEntry(annotsObj->getRef().num + numOffset)->type = xrefEntryCompressed;
             }
         }
-        if (annotsObj->getRef().num + (int)numOffset >= countRef->getNumObjects() || countRef->getEntry(annotsObj->getRef().num + numOffset)->type == xrefEntryFree) {
-            countRef->add(annotsObj->getRef().num + numOffset, 1, 0, true);
-        } else {
-            XRefEntry *entry = countRef->getEntry(annotsObj->getRef().num + numOffset);
-            entry->gen++;
-        }
-        getXRef()->setModifiedObject(&annots, annotsObj->getRef());
+        setMarked(markedObjects, annotsObj->getRef().num + numOffset);
+        srcXRef->setModifiedObject(&annots, annotsObj->getRef());
     }
     return modified;
 }
 
-void PDFDoc::markAcroForm(Object *afObj, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum)
+void PDFDoc::markAcroForm(Object *afObj, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef)
 {
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
     bool modified = false;
-    Object acroform = afObj->fetch(getXRef());
+    Object acroform = afObj->fetch(srcXRef);
     if (acroform.isDict()) {
         Dict *dict = acroform.getDict();
         for (int i = 0; i < dict->getLength(); i++) {
             if (strcmp(dict->getKey(i), "Fields") == 0) {
                 Object fields = dict->getValNF(i).copy();
-                modified = markAnnotations(&fields, xRef, countRef, numOffset, oldRefNum, newRefNum);
+                modified = markAnnotations(&fields, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
             } else {
                 Object obj = dict->getValNF(i).copy();
-                markObject(&obj, xRef, countRef, numOffset, oldRefNum, newRefNum);
+                markObject(&obj, xRef, markedObjects, numOffset, oldRefNum, newRefNum, srcXRef);
             }
         }
     }
     if (afObj->isRef()) {
         if (afObj->getRef().num + (int)numOffset >= xRef->getNumObjects() || xRef->getEntry(afObj->getRef().num + numOffset)->type == xrefEntryFree) {
-            if (getXRef()->getEntry(afObj->getRef().num)->type == xrefEntryFree) {
+            if (srcXRef->getEntry(afObj->getRef().num)->type == xrefEntryFree) {
                 return; // already marked as free => should be replaced
             }
             xRef->add(afObj->getRef().num + numOffset, afObj->getRef().gen, 0, true);
-            if (getXRef()->getEntry(afObj->getRef().num)->type == xrefEntryCompressed) {
+            if (srcXRef->getEntry(afObj->getRef().num)->type == xrefEntryCompressed) {
                 xRef->getEntry(afObj->getRef().num + numOffset)->type = xrefEntryCompressed;
             }
         }
-        if (afObj->getRef().num + (int)numOffset >= countRef->getNumObjects() || countRef->getEntry(afObj->getRef().num + numOffset)->type == xrefEntryFree) {
-            countRef->add(afObj->getRef().num + numOffset, 1, 0, true);
-        } else {
-            XRefEntry *entry = countRef->getEntry(afObj->getRef().num + numOffset);
-            entry->gen++;
-        }
+        setMarked(markedObjects, afObj->getRef().num + numOffset);
         if (modified) {
-            getXRef()->setModifiedObject(&acroform, afObj->getRef());
+            srcXRef->setModifiedObject(&acroform, afObj->getRef());
         }
     }
     return;
 }
 
-unsigned int PDFDoc::writePageObjects(OutStream *outStr, XRef *xRef, unsigned int numOffset, bool combine)
+unsigned int PDFDoc::writePageObjects(OutStream *outStr, XRef *xRef, unsigned int numOffset, bool combine, int endNum, XRef *srcXRef)
 {
+    if (!srcXRef) {
+        srcXRef = getXRef();
+    }
     unsigned int objectsCount = 0; // count the number of objects in the XRef(s)
     unsigned char *fileKey;
     CryptAlgorithm encAlgorithm;
     int keyLength;
     xRef->getEncryptionParameters(&fileKey, &encAlgorithm, &keyLength);
 
-    for (int n = numOffset; n < xRef->getNumObjects(); n++) {
+    if (endNum < 0 || endNum > xRef->getNumObjects()) {
+        endNum = xRef->getNumObjects();
+    }
+    for (int n = numOffset; n < endNum; n++) {
         if (xRef->getEntry(n)->type != xrefEntryFree) {
             Ref ref;
             ref.num = n;
             ref.gen = xRef->getEntry(n)->gen;
             objectsCount++;
-            Object obj = getXRef()->fetch(ref.num - numOffset, ref.gen);
+            Object obj = srcXRef->fetch(ref.num - numOffset, ref.gen);
             Goffset offset = writeObjectHeader(&ref, outStr);
             if (combine) {
-                writeObject(&obj, outStr, getXRef(), numOffset, nullptr, cryptRC4, 0, 0, 0);
+                writeObject(&obj, outStr, srcXRef, numOffset, nullptr, cryptRC4, 0, 0, 0);
             } else if (xRef->getEntry(n)->getFlag(XRefEntry::Unencrypted)) {
                 writeObject(&obj, outStr, nullptr, cryptRC4, 0, 0, 0);
             } else {
@@ -2123,6 +2388,56 @@ int PDFDoc::getNumPages()
     return catalog->getNumPages();
 }
 
+// Ranges closer than this are fetched together, as reading the gap
+// costs less than another request.
+static const unsigned int maxByteRangeGap = 4 * CachedFileChunkSize;
+
+static void mergeByteRanges(std::vector<ByteRange> *ranges)
+{
+    std::sort(ranges->begin(), ranges->end(), [](const ByteRange &a, const ByteRange &b) { return a.offset < b.offset; });
+
+    size_t n = 0;
+    for (const ByteRange &r : *ranges) {
+        if (n > 0) {
+            ByteRange &last = (*ranges)[n - 1];
+            const size_t lastEnd = last.offset + last.length;
+            if (r.offset <= lastEnd + maxByteRangeGap) {
+                const size_t end = std::max(lastEnd, r.offset + r.length);
+                if (end - last.offset <= UINT_MAX) {
+                    last.length = end - last.offset;
+                    continue;
+                }
+            }
+        }
+        (*ranges)[n++] = r;
+    }
+    ranges->resize(n);
+}
+
+// Load everything <page> needs from a CachedFile with as few requests as
+// possible, rather than chunk by chunk as the parser gets to it, and
+// queue the following pages for prefetching.
+void PDFDoc::cachePageData(int page)
+{
+    if (str->getKind() != strCachedFile) {
+        return;
+    }
+    CachedFile *cachedFile = static_cast<CachedFileStream *>(str)->getCachedFile();
+
+    std::vector<ByteRange> ranges = getHints()->getPageRanges(page);
+    mergeByteRanges(&ranges);
+    cachedFile->cache(ranges);
+
+    const int lastPage = std::min(page + prefetchPages, getNumPages());
+    for (int i = page + 1; i <= lastPage; ++i) {
+        if (!pageCache[i - 1]) {
+            ranges = getHints()->getPageRanges(i);
+            mergeByteRanges(&ranges);
+            cachedFile->prefetch(ranges);
+        }
+    }
+}
+
 Page *PDFDoc::parsePage(int page)
 {
     Ref pageRef;
@@ -2139,6 +2454,8 @@ Page *PDFDoc::parsePage(int page)
         return nullptr;
     }
 
+    cachePageData(page);
+
     pageRef.gen = xref->getEntry(pageRef.num)->gen;
     Object obj = xref->fetch(pageRef);
     if (!obj.isDict("Page")) {
@@ -52,6 +52,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <mutex>
+#include <vector>
 
 #include "poppler-config.h"
 
@@ -86,6 +87,19 @@ enum PDFWriteMode
     writeForceIncremental
 };
 
+// Options for PDFDoc::saveAs() when it rewrites the whole file.
+struct PDFRewriteOptions
+{
+    // Pack objects other than streams into Flate compressed object
+    // streams and write a cross-reference stream.  Makes the file
+    // PDF 1.5 at least.
+    bool useObjectStreams = false;
+    // Flate compress the streams that are stored without any filter.
+    bool compressStreams = false;
+    // Write streams with identical dictionaries and data only once.
+    bool deduplicateStreams = false;
+};
+
 enum PDFSubtype
 {
     subtypeNull,
@@ -198,6 +212,12 @@ public:
     // Get page.
     Page *getPage(int page);
 
+    // For linearized documents read through a CachedFile, the data a
+    // page needs is requested in one go when the page is first parsed.
+    // With <n> > 0 the data of the next <n> pages is also fetched in the
+    // background.  Defaults to 0.
+    void setPrefetchPages(int n) { prefetchPages = n; }
+
     // Display a page.
     void displayPage(OutputDev *out, int page, double hDPI, double vDPI, int rotate, bool useMediaBox, bool crop, bool printing, bool (*abortCheckCbk)(void *data) = nullptr, void *abortCheckCbkData = nullptr,
                      bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data) = nullptr, void *annotDisplayDecideCbkData = nullptr, bool copyXRef = false);
@@ -304,12 +324,19 @@ public:
     // Return the PDF ID in the trailer dictionary (if any).
     bool getID(GooString *permanent_id, GooString *update_id) const;
 
-    // Save one page with another name.
-    int savePageAs(const GooString &name, int pageNo);
+    // Save one page with another name.  If srcXRef isn't null, the
+    // objects are read and changed through it rather than through the
+    // document's XRef, so that several pages can be saved at the same time,
+    // each through its own XRef::copy().
+    int savePageAs(const GooString &name, int pageNo, XRef *srcXRef = nullptr);
     // Save this file with another name.
     int saveAs(const GooString &name, PDFWriteMode mode = writeStandard);
     // Save this file in the given output stream.
     int saveAs(OutStream *outStr, PDFWriteMode mode = writeStandard);
+    // Rewrite the whole file, with its changes, with another name.
+    int saveAs(const GooString &name, const PDFRewriteOptions &options);
+    // Rewrite the whole file, with its changes, in the given output stream.
+    int saveAs(OutStream *outStr, const PDFRewriteOptions &options);
     // Save this file with another name without saving changes
     int saveWithoutChangesAs(const GooString &name);
     // Save this file in the given output stream without saving changes
@@ -319,12 +346,18 @@ public:
     void *getGUIData() { return guiData; }
 
     // rewrite pageDict with MediaBox, CropBox and new page CTM
-    bool replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBox, const PDFRectangle *cropBox);
-    bool markPageObjects(Dict *pageDict, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts = nullptr);
-    bool markAnnotations(Object *annots, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldPageNum, int newPageNum, std::set<Dict *> *alreadyMarkedDicts = nullptr);
-    void markAcroForm(Object *afObj, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum);
-    // write all objects used by pageDict to outStr
-    unsigned int writePageObjects(OutStream *outStr, XRef *xRef, unsigned int numOffset, bool combine = false);
+    // (the functions below take a srcXRef, as savePageAs() does, and use
+    // the document's XRef if it is null)
+    bool replacePageDict(int pageNo, int rotate, const PDFRectangle *mediaBox, const PDFRectangle *cropBox, XRef *srcXRef = nullptr);
+    // insert the objects used by pageDict in xRef; markedObjects has a flag
+    // per (offset) object number telling whether the object was already
+    // walked, so that every object is only visited once per output
+    bool markPageObjects(Dict *pageDict, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef = nullptr);
+    bool markAnnotations(Object *annots, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldPageNum, int newPageNum, XRef *srcXRef = nullptr);
+    void markAcroForm(Object *afObj, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef = nullptr);
+    // write all objects used by pageDict to outStr; only objects numbered
+    // below endNum are written if it isn't -1
+    unsigned int writePageObjects(OutStream *outStr, XRef *xRef, unsigned int numOffset, bool combine = false, int endNum = -1, XRef *srcXRef = nullptr);
     static void writeObject(Object *obj, OutStream *outStr, XRef *xref, unsigned int numOffset, unsigned char *fileKey, CryptAlgorithm encAlgorithm, int keyLength, int objNum, int objGen, std::set<Dict *> *alreadyWrittenDicts = nullptr);
     static void writeObject(Object *obj, OutStream *outStr, XRef *xref, unsigned int numOffset, unsigned char *fileKey, CryptAlgorithm encAlgorithm, int keyLength, Ref ref, std::set<Dict *> *alreadyWrittenDicts = nullptr);
     static void writeHeader(OutStream *outStr, int major, int minor);
@@ -345,8 +378,11 @@ public:
 
 private:
     // insert referenced objects in XRef
-    bool markDictionary(Dict *dict, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts);
-    bool markObject(Object *obj, XRef *xRef, XRef *countRef, unsigned int numOffset, int oldRefNum, int newRefNum, std::set<Dict *> *alreadyMarkedDicts = nullptr);
+    bool markDictionary(Dict *dict, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef);
+    bool markObject(Object *obj, XRef *xRef, std::vector<bool> *markedObjects, unsigned int numOffset, int oldRefNum, int newRefNum, XRef *srcXRef);
+    // set the flag of object <num> in markedObjects; returns false if it
+    // was already set
+    static bool setMarked(std::vector<bool> *markedObjects, int num);
 
     // Sanitizes the string so that it does
     // not contain any ( ) < > [ ] { } / %
@@ -368,9 +404,11 @@ private:
     void writeXRefTableTrailer(Goffset uxrefOffset, XRef *uxref, bool writeAllEntries, int uxrefSize, OutStream *outStr, bool incrUpdate);
     static void writeString(const GooString *s, OutStream *outStr, const unsigned char *fileKey, CryptAlgorithm encAlgorithm, int keyLength, Ref ref);
     void saveIncrementalUpdate(OutStream *outStr);
-    void saveCompleteRewrite(OutStream *outStr);
+    void saveCompleteRewrite(OutStream *outStr, const PDFRewriteOptions &options = {});
+    Goffset getFileSize();
 
     Page *parsePage(int page);
+    void cachePageData(int page);
 
     // Get hints.
     Hints *getHints();
@@ -412,6 +450,7 @@ private:
     Hints *hints = nullptr;
     Outline *outline = nullptr;
     Page **pageCache = nullptr;
+    int prefetchPages = 0;
 
     bool ok = false;
     int errCode = errNone;
@@ -30,7 +30,7 @@
 // PDFDocFactory
 //------------------------------------------------------------------------
 
-PDFDocFactory::PDFDocFactory(std::vector<PDFDocBuilder *> *pdfDocBuilders)
+PDFDocFactory::PDFDocFactory(std::vector<PDFDocBuilder *> *pdfDocBuilders, size_t cacheMemoryLimit)
 {
     if (pdfDocBuilders) {
         builders = pdfDocBuilders;
@@ -38,9 +38,9 @@ PDFDocFactory::PDFDocFactory(std::vector<PDFDocBuilder *> *pdfDocBuilders)
         builders = new std::vector<PDFDocBuilder *>();
     }
     builders->push_back(new LocalPDFDocBuilder());
-    builders->push_back(new FileDescriptorPDFDocBuilder());
+    builders->push_back(new FileDescriptorPDFDocBuilder(cacheMemoryLimit));
 #ifdef ENABLE_LIBCURL
-    builders->push_back(new CurlPDFDocBuilder());
+    builders->push_back(new CurlPDFDocBuilder(cacheMemoryLimit));
 #endif
 }
 
@@ -37,7 +37,9 @@ class POPPLER_PRIVATE_EXPORT PDFDocFactory
 {
 
 public:
-    explicit PDFDocFactory(std::vector<PDFDocBuilder *> *pdfDocBuilders = nullptr);
+    // <cacheMemoryLimit> bounds the memory used for documents read from
+    // a file descriptor or over HTTP, see CachedFile; 0 for no limit.
+    explicit PDFDocFactory(std::vector<PDFDocBuilder *> *pdfDocBuilders = nullptr, size_t cacheMemoryLimit = 0);
     ~PDFDocFactory();
 
     PDFDocFactory(const PDFDocFactory &) = delete;
@@ -55,6 +55,9 @@
 #include <climits>
 #include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "goo/GooString.h"
 #include "poppler-config.h"
 #include "GlobalParams.h"
@@ -972,6 +975,65 @@ struct PSOutImgClipRect
     int x0, x1, y0, y1;
 };
 
+//------------------------------------------------------------------------
+// PSGlyphUsageDev
+//------------------------------------------------------------------------
+
+// Records the characters drawn with each font, so font subsets can be
+// embedded before the pages are written.  Type 3 glyphs are
+// interpreted, to find the fonts used inside them.
+class PSGlyphUsageDev : public OutputDev
+{
+public:
+    PSGlyphUsageDev(std::map<Ref, std::set<int>> *usedCodesA, std::map<Ref, std::set<int>> *usedCIDGlyphsA, std::map<Ref, std::set<std::string>> *usedType1CGlyphsA)
+        : usedCodes(usedCodesA), usedCIDGlyphs(usedCIDGlyphsA), usedType1CGlyphs(usedType1CGlyphsA)
+    {
+    }
+
+    bool upsideDown() override { return true; }
+    bool useDrawChar() override { return true; }
+    bool interpretType3Chars() override { return true; }
+    bool needNonText() override { return false; }
+
+    void drawChar(GfxState *state, double x, double y, double dx, double dy, double originX, double originY, CharCode code, int nBytes, const Unicode *u, int uLen) override;
+
+private:
+    std::map<Ref, std::set<int>> *usedCodes;
+    std::map<Ref, std::set<int>> *usedCIDGlyphs;
+    std::map<Ref, std::set<std::string>> *usedType1CGlyphs;
+};
+
+void PSGlyphUsageDev::drawChar(GfxState *state, double x, double y, double dx, double dy, double originX, double originY, CharCode code, int nBytes, const Unicode *u, int uLen)
+{
+    GfxFont *font = state->getFont().get();
+    Ref fontFileID;
+
+    // PSOutputDev::drawString() skips invisible text
+    if (!font || state->getRender() == 3) {
+        return;
+    }
+    if (!font->isCIDFont()) {
+        (*usedCodes)[*font->getID()].insert(code);
+        // Type 1C font files are shared by the fonts using them, and
+        // their glyphs are found by name
+        if (font->getType() == fontType1C && code < 256 && font->getEmbeddedFontID(&fontFileID)) {
+            const char *name = static_cast<Gfx8BitFont *>(font)->getCharName(code);
+            if (name) {
+                (*usedType1CGlyphs)[fontFileID].insert(name);
+            }
+        }
+    } else if (font->getEmbeddedFontID(&fontFileID)) {
+        int glyph = code;
+        if (font->getType() == fontCIDType2 || font->getType() == fontCIDType2OT) {
+            const GfxCIDFont *cidFont = static_cast<GfxCIDFont *>(font);
+            if (cidFont->getCIDToGID()) {
+                glyph = code < cidFont->getCIDToGIDLen() ? cidFont->getCIDToGID()[code] : 0;
+            }
+        }
+        (*usedCIDGlyphs)[fontFileID].insert(glyph);
+    }
+}
+
 //------------------------------------------------------------------------
 // DeviceNRecoder
 //------------------------------------------------------------------------
@@ -1498,6 +1560,9 @@ PSOutputDev::~PSOutputDev()
     PSOutCustomColor *cc;
     int i;
 
+    // stop rasterizing pages nobody will ask for
+    rasterPool.reset();
+
     if (ok) {
         if (!postInitDone) {
             postInit();
@@ -1713,6 +1778,9 @@ void PSOutputDev::writeDocSetup(Catalog *catalog, const std::vector<int> &pageLi
     } else {
         writePS("xpdf begin\n");
     }
+    if (subsetFonts) {
+        scanGlyphUsage(pageList);
+    }
     for (const int pg : pageList) {
         page = doc->getPage(pg);
         if (!page) {
@@ -2376,6 +2444,9 @@ void PSOutputDev::setupEmbeddedType1CFont(GfxFont *font, Ref *id, GooString *psN
     const std::optional<std::vector<unsigned char>> fontBuf = font->readEmbFontFile(xref);
     if (fontBuf) {
         if ((ffT1C = FoFiType1C::make(fontBuf->data(), fontBuf->size()))) {
+            if (subsetFonts) {
+                setType1CSubset(ffT1C, id);
+            }
             ffT1C->convertToType1(psName->c_str(), nullptr, true, outputFunc, outputStream);
             delete ffT1C;
         }
@@ -2440,6 +2511,9 @@ void PSOutputDev::setupEmbeddedTrueTypeFont(GfxFont *font, Ref *id, GooString *p
     if (fontBuf) {
         if (std::unique_ptr<FoFiTrueType> ffTT = FoFiTrueType::make(fontBuf->data(), fontBuf->size())) {
             codeToGID = ((Gfx8BitFont *)font)->getCodeToGIDMap(ffTT.get());
+            if (subsetFonts) {
+                setTrueTypeSubset(ffTT.get(), font, codeToGID);
+            }
             ffTT->convertToType42(psName->c_str(), ((Gfx8BitFont *)font)->getHasEncoding() ? ((Gfx8BitFont *)font)->getEncoding() : nullptr, codeToGID, outputFunc, outputStream);
             if (codeToGID) {
                 if (font8InfoLen >= font8InfoSize) {
@@ -2470,6 +2544,9 @@ void PSOutputDev::setupExternalTrueTypeFont(GfxFont *font, const GooString *file
     // convert it to a Type 42 font
     if (std::unique_ptr<FoFiTrueType> ffTT = FoFiTrueType::load(fileName->c_str())) {
         codeToGID = ((Gfx8BitFont *)font)->getCodeToGIDMap(ffTT.get());
+        if (subsetFonts) {
+            setTrueTypeSubset(ffTT.get(), font, codeToGID);
+        }
         ffTT->convertToType42(psName->c_str(), ((Gfx8BitFont *)font)->getHasEncoding() ? ((Gfx8BitFont *)font)->getEncoding() : nullptr, codeToGID, outputFunc, outputStream);
         if (codeToGID) {
             if (font8InfoLen >= font8InfoSize) {
@@ -2496,6 +2573,70 @@ void PSOutputDev::updateFontMaxValidGlyph(GfxFont *font, int maxValidGlyph)
     }
 }
 
+void PSOutputDev::scanGlyphUsage(const std::vector<int> &pageList)
+{
+    PSGlyphUsageDev glyphUsageDev(&usedCodes, &usedCIDGlyphs, &usedType1CGlyphs);
+
+    for (const int pg : pageList) {
+        doc->displayPageSlice(&glyphUsageDev, pg, 72, 72, 0, false, false, true, -1, -1, -1, -1);
+    }
+}
+
+void PSOutputDev::setTrueTypeSubset(FoFiTrueType *ffTT, GfxFont *font, const int *codeToGID) const
+{
+    // fonts that weren't seen drawing anything (e.g. only used by
+    // form fields) are embedded completely
+    const auto codes = usedCodes.find(*font->getID());
+    if (!codeToGID || codes == usedCodes.end()) {
+        return;
+    }
+    std::set<int> gids;
+    for (int code : codes->second) {
+        if (code >= 0 && code < 256) {
+            gids.insert(codeToGID[code]);
+        }
+    }
+    ffTT->setGlyphSubset(gids);
+}
+
+void PSOutputDev::setType1CSubset(FoFiType1C *ffT1C, const Ref *id) const
+{
+    const auto names = usedType1CGlyphs.find(*id);
+    if (names == usedType1CGlyphs.end()) {
+        return;
+    }
+    std::set<int> gids;
+    for (int gid = 0; gid < ffT1C->getNumGlyphs(); ++gid) {
+        const std::unique_ptr<GooString> name(ffT1C->getGlyphName(gid));
+        if (name && names->second.count(name->toStr())) {
+            gids.insert(gid);
+        }
+    }
+    ffT1C->setGlyphSubset(gids);
+}
+
+int *PSOutputDev::makeCFFSubsetMap(const Ref *id, const int *cidToGID, int nCIDs) const
+{
+    const auto cids = usedCIDGlyphs.find(*id);
+    if (!cidToGID || cids == usedCIDGlyphs.end()) {
+        return nullptr;
+    }
+    int *map = (int *)gmallocn(nCIDs, sizeof(int));
+    for (int cid = 0; cid < nCIDs; ++cid) {
+        map[cid] = -1;
+    }
+    if (nCIDs > 0) {
+        map[0] = cidToGID[0];
+    }
+    for (int cid : cids->second) {
+        // CIDs missing from a CID font's charset map to GID 0
+        if (cid > 0 && cid < nCIDs && cidToGID[cid] > 0) {
+            map[cid] = cidToGID[cid];
+        }
+    }
+    return map;
+}
+
 void PSOutputDev::setupExternalCIDTrueTypeFont(GfxFont *font, const GooString *fileName, GooString *psName, bool needVerticalMetrics)
 {
     int *codeToGID;
@@ -2576,13 +2717,29 @@ void PSOutputDev::setupEmbeddedCIDType0Font(GfxFont *font, Ref *id, GooString *p
     const std::optional<std::vector<unsigned char>> fontBuf = font->readEmbFontFile(xref);
     if (fontBuf) {
         if ((ffT1C = FoFiType1C::make(fontBuf->data(), fontBuf->size()))) {
+            int *codeMap = nullptr;
+            int nCodes = 0;
+            if (subsetFonts) {
+                int *cidToGID = ffT1C->getCIDToGIDMap(&nCodes);
+                if (!cidToGID) {
+                    // 8-bit CFF font: CIDs are GIDs
+                    nCodes = ffT1C->getNumGlyphs();
+                    cidToGID = (int *)gmallocn(nCodes, sizeof(int));
+                    for (i = 0; i < nCodes; ++i) {
+                        cidToGID[i] = i;
+                    }
+                }
+                codeMap = makeCFFSubsetMap(id, cidToGID, nCodes);
+                gfree(cidToGID);
+            }
             if (level >= psLevel3) {
                 // Level 3: use a CID font
-                ffT1C->convertToCIDType0(psName->c_str(), nullptr, 0, outputFunc, outputStream);
+                ffT1C->convertToCIDType0(psName->c_str(), codeMap, codeMap ? nCodes : 0, outputFunc, outputStream);
             } else {
                 // otherwise: use a non-CID composite font
-                ffT1C->convertToType0(psName->c_str(), nullptr, 0, outputFunc, outputStream);
+                ffT1C->convertToType0(psName->c_str(), codeMap, codeMap ? nCodes : 0, outputFunc, outputStream);
             }
+            gfree(codeMap);
             delete ffT1C;
         }
     }
@@ -2593,6 +2750,24 @@ void PSOutputDev::setupEmbeddedCIDType0Font(GfxFont *font, Ref *id, GooString *p
 
 void PSOutputDev::setupEmbeddedCIDTrueTypeFont(GfxFont *font, Ref *id, GooString *psName, bool needVerticalMetrics)
 {
+    int *cidToGID = ((GfxCIDFont *)font)->getCIDToGID();
+    const int cidToGIDLen = ((GfxCIDFont *)font)->getCIDToGIDLen();
+    std::vector<int> cidToGIDVec;
+    if (cidToGID) {
+        cidToGIDVec.assign(cidToGID, cidToGID + cidToGIDLen);
+    }
+
+    // check if the font file is already embedded with the same CID to
+    // GID mapping (the mapping is part of the converted font)
+    for (const PSCIDTrueTypeFont &cidTTFont : cidTrueTypeFonts) {
+        if (cidTTFont.fontFileID == *id && cidTTFont.cidToGID == cidToGIDVec) {
+            psName->clear();
+            psName->append(cidTTFont.psName);
+            updateFontMaxValidGlyph(font, cidTTFont.maxValidGlyph);
+            return;
+        }
+    }
+
     // beginning comment
     writePSFmt("%%BeginResource: font {0:t}\n", psName);
     embFontList->append("%%+ font ");
@@ -2600,20 +2775,27 @@ void PSOutputDev::setupEmbeddedCIDTrueTypeFont(GfxFont *font, Ref *id, GooString
     embFontList->append("\n");
 
     // convert it to a Type 0 font
+    int maxValidGlyph = -1;
     const std::optional<std::vector<unsigned char>> fontBuf = font->readEmbFontFile(xref);
     if (fontBuf) {
         if (std::unique_ptr<FoFiTrueType> ffTT = FoFiTrueType::make(fontBuf->data(), fontBuf->size())) {
+            if (subsetFonts) {
+                const auto gids = usedCIDGlyphs.find(*id);
+                if (gids != usedCIDGlyphs.end()) {
+                    ffTT->setGlyphSubset(gids->second);
+                }
+            }
             if (level >= psLevel3) {
                 // Level 3: use a CID font
-                ffTT->convertToCIDType2(psName->c_str(), ((GfxCIDFont *)font)->getCIDToGID(), ((GfxCIDFont *)font)->getCIDToGIDLen(), needVerticalMetrics, outputFunc, outputStream);
+                ffTT->convertToCIDType2(psName->c_str(), cidToGID, cidToGIDLen, needVerticalMetrics, outputFunc, outputStream);
             } else {
                 // otherwise: use a non-CID composite font
-                int maxValidGlyph = -1;
-                ffTT->convertToType0(psName->c_str(), ((GfxCIDFont *)font)->getCIDToGID(), ((GfxCIDFont *)font)->getCIDToGIDLen(), needVerticalMetrics, &maxValidGlyph, outputFunc, outputStream);
+                ffTT->convertToType0(psName->c_str(), cidToGID, cidToGIDLen, needVerticalMetrics, &maxValidGlyph, outputFunc, outputStream);
                 updateFontMaxValidGlyph(font, maxValidGlyph);
             }
         }
     }
+    cidTrueTypeFonts.push_back({ *id, std::move(cidToGIDVec), psName->toStr(), maxValidGlyph });
 
     // ending comment
     writePS("%%EndResource\n");
@@ -2650,13 +2832,28 @@ void PSOutputDev::setupEmbeddedOpenTypeCFFFont(GfxFont *font, Ref *id, GooString
     if (fontBuf) {
         if (std::unique_ptr<FoFiTrueType> ffTT = FoFiTrueType::make(fontBuf->data(), fontBuf->size())) {
             if (ffTT->isOpenTypeCFF()) {
+                int *cidToGID = ((GfxCIDFont *)font)->getCIDToGID();
+                int nCIDs = ((GfxCIDFont *)font)->getCIDToGIDLen();
+                int *codeMap = nullptr;
+                if (subsetFonts) {
+                    if (cidToGID) {
+                        codeMap = makeCFFSubsetMap(id, cidToGID, nCIDs);
+                    } else if (int *fontCIDToGID = ffTT->getCIDToGIDMap(&nCIDs)) {
+                        codeMap = makeCFFSubsetMap(id, fontCIDToGID, nCIDs);
+                        gfree(fontCIDToGID);
+                    }
+                    if (codeMap) {
+                        cidToGID = codeMap;
+                    }
+                }
                 if (level >= psLevel3) {
                     // Level 3: use a CID font
-                    ffTT->convertToCIDType0(psName->c_str(), ((GfxCIDFont *)font)->getCIDToGID(), ((GfxCIDFont *)font)->getCIDToGIDLen(), outputFunc, outputStream);
+                    ffTT->convertToCIDType0(psName->c_str(), cidToGID, cidToGID ? nCIDs : 0, outputFunc, outputStream);
                 } else {
                     // otherwise: use a non-CID composite font
-                    ffTT->convertToType0(psName->c_str(), ((GfxCIDFont *)font)->getCIDToGID(), ((GfxCIDFont *)font)->getCIDToGIDLen(), outputFunc, outputStream);
+                    ffTT->convertToType0(psName->c_str(), cidToGID, cidToGID ? nCIDs : 0, outputFunc, outputStream);
                 }
+                gfree(codeMap);
             }
         }
     }
@@ -3100,24 +3297,494 @@ void PSOutputDev::setupForm(Ref id, Object *strObj)
     writePS("} def\n");
 }
 
+//------------------------------------------------------------------------
+// page rasterization
+//------------------------------------------------------------------------
+
+// The arguments of a checkPageSlice() call, which are needed again to
+// rasterize the page.
+struct PSOutputDev::RasterSlice
+{
+    int rotate;
+    bool useMediaBox;
+    bool crop;
+    int sliceX, sliceY, sliceW, sliceH;
+    bool printing;
+    bool (*abortCheckCbk)(void *data);
+    void *abortCheckCbkData;
+    bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data);
+    void *annotDisplayDecideCbkData;
+
+    bool operator==(const RasterSlice &other) const = default;
+};
+
+// One stripe of a rasterized page, encoded for a level 2 or 3 image
+// operator.
+struct PSOutputDev::RasterStripe
+{
+    double mat[6]; // maps the unit square to the stripe
+    int width, height;
+    int numComps; // 1 if the image was optimized to gray
+    bool isOptimizedGray;
+    std::string data; // compressed, and unless binary, ASCII encoded
+};
+
+// A page checked, and if needed rasterized, by a RasterPool thread.
+struct PSOutputDev::RasterPage
+{
+    bool rasterize;
+    bool ok; // false if the page was too large to rasterize
+    double xScale, yScale; // the scale the stripes were rendered at
+    std::vector<RasterStripe> stripes;
+};
+
+// Worker threads preparing the pages following the one being written.
+// Every worker has a SplashOutputDev of its own, kept for the whole
+// job so fonts are only loaded once per thread.  Only the encoded
+// stripes of a few pages per thread are kept waiting.
+class PSOutputDev::RasterPool
+{
+public:
+    RasterPool(PSOutputDev *psOutA, const RasterSlice &sliceA, SplashColorMode internalColorFormatA, int numCompsA, bool overprintA);
+    ~RasterPool();
+
+    RasterPool(const RasterPool &) = delete;
+    RasterPool &operator=(const RasterPool &) = delete;
+
+    // Returns page <pg> if it was prepared for <sliceA>, waiting for it
+    // if it is being worked on, or nullptr if the caller has to do it.
+    std::unique_ptr<RasterPage> take(int pg, const RasterSlice &sliceA);
+
+    // Scale the following pages are rendered at.
+    void setScale(double xScaleA, double yScaleA);
+
+private:
+    void work();
+
+    PSOutputDev *psOut;
+    const RasterSlice slice;
+    const SplashColorMode internalColorFormat;
+    const int numComps;
+    const bool overprint;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::thread> threads;
+    std::map<size_t, std::unique_ptr<RasterPage>> done; // by index in psOut->pages
+    size_t nextIdx; // next page to hand out to a worker
+    size_t takeIdx; // next page expected by take()
+    size_t window; // pages prepared ahead of takeIdx
+    double xScale, yScale;
+    bool stopping;
+};
+
+PSOutputDev::RasterPool::RasterPool(PSOutputDev *psOutA, const RasterSlice &sliceA, SplashColorMode internalColorFormatA, int numCompsA, bool overprintA)
+    : psOut(psOutA), slice(sliceA), internalColorFormat(internalColorFormatA), numComps(numCompsA), overprint(overprintA), nextIdx(0), takeIdx(0), xScale(1), yScale(1), stopping(false)
+{
+    window = 2 * psOut->rasterThreads;
+    for (int i = 0; i < psOut->rasterThreads; ++i) {
+        threads.emplace_back(&RasterPool::work, this);
+    }
+}
+
+PSOutputDev::RasterPool::~RasterPool()
+{
+    {
+        std::scoped_lock lock { mutex };
+        stopping = true;
+    }
+    cond.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void PSOutputDev::RasterPool::setScale(double xScaleA, double yScaleA)
+{
+    std::scoped_lock lock { mutex };
+    xScale = xScaleA;
+    yScale = yScaleA;
+}
+
+std::unique_ptr<PSOutputDev::RasterPage> PSOutputDev::RasterPool::take(int pg, const RasterSlice &sliceA)
+{
+    const std::vector<int> &pages = psOut->pages;
+    std::unique_ptr<RasterPage> page;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t idx = takeIdx;
+    while (idx < pages.size() && pages[idx] != pg) {
+        ++idx;
+    }
+    if (idx == pages.size()) {
+        return nullptr;
+    }
+    takeIdx = idx + 1;
+    done.erase(done.begin(), done.lower_bound(idx));
+    if (idx >= nextIdx) {
+        // not handed out yet, skip it
+        nextIdx = idx + 1;
+    } else {
+        cond.wait(lock, [&] { return done.count(idx) != 0; });
+        page = std::move(done.extract(idx).mapped());
+    }
+    lock.unlock();
+    cond.notify_all();
+
+    if (page && !(sliceA == slice)) {
+        page.reset();
+    }
+    return page;
+}
+
+void PSOutputDev::RasterPool::work()
+{
+    std::unique_ptr<SplashOutputDev> splashOut(psOut->createRasterOutputDev(internalColorFormat, overprint));
+    const std::vector<int> &pages = psOut->pages;
+
+    while (true) {
+        size_t idx;
+        double xScaleA, yScaleA;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return stopping || (nextIdx < pages.size() && nextIdx < takeIdx + window); });
+            if (stopping) {
+                return;
+            }
+            idx = nextIdx++;
+            xScaleA = xScale;
+            yScaleA = yScale;
+        }
+
+        std::unique_ptr<RasterPage> page;
+        Page *pdfPage = psOut->doc->getPage(pages[idx]);
+        if (pdfPage) {
+            page = psOut->prepareRasterPage(splashOut.get(), pdfPage, slice, xScaleA, yScaleA, numComps, internalColorFormat);
+        }
+
+        {
+            std::scoped_lock lock { mutex };
+            done.emplace(idx, std::move(page));
+        }
+        cond.notify_all();
+    }
+}
+
+// The color format pages are rasterized in, and its number of color
+// components in the PostScript image.
+void PSOutputDev::getRasterColorFormat(SplashColorMode *internalColorFormat, int *numComps, bool *overprint)
+{
+    // If we would not rasterize this page, we would emit the overprint code anyway for language level 2 and upwards.
+    // As such it is safe to assume for a CMYK printer that it would respect the overprint operands.
+    *overprint = overprintPreview || (processColorFormat == splashModeCMYK8 && level >= psLevel2);
+
+    *internalColorFormat = processColorFormat;
+    if (processColorFormat == splashModeMono8) {
+        *numComps = 1;
+    } else if (processColorFormat == splashModeCMYK8) {
+        *numComps = 4;
+
+        // If overprinting is emulated, it is not sufficient to just store the CMYK values in a bitmap.
+        // All separation channels need to be stored and collapsed at the end.
+        // Cf. PDF32000_2008 Section 11.7.4.5 and Tables 148, 149
+        if (*overprint) {
+            *internalColorFormat = splashModeDeviceN8;
+        }
+    } else if (processColorFormat == splashModeRGB8) {
+        *numComps = 3;
+    } else {
+        error(errUnimplemented, -1, "Unsupported processColorMode. Falling back to RGB8.");
+        processColorFormat = splashModeRGB8;
+        *internalColorFormat = processColorFormat;
+        *numComps = 3;
+    }
+}
+
+SplashOutputDev *PSOutputDev::createRasterOutputDev(SplashColorMode internalColorFormat, bool overprint) const
+{
+    SplashColor paperColor;
+
+    if (processColorFormat == splashModeMono8) {
+        paperColor[0] = 0xff;
+    } else if (processColorFormat == splashModeCMYK8) {
+        splashClearColor(paperColor);
+    } else {
+        paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+    }
+    SplashOutputDev *splashOut = new SplashOutputDev(internalColorFormat, 1, false, paperColor, false, splashThinLineDefault, overprint);
+    splashOut->setFontAntialias(rasterAntialias);
+    splashOut->setVectorAntialias(rasterAntialias);
+#ifdef USE_CMS
+    splashOut->setDisplayProfile(getDisplayProfile());
+    splashOut->setDefaultGrayProfile(getDefaultGrayProfile());
+    splashOut->setDefaultRGBProfile(getDefaultRGBProfile());
+    splashOut->setDefaultCMYKProfile(getDefaultCMYKProfile());
+#endif
+    splashOut->startDoc(doc);
+    return splashOut;
+}
+
+// Set <slice> up for rasterizing it at <hDPI2> x <vDPI2> in stripes,
+// and returns the height of the stripes, or 0 if the slice is too
+// large.
+int PSOutputDev::setupRasterSlice(Page *page, RasterSlice *slice, double hDPI2, double vDPI2) const
+{
+    PDFRectangle box;
+
+    page->makeBox(rasterResolution, rasterResolution, slice->rotate, slice->useMediaBox, false, slice->sliceX, slice->sliceY, slice->sliceW, slice->sliceH, &box, &slice->crop);
+    if (slice->sliceW < 0 || slice->sliceH < 0) {
+        if (slice->useMediaBox) {
+            box = *page->getMediaBox();
+        } else {
+            box = *page->getCropBox();
+        }
+        slice->sliceX = slice->sliceY = 0;
+        slice->sliceW = (int)((box.x2 - box.x1) * hDPI2 / 72.0);
+        slice->sliceH = (int)((box.y2 - box.y1) * vDPI2 / 72.0);
+    }
+    int sliceArea;
+    if (checkedMultiply(slice->sliceW, slice->sliceH, &sliceArea)) {
+        return 0;
+    }
+    const int nStripes = (int)ceil((double)(sliceArea) / (double)rasterizationSliceSize);
+    if (unlikely(nStripes == 0)) {
+        return 0;
+    }
+    return (slice->sliceH + nStripes - 1) / nStripes;
+}
+
+// Rasterize the stripe of <slice> starting at row <stripeY>, and set
+// <mat> to the matrix mapping the unit square to it.  <copyXRef> is set
+// on RasterPool threads, which must not share the XRef of the document.
+void PSOutputDev::rasterizeStripe(SplashOutputDev *splashOut, Page *page, RasterSlice *slice, double hDPI2, double vDPI2, int stripeY, int stripeH, double *mat, bool copyXRef) const
+{
+    PDFRectangle box;
+
+    page->makeBox(hDPI2, vDPI2, 0, slice->useMediaBox, false, slice->sliceX, stripeY, slice->sliceW, stripeH, &box, &slice->crop);
+    mat[0] = box.x2 - box.x1;
+    mat[1] = 0;
+    mat[2] = 0;
+    mat[3] = box.y2 - box.y1;
+    mat[4] = box.x1;
+    mat[5] = box.y1;
+    page->displaySlice(splashOut, hDPI2, vDPI2, (360 - page->getRotate()) % 360, slice->useMediaBox, slice->crop, slice->sliceX, stripeY, slice->sliceW, stripeH, slice->printing, slice->abortCheckCbk, slice->abortCheckCbkData,
+                       slice->annotDisplayDecideCbk, slice->annotDisplayDecideCbkData, copyXRef);
+}
+
+// Compress <bitmap>, bottom row first, for a level 2 or 3 image
+// operator.  The data is encoded once, into <stripe>, so its length
+// is known before it is written.
+void PSOutputDev::encodeRasterStripe(SplashBitmap *bitmap, int numComps, SplashColorMode internalColorFormat, RasterStripe *stripe) const
+{
+    Stream *str0, *str;
+    bool isOptimizedGray;
+    const bool useFlate = getEnableFlate() && level >= psLevel3;
+    const bool useLZW = getEnableLZW();
+    const int w = bitmap->getWidth();
+    const int h = bitmap->getHeight();
+
+    unsigned char *p = bitmap->getDataPtr() + (h - 1) * bitmap->getRowSize();
+    if (processColorFormat == splashModeCMYK8 && internalColorFormat != splashModeCMYK8) {
+        str0 = new SplashBitmapCMYKEncoder(bitmap);
+    } else {
+        str0 = new MemStream((char *)p, 0, w * h * numComps, Object(objNull));
+    }
+    // Check for a color image that uses only gray
+    if (!getOptimizeColorSpace()) {
+        isOptimizedGray = false;
+    } else if (numComps == 4) {
+        int compCyan;
+        isOptimizedGray = true;
+        while ((compCyan = str0->getChar()) != EOF) {
+            if (str0->getChar() != compCyan || str0->getChar() != compCyan) {
+                isOptimizedGray = false;
+                break;
+            }
+            str0->getChar();
+        }
+    } else if (numComps == 3) {
+        int compRed;
+        isOptimizedGray = true;
+        while ((compRed = str0->getChar()) != EOF) {
+            if (str0->getChar() != compRed || str0->getChar() != compRed) {
+                isOptimizedGray = false;
+                break;
+            }
+        }
+    } else {
+        isOptimizedGray = false;
+    }
+    str0->reset();
+    if (useFlate) {
+        if (isOptimizedGray && numComps == 4) {
+            str = new FlateEncoder(new CMYKGrayEncoder(str0));
+            numComps = 1;
+        } else if (isOptimizedGray && numComps == 3) {
+            str = new FlateEncoder(new RGBGrayEncoder(str0));
+            numComps = 1;
+        } else {
+            str = new FlateEncoder(str0);
+        }
+    } else if (useLZW) {
+        if (isOptimizedGray && numComps == 4) {
+            str = new LZWEncoder(new CMYKGrayEncoder(str0));
+            numComps = 1;
+        } else if (isOptimizedGray && numComps == 3) {
+            str = new LZWEncoder(new RGBGrayEncoder(str0));
+            numComps = 1;
+        } else {
+            str = new LZWEncoder(str0);
+        }
+    } else {
+        if (isOptimizedGray && numComps == 4) {
+            str = new RunLengthEncoder(new CMYKGrayEncoder(str0));
+            numComps = 1;
+        } else if (isOptimizedGray && numComps == 3) {
+            str = new RunLengthEncoder(new RGBGrayEncoder(str0));
+            numComps = 1;
+        } else {
+            str = new RunLengthEncoder(str0);
+        }
+    }
+    if (useBinary) {
+        /* nothing to do */;
+    } else if (useASCIIHex) {
+        str = new ASCIIHexEncoder(str);
+    } else {
+        str = new ASCII85Encoder(str);
+    }
+
+    stripe->width = w;
+    stripe->height = h;
+    stripe->numComps = numComps;
+    stripe->isOptimizedGray = isOptimizedGray;
+    stripe->data.clear();
+    str->reset();
+    unsigned char buf[4096];
+    int n;
+    while ((n = str->doGetChars(sizeof(buf), buf)) > 0) {
+        stripe->data.append((const char *)buf, n);
+    }
+    str->close();
+    delete str;
+    delete str0;
+}
+
+void PSOutputDev::writeRasterImage(const RasterStripe &stripe)
+{
+    const int w = stripe.width;
+    const int h = stripe.height;
+
+    if (stripe.numComps == 1) {
+        writePS("/DeviceGray setcolorspace\n");
+    } else if (stripe.numComps == 3) {
+        writePS("/DeviceRGB setcolorspace\n");
+    } else {
+        writePS("/DeviceCMYK setcolorspace\n");
+    }
+    writePS("<<\n  /ImageType 1\n");
+    writePSFmt("  /Width {0:d}\n", w);
+    writePSFmt("  /Height {0:d}\n", h);
+    writePSFmt("  /ImageMatrix [{0:d} 0 0 {1:d} 0 {2:d}]\n", w, -h, h);
+    writePS("  /BitsPerComponent 8\n");
+    if (stripe.numComps == 1) {
+        // the optimized gray variants are implemented as a subtractive color space,
+        // such that the range is flipped for them
+        if (stripe.isOptimizedGray) {
+            writePS("  /Decode [1 0]\n");
+        } else {
+            writePS("  /Decode [0 1]\n");
+        }
+    } else if (stripe.numComps == 3) {
+        writePS("  /Decode [0 1 0 1 0 1]\n");
+    } else {
+        writePS("  /Decode [0 1 0 1 0 1 0 1]\n");
+    }
+    writePS("  /DataSource currentfile\n");
+    if (useBinary) {
+        /* nothing to do */;
+    } else if (useASCIIHex) {
+        writePS("    /ASCIIHexDecode filter\n");
+    } else {
+        writePS("    /ASCII85Decode filter\n");
+    }
+    if (getEnableFlate() && level >= psLevel3) {
+        writePS("    /FlateDecode filter\n");
+    } else if (getEnableLZW()) {
+        writePS("    /LZWDecode filter\n");
+    } else {
+        writePS("    /RunLengthDecode filter\n");
+    }
+    writePS(">>\n");
+    if (useBinary) {
+        // Count the bytes to write a document comment
+        writePSFmt("%%BeginData: {0:d} Binary Bytes\n", (int)stripe.data.size() + 6 + 1);
+    }
+    writePS("image\n");
+    writePSBuf(stripe.data.data(), stripe.data.size());
+    writePSChar('\n');
+    if (useBinary) {
+        writePS("%%EndData\n");
+    }
+    processColors |= (stripe.numComps == 1) ? psProcessBlack : psProcessCMYK;
+}
+
+// Check whether <page> has to be rasterized, and if it does, rasterize
+// and encode it, at <xScaleA> x <yScaleA> times the raster resolution.
+// This runs on RasterPool threads, and so only reads the settings and
+// renders with a copy of the XRef.
+std::unique_ptr<PSOutputDev::RasterPage> PSOutputDev::prepareRasterPage(SplashOutputDev *splashOut, Page *page, const RasterSlice &slice, double xScaleA, double yScaleA, int numComps, SplashColorMode internalColorFormat) const
+{
+    auto result = std::make_unique<RasterPage>();
+    result->ok = true;
+    result->xScale = xScaleA;
+    result->yScale = yScaleA;
+
+    if (forceRasterize == psAlwaysRasterize) {
+        result->rasterize = true;
+    } else if (forceRasterize == psNeverRasterize) {
+        result->rasterize = false;
+    } else {
+        PreScanOutputDev scan(level);
+        page->displaySlice(&scan, 72, 72, slice.rotate, slice.useMediaBox, slice.crop, slice.sliceX, slice.sliceY, slice.sliceW, slice.sliceH, slice.printing, slice.abortCheckCbk, slice.abortCheckCbkData, slice.annotDisplayDecideCbk,
+                           slice.annotDisplayDecideCbkData, true);
+        result->rasterize = scan.usesTransparency() || scan.usesPatternImageMask();
+    }
+    if (!result->rasterize) {
+        return result;
+    }
+
+    const double hDPI2 = xScaleA * rasterResolution;
+    const double vDPI2 = yScaleA * rasterResolution;
+    RasterSlice stripeSlice = slice;
+    const int stripeH = setupRasterSlice(page, &stripeSlice, hDPI2, vDPI2);
+    if (stripeH == 0) {
+        result->ok = false;
+        return result;
+    }
+    for (int stripeY = stripeSlice.sliceY; stripeY < stripeSlice.sliceH; stripeY += stripeH) {
+        RasterStripe &stripe = result->stripes.emplace_back();
+        rasterizeStripe(splashOut, page, &stripeSlice, hDPI2, vDPI2, stripeY, stripeH, stripe.mat, true);
+        encodeRasterStripe(splashOut->getBitmap(), numComps, internalColorFormat, &stripe);
+    }
+    return result;
+}
+
 bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, int rotateA, bool useMediaBox, bool crop, int sliceX, int sliceY, int sliceW, int sliceH, bool printing, bool (*abortCheckCbk)(void *data),
                                  void *abortCheckCbkData, bool (*annotDisplayDecideCbk)(Annot *annot, void *user_data), void *annotDisplayDecideCbkData)
 {
     PreScanOutputDev *scan;
     bool rasterize;
-    bool useFlate, useLZW;
     SplashOutputDev *splashOut;
-    SplashColor paperColor;
     PDFRectangle box;
     GfxState *state;
     SplashBitmap *bitmap;
-    Stream *str0, *str;
     unsigned char *p;
     unsigned char col[4];
     double hDPI2, vDPI2;
-    double m0, m1, m2, m3, m4, m5;
-    int nStripes, stripeH, stripeY;
-    int c, w, h, x, y, comp, i;
+    double mat[6];
+    int stripeH, stripeY;
+    int w, h, x, y, comp, i;
     int numComps, initialNumComps;
     char hexBuf[32 * 2 + 2]; // 32 values X 2 chars/value + line ending + null
     unsigned char digit;
@@ -3128,7 +3795,21 @@ bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, i
     if (!postInitDone) {
         postInit();
     }
-    if (forceRasterize == psAlwaysRasterize) {
+    const RasterSlice slice = { rotateA, useMediaBox, crop, sliceX, sliceY, sliceW, sliceH, printing, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData };
+
+    // the page may have been checked and rasterized ahead
+    std::unique_ptr<RasterPage> prepared;
+    if (rasterThreads > 1 && level >= psLevel2) {
+        if (!rasterPool) {
+            getRasterColorFormat(&internalColorFormat, &numComps, &overprint);
+            rasterPool = std::make_unique<RasterPool>(this, slice, internalColorFormat, numComps, overprint);
+        }
+        prepared = rasterPool->take(page->getNum(), slice);
+    }
+
+    if (prepared) {
+        rasterize = prepared->rasterize;
+    } else if (forceRasterize == psAlwaysRasterize) {
         rasterize = true;
     } else if (forceRasterize == psNeverRasterize) {
         rasterize = false;
@@ -3142,9 +3823,6 @@ bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, i
         return true;
     }
 
-    // get the rasterization parameters
-    useFlate = getEnableFlate() && level >= psLevel3;
-    useLZW = getEnableLZW();
     // start the PS page
     page->makeBox(rasterResolution, rasterResolution, rotateA, useMediaBox, false, sliceX, sliceY, sliceW, sliceH, &box, &crop);
     rotateA += page->getRotate();
@@ -3157,84 +3835,42 @@ bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, i
     startPage(page->getNum(), state, xref);
     delete state;
 
-    // If we would not rasterize this page, we would emit the overprint code anyway for language level 2 and upwards.
-    // As such it is safe to assume for a CMYK printer that it would respect the overprint operands.
-    overprint = overprintPreview || (processColorFormat == splashModeCMYK8 && level >= psLevel2);
-
-    // set up the SplashOutputDev
-    internalColorFormat = processColorFormat;
-    if (processColorFormat == splashModeMono8) {
-        numComps = 1;
-        paperColor[0] = 0xff;
-    } else if (processColorFormat == splashModeCMYK8) {
-        numComps = 4;
-        splashClearColor(paperColor);
-
-        // If overprinting is emulated, it is not sufficient to just store the CMYK values in a bitmap.
-        // All separation channels need to be stored and collapsed at the end.
-        // Cf. PDF32000_2008 Section 11.7.4.5 and Tables 148, 149
-        if (overprint) {
-            internalColorFormat = splashModeDeviceN8;
+    if (rasterPool) {
+        rasterPool->setScale(xScale, yScale);
+    }
+    if (prepared && prepared->ok && prepared->xScale == xScale && prepared->yScale == yScale) {
+        for (const RasterStripe &stripe : prepared->stripes) {
+            writePS("gsave\n");
+            writePSFmt("[{0:.6g} {1:.6g} {2:.6g} {3:.6g} {4:.6g} {5:.6g}] concat\n", stripe.mat[0], stripe.mat[1], stripe.mat[2], stripe.mat[3], stripe.mat[4], stripe.mat[5]);
+            writeRasterImage(stripe);
+            writePS("grestore\n");
         }
-    } else if (processColorFormat == splashModeRGB8) {
-        numComps = 3;
-        paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
-    } else {
-        error(errUnimplemented, -1, "Unsupported processColorMode. Falling back to RGB8.");
-        processColorFormat = splashModeRGB8;
-        internalColorFormat = processColorFormat;
-        numComps = 3;
-        paperColor[0] = paperColor[1] = paperColor[2] = 0xff;
+        endPage();
+        return false;
     }
-    splashOut = new SplashOutputDev(internalColorFormat, 1, false, paperColor, false, splashThinLineDefault, overprint);
-    splashOut->setFontAntialias(rasterAntialias);
-    splashOut->setVectorAntialias(rasterAntialias);
-#ifdef USE_CMS
-    splashOut->setDisplayProfile(getDisplayProfile());
-    splashOut->setDefaultGrayProfile(getDefaultGrayProfile());
-    splashOut->setDefaultRGBProfile(getDefaultRGBProfile());
-    splashOut->setDefaultCMYKProfile(getDefaultCMYKProfile());
-#endif
-    splashOut->startDoc(doc);
+
+    // set up the SplashOutputDev, which is kept for the following pages
+    getRasterColorFormat(&internalColorFormat, &numComps, &overprint);
+    if (!rasterOut) {
+        rasterOut.reset(createRasterOutputDev(internalColorFormat, overprint));
+    }
+    splashOut = rasterOut.get();
 
     // break the page into stripes
     hDPI2 = xScale * rasterResolution;
     vDPI2 = yScale * rasterResolution;
-    if (sliceW < 0 || sliceH < 0) {
-        if (useMediaBox) {
-            box = *page->getMediaBox();
-        } else {
-            box = *page->getCropBox();
-        }
-        sliceX = sliceY = 0;
-        sliceW = (int)((box.x2 - box.x1) * hDPI2 / 72.0);
-        sliceH = (int)((box.y2 - box.y1) * vDPI2 / 72.0);
-    }
-    int sliceArea;
-    if (checkedMultiply(sliceW, sliceH, &sliceArea)) {
-        delete splashOut;
+    RasterSlice stripeSlice = slice;
+    stripeH = setupRasterSlice(page, &stripeSlice, hDPI2, vDPI2);
+    if (stripeH == 0) {
         return false;
     }
-    nStripes = (int)ceil((double)(sliceArea) / (double)rasterizationSliceSize);
-    if (unlikely(nStripes == 0)) {
-        delete splashOut;
-        return false;
-    }
-    stripeH = (sliceH + nStripes - 1) / nStripes;
 
     // render the stripes
     initialNumComps = numComps;
-    for (stripeY = sliceY; stripeY < sliceH; stripeY += stripeH) {
+    for (stripeY = stripeSlice.sliceY; stripeY < stripeSlice.sliceH; stripeY += stripeH) {
 
         // rasterize a stripe
-        page->makeBox(hDPI2, vDPI2, 0, useMediaBox, false, sliceX, stripeY, sliceW, stripeH, &box, &crop);
-        m0 = box.x2 - box.x1;
-        m1 = 0;
-        m2 = 0;
-        m3 = box.y2 - box.y1;
-        m4 = box.x1;
-        m5 = box.y1;
-        page->displaySlice(splashOut, hDPI2, vDPI2, (360 - page->getRotate()) % 360, useMediaBox, crop, sliceX, stripeY, sliceW, stripeH, printing, abortCheckCbk, abortCheckCbkData, annotDisplayDecideCbk, annotDisplayDecideCbkData);
+        rasterizeStripe(splashOut, page, &stripeSlice, hDPI2, vDPI2, stripeY, stripeH, mat, false);
 
         // draw the rasterized image
         bitmap = splashOut->getBitmap();
@@ -3242,7 +3878,7 @@ bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, i
         w = bitmap->getWidth();
         h = bitmap->getHeight();
         writePS("gsave\n");
-        writePSFmt("[{0:.6g} {1:.6g} {2:.6g} {3:.6g} {4:.6g} {5:.6g}] concat\n", m0, m1, m2, m3, m4, m5);
+        writePSFmt("[{0:.6g} {1:.6g} {2:.6g} {3:.6g} {4:.6g} {5:.6g}] concat\n", mat[0], mat[1], mat[2], mat[3], mat[4], mat[5]);
         switch (level) {
         case psLevel1:
             writePSFmt("{0:d} {1:d} 8 [{2:d} 0 0 {3:d} 0 {4:d}] pdfIm1{5:s}\n", w, h, w, -h, h, useBinary ? "Bin" : "");
@@ -3439,147 +4075,16 @@ bool PSOutputDev::checkPageSlice(Page *page, double /*hDPI*/, double /*vDPI*/, i
         case psLevel2:
         case psLevel2Sep:
         case psLevel3:
-        case psLevel3Sep:
-            p = bitmap->getDataPtr() + (h - 1) * bitmap->getRowSize();
-            if (processColorFormat == splashModeCMYK8 && internalColorFormat != splashModeCMYK8) {
-                str0 = new SplashBitmapCMYKEncoder(bitmap);
-            } else {
-                str0 = new MemStream((char *)p, 0, w * h * numComps, Object(objNull));
-            }
-            // Check for a color image that uses only gray
-            if (!getOptimizeColorSpace()) {
-                isOptimizedGray = false;
-            } else if (numComps == 4) {
-                int compCyan;
-                isOptimizedGray = true;
-                while ((compCyan = str0->getChar()) != EOF) {
-                    if (str0->getChar() != compCyan || str0->getChar() != compCyan) {
-                        isOptimizedGray = false;
-                        break;
-                    }
-                    str0->getChar();
-                }
-            } else if (numComps == 3) {
-                int compRed;
-                isOptimizedGray = true;
-                while ((compRed = str0->getChar()) != EOF) {
-                    if (str0->getChar() != compRed || str0->getChar() != compRed) {
-                        isOptimizedGray = false;
-                        break;
-                    }
-                }
-            } else {
-                isOptimizedGray = false;
-            }
-            str0->reset();
-            if (useFlate) {
-                if (isOptimizedGray && numComps == 4) {
-                    str = new FlateEncoder(new CMYKGrayEncoder(str0));
-                    numComps = 1;
-                } else if (isOptimizedGray && numComps == 3) {
-                    str = new FlateEncoder(new RGBGrayEncoder(str0));
-                    numComps = 1;
-                } else {
-                    str = new FlateEncoder(str0);
-                }
-            } else if (useLZW) {
-                if (isOptimizedGray && numComps == 4) {
-                    str = new LZWEncoder(new CMYKGrayEncoder(str0));
-                    numComps = 1;
-                } else if (isOptimizedGray && numComps == 3) {
-                    str = new LZWEncoder(new RGBGrayEncoder(str0));
-                    numComps = 1;
-                } else {
-                    str = new LZWEncoder(str0);
-                }
-            } else {
-                if (isOptimizedGray && numComps == 4) {
-                    str = new RunLengthEncoder(new CMYKGrayEncoder(str0));
-                    numComps = 1;
-                } else if (isOptimizedGray && numComps == 3) {
-                    str = new RunLengthEncoder(new RGBGrayEncoder(str0));
-                    numComps = 1;
-                } else {
-                    str = new RunLengthEncoder(str0);
-                }
-            }
-            if (numComps == 1) {
-                writePS("/DeviceGray setcolorspace\n");
-            } else if (numComps == 3) {
-                writePS("/DeviceRGB setcolorspace\n");
-            } else {
-                writePS("/DeviceCMYK setcolorspace\n");
-            }
-            writePS("<<\n  /ImageType 1\n");
-            writePSFmt("  /Width {0:d}\n", bitmap->getWidth());
-            writePSFmt("  /Height {0:d}\n", bitmap->getHeight());
-            writePSFmt("  /ImageMatrix [{0:d} 0 0 {1:d} 0 {2:d}]\n", w, -h, h);
-            writePS("  /BitsPerComponent 8\n");
-            if (numComps == 1) {
-                // the optimized gray variants are implemented as a subtractive color space,
-                // such that the range is flipped for them
-                if (isOptimizedGray) {
-                    writePS("  /Decode [1 0]\n");
-                } else {
-                    writePS("  /Decode [0 1]\n");
-                }
-            } else if (numComps == 3) {
-                writePS("  /Decode [0 1 0 1 0 1]\n");
-            } else {
-                writePS("  /Decode [0 1 0 1 0 1 0 1]\n");
-            }
-            writePS("  /DataSource currentfile\n");
-            if (useBinary) {
-                /* nothing to do */;
-            } else if (useASCIIHex) {
-                writePS("    /ASCIIHexDecode filter\n");
-            } else {
-                writePS("    /ASCII85Decode filter\n");
-            }
-            if (useFlate) {
-                writePS("    /FlateDecode filter\n");
-            } else if (useLZW) {
-                writePS("    /LZWDecode filter\n");
-            } else {
-                writePS("    /RunLengthDecode filter\n");
-            }
-            writePS(">>\n");
-            if (useBinary) {
-                /* nothing to do */;
-            } else if (useASCIIHex) {
-                str = new ASCIIHexEncoder(str);
-            } else {
-                str = new ASCII85Encoder(str);
-            }
-            str->reset();
-            if (useBinary) {
-                // Count the bytes to write a document comment
-                int len = 0;
-                while (str->getChar() != EOF) {
-                    len++;
-                }
-                str->reset();
-                writePSFmt("%%BeginData: {0:d} Binary Bytes\n", len + 6 + 1);
-            }
-            writePS("image\n");
-            while ((c = str->getChar()) != EOF) {
-                writePSChar(c);
-            }
-            str->close();
-            delete str;
-            delete str0;
-            writePSChar('\n');
-            if (useBinary) {
-                writePS("%%EndData\n");
-            }
-            processColors |= (numComps == 1) ? psProcessBlack : psProcessCMYK;
+        case psLevel3Sep: {
+            RasterStripe stripe;
+            encodeRasterStripe(bitmap, numComps, internalColorFormat, &stripe);
+            writeRasterImage(stripe);
             break;
         }
+        }
         writePS("grestore\n");
     }
 
-    delete splashOut;
-
     // finish the PS page
     endPage();
 
@@ -43,6 +43,8 @@
 #include "poppler-config.h"
 #include "poppler_private_export.h"
 #include <cstddef>
+#include <functional>
+#include <memory>
 #include "Object.h"
 #include "GfxState.h"
 #include "GlobalParams.h"
@@ -58,10 +60,14 @@
 #include "splash/Splash.h"
 
 class PDFDoc;
+class SplashBitmap;
+class SplashOutputDev;
 class XRef;
 class Function;
 class GfxPath;
 class GfxFont;
+class FoFiTrueType;
+class FoFiType1C;
 class GfxColorSpace;
 class GfxSeparationColorSpace;
 class PDFRectangle;
@@ -314,6 +320,10 @@ public:
     void setRasterAntialias(bool a) { rasterAntialias = a; }
     void setForceRasterize(PSForceRasterize f) { forceRasterize = f; }
     void setRasterResolution(double r) { rasterResolution = r; }
+    // Rasterize pages on <n> threads, ahead of the page being written
+    // (PostScript level 2 and 3 only).  The abort check and annotation
+    // display callbacks are then also called from those threads.
+    void setRasterThreads(int n) { rasterThreads = n; }
     void setRasterMono(bool b)
     {
         processColorFormat = splashModeMono8;
@@ -337,6 +347,10 @@ public:
     void setEmbedCIDTrueType(bool b) { embedCIDTrueType = b; }
     void setFontPassthrough(bool b) { fontPassthrough = b; }
     void setOptimizeColorSpace(bool b) { optimizeColorSpace = b; }
+    // Only embed the glyphs of embedded TrueType, Type 1C and CID
+    // fonts that the pages actually draw.  This needs an extra pass
+    // over the pages before the document setup is written.
+    void setSubsetFonts(bool b) { subsetFonts = b; }
     void setPassLevel1CustomColor(bool b) { passLevel1CustomColor = b; }
     void setPreloadImagesForms(bool b) { preloadImagesForms = b; }
     void setGenerateOPI(bool b) { generateOPI = b; }
@@ -370,6 +384,10 @@ private:
     void setupFont(GfxFont *font, Dict *parentResDict);
     void setupEmbeddedType1Font(Ref *id, GooString *psName);
     void updateFontMaxValidGlyph(GfxFont *font, int maxValidGlyph);
+    void scanGlyphUsage(const std::vector<int> &pageList);
+    void setTrueTypeSubset(FoFiTrueType *ffTT, GfxFont *font, const int *codeToGID) const;
+    void setType1CSubset(FoFiType1C *ffT1C, const Ref *id) const;
+    int *makeCFFSubsetMap(const Ref *id, const int *cidToGID, int nCIDs) const;
     void setupExternalType1Font(const GooString *fileName, GooString *psName);
     void setupEmbeddedType1CFont(GfxFont *font, Ref *id, GooString *psName);
     void setupEmbeddedOpenTypeT1CFont(GfxFont *font, Ref *id, GooString *psName);
@@ -408,6 +426,19 @@ private:
     // Write the document-level setup.
     void writeDocSetup(Catalog *catalog, const std::vector<int> &pageList, bool duplexA);
 
+    // page rasterization
+    struct RasterSlice;
+    struct RasterStripe;
+    struct RasterPage;
+    class RasterPool;
+    void getRasterColorFormat(SplashColorMode *internalColorFormat, int *numComps, bool *overprint);
+    SplashOutputDev *createRasterOutputDev(SplashColorMode internalColorFormat, bool overprint) const;
+    int setupRasterSlice(Page *page, RasterSlice *slice, double hDPI2, double vDPI2) const;
+    void rasterizeStripe(SplashOutputDev *splashOut, Page *page, RasterSlice *slice, double hDPI2, double vDPI2, int stripeY, int stripeH, double *mat, bool copyXRef) const;
+    void encodeRasterStripe(SplashBitmap *bitmap, int numComps, SplashColorMode internalColorFormat, RasterStripe *stripe) const;
+    void writeRasterImage(const RasterStripe &stripe);
+    std::unique_ptr<RasterPage> prepareRasterPage(SplashOutputDev *splashOut, Page *page, const RasterSlice &slice, double xScaleA, double yScaleA, int numComps, SplashColorMode internalColorFormat) const;
+
     void writePSChar(char c);
     void writePS(const char *s);
     void writePSBuf(const char *s, int len);
@@ -453,6 +484,17 @@ private:
     std::set<int> resourceIDs; // list of object IDs of objects containing Resources we've already set up
     std::unordered_set<std::string> fontNames; // all used font names
     std::unordered_map<std::string, int> perFontMaxValidGlyph; // max valid glyph of each font
+    struct PSCIDTrueTypeFont
+    {
+        Ref fontFileID;
+        std::vector<int> cidToGID;
+        std::string psName;
+        int maxValidGlyph;
+    };
+    std::vector<PSCIDTrueTypeFont> cidTrueTypeFonts; // embedded CID TrueType fonts, to reuse them
+    std::map<Ref, std::set<int>> usedCodes; // char codes drawn with each 8-bit font (with subsetFonts)
+    std::map<Ref, std::set<int>> usedCIDGlyphs; // GIDs (TrueType) or CIDs (CFF) drawn with each embedded CID font file (with subsetFonts)
+    std::map<Ref, std::set<std::string>> usedType1CGlyphs; // glyph names drawn with each embedded 8-bit Type 1C font file (with subsetFonts)
     PST1FontName *t1FontNames; // font names for Type 1/1C fonts
     int t1FontNameLen; // number of entries in t1FontNames array
     int t1FontNameSize; // size of t1FontNames array
@@ -511,11 +553,15 @@ private:
     bool rasterAntialias; // antialias on rasterize
     bool uncompressPreloadedImages;
     double rasterResolution; // PostScript rasterization resolution (dpi)
+    int rasterThreads = 1; // number of threads rasterizing pages ahead
+    std::unique_ptr<SplashOutputDev> rasterOut; // rasterizes pages, reused so fonts stay loaded
+    std::unique_ptr<RasterPool> rasterPool; // rasterizes pages ahead on worker threads
     bool embedType1; // embed Type 1 fonts?
     bool embedTrueType; // embed TrueType fonts?
     bool embedCIDPostScript; // embed CID PostScript fonts?
     bool embedCIDTrueType; // embed CID TrueType fonts?
     bool fontPassthrough; // pass all fonts through as-is?
+    bool subsetFonts = false; // embed only the used glyphs of TrueType and CID fonts?
     bool optimizeColorSpace; // false to keep gray RGB images in their original color space
                              // true to optimize gray images to DeviceGray color space
     bool passLevel1CustomColor; // false to convert all custom colors to CMYK
@@ -0,0 +1,447 @@
+//========================================================================
+//
+// ResourceInfo.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+// To see a description of the changes please see the Changelog file that
+// came with your tarball or type make ChangeLog if you are building from git
+//
+//========================================================================
+
+#include "config.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "Object.h"
+#include "Array.h"
+#include "Dict.h"
+#include "XRef.h"
+#include "Page.h"
+#include "PDFDoc.h"
+#include "ResourceInfo.h"
+
+//------------------------------------------------------------------------
+
+// The family of a color space: its name, or the name at the start of
+// its array.
+static std::string colorSpaceFamily(const Object &csObj)
+{
+    if (csObj.isName()) {
+        return csObj.getName();
+    }
+    if (csObj.isArray() && csObj.arrayGetLength() > 0) {
+        Object obj = csObj.arrayGet(0);
+        if (obj.isName()) {
+            return obj.getName();
+        }
+    }
+    return {};
+}
+
+static std::string shadingTypeName(int shadingType)
+{
+    static const char *names[] = { "function", "axial", "radial", "free-form", "lattice", "coons", "tensor" };
+    if (shadingType >= 1 && shadingType <= 7) {
+        return names[shadingType - 1];
+    }
+    return "unknown";
+}
+
+static int lookupInt(Dict *dict, const char *key)
+{
+    Object obj = dict->lookup(key);
+    return obj.isInt() ? obj.getInt() : 0;
+}
+
+//------------------------------------------------------------------------
+// ResourceScanner
+//------------------------------------------------------------------------
+
+ResourceScanner::ResourceScanner(PDFDoc *docA)
+{
+    doc = docA;
+    lastScannedPage = 0;
+    lowestOpenDepth = INT_MAX;
+}
+
+ResourceScanner::~ResourceScanner() = default;
+
+void ResourceScanner::scan(int firstPage, int lastPage)
+{
+    firstPage = std::max(firstPage, lastScannedPage + 1);
+    lastPage = std::min(lastPage, doc->getNumPages());
+
+    for (int pg = firstPage; pg <= lastPage; ++pg) {
+        Page *page = doc->getPage(pg);
+        if (!page) {
+            continue;
+        }
+
+        IdList ids;
+
+        // Page resources are fetched by PageAttrs, so look the reference up
+        // in the page dictionary.  Direct and inherited resource dicts are
+        // remembered by their address instead: inherited ones are shared
+        // by all the pages below the node they come from.
+        Ref resRef = Ref::INVALID();
+        if (page->getRef() != Ref::INVALID()) {
+            Object pageObj = doc->getXRef()->fetch(page->getRef());
+            if (pageObj.isDict()) {
+                const Object &resNF = pageObj.dictLookupNF("Resources");
+                if (resNF.isRef()) {
+                    resRef = resNF.getRef();
+                }
+            }
+        }
+        Object *resObj = page->getResourceDictObject();
+        if (resRef != Ref::INVALID()) {
+            addResourceDict(*resObj, resRef, &ids);
+        } else if (resObj->isDict()) {
+            auto it = pageClosures.find(resObj->getDict());
+            if (it == pageClosures.end()) {
+                IdList found;
+                scanResourceDict(resObj->getDict(), &found);
+                std::sort(found.begin(), found.end());
+                found.erase(std::unique(found.begin(), found.end()), found.end());
+                it = pageClosures.emplace(resObj->getDict(), std::move(found)).first;
+            }
+            ids.insert(ids.end(), it->second.begin(), it->second.end());
+        }
+
+        Object annots = page->getAnnotsObject();
+        if (annots.isArray()) {
+            for (int i = 0; i < annots.arrayGetLength(); ++i) {
+                Object annot = annots.arrayGet(i);
+                if (annot.isDict()) {
+                    Ref apRef;
+                    Object ap = annot.getDict()->lookup("AP", &apRef);
+                    addAppearance(ap, apRef, &ids);
+                }
+            }
+        }
+
+        for (int id : ids) {
+            std::vector<int> &pages = resources[id].pages;
+            if (pages.empty() || pages.back() != pg) {
+                pages.push_back(pg);
+            }
+        }
+    }
+
+    lastScannedPage = std::max(lastScannedPage, lastPage);
+}
+
+// Adds to <ids> the resources that the object <ref> leads to, running
+// <collectFunc> to find them the first time <ref> is seen.  Direct
+// objects (<ref> is Ref::INVALID()) are not remembered.
+//
+// A reference back to an object that is still being collected ends the
+// walk there.  What such a cycle leads to is only complete once its
+// first object is done, so the objects inside it are not remembered:
+// they are collected again if they are reached from elsewhere.
+void ResourceScanner::collect(Ref ref, const std::function<void(IdList *)> &collectFunc, IdList *ids)
+{
+    if (ref == Ref::INVALID()) {
+        collectFunc(ids);
+        return;
+    }
+
+    auto it = closures.find(ref);
+    if (it != closures.end()) {
+        ids->insert(ids->end(), it->second.begin(), it->second.end());
+        return;
+    }
+    const auto open = openRefs.find(ref);
+    if (open != openRefs.end()) {
+        lowestOpenDepth = std::min(lowestOpenDepth, open->second);
+        return;
+    }
+
+    const int depth = openRefs.size();
+    openRefs.emplace(ref, depth);
+    const int outerLowestOpenDepth = lowestOpenDepth;
+    lowestOpenDepth = INT_MAX;
+
+    IdList found;
+    collectFunc(&found);
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+
+    openRefs.erase(ref);
+    ids->insert(ids->end(), found.begin(), found.end());
+    if (lowestOpenDepth >= depth) {
+        closures.emplace(ref, std::move(found));
+        lowestOpenDepth = outerLowestOpenDepth;
+    } else {
+        lowestOpenDepth = std::min(lowestOpenDepth, outerLowestOpenDepth);
+    }
+}
+
+void ResourceScanner::addResourceDict(const Object &resObj, Ref resRef, IdList *ids)
+{
+    collect(
+            resRef,
+            [&](IdList *found) {
+                if (resObj.isDict()) {
+                    scanResourceDict(resObj.getDict(), found);
+                }
+            },
+            ids);
+}
+
+// The resources of a form XObject, tiling pattern, Type 3 font or
+// appearance stream.
+void ResourceScanner::addResources(Dict *owner, Ref ownerRef, IdList *ids)
+{
+    collect(
+            ownerRef,
+            [&](IdList *found) {
+                Ref resRef;
+                Object resObj = owner->lookup("Resources", &resRef);
+                addResourceDict(resObj, resRef, found);
+            },
+            ids);
+}
+
+void ResourceScanner::scanResourceDict(Dict *resDict, IdList *ids)
+{
+    // calls <func> with each entry of the <category> sub-dictionary
+    auto forEachEntry = [&](const char *category, const std::function<void(const char *key, const Object &obj, Ref ref, IdList *found)> &func) {
+        Ref catRef;
+        Object cat = resDict->lookup(category, &catRef);
+        collect(
+                catRef,
+                [&](IdList *found) {
+                    if (!cat.isDict()) {
+                        return;
+                    }
+                    for (int i = 0; i < cat.dictGetLength(); ++i) {
+                        Ref ref;
+                        Object obj = cat.getDict()->getVal(i, &ref);
+                        func(cat.getDict()->getKey(i), obj, ref, found);
+                    }
+                },
+                ids);
+    };
+
+    forEachEntry("Font", [&](const char *key, const Object &obj, Ref ref, IdList *found) { addFont(key, obj, ref, found); });
+    forEachEntry("XObject", [&](const char *key, const Object &obj, Ref ref, IdList *found) { addXObject(key, obj, ref, found); });
+    forEachEntry("Pattern", [&](const char *key, const Object &obj, Ref ref, IdList *found) { addPattern(key, obj, ref, found); });
+    forEachEntry("ExtGState", [&](const char *key, const Object &obj, Ref ref, IdList *found) { addExtGState(obj, ref, found); });
+    forEachEntry("ColorSpace", [&](const char *key, const Object &obj, Ref ref, IdList *found) {
+        bool isNew;
+        const int id = addResource(ResourceInfo::colorSpace, key, ref, &isNew);
+        if (isNew) {
+            resources[id].type = colorSpaceFamily(obj);
+        }
+        found->push_back(id);
+    });
+    forEachEntry("Shading", [&](const char *key, const Object &obj, Ref ref, IdList *found) {
+        Dict *dict = obj.isStream() ? obj.streamGetDict() : obj.isDict() ? obj.getDict() : nullptr;
+        if (!dict) {
+            return;
+        }
+        bool isNew;
+        const int id = addResource(ResourceInfo::shading, key, ref, &isNew);
+        if (isNew) {
+            resources[id].type = shadingTypeName(lookupInt(dict, "ShadingType"));
+        }
+        found->push_back(id);
+    });
+}
+
+void ResourceScanner::addFont(const char *key, const Object &fontObj, Ref fontRef, IdList *ids)
+{
+    if (!fontObj.isDict()) {
+        return;
+    }
+    Dict *fontDict = fontObj.getDict();
+
+    bool isNew;
+    const int id = addResource(ResourceInfo::font, key, fontRef, &isNew);
+    ids->push_back(id);
+
+    Object subtype = fontDict->lookup("Subtype");
+    if (isNew) {
+        ResourceInfo &info = resources[id];
+        Object baseFont = fontDict->lookup("BaseFont");
+        if (baseFont.isName()) {
+            info.fontName = baseFont.getName();
+        }
+        if (subtype.isName()) {
+            info.type = subtype.getName();
+        }
+
+        // the descriptor of a Type 0 font is in its descendant font
+        Object descendant;
+        Dict *descDict = fontDict;
+        if (subtype.isName("Type0")) {
+            Object descendants = fontDict->lookup("DescendantFonts");
+            if (descendants.isArray() && descendants.arrayGetLength() > 0) {
+                descendant = descendants.arrayGet(0);
+                if (descendant.isDict()) {
+                    descDict = descendant.getDict();
+                    Object descSubtype = descDict->lookup("Subtype");
+                    if (descSubtype.isName()) {
+                        info.type = descSubtype.getName();
+                    }
+                }
+            }
+        }
+        if (subtype.isName("Type3")) {
+            info.embedded = true;
+        } else {
+            Object fontDesc = descDict->lookup("FontDescriptor");
+            if (fontDesc.isDict()) {
+                info.embedded = !fontDesc.dictLookupNF("FontFile").isNull() || !fontDesc.dictLookupNF("FontFile2").isNull() || !fontDesc.dictLookupNF("FontFile3").isNull();
+            }
+        }
+    }
+
+    // glyph procedures of Type 3 fonts have resources of their own
+    if (subtype.isName("Type3")) {
+        addResources(fontDict, fontRef, ids);
+    }
+}
+
+void ResourceScanner::addXObject(const char *key, const Object &xObj, Ref xRef, IdList *ids)
+{
+    if (!xObj.isStream()) {
+        return;
+    }
+    Dict *dict = xObj.streamGetDict();
+
+    Object subtype = dict->lookup("Subtype");
+    if (subtype.isName("Image")) {
+        bool isNew;
+        const int id = addResource(ResourceInfo::image, key, xRef, &isNew);
+        if (isNew) {
+            ResourceInfo &info = resources[id];
+            info.width = lookupInt(dict, "Width");
+            info.height = lookupInt(dict, "Height");
+            Object imageMask = dict->lookup("ImageMask");
+            if (imageMask.isBool() && imageMask.getBool()) {
+                info.type = "ImageMask";
+                info.bpc = 1;
+            } else {
+                info.type = colorSpaceFamily(dict->lookup("ColorSpace"));
+                info.bpc = lookupInt(dict, "BitsPerComponent");
+            }
+        }
+        ids->push_back(id);
+    } else if (subtype.isName("Form")) {
+        addResources(dict, xRef, ids);
+    }
+}
+
+void ResourceScanner::addPattern(const char *key, const Object &patObj, Ref patRef, IdList *ids)
+{
+    Dict *dict = patObj.isStream() ? patObj.streamGetDict() : patObj.isDict() ? patObj.getDict() : nullptr;
+    if (!dict) {
+        return;
+    }
+
+    const int patternType = lookupInt(dict, "PatternType");
+    if (patternType == 1 && patObj.isStream()) {
+        addResources(dict, patRef, ids);
+    } else if (patternType == 2) {
+        Ref shRef;
+        Object shObj = dict->lookup("Shading", &shRef);
+        Dict *shDict = shObj.isStream() ? shObj.streamGetDict() : shObj.isDict() ? shObj.getDict() : nullptr;
+        if (shDict) {
+            bool isNew;
+            const int id = addResource(ResourceInfo::shading, key, shRef, &isNew);
+            if (isNew) {
+                resources[id].type = shadingTypeName(lookupInt(shDict, "ShadingType"));
+            }
+            ids->push_back(id);
+        }
+        Ref gsRef;
+        Object gsObj = dict->lookup("ExtGState", &gsRef);
+        addExtGState(gsObj, gsRef, ids);
+    }
+}
+
+// Graphics states can select a font, and their soft masks are drawn by
+// a form XObject.
+void ResourceScanner::addExtGState(const Object &gsObj, Ref gsRef, IdList *ids)
+{
+    collect(
+            gsRef,
+            [&](IdList *found) {
+                if (!gsObj.isDict()) {
+                    return;
+                }
+                Object fontArray = gsObj.dictLookup("Font");
+                if (fontArray.isArray() && fontArray.arrayGetLength() > 0) {
+                    Ref fontRef;
+                    Object fontObj = fontArray.getArray()->get(0, &fontRef);
+                    addFont("", fontObj, fontRef, found);
+                }
+                Object sMask = gsObj.dictLookup("SMask");
+                if (sMask.isDict()) {
+                    Ref groupRef;
+                    Object group = sMask.getDict()->lookup("G", &groupRef);
+                    if (group.isStream()) {
+                        addResources(group.streamGetDict(), groupRef, found);
+                    }
+                }
+            },
+            ids);
+}
+
+// All the appearance streams of an annotation, whatever its state.
+void ResourceScanner::addAppearance(const Object &apObj, Ref apRef, IdList *ids)
+{
+    collect(
+            apRef,
+            [&](IdList *found) {
+                if (!apObj.isDict()) {
+                    return;
+                }
+                for (const char *key : { "N", "R", "D" }) {
+                    Ref ref;
+                    Object obj = apObj.getDict()->lookup(key, &ref);
+                    if (obj.isStream()) {
+                        addResources(obj.streamGetDict(), ref, found);
+                    } else if (obj.isDict()) {
+                        for (int i = 0; i < obj.dictGetLength(); ++i) {
+                            Ref stateRef;
+                            Object state = obj.getDict()->getVal(i, &stateRef);
+                            if (state.isStream()) {
+                                addResources(state.streamGetDict(), stateRef, found);
+                            }
+                        }
+                    }
+                }
+            },
+            ids);
+}
+
+// Returns the index of the resource found through <ref>,
+// adding it if it hasn't been seen before; <isNew> tells which, so the
+// caller can fill in the details.
+int ResourceScanner::addResource(ResourceInfo::Kind kind, const char *key, Ref ref, bool *isNew)
+{
+    if (ref != Ref::INVALID()) {
+        auto it = resourceIds.find(ref);
+        if (it != resourceIds.end()) {
+            *isNew = false;
+            return it->second;
+        }
+    }
+
+    *isNew = true;
+    ResourceInfo info;
+    info.kind = kind;
+    info.ref = ref;
+    info.name = key;
+    resources.push_back(std::move(info));
+    const int id = resources.size() - 1;
+    if (ref != Ref::INVALID()) {
+        resourceIds.emplace(ref, id);
+    }
+    return id;
+}
@@ -0,0 +1,126 @@
+//========================================================================
+//
+// ResourceInfo.h
+//
+// This file is licensed under the GPLv2 or later
+//
+// To see a description of the changes please see the Changelog file that
+// came with your tarball or type make ChangeLog if you are building from git
+//
+//========================================================================
+
+#ifndef RESOURCE_INFO_H
+#define RESOURCE_INFO_H
+
+#include "Object.h"
+#include "poppler_private_export.h"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class PDFDoc;
+
+//------------------------------------------------------------------------
+// ResourceInfo
+//------------------------------------------------------------------------
+
+// A font, image, color space or shading found in the resources of a
+// document, with the pages using it.
+class POPPLER_PRIVATE_EXPORT ResourceInfo
+{
+public:
+    enum Kind
+    {
+        font,
+        image,
+        colorSpace,
+        shading
+    };
+
+    Kind getKind() const { return kind; }
+    // Ref::INVALID() for resources that are direct objects
+    Ref getRef() const { return ref; }
+    // The name the resource was first found under, e.g. "F1"
+    const std::string &getName() const { return name; }
+    // Fonts: the font Subtype (of the descendant font for Type0 fonts).
+    // Images and color spaces: the color space family ("ImageMask" for
+    // stencil masks).  Shadings: the shading type, e.g. "axial".
+    const std::string &getType() const { return type; }
+    // Fonts only
+    const std::string &getFontName() const { return fontName; }
+    bool getEmbedded() const { return embedded; }
+    // Images only
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getBitsPerComponent() const { return bpc; }
+    // The (1-based) pages using the resource, in increasing order
+    const std::vector<int> &getPages() const { return pages; }
+
+private:
+    friend class ResourceScanner;
+
+    Kind kind;
+    Ref ref;
+    std::string name;
+    std::string type;
+    std::string fontName;
+    bool embedded = false;
+    int width = 0;
+    int height = 0;
+    int bpc = 0;
+    std::vector<int> pages;
+};
+
+//------------------------------------------------------------------------
+// ResourceScanner
+//------------------------------------------------------------------------
+
+// Lists the fonts, images, color spaces and shadings of a document
+// without running any content stream.  The resource dictionaries of the
+// pages, form XObjects, tiling patterns, Type 3 fonts, soft masks and
+// annotation appearances are walked, and what every indirect one of
+// them leads to is remembered, so each object is only looked at once
+// however many pages share it.
+class POPPLER_PRIVATE_EXPORT ResourceScanner
+{
+public:
+    explicit ResourceScanner(PDFDoc *docA);
+    ~ResourceScanner();
+
+    ResourceScanner(const ResourceScanner &) = delete;
+    ResourceScanner &operator=(const ResourceScanner &) = delete;
+
+    // Scan pages <firstPage> to <lastPage> (1-based).  Successive calls
+    // must scan increasing page ranges.
+    void scan(int firstPage, int lastPage);
+
+    // The resources found so far, in the order they were found.
+    const std::vector<ResourceInfo> &getResources() const { return resources; }
+
+private:
+    using IdList = std::vector<int>;
+
+    void collect(Ref ref, const std::function<void(IdList *)> &collectFunc, IdList *ids);
+    void addResourceDict(const Object &resObj, Ref resRef, IdList *ids);
+    void addResources(Dict *owner, Ref ownerRef, IdList *ids);
+    void scanResourceDict(Dict *resDict, IdList *ids);
+    void addFont(const char *key, const Object &fontObj, Ref fontRef, IdList *ids);
+    void addXObject(const char *key, const Object &xObj, Ref xRef, IdList *ids);
+    void addPattern(const char *key, const Object &patObj, Ref patRef, IdList *ids);
+    void addExtGState(const Object &gsObj, Ref gsRef, IdList *ids);
+    void addAppearance(const Object &apObj, Ref apRef, IdList *ids);
+    int addResource(ResourceInfo::Kind kind, const char *key, Ref ref, bool *isNew);
+
+    PDFDoc *doc;
+    int lastScannedPage;
+    std::vector<ResourceInfo> resources;
+    std::unordered_map<Ref, int> resourceIds; // indirect resources -> index in resources
+    std::unordered_map<Ref, IdList> closures; // indirect containers -> resources they lead to
+    std::unordered_map<Ref, int> openRefs; // containers being collected -> their depth
+    int lowestOpenDepth; // the lowest depth of the open containers reached by the current one
+    std::unordered_map<const Dict *, IdList> pageClosures; // direct or inherited page resource dicts
+};
+
+#endif
@@ -71,6 +71,7 @@
 #include "splash/SplashScreen.h"
 #include "splash/SplashPath.h"
 #include "splash/SplashState.h"
+#include "splash/SplashClip.h"
 #include "splash/SplashErrorCodes.h"
 #include "splash/SplashFontEngine.h"
 #include "splash/SplashFont.h"
@@ -212,6 +213,203 @@ void SplashGouraudPattern::getParameterizedColor(double colorinterp, SplashColor
     }
 }
 
+//------------------------------------------------------------------------
+// SplashPatchMeshPattern
+//------------------------------------------------------------------------
+
+// Patches are tessellated into cells small enough for the triangles to
+// stay within patchFlatness device pixels of the patch, and for the color
+// (or the parameter, relative to the domain) to change by at most
+// patchColorStep between neighbouring vertices.  Cells are kept at least
+// patchMinCellSize pixels wide, and there are at most patchMaxCells of
+// them along each side of a patch.
+#define patchFlatness 0.5
+#define patchColorStep (1. / 32)
+#define patchMinCellSize 2
+#define patchMaxCells 128
+
+// Number of cells needed along a curve of the patch with the control
+// points dx, dy in device space, and which needs colorCells cells for
+// the color
+static int patchCells(const double (&dx)[4], const double (&dy)[4], int colorCells)
+{
+    double len = 0;
+    for (int k = 1; k < 4; ++k) {
+        len += std::hypot(dx[k] - dx[k - 1], dy[k] - dy[k - 1]);
+    }
+    // a cubic Bezier curve is within 3/4 * max |P(k-1) - 2 P(k) + P(k+1)| / n^2
+    // of the n segments joining its points at t = 0, 1/n, ..., 1
+    const double dd = std::max(std::hypot(dx[0] - 2 * dx[1] + dx[2], dy[0] - 2 * dy[1] + dy[2]), std::hypot(dx[1] - 2 * dx[2] + dx[3], dy[1] - 2 * dy[2] + dy[3]));
+    if (!std::isfinite(len) || !std::isfinite(dd)) {
+        return 1;
+    }
+    const double cells = std::min(std::max(std::sqrt(0.75 * dd / patchFlatness), (double)colorCells), len / patchMinCellSize);
+    return std::clamp((int)std::ceil(cells), 1, patchMaxCells);
+}
+
+SplashPatchMeshPattern::SplashPatchMeshPattern(SplashColorMode colorModeA, GfxState *stateA, GfxPatchMeshShading *shadingA)
+{
+    colorMode = colorModeA;
+    state = stateA;
+    shading = shadingA;
+    gfxMode = shadingA->getColorSpace()->getMode();
+    curPatch = -1;
+    curMode = colorModeA;
+
+    const bool parameterized = shading->isParameterized();
+    const int nComps = parameterized ? 1 : shading->getColorSpace()->getNComps();
+    const double colorRange = parameterized ? std::fabs(shading->getParameterDomainMax() - shading->getParameterDomainMin()) : (double)gfxColorComp1;
+    firstTriangle.push_back(0);
+    for (int i = 0; i < shading->getNPatches(); ++i) {
+        const GfxPatch *patch = shading->getPatch(i);
+        double px[4][4], py[4][4];
+        for (int j = 0; j < 4; ++j) {
+            for (int k = 0; k < 4; ++k) {
+                state->transform(patch->x[j][k], patch->y[j][k], &px[j][k], &py[j][k]);
+            }
+        }
+        // largest color change along u and along v
+        double du = 0, dv = 0;
+        for (int m = 0; m < nComps; ++m) {
+            du = std::max({ du, std::fabs(patch->color[0][0].c[m] - patch->color[1][0].c[m]), std::fabs(patch->color[0][1].c[m] - patch->color[1][1].c[m]) });
+            dv = std::max({ dv, std::fabs(patch->color[0][0].c[m] - patch->color[0][1].c[m]), std::fabs(patch->color[1][0].c[m] - patch->color[1][1].c[m]) });
+        }
+        int uColorCells = 1, vColorCells = 1;
+        if (colorRange > 0) {
+            uColorCells = (int)std::min(std::ceil(du / colorRange / patchColorStep), (double)patchMaxCells);
+            vColorCells = (int)std::min(std::ceil(dv / colorRange / patchColorStep), (double)patchMaxCells);
+        }
+        int nu = 1, nv = 1;
+        for (int j = 0; j < 4; ++j) {
+            const double cx[4] = { px[0][j], px[1][j], px[2][j], px[3][j] };
+            const double cy[4] = { py[0][j], py[1][j], py[2][j], py[3][j] };
+            nu = std::max(nu, patchCells(cx, cy, uColorCells));
+            nv = std::max(nv, patchCells(px[j], py[j], vColorCells));
+        }
+        uCells.push_back(nu);
+        vCells.push_back(nv);
+        firstTriangle.push_back(firstTriangle.back() + 2 * nu * nv);
+    }
+}
+
+SplashPatchMeshPattern::~SplashPatchMeshPattern() { }
+
+// The grid point (u, v) of the patch lies at sum_j,k B_j(u) B_k(v) (x[j][k], y[j][k])
+// with B the cubic Bernstein polynomials, and has the color of the corners
+// interpolated bilinearly, color[0][1] being the one at u = 0, v = 1.
+void SplashPatchMeshPattern::tessellate(int patchIdx, SplashColorMode mode)
+{
+    const GfxPatch *patch = shading->getPatch(patchIdx);
+    const int nu = uCells[patchIdx];
+    const int nv = vCells[patchIdx];
+    const bool parameterized = shading->isParameterized();
+    const GfxColorSpace *colorSpace = shading->getColorSpace();
+    const int nComps = colorSpace->getNComps();
+
+    auto bernstein = [](double t, double *b) {
+        const double s = 1 - t;
+        b[0] = s * s * s;
+        b[1] = 3 * t * s * s;
+        b[2] = 3 * t * t * s;
+        b[3] = t * t * t;
+    };
+    std::vector<double> bv(4 * (nv + 1));
+    for (int k = 0; k <= nv; ++k) {
+        bernstein((double)k / nv, &bv[4 * k]);
+    }
+
+    vertices.resize((nu + 1) * (nv + 1));
+    Vertex *vtx = vertices.data();
+    for (int j = 0; j <= nu; ++j) {
+        const double u = (double)j / nu;
+        double bu[4];
+        bernstein(u, bu);
+        // the control points of the curve for this u
+        double cx[4], cy[4];
+        for (int k = 0; k < 4; ++k) {
+            cx[k] = bu[0] * patch->x[0][k] + bu[1] * patch->x[1][k] + bu[2] * patch->x[2][k] + bu[3] * patch->x[3][k];
+            cy[k] = bu[0] * patch->y[0][k] + bu[1] * patch->y[1][k] + bu[2] * patch->y[2][k] + bu[3] * patch->y[3][k];
+        }
+        for (int k = 0; k <= nv; ++k, ++vtx) {
+            const double v = (double)k / nv;
+            const double *b = &bv[4 * k];
+            vtx->x = b[0] * cx[0] + b[1] * cx[1] + b[2] * cx[2] + b[3] * cx[3];
+            vtx->y = b[0] * cy[0] + b[1] * cy[1] + b[2] * cy[2] + b[3] * cy[3];
+            const double w00 = (1 - u) * (1 - v), w01 = (1 - u) * v, w10 = u * (1 - v), w11 = u * v;
+            GfxColor color;
+            if (parameterized) {
+                vtx->t = w00 * patch->color[0][0].c[0] + w01 * patch->color[0][1].c[0] + w10 * patch->color[1][0].c[0] + w11 * patch->color[1][1].c[0];
+                shading->getParameterizedColor(vtx->t, &color);
+            } else {
+                vtx->t = 0;
+                for (int m = 0; m < nComps; ++m) {
+                    color.c[m] = GfxColorComp(w00 * patch->color[0][0].c[m] + w01 * patch->color[0][1].c[m] + w10 * patch->color[1][0].c[m] + w11 * patch->color[1][1].c[m]);
+                }
+            }
+            convertGfxColor(vtx->color, mode, colorSpace, &color);
+        }
+    }
+    curPatch = patchIdx;
+    curMode = mode;
+}
+
+void SplashPatchMeshPattern::getTriangle(int i, SplashColorMode mode, const Vertex **v0, const Vertex **v1, const Vertex **v2)
+{
+    // triangles are asked for in order, so this mostly stays on the same patch
+    int patchIdx = curPatch;
+    if (patchIdx < 0 || i < firstTriangle[patchIdx] || i >= firstTriangle[patchIdx + 1]) {
+        patchIdx = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), i) - firstTriangle.begin() - 1;
+    }
+    if (patchIdx != curPatch || mode != curMode) {
+        tessellate(patchIdx, mode);
+    }
+
+    // every cell is split in two triangles along its (u, v) diagonal
+    const int nv = vCells[patchIdx];
+    const int cell = (i - firstTriangle[patchIdx]) / 2;
+    const Vertex *corner = &vertices[(cell / nv) * (nv + 1) + cell % nv];
+    *v0 = corner;
+    *v1 = corner + nv + 2;
+    *v2 = ((i - firstTriangle[patchIdx]) & 1) ? corner + nv + 1 : corner + 1;
+}
+
+void SplashPatchMeshPattern::getParametrizedTriangle(int i, double *x0, double *y0, double *color0, double *x1, double *y1, double *color1, double *x2, double *y2, double *color2)
+{
+    const Vertex *v0, *v1, *v2;
+    getTriangle(i, colorMode, &v0, &v1, &v2);
+    *x0 = v0->x;
+    *y0 = v0->y;
+    *color0 = v0->t;
+    *x1 = v1->x;
+    *y1 = v1->y;
+    *color1 = v1->t;
+    *x2 = v2->x;
+    *y2 = v2->y;
+    *color2 = v2->t;
+}
+
+void SplashPatchMeshPattern::getNonParametrizedTriangle(int i, SplashColorMode mode, double *x0, double *y0, SplashColorPtr color0, double *x1, double *y1, SplashColorPtr color1, double *x2, double *y2, SplashColorPtr color2)
+{
+    const Vertex *v0, *v1, *v2;
+    getTriangle(i, mode, &v0, &v1, &v2);
+    *x0 = v0->x;
+    *y0 = v0->y;
+    splashColorCopy(color0, v0->color);
+    *x1 = v1->x;
+    *y1 = v1->y;
+    splashColorCopy(color1, v1->color);
+    *x2 = v2->x;
+    *y2 = v2->y;
+    splashColorCopy(color2, v2->color);
+}
+
+void SplashPatchMeshPattern::getParameterizedColor(double colorinterp, SplashColorMode mode, SplashColorPtr dest)
+{
+    GfxColor src;
+    shading->getParameterizedColor(colorinterp, &src);
+    convertGfxShortColor(dest, mode, shading->getColorSpace(), &src);
+}
+
 //------------------------------------------------------------------------
 // SplashFunctionPattern
 //------------------------------------------------------------------------
@@ -1218,6 +1416,7 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA, int bitmapRowPadA,
     bitmapTopDown = bitmapTopDownA;
     fontAntialias = true;
     vectorAntialias = true;
+    analyticAntialias = false;
     overprintPreview = overprintPreviewA;
     enableFreeType = true;
     enableFreeTypeHinting = false;
@@ -1239,12 +1438,16 @@ SplashOutputDev::SplashOutputDev(SplashColorMode colorModeA, int bitmapRowPadA,
     splash = new Splash(bitmap, vectorAntialias, &screenParams);
     splash->setMinLineWidth(s_minLineWidth);
     splash->setThinLineMode(thinLineMode);
+    splash->setAnalyticAntialias(analyticAntialias);
     splash->clear(paperColor, 0);
 
     fontEngine = nullptr;
 
     nT3Fonts = 0;
     t3GlyphStack = nullptr;
+    tilingCellBytes = 0;
+    tilingCellDepth = 0;
+    groupBitmapPoolBytes = 0;
 
     font = nullptr;
     needFontUpdate = false;
@@ -1311,6 +1514,10 @@ void SplashOutputDev::startDoc(PDFDoc *docA)
         delete t3FontCache[i];
     }
     nT3Fonts = 0;
+    tilingCells.clear();
+    tilingCellBytes = 0;
+    groupBitmapPool.clear();
+    groupBitmapPoolBytes = 0;
 }
 
 void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA)
@@ -1339,7 +1546,9 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA)
         delete splash;
         splash = nullptr;
     }
-    if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight()) {
+    // the bitmap of the last page is reused, unless its data was taken or
+    // it was converted to another mode
+    if (!bitmap || w != bitmap->getWidth() || h != bitmap->getHeight() || !bitmap->getDataPtr() || bitmap->getMode() != colorMode) {
         if (bitmap) {
             delete bitmap;
             bitmap = nullptr;
@@ -1354,6 +1563,7 @@ void SplashOutputDev::startPage(int pageNum, GfxState *state, XRef *xrefA)
     splash = new Splash(bitmap, vectorAntialias, &screenParams);
     splash->setThinLineMode(thinLineMode);
     splash->setMinLineWidth(s_minLineWidth);
+    splash->setAnalyticAntialias(analyticAntialias);
     if (state) {
         const double *ctm = state->getCTM();
         mat[0] = (SplashCoord)ctm[0];
@@ -2567,6 +2777,7 @@ void SplashOutputDev::type3D1(GfxState *state, double wx, double wy, double llx,
     }
     splash->setMinLineWidth(s_minLineWidth);
     splash->setThinLineMode(splashThinLineDefault);
+    splash->setAnalyticAntialias(analyticAntialias);
     splash->setFillPattern(new SplashSolidColor(color));
     splash->setStrokePattern(new SplashSolidColor(color));
     //~ this should copy other state from t3GlyphStack->origSplash?
@@ -3168,6 +3379,100 @@ struct TilingSplashOutBitmap
     int y;
 };
 
+//------------------------------------------------------------------------
+// SplashTilingCell
+//------------------------------------------------------------------------
+
+// A tiling pattern cell rendered by tilingPatternFill, with everything
+// the rendering depends on.
+struct SplashTilingCell
+{
+    int patternRefNum;
+    int paintType;
+    SplashColorMode mode;
+    int width, height;
+    double mat[6]; // pattern space to cell matrix
+    bool colorized; // drawn with the fill and stroke colors below
+    SplashColor fillColor, strokeColor;
+    SplashThinLineMode thinLineMode;
+    bool analyticAntialias;
+    std::unique_ptr<SplashBitmap> bitmap;
+
+    bool matches(const SplashTilingCell &key) const
+    {
+        return patternRefNum == key.patternRefNum && paintType == key.paintType && mode == key.mode && width == key.width && height == key.height && std::equal(mat, mat + 6, key.mat) && colorized == key.colorized
+                && (!colorized || (!memcmp(fillColor, key.fillColor, sizeof(SplashColor)) && !memcmp(strokeColor, key.strokeColor, sizeof(SplashColor)))) && thinLineMode == key.thinLineMode && analyticAntialias == key.analyticAntialias;
+    }
+};
+
+static size_t bitmapSize(const SplashBitmap *bitmap)
+{
+    size_t size = (size_t)std::abs(bitmap->getRowSize()) * bitmap->getHeight();
+    if (bitmap->getAlphaPtr()) {
+        size += (size_t)bitmap->getWidth() * bitmap->getHeight();
+    }
+    return size;
+}
+
+SplashBitmap *SplashOutputDev::findTilingCell(const SplashTilingCell &key)
+{
+    for (size_t i = 0; i < tilingCells.size(); ++i) {
+        if (tilingCells[i]->matches(key)) {
+            std::rotate(tilingCells.begin(), tilingCells.begin() + i, tilingCells.begin() + i + 1);
+            return tilingCells[0]->bitmap.get();
+        }
+    }
+    return nullptr;
+}
+
+void SplashOutputDev::addTilingCell(std::unique_ptr<SplashTilingCell> cell)
+{
+    const size_t size = bitmapSize(cell->bitmap.get());
+    if (size > splashOutTilingCacheSize / 4) {
+        return;
+    }
+    while (tilingCellBytes + size > splashOutTilingCacheSize) {
+        tilingCellBytes -= bitmapSize(tilingCells.back()->bitmap.get());
+        tilingCells.pop_back();
+    }
+    tilingCells.insert(tilingCells.begin(), std::move(cell));
+    tilingCellBytes += size;
+}
+
+// Returns a bitmap with an alpha channel for a transparency group, taken
+// from the pool if one of the same size and mode was released before.
+// Its contents are undefined.
+SplashBitmap *SplashOutputDev::newGroupBitmap(int width, int height, SplashColorMode mode, const std::vector<GfxSeparationColorSpace *> *separationList)
+{
+    if (!separationList || separationList->empty()) {
+        for (size_t i = 0; i < groupBitmapPool.size(); ++i) {
+            const SplashBitmap *pooled = groupBitmapPool[i].get();
+            if (pooled->getWidth() == width && pooled->getHeight() == height && pooled->getMode() == mode && pooled->getRowPad() == bitmapRowPad && (pooled->getRowSize() >= 0) == bitmapTopDown) {
+                groupBitmapPoolBytes -= bitmapSize(pooled);
+                SplashBitmap *groupBitmap = groupBitmapPool[i].release();
+                groupBitmapPool.erase(groupBitmapPool.begin() + i);
+                return groupBitmap;
+            }
+        }
+    }
+    return new SplashBitmap(width, height, bitmapRowPad, mode, true, bitmapTopDown, separationList);
+}
+
+void SplashOutputDev::releaseGroupBitmap(SplashBitmap *groupBitmap)
+{
+    const size_t size = bitmapSize(groupBitmap);
+    if (!groupBitmap->getDataPtr() || !groupBitmap->getAlphaPtr() || !groupBitmap->getSeparationList()->empty() || size > splashOutGroupBitmapPoolSize / 2) {
+        delete groupBitmap;
+        return;
+    }
+    while (groupBitmapPoolBytes + size > splashOutGroupBitmapPoolSize) {
+        groupBitmapPoolBytes -= bitmapSize(groupBitmapPool.back().get());
+        groupBitmapPool.pop_back();
+    }
+    groupBitmapPool.emplace(groupBitmapPool.begin(), groupBitmap);
+    groupBitmapPoolBytes += size;
+}
+
 bool SplashOutputDev::tilingBitmapSrc(void *data, SplashColorPtr colorLine, unsigned char *alphaLine)
 {
     TilingSplashOutBitmap *imgData = (TilingSplashOutBitmap *)data;
@@ -3908,6 +4213,19 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const double *bbox
     } else if (y > yMax) {
         yMax = y;
     }
+
+    // the group is composited through the clip, so nothing outside the
+    // clip rectangle is needed -- except for soft masks, which are used
+    // as they are, and in mono1 mode, where moving the group would move
+    // the halftone screen
+    if (!forSoftMask && colorMode != splashModeMono1) {
+        SplashClip *clip = splash->getClip();
+        xMin = std::max(xMin, (double)clip->getXMin());
+        yMin = std::max(yMin, (double)clip->getYMin());
+        xMax = std::min(xMax, (double)clip->getXMax());
+        yMax = std::min(yMax, (double)clip->getYMax());
+    }
+
     tx = (int)floor(xMin);
     if (tx < 0) {
         tx = 0;
@@ -3969,7 +4287,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const double *bbox
     }
 
     // create the temporary bitmap
-    bitmap = new SplashBitmap(w, h, bitmapRowPad, colorMode, true, bitmapTopDown, bitmap->getSeparationList());
+    bitmap = newGroupBitmap(w, h, colorMode, bitmap->getSeparationList());
     if (!bitmap->getDataPtr()) {
         delete bitmap;
         w = h = 1;
@@ -3981,6 +4299,7 @@ void SplashOutputDev::beginTransparencyGroup(GfxState *state, const double *bbox
     }
     splash->setThinLineMode(transpGroup->origSplash->getThinLineMode());
     splash->setMinLineWidth(s_minLineWidth);
+    splash->setAnalyticAntialias(analyticAntialias);
     //~ Acrobat apparently copies at least the fill and stroke colors, and
     //~ maybe other state(?) -- but not the clipping path (and not sure
     //~ what else)
@@ -4049,7 +4368,7 @@ void SplashOutputDev::paintTransparencyGroup(GfxState *state, const double *bbox
     delete transpGroup->shape;
     delete transpGroup;
 
-    delete tBitmap;
+    releaseGroupBitmap(tBitmap);
 }
 
 void SplashOutputDev::setSoftMask(GfxState *state, const double *bbox, bool alpha, Function *transferFunc, GfxColor *backdropColor)
@@ -4180,7 +4499,7 @@ void SplashOutputDev::setSoftMask(GfxState *state, const double *bbox, bool alph
     transpGroupStack = transpGroup->next;
     delete transpGroup;
 
-    delete tBitmap;
+    releaseGroupBitmap(tBitmap);
 }
 
 void SplashOutputDev::clearSoftMask(GfxState *state)
@@ -4226,6 +4545,12 @@ void SplashOutputDev::setVectorAntialias(bool vaa)
 }
 #endif
 
+void SplashOutputDev::setAnalyticAntialias(bool aaa)
+{
+    analyticAntialias = aaa;
+    splash->setAnalyticAntialias(aaa);
+}
+
 void SplashOutputDev::setFreeTypeHinting(bool enable, bool enableSlightHintingA)
 {
     enableFreeTypeHinting = enable;
@@ -4397,46 +4722,85 @@ bool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog *cat
     matc[3] = ctm[3];
 
     const bool doFastBlit = matc[0] > 0 && matc[1] == 0 && matc[2] == 0 && matc[3] > 0;
-    bitmap = new SplashBitmap(surface_width, surface_height, 1, (paintType == 1 || doFastBlit) ? colorMode : splashModeMono8, true);
-    if (bitmap->getDataPtr() == nullptr) {
-        SplashBitmap *tBitmap = bitmap;
-        bitmap = formerBitmap;
-        delete tBitmap;
-        state->setCTM(savedCTM[0], savedCTM[1], savedCTM[2], savedCTM[3], savedCTM[4], savedCTM[5]);
-        return false;
+    const SplashColorMode cellMode = (paintType == 1 || doFastBlit) ? colorMode : splashModeMono8;
+
+    // look for the cell in the cache -- cells are not cached while
+    // another one is being rendered, or if optional content could
+    // change what they show between pages
+    std::unique_ptr<SplashTilingCell> cell;
+    SplashBitmap *tBitmap = nullptr;
+    if (tPat->getPatternRefNum() != -1 && tilingCellDepth == 0 && !(doc && doc->getOptContentConfig())) {
+        cell = std::make_unique<SplashTilingCell>();
+        cell->patternRefNum = tPat->getPatternRefNum();
+        cell->paintType = paintType;
+        cell->mode = cellMode;
+        cell->width = surface_width;
+        cell->height = surface_height;
+        std::copy(m1.m, m1.m + 6, cell->mat);
+        cell->colorized = doFastBlit;
+        memset(cell->fillColor, 0, sizeof(SplashColor));
+        memset(cell->strokeColor, 0, sizeof(SplashColor));
+        cell->thinLineMode = formerSplash->getThinLineMode();
+        cell->analyticAntialias = analyticAntialias;
+        if (doFastBlit) {
+            if (formerSplash->getFillPattern()->isStatic() && formerSplash->getStrokePattern()->isStatic()) {
+                formerSplash->getFillPattern()->getColor(0, 0, cell->fillColor);
+                formerSplash->getStrokePattern()->getColor(0, 0, cell->strokeColor);
+            } else {
+                cell.reset();
+            }
+        }
+        if (cell) {
+            tBitmap = findTilingCell(*cell);
+        }
     }
-    splash = new Splash(bitmap, true);
-    updateCTM(gfx->getState(), m1.m[0], m1.m[1], m1.m[2], m1.m[3], m1.m[4], m1.m[5]);
+    const bool cached = tBitmap != nullptr;
 
-    if (paintType == 2) {
-        SplashColor clearColor;
-        clearColor[0] = (colorMode == splashModeCMYK8 || colorMode == splashModeDeviceN8) ? 0x00 : 0xFF;
-        splash->clear(clearColor, 0);
-    } else {
-        splash->clear(paperColor, 0);
-    }
-    splash->setThinLineMode(formerSplash->getThinLineMode());
-    splash->setMinLineWidth(s_minLineWidth);
-    if (doFastBlit) {
-        // drawImage would colorize the greyscale pattern in tilingBitmapSrc buffer accessor while tiling.
-        // blitImage can't, it has no buffer accessor. We instead colorize the pattern prototype in advance.
-        splash->setFillPattern(formerSplash->getFillPattern()->copy());
-        splash->setStrokePattern(formerSplash->getStrokePattern()->copy());
+    if (!cached) {
+        bitmap = new SplashBitmap(surface_width, surface_height, 1, cellMode, true);
+        if (bitmap->getDataPtr() == nullptr) {
+            tBitmap = bitmap;
+            bitmap = formerBitmap;
+            delete tBitmap;
+            state->setCTM(savedCTM[0], savedCTM[1], savedCTM[2], savedCTM[3], savedCTM[4], savedCTM[5]);
+            return false;
+        }
+        splash = new Splash(bitmap, true);
+        updateCTM(gfx->getState(), m1.m[0], m1.m[1], m1.m[2], m1.m[3], m1.m[4], m1.m[5]);
+
+        if (paintType == 2) {
+            SplashColor clearColor;
+            clearColor[0] = (colorMode == splashModeCMYK8 || colorMode == splashModeDeviceN8) ? 0x00 : 0xFF;
+            splash->clear(clearColor, 0);
+        } else {
+            splash->clear(paperColor, 0);
+        }
+        splash->setThinLineMode(formerSplash->getThinLineMode());
+        splash->setMinLineWidth(s_minLineWidth);
+        splash->setAnalyticAntialias(analyticAntialias);
+        if (doFastBlit) {
+            // drawImage would colorize the greyscale pattern in tilingBitmapSrc buffer accessor while tiling.
+            // blitImage can't, it has no buffer accessor. We instead colorize the pattern prototype in advance.
+            splash->setFillPattern(formerSplash->getFillPattern()->copy());
+            splash->setStrokePattern(formerSplash->getStrokePattern()->copy());
+        }
+        ++tilingCellDepth;
+        gfx->display(tPat->getContentStream());
+        --tilingCellDepth;
+        delete splash;
+        splash = formerSplash;
+        tBitmap = bitmap;
+        bitmap = formerBitmap;
     }
-    gfx->display(tPat->getContentStream());
-    delete splash;
-    splash = formerSplash;
 
     TilingSplashOutBitmap imgData;
-    imgData.bitmap = bitmap;
+    imgData.bitmap = tBitmap;
     imgData.paintType = paintType;
     imgData.pattern = splash->getFillPattern();
     imgData.colorMode = colorMode;
     imgData.y = 0;
     imgData.repeatX = repeatX;
     imgData.repeatY = repeatY;
-    SplashBitmap *tBitmap = bitmap;
-    bitmap = formerBitmap;
     if (doFastBlit) {
         // draw the tiles
         for (int y = 0; y < imgData.repeatY; ++y) {
@@ -4450,7 +4814,12 @@ bool SplashOutputDev::tilingPatternFill(GfxState *state, Gfx *gfxA, Catalog *cat
     } else {
         retValue = splash->drawImage(&tilingBitmapSrc, nullptr, &imgData, colorMode, true, result_width, result_height, matc, false, true) == splashOk;
     }
-    delete tBitmap;
+    if (cell && !cached) {
+        cell->bitmap.reset(tBitmap);
+        addTilingCell(std::move(cell));
+    } else if (!cached) {
+        delete tBitmap;
+    }
     if (!retValue) {
         state->setCTM(savedCTM[0], savedCTM[1], savedCTM[2], savedCTM[3], savedCTM[4], savedCTM[5]);
     }
@@ -4481,6 +4850,21 @@ bool SplashOutputDev::gouraudTriangleShadedFill(GfxState *state, GfxGouraudTrian
     return retVal;
 }
 
+bool SplashOutputDev::patchMeshShadedFill(GfxState *state, GfxPatchMeshShading *shading)
+{
+    // the triangle filling addresses whole bytes per pixel
+    if (colorMode == splashModeMono1) {
+        return false;
+    }
+    SplashPatchMeshPattern splashShading(colorMode, state, shading);
+    // restore vector antialias because we support it here
+    const bool vaa = getVectorAntialias();
+    setVectorAntialias(true);
+    const bool retVal = splash->gouraudTriangleShadedFill(&splashShading);
+    setVectorAntialias(vaa);
+    return retVal;
+}
+
 bool SplashOutputDev::univariateShadedFill(GfxState *state, SplashUnivariatePattern *pattern, double tMin, double tMax)
 {
     double xMin, yMin, xMax, yMax;
@@ -39,6 +39,8 @@
 #include "OutputDev.h"
 #include "GfxState.h"
 #include "GlobalParams.h"
+#include <memory>
+#include <vector>
 
 class PDFDoc;
 class Gfx8BitFont;
@@ -51,6 +53,7 @@ class T3FontCache;
 struct T3FontCacheTag;
 struct T3GlyphStack;
 struct SplashTransparencyGroup;
+struct SplashTilingCell;
 
 //------------------------------------------------------------------------
 // Splash dynamic pattern
@@ -164,6 +167,65 @@ private:
     GfxColorSpaceMode gfxMode;
 };
 
+// see GfxState.h, GfxPatchMeshShading
+//
+// Every patch is tessellated into a grid of triangles fine enough for
+// the size it has on the device, with the colors interpolated between
+// the vertices.  Only the patch whose triangles are being drawn is kept
+// tessellated.
+class SplashPatchMeshPattern : public SplashGouraudColor
+{
+public:
+    SplashPatchMeshPattern(SplashColorMode colorMode, GfxState *state, GfxPatchMeshShading *shading);
+
+    SplashPattern *copy() const override { return new SplashPatchMeshPattern(colorMode, state, shading); }
+
+    ~SplashPatchMeshPattern() override;
+
+    bool getColor(int x, int y, SplashColorPtr c) override { return false; }
+
+    bool testPosition(int x, int y) override { return false; }
+
+    bool isStatic() override { return false; }
+
+    bool isCMYK() override { return gfxMode == csDeviceCMYK; }
+
+    // The function of parameterized shadings is evaluated at the vertices
+    // rather than at every pixel, the cells being small enough.
+    bool isParameterized() override { return false; }
+    bool interpolatesColors() override { return true; }
+    int getNTriangles() override { return firstTriangle.back(); }
+    void getParametrizedTriangle(int i, double *x0, double *y0, double *color0, double *x1, double *y1, double *color1, double *x2, double *y2, double *color2) override;
+
+    void getNonParametrizedTriangle(int i, SplashColorMode mode, double *x0, double *y0, SplashColorPtr color0, double *x1, double *y1, SplashColorPtr color1, double *x2, double *y2, SplashColorPtr color2) override;
+
+    void getParameterizedColor(double colorinterp, SplashColorMode mode, SplashColorPtr dest) override;
+
+private:
+    struct Vertex
+    {
+        double x, y;
+        double t; // the parameter of parameterized shadings
+        SplashColor color;
+    };
+
+    // Return the vertices of triangle <i>
+    void getTriangle(int i, SplashColorMode mode, const Vertex **v0, const Vertex **v1, const Vertex **v2);
+    void tessellate(int patchIdx, SplashColorMode mode);
+
+    SplashColorMode colorMode;
+    GfxState *state;
+    GfxPatchMeshShading *shading;
+    GfxColorSpaceMode gfxMode;
+    // grid size of each patch, and index of its first triangle
+    std::vector<int> uCells, vCells;
+    std::vector<int> firstTriangle;
+    // the tessellated patch
+    int curPatch;
+    SplashColorMode curMode;
+    std::vector<Vertex> vertices;
+};
+
 // see GfxState.h, GfxRadialShading
 class SplashRadialPattern : public SplashUnivariatePattern
 {
@@ -186,6 +248,12 @@ private:
 // number of Type 3 fonts to cache
 #define splashOutT3FontCacheSize 8
 
+// size of the tiling pattern cell cache, in bytes
+#define splashOutTilingCacheSize (16 << 20)
+
+// size of the pool of transparency group bitmaps, in bytes
+#define splashOutGroupBitmapPoolSize (64 << 20)
+
 //------------------------------------------------------------------------
 // SplashOutputDev
 //------------------------------------------------------------------------
@@ -209,7 +277,7 @@ public:
     // Does this device use functionShadedFill(), axialShadedFill(), and
     // radialShadedFill()?  If this returns false, these shaded fills
     // will be reduced to a series of other drawing operations.
-    bool useShadedFills(int type) override { return (type >= 1 && type <= 5) ? true : false; }
+    bool useShadedFills(int type) override { return (type >= 1 && type <= 7) ? true : false; }
 
     // Does this device use upside-down coordinates?
     // (Upside-down means (0,0) is the top left corner of the page.)
@@ -270,6 +338,7 @@ public:
     bool axialShadedFill(GfxState *state, GfxAxialShading *shading, double tMin, double tMax) override;
     bool radialShadedFill(GfxState *state, GfxRadialShading *shading, double tMin, double tMax) override;
     bool gouraudTriangleShadedFill(GfxState *state, GfxGouraudTriangleShading *shading) override;
+    bool patchMeshShadedFill(GfxState *state, GfxPatchMeshShading *shading) override;
 
     //----- path clipping
     void clip(GfxState *state) override;
@@ -341,6 +410,11 @@ public:
     void setVectorAntialias(bool vaa) override;
 #endif
 
+    // Compute the exact coverage of filled paths instead of
+    // supersampling them, when vector anti-aliasing is on.
+    bool getAnalyticAntialias() { return analyticAntialias; }
+    void setAnalyticAntialias(bool aaa);
+
     bool getFontAntialias() { return fontAntialias; }
     void setFontAntialias(bool anti) { fontAntialias = anti; }
 
@@ -362,6 +436,10 @@ private:
     void setOverprintMask(GfxColorSpace *colorSpace, bool overprintFlag, int overprintMode, const GfxColor *singleColor, bool grayIndexed = false);
     SplashPath convertPath(GfxState *state, const GfxPath *path, bool dropEmptySubpaths);
     void drawType3Glyph(GfxState *state, T3FontCache *t3Font, T3FontCacheTag *tag, unsigned char *data);
+    SplashBitmap *findTilingCell(const SplashTilingCell &key);
+    void addTilingCell(std::unique_ptr<SplashTilingCell> cell);
+    SplashBitmap *newGroupBitmap(int width, int height, SplashColorMode mode, const std::vector<GfxSeparationColorSpace *> *separationList);
+    void releaseGroupBitmap(SplashBitmap *groupBitmap);
 #ifdef USE_CMS
     bool useIccImageSrc(void *data);
     static void iccTransform(void *data, SplashBitmap *bitmap);
@@ -380,6 +458,7 @@ private:
     bool bitmapTopDown;
     bool fontAntialias;
     bool vectorAntialias;
+    bool analyticAntialias;
     bool overprintPreview;
     bool enableFreeType;
     bool enableFreeTypeHinting;
@@ -402,6 +481,15 @@ private:
     int nT3Fonts; // number of valid entries in t3FontCache
     T3GlyphStack *t3GlyphStack; // Type 3 glyph context stack
 
+    std::vector<std::unique_ptr<SplashTilingCell>> tilingCells; // rendered tiling pattern cells,
+                                                                //   most recently used first
+    size_t tilingCellBytes; // size of the bitmaps in tilingCells
+    int tilingCellDepth; // number of pattern cells being rendered
+
+    std::vector<std::unique_ptr<SplashBitmap>> groupBitmapPool; // transparency group bitmaps for reuse,
+                                                                //   most recently released first
+    size_t groupBitmapPoolBytes; // size of the bitmaps in groupBitmapPool
+
     SplashFont *font; // current font
     bool needFontUpdate; // set when the font needs to be updated
     SplashPath *textClipPath; // clipping path built with text object
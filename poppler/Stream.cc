@@ -459,6 +459,49 @@ void FileOutStream::printf(const char *format, ...)
     va_end(argptr);
 }
 
+//------------------------------------------------------------------------
+// StringOutStream
+//------------------------------------------------------------------------
+
+StringOutStream::StringOutStream() = default;
+
+StringOutStream::~StringOutStream() = default;
+
+void StringOutStream::close() { }
+
+Goffset StringOutStream::getPos()
+{
+    return buf.size();
+}
+
+void StringOutStream::put(char c)
+{
+    buf.push_back(c);
+}
+
+size_t StringOutStream::write(std::span<unsigned char> data)
+{
+    buf.append(reinterpret_cast<const char *>(data.data()), data.size());
+    return data.size();
+}
+
+void StringOutStream::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    const int n = vsnprintf(nullptr, 0, format, argsCopy);
+    va_end(argsCopy);
+    if (n > 0) {
+        const size_t pos = buf.size();
+        buf.resize(pos + n + 1);
+        vsnprintf(buf.data() + pos, n + 1, format, args);
+        buf.resize(pos + n);
+    }
+    va_end(args);
+}
+
 //------------------------------------------------------------------------
 // BaseStream
 //------------------------------------------------------------------------
@@ -48,6 +48,8 @@
 #include <cstdio>
 #include <vector>
 #include <span>
+#include <string>
+#include <utility>
 
 #include "poppler-config.h"
 #include "poppler_private_export.h"
@@ -334,6 +336,36 @@ private:
     Goffset start;
 };
 
+//------------------------------------------------------------------------
+// StringOutStream
+//
+// Collects the output in memory.
+//------------------------------------------------------------------------
+class POPPLER_PRIVATE_EXPORT StringOutStream : public OutStream
+{
+public:
+    StringOutStream();
+
+    ~StringOutStream() override;
+
+    void close() override;
+
+    Goffset getPos() override;
+
+    void put(char c) override;
+
+    size_t write(std::span<unsigned char> data) override;
+
+    void printf(const char *format, ...) override GCC_PRINTF_FORMAT(2, 3);
+
+    const std::string &getString() const { return buf; }
+    // Return the output collected so far and start over
+    std::string takeString() { return std::exchange(buf, {}); }
+
+private:
+    std::string buf;
+};
+
 //------------------------------------------------------------------------
 // BaseStream
 //
@@ -626,6 +658,8 @@ public:
     int getUnfilteredChar() override { return getChar(); }
     void unfilteredReset() override { reset(); }
 
+    CachedFile *getCachedFile() const { return cc; }
+
 private:
     bool fillBuf();
 
@@ -0,0 +1,433 @@
+//========================================================================
+//
+// TextIndex.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "goo/gfile.h"
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "TextOutputDev.h"
+#include "UnicodeTypeTable.h"
+#include "UTF.h"
+#include "TextIndex.h"
+
+// Bump when the file layout changes; older files are then rejected.
+static const char textIndexMagic[8] = { 'P', 'D', 'F', 'T', 'I', 'D', 'X', '1' };
+
+//------------------------------------------------------------------------
+
+// Characters that separate indexed terms: white space and common
+// punctuation.  Everything else, including combining marks, is part of
+// a term.
+static bool isTermSeparator(Unicode u)
+{
+    if (UnicodeIsWhitespace(u)) {
+        return true;
+    }
+    if (u < 0x80) {
+        return !((u >= '0' && u <= '9') || (u >= 'A' && u <= 'Z') || (u >= 'a' && u <= 'z'));
+    }
+    return (u >= 0x2000 && u <= 0x206f) || (u >= 0x3000 && u <= 0x303f) || u == 0xa0 || u == 0xab || u == 0xbb || u == 0xbf || u == 0xa1;
+}
+
+// Split <u> into terms, normalizing each of them.  The source range of
+// each term in <u> is returned in <ranges>.
+static std::vector<std::u32string> splitTerms(const Unicode *u, int len, std::vector<std::pair<int, int>> *ranges)
+{
+    std::vector<std::u32string> result;
+    int normLen;
+    int *indices;
+
+    Unicode *norm = unicodeNormalizeNFKC(u, len, &normLen, &indices);
+    int i = 0;
+    while (i < normLen) {
+        while (i < normLen && isTermSeparator(norm[i])) {
+            ++i;
+        }
+        if (i == normLen) {
+            break;
+        }
+        const int start = i;
+        std::u32string term;
+        while (i < normLen && !isTermSeparator(norm[i])) {
+            term.push_back((char32_t)unicodeToUpper(norm[i]));
+            ++i;
+        }
+        result.push_back(std::move(term));
+        if (ranges) {
+            ranges->emplace_back(indices[start], indices[i - 1]);
+        }
+    }
+    gfree(norm);
+    gfree(indices);
+
+    return result;
+}
+
+//------------------------------------------------------------------------
+// little endian (de)serialization helpers
+//------------------------------------------------------------------------
+
+static void writeU32(std::string *buf, uint32_t x)
+{
+    for (int i = 0; i < 4; ++i) {
+        buf->push_back((char)((x >> (8 * i)) & 0xff));
+    }
+}
+
+static void writeFloat(std::string *buf, float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    writeU32(buf, x);
+}
+
+static void writeString(std::string *buf, const std::string &s)
+{
+    writeU32(buf, s.size());
+    buf->append(s);
+}
+
+namespace {
+
+class TextIndexReader
+{
+public:
+    TextIndexReader(const char *dataA, size_t lenA) : data(dataA), len(lenA), pos(0), ok(true) { }
+
+    bool isOk() const { return ok; }
+    bool atEnd() const { return pos == len; }
+
+    uint32_t readU32()
+    {
+        if (len - pos < 4) {
+            ok = false;
+            return 0;
+        }
+        uint32_t x = 0;
+        for (int i = 0; i < 4; ++i) {
+            x |= (uint32_t)(unsigned char)data[pos + i] << (8 * i);
+        }
+        pos += 4;
+        return x;
+    }
+
+    float readFloat()
+    {
+        const uint32_t x = readU32();
+        float f;
+        memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+
+    std::string readString()
+    {
+        const uint32_t n = readU32();
+        if (!ok || len - pos < n) {
+            ok = false;
+            return {};
+        }
+        std::string s(data + pos, n);
+        pos += n;
+        return s;
+    }
+
+    // Number of bytes left, to sanity check counts read from the file
+    // before allocating for them.
+    size_t remaining() const { return len - pos; }
+
+private:
+    const char *data;
+    size_t len;
+    size_t pos;
+    bool ok;
+};
+
+}
+
+//------------------------------------------------------------------------
+// TextIndex
+//------------------------------------------------------------------------
+
+TextIndex::TextIndex() : nPages(0) { }
+
+TextIndex::~TextIndex() = default;
+
+std::unique_ptr<TextIndex> TextIndex::create(PDFDoc *doc)
+{
+    auto index = std::make_unique<TextIndex>();
+
+    for (int page = 1; page <= doc->getNumPages(); ++page) {
+        TextOutputDev textOut(nullptr, false, 0, false, false);
+        doc->displayPageSlice(&textOut, page, 72, 72, 0, false, false, false, -1, -1, -1, -1);
+        std::unique_ptr<TextWordList> wordList = textOut.makeWordList();
+        index->addPage(page, wordList.get());
+    }
+
+    return index;
+}
+
+int TextIndex::addTerm(const std::u32string &term)
+{
+    const auto it = termIds.find(term);
+    if (it != termIds.end()) {
+        return it->second;
+    }
+
+    const int id = terms.size();
+    terms.push_back(term);
+    termIds.emplace(term, id);
+    postings.emplace_back();
+    return id;
+}
+
+void TextIndex::addPage(int page, TextWordList *wordList)
+{
+    std::vector<std::pair<int, int>> ranges;
+    double xMin, yMin, xMax, yMax, x0, y0, x1, y1;
+
+    nPages = std::max(nPages, page);
+    if (!wordList) {
+        return;
+    }
+
+    for (int i = 0; i < wordList->getLength(); ++i) {
+        const TextWord *word = wordList->get(i);
+        const int len = word->getLength();
+        std::vector<Unicode> u(len);
+        for (int j = 0; j < len; ++j) {
+            u[j] = *word->getChar(j);
+        }
+
+        ranges.clear();
+        const std::vector<std::u32string> wordTerms = splitTerms(u.data(), len, &ranges);
+        for (size_t k = 0; k < wordTerms.size(); ++k) {
+            word->getCharBBox(ranges[k].first, &xMin, &yMin, &xMax, &yMax);
+            word->getCharBBox(ranges[k].second, &x0, &y0, &x1, &y1);
+            const int term = addTerm(wordTerms[k]);
+            postings[term].push_back(words.size());
+            words.push_back({ page, term, (float)std::min(xMin, x0), (float)std::min(yMin, y0), (float)std::max(xMax, x1), (float)std::max(yMax, y1) });
+        }
+    }
+}
+
+std::vector<TextIndex::Match> TextIndex::find(const Unicode *s, int len, bool prefix) const
+{
+    std::vector<Match> matches;
+
+    const std::vector<std::u32string> query = splitTerms(s, len, nullptr);
+    if (query.empty()) {
+        return matches;
+    }
+
+    // resolve the query terms to term ids; the last one may stand for
+    // every term it is a prefix of
+    const size_t n = query.size();
+    std::vector<int> ids(n, -1);
+    std::vector<bool> lastTerms;
+    for (size_t i = 0; i < n; ++i) {
+        if (i == n - 1 && prefix) {
+            lastTerms.resize(terms.size(), false);
+            bool any = false;
+            for (auto it = termIds.lower_bound(query[i]); it != termIds.end() && it->first.compare(0, query[i].size(), query[i]) == 0; ++it) {
+                lastTerms[it->second] = true;
+                any = true;
+            }
+            if (!any) {
+                return matches;
+            }
+        } else {
+            const auto it = termIds.find(query[i]);
+            if (it == termIds.end()) {
+                return matches;
+            }
+            ids[i] = it->second;
+        }
+    }
+
+    auto termMatches = [&](size_t i, int term) { return (i == n - 1 && prefix) ? (bool)lastTerms[term] : term == ids[i]; };
+
+    // drive the search from the postings of the first term (or every
+    // matching term when the whole query is a single prefix)
+    std::vector<int> starts;
+    if (ids[0] >= 0) {
+        starts = postings[ids[0]];
+    } else {
+        for (int term = 0; term < (int)lastTerms.size(); ++term) {
+            if (lastTerms[term]) {
+                starts.insert(starts.end(), postings[term].begin(), postings[term].end());
+            }
+        }
+        std::sort(starts.begin(), starts.end());
+    }
+
+    for (int start : starts) {
+        if (start + n > words.size()) {
+            break;
+        }
+        const Word &first = words[start];
+        Match match = { first.page, first.xMin, first.yMin, first.xMax, first.yMax };
+        bool found = true;
+        for (size_t i = 1; i < n && found; ++i) {
+            const Word &word = words[start + i];
+            if (word.page != first.page || !termMatches(i, word.term)) {
+                found = false;
+                break;
+            }
+            match.xMin = std::min(match.xMin, (double)word.xMin);
+            match.yMin = std::min(match.yMin, (double)word.yMin);
+            match.xMax = std::max(match.xMax, (double)word.xMax);
+            match.yMax = std::max(match.yMax, (double)word.yMax);
+        }
+        if (found) {
+            matches.push_back(match);
+        }
+    }
+
+    return matches;
+}
+
+// The file length and the document ID.  Documents without an ID get a
+// hash of the whole file instead, so that an index is never taken for
+// the one of another ID-less document.
+std::string TextIndex::documentKey(PDFDoc *doc)
+{
+    BaseStream *str = doc->getBaseStream();
+    std::string key = std::to_string(str->getLength()) + ":";
+
+    GooString permanentId, updateId;
+    if (doc->getID(&permanentId, &updateId)) {
+        return key + permanentId.toStr() + ":" + updateId.toStr();
+    }
+
+    // 64-bit FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    std::unique_ptr<BaseStream> copy(str->copy());
+    unsigned char buf[4096];
+    int n;
+    copy->reset();
+    while ((n = copy->doGetChars(sizeof(buf), buf)) > 0) {
+        for (int i = 0; i < n; ++i) {
+            hash = (hash ^ buf[i]) * 0x100000001b3ULL;
+        }
+    }
+    copy->close();
+
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+    return key + hex;
+}
+
+bool TextIndex::save(const char *fileName, PDFDoc *doc) const
+{
+    std::string buf(textIndexMagic, sizeof(textIndexMagic));
+
+    writeString(&buf, documentKey(doc));
+    writeU32(&buf, nPages);
+
+    writeU32(&buf, terms.size());
+    for (const std::u32string &term : terms) {
+        writeU32(&buf, term.size());
+        for (char32_t c : term) {
+            writeU32(&buf, c);
+        }
+    }
+
+    writeU32(&buf, words.size());
+    for (const Word &word : words) {
+        writeU32(&buf, word.page);
+        writeU32(&buf, word.term);
+        writeFloat(&buf, word.xMin);
+        writeFloat(&buf, word.yMin);
+        writeFloat(&buf, word.xMax);
+        writeFloat(&buf, word.yMax);
+    }
+
+    FILE *f = openFile(fileName, "wb");
+    if (!f) {
+        return false;
+    }
+    const bool ok = fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    return fclose(f) == 0 && ok;
+}
+
+std::unique_ptr<TextIndex> TextIndex::load(const char *fileName, PDFDoc *doc)
+{
+    std::unique_ptr<GooFile> file = GooFile::open(std::string(fileName));
+    if (!file) {
+        return nullptr;
+    }
+    const Goffset size = file->size();
+    if (size < (Goffset)sizeof(textIndexMagic)) {
+        return nullptr;
+    }
+    std::string buf(size, '\0');
+    if (file->read(buf.data(), size, 0) != size || memcmp(buf.data(), textIndexMagic, sizeof(textIndexMagic)) != 0) {
+        return nullptr;
+    }
+
+    TextIndexReader reader(buf.data() + sizeof(textIndexMagic), buf.size() - sizeof(textIndexMagic));
+    if (reader.readString() != documentKey(doc)) {
+        return nullptr;
+    }
+
+    auto index = std::make_unique<TextIndex>();
+    index->nPages = reader.readU32();
+
+    const uint32_t nTerms = reader.readU32();
+    if (nTerms > reader.remaining() / 4) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < nTerms && reader.isOk(); ++i) {
+        const uint32_t termLen = reader.readU32();
+        if (termLen > reader.remaining() / 4) {
+            return nullptr;
+        }
+        std::u32string term(termLen, 0);
+        for (uint32_t j = 0; j < termLen; ++j) {
+            term[j] = reader.readU32();
+        }
+        if (index->addTerm(term) != (int)i) {
+            // duplicated term
+            return nullptr;
+        }
+    }
+
+    const uint32_t nWords = reader.readU32();
+    if (nWords > reader.remaining() / 24) {
+        return nullptr;
+    }
+    index->words.reserve(nWords);
+    for (uint32_t i = 0; i < nWords && reader.isOk(); ++i) {
+        Word word;
+        word.page = reader.readU32();
+        word.term = reader.readU32();
+        word.xMin = reader.readFloat();
+        word.yMin = reader.readFloat();
+        word.xMax = reader.readFloat();
+        word.yMax = reader.readFloat();
+        if (word.term < 0 || word.term >= (int)nTerms || word.page < 1 || word.page > index->nPages) {
+            return nullptr;
+        }
+        index->postings[word.term].push_back(index->words.size());
+        index->words.push_back(word);
+    }
+
+    if (!reader.isOk() || !reader.atEnd()) {
+        return nullptr;
+    }
+
+    return index;
+}
@@ -0,0 +1,94 @@
+//========================================================================
+//
+// TextIndex.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "poppler_private_export.h"
+#include "CharTypes.h"
+
+class GooString;
+class PDFDoc;
+class TextWordList;
+
+//------------------------------------------------------------------------
+// TextIndex
+//------------------------------------------------------------------------
+
+// A document-wide word index.  Words are normalized (NFKC, upper
+// cased) and stored in reading order together with their page and
+// bounding box, so phrase and prefix queries can be answered for the
+// whole document without laying out any page again.  The index can be
+// saved to a sidecar file, keyed by the document ID and file length
+// (or a hash of the file for documents without ID).
+class POPPLER_PRIVATE_EXPORT TextIndex
+{
+public:
+    struct Match
+    {
+        int page; // 1-based page number
+        double xMin, yMin, xMax, yMax; // union of the matched words' bounding boxes
+    };
+
+    TextIndex();
+    ~TextIndex();
+
+    TextIndex(const TextIndex &) = delete;
+    TextIndex &operator=(const TextIndex &) = delete;
+
+    // Lay out every page of <doc> with a TextOutputDev and index its
+    // words.  Coordinates are those of a TextOutputDev at 72 dpi
+    // without rotation.
+    static std::unique_ptr<TextIndex> create(PDFDoc *doc);
+
+    // Add the words of page <page> (1-based).  Pages must be added in
+    // increasing order.
+    void addPage(int page, TextWordList *words);
+
+    // Find all occurrences of the phrase <s> (words separated by white
+    // space).  Matching is case insensitive; if <prefix> is true the
+    // last word of the phrase only has to be a prefix of the indexed
+    // word.  Matches never span pages.
+    std::vector<Match> find(const Unicode *s, int len, bool prefix) const;
+
+    int getNumPages() const { return nPages; }
+    int getNumWords() const { return words.size(); }
+
+    // Write the index to <fileName>, tagged with the ID of <doc>.
+    bool save(const char *fileName, PDFDoc *doc) const;
+
+    // Read an index written by save().  Returns nullptr if the file
+    // can't be read or was written for another document.
+    static std::unique_ptr<TextIndex> load(const char *fileName, PDFDoc *doc);
+
+private:
+    struct Word
+    {
+        int page;
+        int term;
+        float xMin, yMin, xMax, yMax;
+    };
+
+    int addTerm(const std::u32string &term);
+    void addWord(int page, const Unicode *u, int len, double xMin, double yMin, double xMax, double yMax);
+    static std::u32string normalize(const Unicode *u, int len);
+    static std::string documentKey(PDFDoc *doc);
+
+    int nPages;
+    std::vector<Word> words; // all words, in page and reading order
+    std::vector<std::u32string> terms; // normalized words, by term id
+    std::map<std::u32string, int> termIds; // sorted, for prefix lookups
+    std::vector<std::vector<int>> postings; // term id -> positions in words
+};
+
+#endif
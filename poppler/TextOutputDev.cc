@@ -2392,6 +2392,195 @@ TextWord *TextWordList::get(int idx)
 
 #endif // TEXTOUT_WORD_LIST
 
+//------------------------------------------------------------------------
+// TextSpatialIndex
+//------------------------------------------------------------------------
+
+// A uniform grid over the bounding boxes of a set of items.  Each item
+// is registered in every cell its box overlaps, so rectangle queries
+// and nearest item lookups only touch the cells around the query.
+class TextSpatialIndex
+{
+public:
+    struct Box
+    {
+        double xMin, yMin, xMax, yMax;
+    };
+
+    explicit TextSpatialIndex(std::vector<Box> &&boxesA);
+
+    TextSpatialIndex(const TextSpatialIndex &) = delete;
+    TextSpatialIndex &operator=(const TextSpatialIndex &) = delete;
+
+    // Return the indices of all items whose box intersects the given
+    // rectangle, in increasing order.
+    std::vector<int> query(double x0, double y0, double x1, double y1) const;
+
+    // Return the index of the item with the smallest manhattan distance
+    // to (<x>,<y>), preferring the lowest index on ties, or -1 if the
+    // index is empty.
+    int nearest(double x, double y) const;
+
+private:
+    int cellX(double x) const;
+    int cellY(double y) const;
+    double distance(int idx, double x, double y) const;
+
+    std::vector<Box> boxes;
+    double xMin, yMin; // grid origin
+    double cellW, cellH; // cell size
+    int nx, ny; // number of cells in each direction
+    std::vector<std::vector<int>> cells;
+};
+
+TextSpatialIndex::TextSpatialIndex(std::vector<Box> &&boxesA) : boxes(std::move(boxesA))
+{
+    double xMax, yMax;
+
+    xMin = yMin = 0;
+    xMax = yMax = 1;
+    if (!boxes.empty()) {
+        xMin = yMin = DBL_MAX;
+        xMax = yMax = -DBL_MAX;
+        for (const Box &box : boxes) {
+            xMin = std::min(xMin, box.xMin);
+            yMin = std::min(yMin, box.yMin);
+            xMax = std::max(xMax, box.xMax);
+            yMax = std::max(yMax, box.yMax);
+        }
+    }
+
+    // aim for about one item per cell, keeping cells roughly square
+    const double w = std::max(xMax - xMin, 1.0);
+    const double h = std::max(yMax - yMin, 1.0);
+    const double n = std::max((double)boxes.size(), 1.0);
+    nx = std::clamp((int)ceil(sqrt(n * w / h)), 1, 256);
+    ny = std::clamp((int)ceil(n / nx), 1, 256);
+    cellW = w / nx;
+    cellH = h / ny;
+
+    cells.resize(nx * ny);
+    for (int idx = 0; idx < (int)boxes.size(); ++idx) {
+        const Box &box = boxes[idx];
+        const int cx1 = cellX(box.xMax);
+        const int cy1 = cellY(box.yMax);
+        for (int cy = cellY(box.yMin); cy <= cy1; ++cy) {
+            for (int cx = cellX(box.xMin); cx <= cx1; ++cx) {
+                cells[cy * nx + cx].push_back(idx);
+            }
+        }
+    }
+}
+
+int TextSpatialIndex::cellX(double x) const
+{
+    return std::clamp((int)floor((x - xMin) / cellW), 0, nx - 1);
+}
+
+int TextSpatialIndex::cellY(double y) const
+{
+    return std::clamp((int)floor((y - yMin) / cellH), 0, ny - 1);
+}
+
+double TextSpatialIndex::distance(int idx, double x, double y) const
+{
+    const Box &box = boxes[idx];
+    return fmax(box.xMin - x, 0.0) + fmax(x - box.xMax, 0.0) + fmax(box.yMin - y, 0.0) + fmax(y - box.yMax, 0.0);
+}
+
+std::vector<int> TextSpatialIndex::query(double x0, double y0, double x1, double y1) const
+{
+    std::vector<int> result;
+
+    if (x0 > x1) {
+        std::swap(x0, x1);
+    }
+    if (y0 > y1) {
+        std::swap(y0, y1);
+    }
+    const int cx1 = cellX(x1);
+    const int cy1 = cellY(y1);
+    for (int cy = cellY(y0); cy <= cy1; ++cy) {
+        for (int cx = cellX(x0); cx <= cx1; ++cx) {
+            for (int idx : cells[cy * nx + cx]) {
+                const Box &box = boxes[idx];
+                if (box.xMin <= x1 && box.xMax >= x0 && box.yMin <= y1 && box.yMax >= y0) {
+                    result.push_back(idx);
+                }
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+int TextSpatialIndex::nearest(double x, double y) const
+{
+    int best = -1;
+    double bestD = 0;
+
+    if (boxes.empty()) {
+        return -1;
+    }
+
+    // Visit rings of cells of growing (chebyshev) radius around the
+    // cell containing the point.  Once the rings 0..r-1 have been
+    // searched, every item not seen yet lies entirely beyond them and
+    // is at least (r - 1) cells away; one more cell of slack absorbs
+    // rounding in cellX/cellY.
+    const int cx = cellX(x);
+    const int cy = cellY(y);
+    const int maxR = std::max({ cx, nx - 1 - cx, cy, ny - 1 - cy });
+    const double minCell = std::min(cellW, cellH);
+    for (int r = 0; r <= maxR; ++r) {
+        if (best >= 0 && (r - 2) * minCell > bestD) {
+            break;
+        }
+        for (int j = std::max(cy - r, 0); j <= std::min(cy + r, ny - 1); ++j) {
+            const bool edgeRow = j == cy - r || j == cy + r;
+            for (int i = std::max(cx - r, 0); i <= std::min(cx + r, nx - 1); ++i) {
+                if (!edgeRow && i != cx - r && i != cx + r) {
+                    continue;
+                }
+                for (int idx : cells[j * nx + i]) {
+                    const double d = distance(idx, x, y);
+                    if (best < 0 || d < bestD || (d == bestD && idx < best)) {
+                        best = idx;
+                        bestD = d;
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+//------------------------------------------------------------------------
+// TextPageIndex
+//------------------------------------------------------------------------
+
+// Spatial indices over the blocks (in flow order) and words (in
+// reading order) of a coalesced TextPage.
+class TextPageIndex
+{
+public:
+    struct BlockEntry
+    {
+        TextFlow *flow;
+        TextBlock *blk;
+    };
+
+    std::vector<BlockEntry> blocks;
+    std::unique_ptr<TextSpatialIndex> blockGrid;
+    // bounding box of all blocks, clipped to the page as
+    // TextPage::visitSelection expects
+    double xMin, yMin, xMax, yMax;
+
+    std::vector<TextWord *> words;
+    std::unique_ptr<TextSpatialIndex> wordGrid;
+};
+
 //------------------------------------------------------------------------
 // TextPage
 //------------------------------------------------------------------------
@@ -2490,6 +2679,7 @@ void TextPage::clear()
     fonts.clear();
     underlines.clear();
     links.clear();
+    index.reset();
 
     diagonal = false;
     curWord = nullptr;
@@ -2827,6 +3017,8 @@ void TextPage::coalesce(bool physLayout, double fixedPitch, bool doHTML, double
     int col1, col2;
     int j, n;
 
+    index.reset();
+
     if (rawOrder) {
         primaryRot = 0;
         primaryLR = true;
@@ -5099,76 +5291,48 @@ void TextBlock::visitSelection(TextSelectionVisitor *visitor, const PDFRectangle
 void TextPage::visitSelection(TextSelectionVisitor *visitor, const PDFRectangle *selection, SelectionStyle style)
 {
     PDFRectangle child_selection;
-    double x[2], y[2], d, best_d[2];
-    double xMin, yMin, xMax, yMax;
+    double x[2], y[2];
     TextFlow *flow, *best_flow[2];
     TextBlock *blk, *best_block[2];
-    int i, count = 0, best_count[2], start, stop;
+    int i, best_count[2], start, stop;
 
     if (!flows) {
         return;
     }
 
+    const TextPageIndex *idx = getIndex();
+    if (idx->blocks.empty()) {
+        return;
+    }
+
     x[0] = selection->x1;
     y[0] = selection->y1;
     x[1] = selection->x2;
     y[1] = selection->y2;
 
-    xMin = pageWidth;
-    yMin = pageHeight;
-    xMax = 0.0;
-    yMax = 0.0;
-
-    for (i = 0; i < 2; i++) {
-        best_block[i] = nullptr;
-        best_flow[i] = nullptr;
-        best_count[i] = 0;
-        best_d[i] = 0;
-    }
-
     // find the nearest blocks to the selection points
     // using the manhattan distance.
-    for (flow = flows; flow; flow = flow->next) {
-        for (blk = flow->blocks; blk; blk = blk->next) {
-            count++;
-            // the first/last blocks in reading order are
-            // often not the closest to the page corners;
-            // track the corners, force those blocks to
-            // be selected if the selection runs across
-            // multiple pages.
-            xMin = fmin(xMin, blk->xMin);
-            yMin = fmin(yMin, blk->yMin);
-            xMax = fmax(xMax, blk->xMax);
-            yMax = fmax(yMax, blk->yMax);
-            for (i = 0; i < 2; i++) {
-                d = fmax(blk->xMin - x[i], 0.0) + fmax(x[i] - blk->xMax, 0.0) + fmax(blk->yMin - y[i], 0.0) + fmax(y[i] - blk->yMax, 0.0);
-                if (!best_block[i] || d < best_d[i] || (!blk->next && !flow->next && x[i] >= fmin(xMax, pageWidth) && y[i] >= fmin(yMax, pageHeight))) {
-                    best_block[i] = blk;
-                    best_flow[i] = flow;
-                    best_count[i] = count;
-                    best_d[i] = d;
-                }
-            }
-        }
-    }
     for (i = 0; i < 2; i++) {
+        int best = idx->blockGrid->nearest(x[i], y[i]);
+        // the first/last blocks in reading order are
+        // often not the closest to the page corners;
+        // force those blocks to be selected if the
+        // selection runs across multiple pages.
+        if (x[i] >= fmin(idx->xMax, pageWidth) && y[i] >= fmin(idx->yMax, pageHeight)) {
+            best = idx->blocks.size() - 1;
+        }
         if (primaryLR) {
-            if (x[i] < xMin && y[i] < yMin) {
-                best_block[i] = flows->blocks;
-                best_flow[i] = flows;
-                best_count[i] = 1;
+            if (x[i] < idx->xMin && y[i] < idx->yMin) {
+                best = 0;
             }
         } else {
-            if (x[i] > xMax && y[i] < yMin) {
-                best_block[i] = flows->blocks;
-                best_flow[i] = flows;
-                best_count[i] = 1;
+            if (x[i] > idx->xMax && y[i] < idx->yMin) {
+                best = 0;
             }
         }
-    }
-    // assert: best is always set.
-    if (!best_block[0] || !best_block[1]) {
-        return;
+        best_block[i] = idx->blocks[best].blk;
+        best_flow[i] = idx->blocks[best].flow;
+        best_count[i] = best + 1;
     }
 
     // Now decide which point was first.
@@ -5211,6 +5375,74 @@ void TextPage::visitSelection(TextSelectionVisitor *visitor, const PDFRectangle
     }
 }
 
+const TextPageIndex *TextPage::getIndex()
+{
+    if (index) {
+        return index.get();
+    }
+
+    index = std::make_unique<TextPageIndex>();
+    std::vector<TextSpatialIndex::Box> boxes;
+
+    index->xMin = pageWidth;
+    index->yMin = pageHeight;
+    index->xMax = 0.0;
+    index->yMax = 0.0;
+    for (TextFlow *flow = flows; flow; flow = flow->next) {
+        for (TextBlock *blk = flow->blocks; blk; blk = blk->next) {
+            index->blocks.push_back({ flow, blk });
+            boxes.push_back({ blk->xMin, blk->yMin, blk->xMax, blk->yMax });
+            index->xMin = fmin(index->xMin, blk->xMin);
+            index->yMin = fmin(index->yMin, blk->yMin);
+            index->xMax = fmax(index->xMax, blk->xMax);
+            index->yMax = fmax(index->yMax, blk->yMax);
+        }
+    }
+    index->blockGrid = std::make_unique<TextSpatialIndex>(std::move(boxes));
+
+    boxes.clear();
+    if (rawOrder) {
+        for (TextWord *word = rawWords; word; word = word->next) {
+            index->words.push_back(word);
+        }
+    } else {
+        for (TextFlow *flow = flows; flow; flow = flow->next) {
+            for (TextBlock *blk = flow->blocks; blk; blk = blk->next) {
+                for (TextLine *line = blk->lines; line; line = line->next) {
+                    for (TextWord *word = line->words; word; word = word->next) {
+                        index->words.push_back(word);
+                    }
+                }
+            }
+        }
+    }
+    for (const TextWord *word : index->words) {
+        boxes.push_back({ word->xMin, word->yMin, word->xMax, word->yMax });
+    }
+    index->wordGrid = std::make_unique<TextSpatialIndex>(std::move(boxes));
+
+    return index.get();
+}
+
+std::vector<TextWord *> TextPage::findWords(const PDFRectangle &area)
+{
+    std::vector<TextWord *> result;
+    const TextPageIndex *idx = getIndex();
+
+    for (int i : idx->wordGrid->query(area.x1, area.y1, area.x2, area.y2)) {
+        result.push_back(idx->words[i]);
+    }
+    return result;
+}
+
+TextWord *TextPage::findWordAt(double x, double y)
+{
+    const TextPageIndex *idx = getIndex();
+    const std::vector<int> hits = idx->wordGrid->query(x, y, x, y);
+
+    return hits.empty() ? nullptr : idx->words[hits.front()];
+}
+
 void TextPage::drawSelection(OutputDev *out, double scale, int rotation, const PDFRectangle *selection, SelectionStyle style, const GfxColor *glyph_color, const GfxColor *box_color)
 {
     TextSelectionPainter painter(this, scale, rotation, out, box_color, glyph_color);
@@ -61,6 +61,7 @@ class TextLink;
 class TextUnderline;
 class TextWordList;
 class TextPage;
+class TextPageIndex;
 class TextSelectionVisitor;
 
 //------------------------------------------------------------------------
@@ -646,6 +647,14 @@ public:
 
     std::vector<TextWordSelection *> **getSelectionWords(const PDFRectangle *selection, SelectionStyle style, int *nLines);
 
+    // Return the words whose bounding boxes intersect <area>, in
+    // reading order (or content stream order if rawOrder is set).
+    std::vector<TextWord *> findWords(const PDFRectangle &area);
+
+    // Return the first word, in reading order, whose bounding box
+    // contains the point (<x>,<y>), or nullptr if there is none.
+    TextWord *findWordAt(double x, double y);
+
     // Find a string by character position and length.  If found, sets
     // the text bounding rectangle and returns true; otherwise returns
     // false.
@@ -677,6 +686,7 @@ private:
     void assignColumns(TextLineFrag *frags, int nFrags, bool rot) const;
     int dumpFragment(const Unicode *text, int len, const UnicodeMap *uMap, GooString *s) const;
     void adjustRotation(TextLine *line, int start, int end, double *xMin, double *xMax, double *yMin, double *yMax);
+    const TextPageIndex *getIndex();
 
     bool rawOrder; // keep text in content stream order
     bool discardDiag; // discard diagonal text
@@ -715,6 +725,10 @@ private:
     std::vector<std::unique_ptr<TextUnderline>> underlines;
     std::vector<std::unique_ptr<TextLink>> links;
 
+    std::unique_ptr<TextPageIndex> index; // spatial index over blocks and
+                                          //   words, built lazily after
+                                          //   coalesce()
+
     int refCnt;
 
     friend class TextLine;
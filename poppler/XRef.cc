@@ -408,6 +408,8 @@ XRef *XRef::copy() const
             xref->entries[i].obj = entries[i].obj.copy();
         }
     }
+    // the flags were copied with the entries
+    xref->scannedSpecialFlags = scannedSpecialFlags;
     xref->streamEndsLen = streamEndsLen;
     if (streamEndsLen != 0) {
         xref->streamEnds = (Goffset *)gmalloc(streamEndsLen * sizeof(Goffset));
@@ -1445,6 +1447,18 @@ bool XRef::add(int num, int gen, Goffset offs, bool used)
     return true;
 }
 
+void XRef::addCompressed(int num, int objStrNum, int idx)
+{
+    xrefLocker();
+    if (!add(num, 0, 0, false)) {
+        return;
+    }
+    XRefEntry *e = getEntry(num);
+    e->type = xrefEntryCompressed;
+    e->offset = objStrNum;
+    e->gen = idx;
+}
+
 void XRef::setModifiedObject(const Object *o, Ref r)
 {
     xrefLocker();
@@ -1622,7 +1636,7 @@ void XRef::XRefStreamWriter::writeEntry(Goffset offset, int gen, XRefEntryType t
 {
     const int entryTotalSize = 1 + offsetSize + 2; /* type + offset + gen */
     char data[16];
-    data[0] = (type == xrefEntryFree) ? 0 : 1;
+    data[0] = (type == xrefEntryFree) ? 0 : (type == xrefEntryCompressed) ? 2 : 1;
     for (int i = offsetSize; i > 0; i--) {
         data[i] = offset & 0xff;
         offset >>= 8;
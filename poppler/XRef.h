@@ -217,6 +217,9 @@ public:
     void removeIndirectObject(Ref r);
     bool add(int num, int gen, Goffset offs, bool used);
     void add(Ref ref, Goffset offs, bool used);
+    // Add an entry for object <num> stored at index <idx> of object
+    // stream <objStrNum>.  Such entries can only be written to XRef streams.
+    void addCompressed(int num, int objStrNum, int idx);
     // Adds a stream object using AutoFreeMemStream.
     // The function takes ownership over dict and buffer.
     // The buffer should be created using gmalloc().
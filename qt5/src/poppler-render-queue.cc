@@ -0,0 +1,283 @@
+/* poppler-render-queue.cc: qt interface to poppler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "poppler-render-queue.h"
+
+#include <QtCore/QThread>
+
+#include "poppler-private.h"
+#include "poppler-page-private.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace Poppler {
+
+class RenderQueuePrivate;
+
+struct RenderJob
+{
+    RenderQueuePrivate *queue;
+    int id;
+    RenderQueue::Request request;
+    std::unique_ptr<Page> page;
+    std::atomic<bool> aborted { false };
+    std::chrono::steady_clock::time_point lastPartialUpdate;
+};
+
+class RenderQueuePrivate
+{
+public:
+    RenderQueuePrivate(RenderQueue *qq, Document *documentA, int maxThreadsA) : q(qq), document(documentA), maxThreads(maxThreadsA > 0 ? maxThreadsA : std::max(QThread::idealThreadCount(), 1)) { }
+
+    static bool sameRender(const RenderQueue::Request &a, const RenderQueue::Request &b);
+    static bool shouldAbort(const QVariant &closure);
+    static bool shouldDoPartialUpdate(const QVariant &closure);
+    static void partialUpdate(const QImage &image, const QVariant &closure);
+
+    void run();
+    void deliver(int id, const QImage &image, bool partial);
+    void stop();
+
+    RenderQueue *q;
+    Document *document;
+    const int maxThreads;
+    std::atomic<int> partialUpdateInterval { 0 };
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<std::unique_ptr<RenderJob>> queued;
+    std::vector<RenderJob *> running; // owned by the threads rendering them
+    std::set<int> live; // ids not cancelled and not delivered yet
+    std::vector<std::thread> threads;
+    int idleThreads = 0;
+    int nextId = 0;
+    bool quit = false;
+};
+
+bool RenderQueuePrivate::sameRender(const RenderQueue::Request &a, const RenderQueue::Request &b)
+{
+    return a.page == b.page && a.xres == b.xres && a.yres == b.yres && a.rect == b.rect && a.rotate == b.rotate;
+}
+
+bool RenderQueuePrivate::shouldAbort(const QVariant &closure)
+{
+    const RenderJob *job = static_cast<const RenderJob *>(closure.value<void *>());
+    return job->aborted;
+}
+
+bool RenderQueuePrivate::shouldDoPartialUpdate(const QVariant &closure)
+{
+    RenderJob *job = static_cast<RenderJob *>(closure.value<void *>());
+    const int interval = job->queue->partialUpdateInterval;
+    if (interval <= 0 || job->aborted) {
+        return false;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (now - job->lastPartialUpdate < std::chrono::milliseconds(interval)) {
+        return false;
+    }
+    job->lastPartialUpdate = now;
+    return true;
+}
+
+void RenderQueuePrivate::partialUpdate(const QImage &image, const QVariant &closure)
+{
+    const RenderJob *job = static_cast<const RenderJob *>(closure.value<void *>());
+    // the QPainter backend keeps painting on the image it passes
+    job->queue->deliver(job->id, image.copy(), true);
+}
+
+void RenderQueuePrivate::run()
+{
+    SplashOutputDevCache outputDevs;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ++idleThreads;
+        wakeUp.wait(lock, [this] { return quit || !queued.empty(); });
+        --idleThreads;
+        if (quit) {
+            break;
+        }
+
+        // highest priority first, then in the order of the requests
+        const auto next = std::min_element(queued.begin(), queued.end(), [](const std::unique_ptr<RenderJob> &a, const std::unique_ptr<RenderJob> &b) {
+            return a->request.priority > b->request.priority || (a->request.priority == b->request.priority && a->id < b->id);
+        });
+        std::unique_ptr<RenderJob> job = std::move(*next);
+        queued.erase(next);
+        running.push_back(job.get());
+        lock.unlock();
+
+        const RenderQueue::Request &r = job->request;
+        const bool wholePage = r.rect.isNull();
+        const QVariant closure = QVariant::fromValue(static_cast<void *>(job.get()));
+        job->lastPartialUpdate = std::chrono::steady_clock::now();
+        const QImage image = renderPageToImage(job->page.get(), job->page->m_page, r.xres, r.yres, wholePage ? -1 : r.rect.x(), wholePage ? -1 : r.rect.y(), wholePage ? -1 : r.rect.width(), wholePage ? -1 : r.rect.height(), r.rotate,
+                                               partialUpdate, shouldDoPartialUpdate, shouldAbort, closure, &outputDevs);
+
+        lock.lock();
+        running.erase(std::find(running.begin(), running.end(), job.get()));
+        if (!job->aborted) {
+            deliver(job->id, image, false);
+        }
+    }
+}
+
+// Emits the result of a request in the thread of the queue, unless the
+// request was cancelled in the meantime.
+void RenderQueuePrivate::deliver(int id, const QImage &image, bool partial)
+{
+    QMetaObject::invokeMethod(
+            q,
+            [this, id, image, partial]() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    const auto it = live.find(id);
+                    if (it == live.end()) {
+                        return;
+                    }
+                    if (!partial) {
+                        live.erase(it);
+                    }
+                }
+                if (partial) {
+                    Q_EMIT q->partiallyRendered(id, image);
+                } else {
+                    Q_EMIT q->rendered(id, image);
+                }
+            },
+            Qt::QueuedConnection);
+}
+
+void RenderQueuePrivate::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        queued.clear();
+        for (RenderJob *job : running) {
+            job->aborted = true;
+        }
+        live.clear();
+    }
+    wakeUp.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+RenderQueue::RenderQueue(Document *document, int maxThreads, QObject *parent) : QObject(parent), d(std::make_unique<RenderQueuePrivate>(this, document, maxThreads)) { }
+
+RenderQueue::~RenderQueue()
+{
+    d->stop();
+}
+
+int RenderQueue::enqueue(const Request &request)
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    for (const std::unique_ptr<RenderJob> &job : d->queued) {
+        if (RenderQueuePrivate::sameRender(job->request, request)) {
+            job->request.priority = std::max(job->request.priority, request.priority);
+            return job->id;
+        }
+    }
+    for (const RenderJob *job : d->running) {
+        if (!job->aborted && RenderQueuePrivate::sameRender(job->request, request)) {
+            return job->id;
+        }
+    }
+
+    std::unique_ptr<Page> page(d->document->page(request.page));
+    if (!page) {
+        return -1;
+    }
+
+    auto job = std::make_unique<RenderJob>();
+    job->queue = d.get();
+    job->id = d->nextId++;
+    job->request = request;
+    job->page = std::move(page);
+    const int id = job->id;
+    d->queued.push_back(std::move(job));
+    d->live.insert(id);
+
+    if (d->idleThreads == 0 && (int)d->threads.size() < d->maxThreads) {
+        d->threads.emplace_back([this] { d->run(); });
+    } else {
+        d->wakeUp.notify_one();
+    }
+    return id;
+}
+
+bool RenderQueue::cancel(int id)
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    d->live.erase(id);
+    const auto queuedJob = std::find_if(d->queued.begin(), d->queued.end(), [id](const std::unique_ptr<RenderJob> &job) { return job->id == id; });
+    if (queuedJob != d->queued.end()) {
+        d->queued.erase(queuedJob);
+        return true;
+    }
+    for (RenderJob *job : d->running) {
+        if (job->id == id) {
+            job->aborted = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderQueue::cancelAll()
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    d->queued.clear();
+    for (RenderJob *job : d->running) {
+        job->aborted = true;
+    }
+    d->live.clear();
+}
+
+int RenderQueue::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    return static_cast<int>(d->queued.size() + d->running.size());
+}
+
+void RenderQueue::setPartialUpdateInterval(int msecs)
+{
+    d->partialUpdateInterval = msecs;
+}
+
+int RenderQueue::partialUpdateInterval() const
+{
+    return d->partialUpdateInterval;
+}
+
+}
@@ -0,0 +1,145 @@
+/* poppler-render-queue.h: qt interface to poppler
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street - Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef POPPLER_RENDER_QUEUE_H
+#define POPPLER_RENDER_QUEUE_H
+
+#include <QtCore/QObject>
+#include <QtCore/QRect>
+#include <QtGui/QImage>
+
+#include "poppler-export.h"
+#include "poppler-qt5.h"
+
+#include <memory>
+
+namespace Poppler {
+
+class RenderQueuePrivate;
+
+/**
+   \brief Renders pages of a Document on worker threads
+
+   Render requests are queued and carried out on a bounded number of
+   threads, the requests with the highest priority first. Every thread
+   keeps its Splash output device, with the fonts it loaded, from one
+   request to the next, which makes rendering many pages or tiles of the
+   same document faster than calling Page::renderToImage() for each one.
+
+   A request for the same page, area, resolution and rotation as a
+   request that is still queued or being rendered is not queued again:
+   enqueue() returns the id of the existing request (raising its
+   priority if needed). The callers that got the same id share the
+   request: cancelling it cancels it for all of them.
+
+   The results are delivered by the rendered() and partiallyRendered()
+   signals, emitted in the thread the queue lives in. Cancelled requests
+   get no signal, even if they were already rendered.
+
+   The render hints, paper color and backend of the Document are used as
+   they are when a request starts rendering. The Document must outlive
+   the queue, and must not be unlocked while requests are pending.
+
+   \since 24.08
+*/
+class POPPLER_QT5_EXPORT RenderQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+       A render request: what Page::renderToImage() would render
+    */
+    struct Request
+    {
+        int page = 0; ///< The index of the page
+        double xres = 72.0; ///< Horizontal resolution, in dots per inch
+        double yres = 72.0; ///< Vertical resolution, in dots per inch
+        QRect rect; ///< The area to render, in pixels; a null rect renders the whole page
+        Page::Rotation rotate = Page::Rotate0; ///< How to rotate the page
+        int priority = 0; ///< Requests with a higher priority are rendered first
+    };
+
+    /**
+       Creates a queue rendering pages of \p document with at most \p maxThreads
+       threads; 0 means as many threads as there are cores.
+    */
+    explicit RenderQueue(Document *document, int maxThreads = 0, QObject *parent = nullptr);
+
+    /**
+       Destructor. Requests not rendered yet are cancelled, and the ones being
+       rendered are aborted.
+    */
+    ~RenderQueue() override;
+
+    /**
+       Queues \p request and returns its id, or -1 if the page does not exist.
+    */
+    int enqueue(const Request &request);
+
+    /**
+       Cancels the request \p id: it is removed from the queue, or aborted if
+       it is being rendered. If enqueue() returned \p id for several
+       requests, none of them is rendered any more.
+
+       \returns whether the request was still queued or being rendered
+    */
+    bool cancel(int id);
+
+    /**
+       Cancels all the requests.
+    */
+    void cancelAll();
+
+    /**
+       The number of requests queued or being rendered.
+    */
+    int pendingCount() const;
+
+    /**
+       Sets the minimum time between two partiallyRendered() signals of a
+       request, in milliseconds; 0 (the default) turns partial updates off.
+    */
+    void setPartialUpdateInterval(int msecs);
+
+    /**
+       The minimum time between two partiallyRendered() signals of a request.
+    */
+    int partialUpdateInterval() const;
+
+Q_SIGNALS:
+    /**
+       The request \p id was rendered to \p image, which is null if rendering
+       failed.
+    */
+    void rendered(int id, const QImage &image);
+
+    /**
+       \p image is what was rendered of the request \p id so far.
+    */
+    void partiallyRendered(int id, const QImage &image);
+
+private:
+    Q_DISABLE_COPY(RenderQueue)
+
+    std::unique_ptr<RenderQueuePrivate> d;
+    friend class RenderQueuePrivate;
+};
+
+}
+
+#endif
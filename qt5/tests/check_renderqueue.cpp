@@ -0,0 +1,229 @@
+#include <QtTest/QSignalSpy>
+#include <QtTest/QTest>
+
+#include <poppler-qt5.h>
+#include <poppler-render-queue.h>
+
+#include <memory>
+
+class TestRenderQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TestRenderQueue(QObject *parent = nullptr) : QObject(parent) { }
+private slots:
+    void initTestCase();
+    void checkPriority();
+    void checkDuplicates();
+    void checkCancelDuplicate();
+    void checkCancelQueued();
+    void checkCancelRunning();
+    void checkDestroyPending();
+
+private:
+    // Renders page 0, which takes a while, and waits until it is being
+    // rendered, so that the following requests are queued behind it.
+    int startSlowRequest(Poppler::RenderQueue *queue, QSignalSpy *partialSpy);
+
+    std::unique_ptr<Poppler::Document> doc;
+};
+
+static Poppler::RenderQueue::Request request(int page, int priority = 0)
+{
+    Poppler::RenderQueue::Request r;
+    r.page = page;
+    r.priority = priority;
+    return r;
+}
+
+// the ids of the rendered() signals caught by spy, in order
+static QList<int> renderedIds(const QSignalSpy &spy)
+{
+    QList<int> ids;
+    for (const QList<QVariant> &args : spy) {
+        ids << args.at(0).toInt();
+    }
+    return ids;
+}
+
+// A document whose first page draws a million rectangles, and whose three
+// other pages draw one.
+static QByteArray makeDocument()
+{
+    const QByteArray slow = qCompress(QByteArray("0 0 1 1 re f\n").repeated(1000000), 9).mid(4); // without the qCompress size
+    const QByteArray fast = "0 0 50 50 re f";
+
+    QList<QByteArray> objects;
+    objects << "<< /Type /Catalog /Pages 2 0 R >>";
+    objects << "<< /Type /Pages /Kids [3 0 R 4 0 R 5 0 R 6 0 R] /Count 4 /MediaBox [0 0 100 100] >>";
+    objects << "<< /Type /Page /Parent 2 0 R /Contents 7 0 R >>";
+    for (int i = 0; i < 3; ++i) {
+        objects << "<< /Type /Page /Parent 2 0 R /Contents 8 0 R >>";
+    }
+    objects << "<< /Length " + QByteArray::number(slow.size()) + " /Filter /FlateDecode >>\nstream\n" + slow + "\nendstream";
+    objects << "<< /Length " + QByteArray::number(fast.size()) + " >>\nstream\n" + fast + "\nendstream";
+
+    QByteArray data = "%PDF-1.4\n";
+    QList<int> offsets;
+    for (int i = 0; i < objects.size(); ++i) {
+        offsets << data.size();
+        data += QByteArray::number(i + 1) + " 0 obj\n" + objects.at(i) + "\nendobj\n";
+    }
+    const int xrefOffset = data.size();
+    data += "xref\n0 " + QByteArray::number(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (int offset : offsets) {
+        data += QByteArray::number(offset).rightJustified(10, '0') + " 00000 n \n";
+    }
+    data += "trailer\n<< /Size " + QByteArray::number(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + QByteArray::number(xrefOffset) + "\n%%EOF\n";
+    return data;
+}
+
+void TestRenderQueue::initTestCase()
+{
+    doc.reset(Poppler::Document::loadFromData(makeDocument()));
+    QVERIFY(doc);
+    QCOMPARE(doc->numPages(), 4);
+}
+
+int TestRenderQueue::startSlowRequest(Poppler::RenderQueue *queue, QSignalSpy *partialSpy)
+{
+    queue->setPartialUpdateInterval(1);
+    const int id = queue->enqueue(request(0));
+    if (id >= 0 && partialSpy->isEmpty()) {
+        partialSpy->wait(10000);
+    }
+    return id;
+}
+
+void TestRenderQueue::checkPriority()
+{
+    Poppler::RenderQueue queue(doc.get(), 1);
+    QSignalSpy renderedSpy(&queue, &Poppler::RenderQueue::rendered);
+    QSignalSpy partialSpy(&queue, &Poppler::RenderQueue::partiallyRendered);
+
+    const int slow = startSlowRequest(&queue, &partialSpy);
+    QVERIFY(slow >= 0);
+    QVERIFY(!partialSpy.isEmpty());
+
+    const int low = queue.enqueue(request(1, 0));
+    const int high = queue.enqueue(request(2, 2));
+    const int middle = queue.enqueue(request(3, 1));
+    QVERIFY(low >= 0 && high >= 0 && middle >= 0);
+    QCOMPARE(queue.pendingCount(), 4);
+
+    QTRY_COMPARE_WITH_TIMEOUT(renderedSpy.count(), 4, 30000);
+    QCOMPARE(renderedIds(renderedSpy), QList<int>() << slow << high << middle << low);
+    for (const QList<QVariant> &args : renderedSpy) {
+        QVERIFY(!args.at(1).value<QImage>().isNull());
+    }
+    QCOMPARE(queue.pendingCount(), 0);
+}
+
+void TestRenderQueue::checkDuplicates()
+{
+    Poppler::RenderQueue queue(doc.get(), 1);
+    QSignalSpy renderedSpy(&queue, &Poppler::RenderQueue::rendered);
+    QSignalSpy partialSpy(&queue, &Poppler::RenderQueue::partiallyRendered);
+
+    const int slow = startSlowRequest(&queue, &partialSpy);
+    QVERIFY(slow >= 0);
+    QVERIFY(!partialSpy.isEmpty());
+
+    // the request being rendered isn't queued again either
+    QCOMPARE(queue.enqueue(request(0)), slow);
+
+    const int first = queue.enqueue(request(1, 0));
+    const int other = queue.enqueue(request(2, 1));
+    // the same render with a higher priority raises the queued one's
+    QCOMPARE(queue.enqueue(request(1, 2)), first);
+    QCOMPARE(queue.pendingCount(), 3);
+
+    QVERIFY(queue.cancel(slow));
+    QTRY_COMPARE_WITH_TIMEOUT(renderedSpy.count(), 2, 30000);
+    QCOMPARE(renderedIds(renderedSpy), QList<int>() << first << other);
+}
+
+void TestRenderQueue::checkCancelDuplicate()
+{
+    Poppler::RenderQueue queue(doc.get(), 1);
+    QSignalSpy renderedSpy(&queue, &Poppler::RenderQueue::rendered);
+    QSignalSpy partialSpy(&queue, &Poppler::RenderQueue::partiallyRendered);
+
+    const int slow = startSlowRequest(&queue, &partialSpy);
+    QVERIFY(slow >= 0);
+
+    // two callers asking for the same render share the request, so
+    // cancelling it for one cancels it for the other too
+    const int id = queue.enqueue(request(1));
+    QCOMPARE(queue.enqueue(request(1)), id);
+    QVERIFY(queue.cancel(id));
+    QVERIFY(!queue.cancel(id));
+
+    const int last = queue.enqueue(request(2));
+    QVERIFY(queue.cancel(slow));
+    QTRY_VERIFY_WITH_TIMEOUT(renderedIds(renderedSpy).contains(last), 30000);
+    QTest::qWait(100);
+    QCOMPARE(renderedIds(renderedSpy), QList<int>() << last);
+}
+
+void TestRenderQueue::checkCancelQueued()
+{
+    Poppler::RenderQueue queue(doc.get(), 1);
+    QSignalSpy renderedSpy(&queue, &Poppler::RenderQueue::rendered);
+    QSignalSpy partialSpy(&queue, &Poppler::RenderQueue::partiallyRendered);
+
+    const int slow = startSlowRequest(&queue, &partialSpy);
+    QVERIFY(slow >= 0);
+
+    const int cancelled = queue.enqueue(request(1));
+    const int kept = queue.enqueue(request(2));
+    QCOMPARE(queue.pendingCount(), 3);
+    QVERIFY(queue.cancel(cancelled));
+    QCOMPARE(queue.pendingCount(), 2);
+
+    QTRY_VERIFY_WITH_TIMEOUT(renderedIds(renderedSpy).contains(kept), 30000);
+    QTest::qWait(100);
+    QCOMPARE(renderedIds(renderedSpy), QList<int>() << slow << kept);
+}
+
+void TestRenderQueue::checkCancelRunning()
+{
+    Poppler::RenderQueue queue(doc.get(), 1);
+    QSignalSpy renderedSpy(&queue, &Poppler::RenderQueue::rendered);
+    QSignalSpy partialSpy(&queue, &Poppler::RenderQueue::partiallyRendered);
+
+    const int slow = startSlowRequest(&queue, &partialSpy);
+    QVERIFY(slow >= 0);
+    QVERIFY(!partialSpy.isEmpty());
+
+    QVERIFY(queue.cancel(slow));
+    const int partialCount = partialSpy.count();
+    const int next = queue.enqueue(request(1));
+
+    QTRY_VERIFY_WITH_TIMEOUT(renderedIds(renderedSpy).contains(next), 30000);
+    QTest::qWait(100);
+    QCOMPARE(renderedIds(renderedSpy), QList<int>() << next);
+    QCOMPARE(partialSpy.count(), partialCount);
+    QCOMPARE(queue.pendingCount(), 0);
+}
+
+void TestRenderQueue::checkDestroyPending()
+{
+    auto queue = std::make_unique<Poppler::RenderQueue>(doc.get(), 2);
+    QSignalSpy partialSpy(queue.get(), &Poppler::RenderQueue::partiallyRendered);
+
+    QVERIFY(startSlowRequest(queue.get(), &partialSpy) >= 0);
+    for (int page = 1; page < 4; ++page) {
+        QVERIFY(queue->enqueue(request(page)) >= 0);
+    }
+    QVERIFY(queue->pendingCount() > 0);
+
+    // aborts the slow page and drops the queued ones
+    queue.reset();
+    QTest::qWait(100);
+
+    QVERIFY(std::unique_ptr<Poppler::Page>(doc->page(1)));
+}
+
+QTEST_GUILESS_MAIN(TestRenderQueue)
+#include "check_renderqueue.moc"
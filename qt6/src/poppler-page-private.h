@@ -25,6 +25,11 @@
 #define _POPPLER_PAGE_PRIVATE_H_
 
 #include "CharTypes.h"
+#include "GfxState.h"
+
+#include <QtGui/QColor>
+
+#include <memory>
 
 class QRectF;
 
@@ -36,6 +41,7 @@ namespace Poppler {
 
 class DocumentData;
 class PageTransition;
+class Qt6SplashOutputDev;
 
 class PageData
 {
@@ -46,14 +52,46 @@ public:
     ::Page *page;
     int index;
     PageTransition *transition;
+    // The text of the page kept by textList(const QRectF &, Rotation), so
+    // that its spatial index is only built once
+    TextPage *areaTextPage;
+    Page::Rotation areaTextPageRotation;
 
     static std::unique_ptr<Link> convertLinkActionToLink(::LinkAction *a, DocumentData *parentDoc, const QRectF &linkArea);
 
     TextPage *prepareTextSearch(const QString &text, Page::Rotation rotate, QVector<Unicode> *u);
     bool performSingleTextSearch(TextPage *textPage, QVector<Unicode> &u, double &sLeft, double &sTop, double &sRight, double &sBottom, Page::SearchDirection direction, bool sCase, bool sWords, bool sDiacritics, bool sAcrossLines);
     QList<QRectF> performMultipleTextSearch(TextPage *textPage, QVector<Unicode> &u, bool sCase, bool sWords, bool sDiacritics, bool sAcrossLines);
+    TextPage *textPageForArea(Page::Rotation rotate);
+};
+
+// Keeps a Splash output device, with the fonts it loaded, between renders
+// of pages of the same document; a new one is made when the document or
+// its render hints, paper color or display profile change.
+class SplashOutputDevCache
+{
+public:
+    SplashOutputDevCache();
+    ~SplashOutputDevCache();
+
+    SplashOutputDevCache(const SplashOutputDevCache &) = delete;
+    SplashOutputDevCache &operator=(const SplashOutputDevCache &) = delete;
+
+    Qt6SplashOutputDev *outputDev(DocumentData *doc);
+
+private:
+    std::unique_ptr<Qt6SplashOutputDev> m_outputDev;
+    DocumentData *m_doc = nullptr;
+    int m_hints = 0;
+    QColor m_paperColor;
+    GfxLCMSProfilePtr m_displayProfile;
 };
 
+// Page::renderToImage(); with the Splash backend, the output device comes
+// from <splashOutputDevs> unless it is nullptr.
+QImage renderPageToImage(const Page *page, PageData *pageData, double xres, double yres, int xPos, int yPos, int w, int h, Page::Rotation rotate, Page::RenderToImagePartialUpdateFunc partialUpdateCallback,
+                         Page::ShouldRenderToImagePartialQueryFunc shouldDoPartialUpdateCallback, Page::ShouldAbortQueryFunc shouldAbortRenderCallback, const QVariant &payload, SplashOutputDevCache *splashOutputDevs);
+
 }
 
 #endif
@@ -430,11 +430,16 @@ Page::Page(DocumentData *doc, int index)
     m_page->parentDoc = doc;
     m_page->page = doc->doc->getPage(m_page->index + 1);
     m_page->transition = nullptr;
+    m_page->areaTextPage = nullptr;
+    m_page->areaTextPageRotation = Rotate0;
 }
 
 Page::~Page()
 {
     delete m_page->transition;
+    if (m_page->areaTextPage) {
+        m_page->areaTextPage->decRefCnt();
+    }
     delete m_page;
 }
 
@@ -515,92 +520,136 @@ static QFont::HintingPreference QFontHintingFromPopplerHinting(int renderHints)
 QImage Page::renderToImage(double xres, double yres, int xPos, int yPos, int w, int h, Rotation rotate, RenderToImagePartialUpdateFunc partialUpdateCallback, ShouldRenderToImagePartialQueryFunc shouldDoPartialUpdateCallback,
                            ShouldAbortQueryFunc shouldAbortRenderCallback, const QVariant &payload) const
 {
-    int rotation = (int)rotate * 90;
-    QImage img;
-    switch (m_page->parentDoc->m_backend) {
-    case Poppler::Document::SplashBackend: {
-        SplashColor bgColor;
-        const bool overprintPreview = m_page->parentDoc->m_hints & Document::OverprintPreview ? true : false;
-        if (overprintPreview) {
-            unsigned char c, m, y, k;
-
-            c = 255 - m_page->parentDoc->paperColor.blue();
-            m = 255 - m_page->parentDoc->paperColor.red();
-            y = 255 - m_page->parentDoc->paperColor.green();
-            k = c;
-            if (m < k) {
-                k = m;
-            }
-            if (y < k) {
-                k = y;
-            }
-            bgColor[0] = c - k;
-            bgColor[1] = m - k;
-            bgColor[2] = y - k;
-            bgColor[3] = k;
-            for (int i = 4; i < SPOT_NCOMPS + 4; i++) {
-                bgColor[i] = 0;
-            }
-        } else {
-            bgColor[0] = m_page->parentDoc->paperColor.blue();
-            bgColor[1] = m_page->parentDoc->paperColor.green();
-            bgColor[2] = m_page->parentDoc->paperColor.red();
-        }
-
-        const SplashColorMode colorMode = overprintPreview ? splashModeDeviceN8 : splashModeXBGR8;
+    return renderPageToImage(this, m_page, xres, yres, xPos, yPos, w, h, rotate, partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload, nullptr);
+}
 
-        SplashThinLineMode thinLineMode = splashThinLineDefault;
-        if (m_page->parentDoc->m_hints & Document::ThinLineShape) {
-            thinLineMode = splashThinLineShape;
+static std::unique_ptr<Qt6SplashOutputDev> createSplashOutputDev(DocumentData *doc)
+{
+    SplashColor bgColor;
+    const bool overprintPreview = doc->m_hints & Document::OverprintPreview ? true : false;
+    if (overprintPreview) {
+        unsigned char c, m, y, k;
+
+        c = 255 - doc->paperColor.blue();
+        m = 255 - doc->paperColor.red();
+        y = 255 - doc->paperColor.green();
+        k = c;
+        if (m < k) {
+            k = m;
         }
-        if (m_page->parentDoc->m_hints & Document::ThinLineSolid) {
-            thinLineMode = splashThinLineSolid;
+        if (y < k) {
+            k = y;
         }
+        bgColor[0] = c - k;
+        bgColor[1] = m - k;
+        bgColor[2] = y - k;
+        bgColor[3] = k;
+        for (int i = 4; i < SPOT_NCOMPS + 4; i++) {
+            bgColor[i] = 0;
+        }
+    } else {
+        bgColor[0] = doc->paperColor.blue();
+        bgColor[1] = doc->paperColor.green();
+        bgColor[2] = doc->paperColor.red();
+    }
 
-        const bool ignorePaperColor = m_page->parentDoc->m_hints & Document::IgnorePaperColor;
+    const SplashColorMode colorMode = overprintPreview ? splashModeDeviceN8 : splashModeXBGR8;
 
-        Qt6SplashOutputDev splash_output(colorMode, 4, false, ignorePaperColor, ignorePaperColor ? nullptr : bgColor, true, thinLineMode, overprintPreview);
+    SplashThinLineMode thinLineMode = splashThinLineDefault;
+    if (doc->m_hints & Document::ThinLineShape) {
+        thinLineMode = splashThinLineShape;
+    }
+    if (doc->m_hints & Document::ThinLineSolid) {
+        thinLineMode = splashThinLineSolid;
+    }
 
-        splash_output.setCallbacks(partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload);
+    const bool ignorePaperColor = doc->m_hints & Document::IgnorePaperColor;
 
-        splash_output.setFontAntialias(m_page->parentDoc->m_hints & Document::TextAntialiasing ? true : false);
-        splash_output.setVectorAntialias(m_page->parentDoc->m_hints & Document::Antialiasing ? true : false);
-        splash_output.setFreeTypeHinting(m_page->parentDoc->m_hints & Document::TextHinting ? true : false, m_page->parentDoc->m_hints & Document::TextSlightHinting ? true : false);
+    auto splash_output = std::make_unique<Qt6SplashOutputDev>(colorMode, 4, false, ignorePaperColor, ignorePaperColor ? nullptr : bgColor, true, thinLineMode, overprintPreview);
+
+    splash_output->setFontAntialias(doc->m_hints & Document::TextAntialiasing ? true : false);
+    splash_output->setVectorAntialias(doc->m_hints & Document::Antialiasing ? true : false);
+    splash_output->setFreeTypeHinting(doc->m_hints & Document::TextHinting ? true : false, doc->m_hints & Document::TextSlightHinting ? true : false);
 
 #ifdef USE_CMS
-        splash_output.setDisplayProfile(m_page->parentDoc->m_displayProfile);
+    splash_output->setDisplayProfile(doc->m_displayProfile);
 #endif
 
-        splash_output.startDoc(m_page->parentDoc->doc);
+    splash_output->startDoc(doc->doc);
+
+    return splash_output;
+}
+
+SplashOutputDevCache::SplashOutputDevCache() = default;
+
+SplashOutputDevCache::~SplashOutputDevCache() = default;
+
+Qt6SplashOutputDev *SplashOutputDevCache::outputDev(DocumentData *doc)
+{
+    // a new device is needed whenever something it was created with changes
+    if (!m_outputDev || doc != m_doc || doc->m_hints != m_hints || doc->paperColor != m_paperColor
+#ifdef USE_CMS
+        || doc->m_displayProfile != m_displayProfile
+#endif
+    ) {
+        m_outputDev = createSplashOutputDev(doc);
+        m_doc = doc;
+        m_hints = doc->m_hints;
+        m_paperColor = doc->paperColor;
+#ifdef USE_CMS
+        m_displayProfile = doc->m_displayProfile;
+#endif
+    }
+    return m_outputDev.get();
+}
+
+QImage renderPageToImage(const Page *page, PageData *pageData, double xres, double yres, int xPos, int yPos, int w, int h, Page::Rotation rotate, Page::RenderToImagePartialUpdateFunc partialUpdateCallback,
+                         Page::ShouldRenderToImagePartialQueryFunc shouldDoPartialUpdateCallback, Page::ShouldAbortQueryFunc shouldAbortRenderCallback, const QVariant &payload, SplashOutputDevCache *splashOutputDevs)
+{
+    int rotation = (int)rotate * 90;
+    QImage img;
+    switch (pageData->parentDoc->m_backend) {
+    case Poppler::Document::SplashBackend: {
+        std::unique_ptr<Qt6SplashOutputDev> ownOutputDev;
+        Qt6SplashOutputDev *splash_output;
+        if (splashOutputDevs) {
+            splash_output = splashOutputDevs->outputDev(pageData->parentDoc);
+        } else {
+            ownOutputDev = createSplashOutputDev(pageData->parentDoc);
+            splash_output = ownOutputDev.get();
+        }
+
+        splash_output->setCallbacks(partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload);
 
-        const bool hideAnnotations = m_page->parentDoc->m_hints & Document::HideAnnotations;
+        const bool hideAnnotations = pageData->parentDoc->m_hints & Document::HideAnnotations;
 
-        OutputDevCallbackHelper *abortHelper = &splash_output;
-        m_page->parentDoc->doc->displayPageSlice(&splash_output, m_page->index + 1, xres, yres, rotation, false, true, false, xPos, yPos, w, h, shouldAbortRenderCallback ? shouldAbortRenderInternalCallback : nullAbortCallBack, abortHelper,
-                                                 (hideAnnotations) ? annotDisplayDecideCbk : nullAnnotCallBack, nullptr, true);
+        OutputDevCallbackHelper *abortHelper = splash_output;
+        pageData->parentDoc->doc->displayPageSlice(splash_output, pageData->index + 1, xres, yres, rotation, false, true, false, xPos, yPos, w, h, shouldAbortRenderCallback ? shouldAbortRenderInternalCallback : nullAbortCallBack, abortHelper,
+                                                   (hideAnnotations) ? annotDisplayDecideCbk : nullAnnotCallBack, nullptr, true);
 
-        img = splash_output.getXBGRImage(true /* takeImageData */);
+        img = splash_output->getXBGRImage(true /* takeImageData */);
+        splash_output->setCallbacks(nullptr, nullptr, nullptr, QVariant());
         break;
     }
     case Poppler::Document::QPainterBackend: {
-        QSize size = pageSize();
+        QSize size = page->pageSize();
         QImage tmpimg(w == -1 ? qRound(size.width() * xres / 72.0) : w, h == -1 ? qRound(size.height() * yres / 72.0) : h, QImage::Format_ARGB32);
 
-        QColor bgColor(m_page->parentDoc->paperColor.red(), m_page->parentDoc->paperColor.green(), m_page->parentDoc->paperColor.blue(), m_page->parentDoc->paperColor.alpha());
+        QColor bgColor(pageData->parentDoc->paperColor.red(), pageData->parentDoc->paperColor.green(), pageData->parentDoc->paperColor.blue(), pageData->parentDoc->paperColor.alpha());
 
         tmpimg.fill(bgColor);
 
         QPainter painter(&tmpimg);
         QImageDumpingQPainterOutputDev qpainter_output(&painter, &tmpimg);
 
-        qpainter_output.setHintingPreference(QFontHintingFromPopplerHinting(m_page->parentDoc->m_hints));
+        qpainter_output.setHintingPreference(QFontHintingFromPopplerHinting(pageData->parentDoc->m_hints));
 
 #ifdef USE_CMS
-        qpainter_output.setDisplayProfile(m_page->parentDoc->m_displayProfile);
+        qpainter_output.setDisplayProfile(pageData->parentDoc->m_displayProfile);
 #endif
 
         qpainter_output.setCallbacks(partialUpdateCallback, shouldDoPartialUpdateCallback, shouldAbortRenderCallback, payload);
-        renderToQPainter(&qpainter_output, &painter, m_page, xres, yres, xPos, yPos, w, h, rotate, DontSaveAndRestore);
+        renderToQPainter(&qpainter_output, &painter, pageData, xres, yres, xPos, yPos, w, h, rotate, Page::DontSaveAndRestore);
         painter.end();
         img = tmpimg;
         break;
@@ -773,6 +822,60 @@ std::vector<std::unique_ptr<TextBox>> Page::textList(Rotation rotate, ShouldAbor
     return output_list;
 }
 
+TextPage *PageData::textPageForArea(Page::Rotation rotate)
+{
+    if (!areaTextPage || areaTextPageRotation != rotate) {
+        if (areaTextPage) {
+            areaTextPage->decRefCnt();
+        }
+
+        TextOutputDev output_dev(nullptr, false, 0, false, false);
+        parentDoc->doc->displayPageSlice(&output_dev, index + 1, 72, 72, (int)rotate * 90, false, false, false, -1, -1, -1, -1, nullptr, nullptr, nullptr, nullptr, true);
+        areaTextPage = output_dev.takeText();
+        areaTextPageRotation = rotate;
+    }
+    return areaTextPage;
+}
+
+std::vector<std::unique_ptr<TextBox>> Page::textList(const QRectF &area, Rotation rotate) const
+{
+    std::vector<std::unique_ptr<TextBox>> output_list;
+
+    TextPage *textPage = m_page->textPageForArea(rotate);
+    const PDFRectangle rect(area.left(), area.top(), area.right(), area.bottom());
+    const std::vector<TextWord *> words = textPage->findWords(rect);
+
+    QHash<const TextWord *, TextBox *> wordBoxMap;
+
+    output_list.reserve(words.size());
+    for (const TextWord *word : words) {
+        GooString *gooWord = word->getText();
+        QString string = QString::fromUtf8(gooWord->c_str());
+        delete gooWord;
+        double xMin, yMin, xMax, yMax;
+        word->getBBox(&xMin, &yMin, &xMax, &yMax);
+
+        auto text_box = std::make_unique<TextBox>(string, QRectF(xMin, yMin, xMax - xMin, yMax - yMin));
+        text_box->m_data->hasSpaceAfter = word->hasSpaceAfter() == true;
+        text_box->m_data->charBBoxes.reserve(word->getLength());
+        for (int j = 0; j < word->getLength(); ++j) {
+            word->getCharBBox(j, &xMin, &yMin, &xMax, &yMax);
+            text_box->m_data->charBBoxes.append(QRectF(xMin, yMin, xMax - xMin, yMax - yMin));
+        }
+
+        wordBoxMap.insert(word, text_box.get());
+
+        output_list.push_back(std::move(text_box));
+    }
+
+    for (const TextWord *word : words) {
+        TextBox *text_box = wordBoxMap.value(word);
+        text_box->m_data->nextWord = wordBoxMap.value(word->nextWord());
+    }
+
+    return output_list;
+}
+
 PageTransition *Page::transition() const
 {
     if (!m_page->transition) {
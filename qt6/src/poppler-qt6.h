@@ -809,6 +809,24 @@ rather unexpected results.
     */
     std::vector<std::unique_ptr<TextBox>> textList(Rotation rotate, ShouldAbortQueryFunc shouldAbortExtractionCallback, const QVariant &closure) const;
 
+    /**
+       Returns the text boxes of the page that intersect \p area
+
+       This works like textList(), but only returns the TextBoxes
+       whose bounding box intersects \p area (in the same coordinate
+       space as TextBox::boundingBox()), looked up through a spatial
+       index of the page text instead of a linear scan, which makes it
+       suitable for hit-testing.
+
+       TextBox::nextWord() only links boxes that are part of the result.
+
+       The text of the page and its index are kept by this Page object,
+       so later calls with the same \p rotate only do the lookup.
+
+       \since 24.08
+    */
+    std::vector<std::unique_ptr<TextBox>> textList(const QRectF &area, Rotation rotate = Rotate0) const;
+
     /**
        \return The dimensions (cropbox) of the page, in points (i.e. 1/72th of an inch)
     */
@@ -919,6 +937,7 @@ rather unexpected results.
 
 private:
     Q_DISABLE_COPY(Page)
+    friend class RenderQueuePrivate;
 
     Page(DocumentData *doc, int index);
     PageData *m_page;
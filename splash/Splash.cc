@@ -49,6 +49,7 @@
 #include "SplashPath.h"
 #include "SplashXPath.h"
 #include "SplashXPathScanner.h"
+#include "SplashAreaScanner.h"
 #include "SplashPattern.h"
 #include "SplashScreen.h"
 #include "SplashFont.h"
@@ -1315,6 +1316,7 @@ inline void Splash::drawAAPixel(SplashPipe *pipe, int x, int y)
     // update aaBuf
     if (y != aaBufY) {
         memset(aaBuf->getDataPtr(), 0xff, aaBuf->getRowSize() * aaBuf->getHeight());
+        setAABufDirty(0, bitmap->width - 1);
         x0 = 0;
         x1 = bitmap->width - 1;
         state->clip->clipAALine(aaBuf, &x0, &x1, y);
@@ -1426,6 +1428,105 @@ inline void Splash::drawAALine(SplashPipe *pipe, int x0, int x1, int y, bool adj
     }
 }
 
+// Clears the part of aaBuf which may have been written to since the
+// last call.  SplashXPathScanner::renderAALine expects a clear buffer,
+// and for thin strokes this is a few bytes instead of the whole width.
+void Splash::clearAABuf()
+{
+    if (aaBufDirtyMin <= aaBufDirtyMax) {
+        for (int yy = 0; yy < splashAASize; ++yy) {
+            memset(aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + aaBufDirtyMin, 0, aaBufDirtyMax - aaBufDirtyMin + 1);
+        }
+    }
+    aaBufDirtyMin = aaBuf->getRowSize();
+    aaBufDirtyMax = -1;
+}
+
+// Records that pixels <x0> .. <x1> of aaBuf may have been set.
+void Splash::setAABufDirty(int x0, int x1)
+{
+    const int byte0 = (std::max(std::min(x0, x1), 0) * splashAASize) >> 3;
+    const int byte1 = std::min(((std::max(x0, x1) + 1) * splashAASize - 1) >> 3, aaBuf->getRowSize() - 1);
+    if (byte0 <= byte1) {
+        aaBufDirtyMin = std::min(aaBufDirtyMin, byte0);
+        aaBufDirtyMax = std::max(aaBufDirtyMax, byte1);
+    }
+}
+
+// Draws one line of coverage values from SplashAreaScanner.  If
+// <clipToPaths> is set, the coverage is scaled by the part of each
+// pixel left by the clip paths.
+inline void Splash::drawAreaLine(SplashPipe *pipe, const unsigned char *coverage, int x0, int x1, int y, bool clipToPaths)
+{
+#if splashAASize == 4
+    static const int bitCount4[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+    SplashColorPtr p0, p1, p2, p3;
+#else
+    SplashColorPtr p;
+    int xx, yy;
+#endif
+    int x, c, t;
+
+    pipeSetXY(pipe, x0, y);
+    if (!clipToPaths) {
+        for (x = x0; x <= x1; ++x) {
+            c = *coverage++;
+            if (c != 0) {
+                pipe->shape = aaAreaGamma[c];
+                (this->*pipe->run)(pipe);
+            } else {
+                pipeIncX(pipe);
+            }
+        }
+        return;
+    }
+
+    // clip an all-ones line in aaBuf, and scale the coverage by the
+    // number of bits left
+    int clipX0 = x0, clipX1 = x1;
+    const int byte0 = (x0 * splashAASize) >> 3;
+    const int byte1 = ((x1 + 1) * splashAASize - 1) >> 3;
+    for (int i = 0; i < splashAASize; ++i) {
+        memset(aaBuf->getDataPtr() + i * aaBuf->getRowSize() + byte0, 0xff, byte1 - byte0 + 1);
+    }
+    setAABufDirty(x0, x1);
+    state->clip->clipAALineToPaths(aaBuf, &clipX0, &clipX1, y);
+#if splashAASize == 4
+    p0 = aaBuf->getDataPtr() + (x0 >> 1);
+    p1 = p0 + aaBuf->getRowSize();
+    p2 = p1 + aaBuf->getRowSize();
+    p3 = p2 + aaBuf->getRowSize();
+#endif
+    for (x = x0; x <= x1; ++x) {
+#if splashAASize == 4
+        if (x & 1) {
+            t = bitCount4[*p0 & 0x0f] + bitCount4[*p1 & 0x0f] + bitCount4[*p2 & 0x0f] + bitCount4[*p3 & 0x0f];
+            ++p0;
+            ++p1;
+            ++p2;
+            ++p3;
+        } else {
+            t = bitCount4[*p0 >> 4] + bitCount4[*p1 >> 4] + bitCount4[*p2 >> 4] + bitCount4[*p3 >> 4];
+        }
+#else
+        t = 0;
+        for (yy = 0; yy < splashAASize; ++yy) {
+            for (xx = 0; xx < splashAASize; ++xx) {
+                p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize() + ((x * splashAASize + xx) >> 3);
+                t += (*p >> (7 - ((x * splashAASize + xx) & 7))) & 1;
+            }
+        }
+#endif
+        c = (*coverage++ * t + (splashAASize * splashAASize) / 2) / (splashAASize * splashAASize);
+        if (c != 0) {
+            pipe->shape = aaAreaGamma[c];
+            (this->*pipe->run)(pipe);
+        } else {
+            pipeIncX(pipe);
+        }
+    }
+}
+
 //------------------------------------------------------------------------
 
 // Transform a point from user space to device space.
@@ -1455,11 +1556,17 @@ Splash::Splash(SplashBitmap *bitmapA, bool vectorAntialiasA, SplashScreenParams
         for (i = 0; i <= splashAASize * splashAASize; ++i) {
             aaGamma[i] = (unsigned char)splashRound(splashPow((SplashCoord)i / (SplashCoord)(splashAASize * splashAASize), splashAAGamma) * 255);
         }
+        for (i = 0; i < 256; ++i) {
+            aaAreaGamma[i] = (unsigned char)splashRound(splashPow((SplashCoord)i / 255, splashAAGamma) * 255);
+        }
+        aaBufDirtyMin = 0;
+        aaBufDirtyMax = aaBuf->getRowSize() - 1;
     } else {
         aaBuf = nullptr;
     }
     minLineWidth = 0;
     thinLineMode = splashThinLineDefault;
+    analyticAntialias = false;
     debugMode = false;
     alpha0Bitmap = nullptr;
 }
@@ -1477,11 +1584,17 @@ Splash::Splash(SplashBitmap *bitmapA, bool vectorAntialiasA, SplashScreen *scree
         for (i = 0; i <= splashAASize * splashAASize; ++i) {
             aaGamma[i] = (unsigned char)splashRound(splashPow((SplashCoord)i / (SplashCoord)(splashAASize * splashAASize), splashAAGamma) * 255);
         }
+        for (i = 0; i < 256; ++i) {
+            aaAreaGamma[i] = (unsigned char)splashRound(splashPow((SplashCoord)i / 255, splashAAGamma) * 255);
+        }
+        aaBufDirtyMin = 0;
+        aaBufDirtyMax = aaBuf->getRowSize() - 1;
     } else {
         aaBuf = nullptr;
     }
     minLineWidth = 0;
     thinLineMode = splashThinLineDefault;
+    analyticAntialias = false;
     debugMode = false;
     alpha0Bitmap = nullptr;
 }
@@ -2370,6 +2483,31 @@ SplashError Splash::fillWithPattern(SplashPath *path, bool eo, SplashPattern *pa
     }
 
     SplashXPath xPath(path, state->matrix, state->flatness, true, adjustLine, linePosI);
+
+    if (vectorAntialias && !inShading && analyticAntialias && thinLineMode == splashThinLineDefault) {
+        xPath.sort();
+        SplashAreaScanner scanner(xPath, eo, state->clip->getXMin(), state->clip->getYMin(), state->clip->getXMax(), state->clip->getYMax());
+        scanner.getBBox(&xMinI, &yMinI, &xMaxI, &yMaxI);
+        if (xMinI > xMaxI || yMinI > yMaxI) {
+            opClipRes = splashClipAllOutside;
+            return splashOk;
+        }
+        if ((clipRes = state->clip->testRect(xMinI, yMinI, xMaxI, yMaxI)) != splashClipAllOutside) {
+            // the scanner has already intersected the path with the clip
+            // rectangle, only the clip paths are left
+            const bool clipToPaths = clipRes != splashClipAllInside && state->clip->getNumPaths() > 0;
+            pipeInit(&pipe, 0, yMinI, pattern, nullptr, (unsigned char)splashRound(alpha * 255), true, false);
+            for (y = yMinI; y <= yMaxI; ++y) {
+                const unsigned char *coverage = scanner.renderLine(y, &x0, &x1);
+                if (coverage) {
+                    drawAreaLine(&pipe, coverage, x0, x1, y, clipToPaths);
+                }
+            }
+        }
+        opClipRes = clipRes;
+        return splashOk;
+    }
+
     if (vectorAntialias && !inShading) {
         xPath.aaScale();
     }
@@ -2380,7 +2518,7 @@ SplashError Splash::fillWithPattern(SplashPath *path, bool eo, SplashPattern *pa
         yMinI = yMinI * splashAASize;
         yMaxI = (yMaxI + 1) * splashAASize - 1;
     }
-    SplashXPathScanner scanner(xPath, eo, yMinI, yMaxI);
+    SplashXPathScanner scanner(xPath, eo, yMinI, yMaxI, &scannerStorage);
 
     // get the min and max x and y values
     if (vectorAntialias && !inShading) {
@@ -2410,7 +2548,9 @@ SplashError Splash::fillWithPattern(SplashPath *path, bool eo, SplashPattern *pa
         // draw the spans
         if (vectorAntialias && !inShading) {
             for (y = yMinI; y <= yMaxI; ++y) {
+                clearAABuf();
                 scanner.renderAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
+                setAABufDirty(x0, x1);
                 if (clipRes != splashClipAllInside) {
                     state->clip->clipAALine(aaBuf, &x0, &x1, y, thinLineMode != splashThinLineDefault && xMinI == xMaxI);
                 }
@@ -2531,7 +2671,7 @@ SplashError Splash::xorFill(SplashPath *path, bool eo)
     }
     SplashXPath xPath(path, state->matrix, state->flatness, true);
     xPath.sort();
-    SplashXPathScanner scanner(xPath, eo, state->clip->getYMinI(), state->clip->getYMaxI());
+    SplashXPathScanner scanner(xPath, eo, state->clip->getYMinI(), state->clip->getYMaxI(), &scannerStorage);
 
     // get the min and max x and y values
     scanner.getBBox(&xMinI, &yMinI, &xMaxI, &yMaxI);
@@ -5425,13 +5565,21 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
         bitmapAlpha = blitTarget->getAlphaPtr();
 
         // initialisation seems to be necessary:
-        const int S = bitmap->getWidth() * bitmap->getHeight();
-        for (int i = 0; i < S; ++i) {
-            bitmapAlpha[i] = 0;
-        }
+        memset(bitmapAlpha, 0, bitmap->getWidth() * bitmap->getHeight());
         hasAlpha = true;
     }
 
+    // the area covered by the triangles, so that only that part of
+    // blitTarget is composited at the end
+    int drawnXMin = bitmap->getWidth(), drawnYMin = bitmap->getHeight();
+    int drawnXMax = -1, drawnYMax = -1;
+    auto addDrawnArea = [&](const int *xs, const int *ys) {
+        drawnXMin = std::min({ drawnXMin, xs[0], xs[1], xs[2] });
+        drawnXMax = std::max({ drawnXMax, xs[0], xs[1], xs[2] });
+        drawnYMin = std::min({ drawnYMin, ys[0], ys[1], ys[2] });
+        drawnYMax = std::max({ drawnYMax, ys[0], ys[1], ys[2] });
+    };
+
     if (shading->isParameterized()) {
         double color[3];
         double scanLimitMapL[2] = { 0., 0. };
@@ -5493,6 +5641,7 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
             if ((x[0] - x[2]) * (y[1] - y[2]) - (x[1] - x[2]) * (y[0] - y[2]) == 0) {
                 continue; // degenerate triangle.
             }
+            addDrawnArea(x, y);
 
             // this here initialises the scanline generation.
             // We start with low Y coordinates and sweep up to the large Y
@@ -5602,12 +5751,10 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
                 double colorinterp = scanColorMap0 * scanLimitL + scanColorMap1;
 
                 int bitmapOff = scanLineOff + scanLimitL * colorComps;
-                if (likely(bitmapOff >= 0)) {
+                const SplashClipResult spanClip = clip->testSpan(scanLimitL, scanLimitR, Y);
+                if (likely(bitmapOff >= 0) && spanClip != splashClipAllOutside) {
                     for (int X = scanLimitL; X <= scanLimitR && bitmapOff + colorComps <= bitmapOffLimit; ++X, colorinterp += scanColorMap0, bitmapOff += colorComps) {
-                        // FIXME : standard rectangular clipping can be done for a
-                        // complete scanline which is faster
-                        // --> see SplashClip and its methods
-                        if (!clip->test(X, Y)) {
+                        if (spanClip != splashClipAllInside && !clip->test(X, Y)) {
                             continue;
                         }
 
@@ -5628,15 +5775,17 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
         }
     } else {
         SplashColor color, auxColor1, auxColor2;
+        double colorPlane[splashMaxColorComps][3];
         double scanLimitMapL[2] = { 0., 0. };
         double scanLimitMapR[2] = { 0., 0. };
         int scanEdgeL[2] = { 0, 0 };
         int scanEdgeR[2] = { 0, 0 };
 
         for (int i = 0; i < shading->getNTriangles(); ++i) {
-            // Sadly this current algorithm only supports shadings where the three triangle vertices have the same color
+            // Unless the shading interpolates colors, only triangles whose three vertices have the same color are supported
             shading->getNonParametrizedTriangle(i, bitmapMode, xdbl + 0, ydbl + 0, (SplashColorPtr)&color, xdbl + 1, ydbl + 1, (SplashColorPtr)&auxColor1, xdbl + 2, ydbl + 2, (SplashColorPtr)&auxColor2);
-            if (!splashColorEqual(color, auxColor1) || !splashColorEqual(color, auxColor2)) {
+            const bool flat = splashColorEqual(color, auxColor1) && splashColorEqual(color, auxColor2);
+            if (!flat && !shading->interpolatesColors()) {
                 if (!bDirectBlit) {
                     delete blitTarget;
                 }
@@ -5652,6 +5801,21 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
                 x[m] = splashRound(xt);
                 y[m] = splashRound(yt);
             }
+            // the colors are linear in the pixel coordinates:
+            // c = colorPlane[k][0] * X + colorPlane[k][1] * Y + colorPlane[k][2]
+            if (!flat) {
+                const double det = double(x[0] - x[2]) * (y[1] - y[2]) - double(x[1] - x[2]) * (y[0] - y[2]);
+                if (det == 0) {
+                    continue; // degenerate triangle.
+                }
+                for (int k = 0; k < colorComps; ++k) {
+                    const double dc0 = double(color[k]) - auxColor2[k];
+                    const double dc1 = double(auxColor1[k]) - auxColor2[k];
+                    colorPlane[k][0] = (dc0 * (y[1] - y[2]) - dc1 * (y[0] - y[2])) / det;
+                    colorPlane[k][1] = (dc1 * (x[0] - x[2]) - dc0 * (x[1] - x[2])) / det;
+                    colorPlane[k][2] = auxColor2[k] - colorPlane[k][0] * x[2] - colorPlane[k][1] * y[2];
+                }
+            }
             // sort according to y coordinate to simplify sweep through scanlines:
             // INSERTION SORT.
             if (y[0] > y[1]) {
@@ -5686,6 +5850,7 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
             if ((x[0] - x[2]) * (y[1] - y[2]) - (x[1] - x[2]) * (y[0] - y[2]) == 0) {
                 continue; // degenerate triangle.
             }
+            addDrawnArea(x, y);
 
             // this here initialises the scanline generation.
             // We start with low Y coordinates and sweep up to the large Y
@@ -5770,19 +5935,24 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
                 assert(scanLineOff == Y * rowSize);
 
                 int bitmapOff = scanLineOff + scanLimitL * colorComps;
-                if (likely(bitmapOff >= 0)) {
+                const SplashClipResult spanClip = clip->testSpan(scanLimitL, scanLimitR, Y);
+                if (likely(bitmapOff >= 0) && spanClip != splashClipAllOutside) {
                     for (int X = scanLimitL; X <= scanLimitR && bitmapOff + colorComps <= bitmapOffLimit; ++X, bitmapOff += colorComps) {
-                        // FIXME : standard rectangular clipping can be done for a
-                        // complete scanline which is faster
-                        // --> see SplashClip and its methods
-                        if (!clip->test(X, Y)) {
+                        if (spanClip != splashClipAllInside && !clip->test(X, Y)) {
                             continue;
                         }
 
                         assert(bitmapOff == Y * rowSize + colorComps * X && scanLineOff == Y * rowSize);
 
-                        for (int k = 0; k < colorComps; ++k) {
-                            bitmapData[bitmapOff + k] = color[k];
+                        if (flat) {
+                            for (int k = 0; k < colorComps; ++k) {
+                                bitmapData[bitmapOff + k] = color[k];
+                            }
+                        } else {
+                            for (int k = 0; k < colorComps; ++k) {
+                                const double c = colorPlane[k][0] * X + colorPlane[k][1] * Y + colorPlane[k][2];
+                                bitmapData[bitmapOff + k] = (unsigned char)splashRound(std::clamp(c, 0., 255.));
+                            }
                         }
 
                         // make the shading visible.
@@ -5800,24 +5970,40 @@ bool Splash::gouraudTriangleShadedFill(SplashGouraudColor *shading)
     if (!bDirectBlit) {
         // ok. Finalize the stuff by blitting the shading into the final
         // geometry, this time respecting the rendering pipe.
-        const int W = blitTarget->getWidth();
-        const int H = blitTarget->getHeight();
+        // Go row by row, drawAAPixel() sets up the clip mask for a
+        // whole row at once.
+        const int xMin = std::max(drawnXMin, 0);
+        const int xMax = std::min(drawnXMax, blitTarget->getWidth() - 1);
+        const int yMin = std::max(drawnYMin, 0);
+        const int yMax = std::min(drawnYMax, blitTarget->getHeight() - 1);
         SplashColorPtr cur = cSrcVal;
 
-        for (int X = 0; X < W; ++X) {
-            for (int Y = 0; Y < H; ++Y) {
+        for (int Y = yMin; Y <= yMax; ++Y) {
+            for (int X = xMin; X <= xMax; ++X) {
                 if (!bitmapAlpha[Y * bitmapWidth + X]) {
                     continue; // draw only parts of the shading!
                 }
-                const int bitmapOff = Y * rowSize + colorComps * X;
-
-                for (int m = 0; m < colorComps; ++m) {
-                    cur[m] = bitmapData[bitmapOff + m];
+                // the run of drawn pixels starting here; inside the clip
+                // region it is drawn as a span
+                int runEnd = X;
+                while (runEnd < xMax && bitmapAlpha[Y * bitmapWidth + runEnd + 1]) {
+                    ++runEnd;
                 }
-                if (vectorAntialias) {
-                    drawAAPixel(&pipe, X, Y);
-                } else {
-                    drawPixel(&pipe, X, Y, true); // no clipping - has already been done.
+                const bool noAAClip = !vectorAntialias || state->clip->testSpan(X, runEnd, Y) == splashClipAllInside;
+                if (noAAClip) {
+                    pipeSetXY(&pipe, X, Y);
+                }
+                for (; X <= runEnd; ++X) {
+                    const int bitmapOff = Y * rowSize + colorComps * X;
+
+                    for (int m = 0; m < colorComps; ++m) {
+                        cur[m] = bitmapData[bitmapOff + m];
+                    }
+                    if (noAAClip) {
+                        (this->*pipe.run)(&pipe); // no clipping - has already been done.
+                    } else {
+                        drawAAPixel(&pipe, X, Y);
+                    }
                 }
             }
         }
@@ -6381,7 +6567,7 @@ SplashError Splash::shadedFill(SplashPath *path, bool hasBBox, SplashPattern *pa
         yMinI = yMinI * splashAASize;
         yMaxI = (yMaxI + 1) * splashAASize - 1;
     }
-    SplashXPathScanner scanner(xPath, false, yMinI, yMaxI);
+    SplashXPathScanner scanner(xPath, false, yMinI, yMaxI, &scannerStorage);
 
     // get the min and max x and y values
     if (vectorAntialias) {
@@ -6406,7 +6592,9 @@ SplashError Splash::shadedFill(SplashPath *path, bool hasBBox, SplashPattern *pa
         // draw the spans
         if (vectorAntialias) {
             for (y = yMinI; y <= yMaxI; ++y) {
+                clearAABuf();
                 scanner.renderAALine(aaBuf, &x0, &x1, y);
+                setAABufDirty(x0, x1);
                 if (clipRes != splashClipAllInside) {
                     state->clip->clipAALine(aaBuf, &x0, &x1, y);
                 }
@@ -31,6 +31,7 @@
 #include "SplashTypes.h"
 #include "SplashClip.h"
 #include "SplashPattern.h"
+#include "SplashXPathScanner.h"
 #include "poppler_private_export.h"
 
 class SplashBitmap;
@@ -234,6 +235,12 @@ public:
     void setThinLineMode(SplashThinLineMode thinLineModeA) { thinLineMode = thinLineModeA; }
     SplashThinLineMode getThinLineMode() { return thinLineMode; }
 
+    // Setter/Getter for analytic anti-aliasing: with vector
+    // anti-aliasing on, compute the exact area of each pixel covered by
+    // a filled path instead of supersampling it.
+    void setAnalyticAntialias(bool aaa) { analyticAntialias = aaa; }
+    bool getAnalyticAntialias() { return analyticAntialias; }
+
     // Get clipping status for the last drawing operation subject to
     // clipping.
     SplashClipResult getClipRes() { return opClipRes; }
@@ -279,6 +286,9 @@ private:
     void drawAAPixel(SplashPipe *pipe, int x, int y);
     void drawSpan(SplashPipe *pipe, int x0, int x1, int y, bool noClip);
     void drawAALine(SplashPipe *pipe, int x0, int x1, int y, bool adjustLine = false, unsigned char lineOpacity = 0);
+    void drawAreaLine(SplashPipe *pipe, const unsigned char *coverage, int x0, int x1, int y, bool clipToPaths);
+    void clearAABuf();
+    void setAABufDirty(int x0, int x1);
     void transform(const SplashCoord *matrix, SplashCoord xi, SplashCoord yi, SplashCoord *xo, SplashCoord *yo);
     void strokeNarrow(SplashPath *path);
     void strokeWide(SplashPath *path, SplashCoord w);
@@ -319,14 +329,19 @@ private:
     SplashState *state;
     SplashBitmap *aaBuf;
     int aaBufY;
+    int aaBufDirtyMin, aaBufDirtyMax; // bytes of the aaBuf rows which may
+                                      //   not be zero
     SplashBitmap *alpha0Bitmap; // for non-isolated groups, this is the
                                 //   bitmap containing the alpha0 values
     int alpha0X, alpha0Y; // offset within alpha0Bitmap
     SplashCoord aaGamma[splashAASize * splashAASize + 1];
+    unsigned char aaAreaGamma[256];
+    SplashXPathScanner::Storage scannerStorage; // reused by the fill scanners
     SplashCoord minLineWidth;
     SplashThinLineMode thinLineMode;
     SplashClipResult opClipRes;
     bool vectorAntialias;
+    bool analyticAntialias;
     bool inShading;
     bool debugMode;
 };
@@ -0,0 +1,244 @@
+//========================================================================
+//
+// SplashAreaScanner.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+// To see a description of the changes please see the Changelog file that
+// came with your tarball or type make ChangeLog if you are building from git
+//
+//========================================================================
+
+#include <config.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include "goo/GooLikely.h"
+#include "SplashMath.h"
+#include "SplashXPath.h"
+#include "SplashAreaScanner.h"
+
+//------------------------------------------------------------------------
+// SplashAreaScanner
+//------------------------------------------------------------------------
+
+SplashAreaScanner::SplashAreaScanner(const SplashXPath &xPath, bool eoA, SplashCoord clipXMin, SplashCoord clipYMin, SplashCoord clipXMax, SplashCoord clipYMax)
+{
+    SplashCoord xMinFP = 0, yMinFP = 0, xMaxFP = 0, yMaxFP = 0;
+
+    eo = eoA;
+    xMin = yMin = 1;
+    xMax = yMax = 0;
+    clipX0 = clipX1 = 0;
+    nextEdge = 0;
+    cellMin = INT_MAX;
+    cellMax = -1;
+
+    // convert the segments to edges going down, limited to the clip
+    // rectangle's y range, and compute the bbox
+    edges.reserve(xPath.length);
+    for (int i = 0; i < xPath.length; ++i) {
+        const SplashXPathSeg *seg = &xPath.segs[i];
+        if (unlikely(std::isnan(seg->x0) || std::isnan(seg->x1) || std::isnan(seg->y0) || std::isnan(seg->y1))) {
+            edges.clear();
+            return;
+        }
+        if (i == 0) {
+            xMinFP = std::min(seg->x0, seg->x1);
+            xMaxFP = std::max(seg->x0, seg->x1);
+            yMinFP = std::min(seg->y0, seg->y1);
+            yMaxFP = std::max(seg->y0, seg->y1);
+        } else {
+            xMinFP = std::min(xMinFP, std::min(seg->x0, seg->x1));
+            xMaxFP = std::max(xMaxFP, std::max(seg->x0, seg->x1));
+            yMinFP = std::min(yMinFP, std::min(seg->y0, seg->y1));
+            yMaxFP = std::max(yMaxFP, std::max(seg->y0, seg->y1));
+        }
+        if (seg->flags & splashXPathHoriz) {
+            continue;
+        }
+        Edge edge;
+        SplashCoord yBottom;
+        if (seg->flags & splashXPathFlip) {
+            edge.x0 = seg->x1;
+            edge.y0 = seg->y1;
+            yBottom = seg->y0;
+            edge.dir = -1;
+        } else {
+            edge.x0 = seg->x0;
+            edge.y0 = seg->y0;
+            yBottom = seg->y1;
+            edge.dir = 1;
+        }
+        if (yBottom <= clipYMin || edge.y0 >= clipYMax) {
+            continue;
+        }
+        edge.dxdy = (seg->flags & splashXPathVert) ? 0 : seg->dxdy;
+        if (edge.y0 < clipYMin) {
+            edge.x0 += (clipYMin - edge.y0) * edge.dxdy;
+            edge.y0 = clipYMin;
+        }
+        edge.y1 = std::min(yBottom, clipYMax);
+        edges.push_back(edge);
+    }
+
+    if (edges.empty()) {
+        return;
+    }
+    xMinFP = std::max(xMinFP, clipXMin);
+    xMaxFP = std::min(xMaxFP, clipXMax);
+    yMinFP = std::max(yMinFP, clipYMin);
+    yMaxFP = std::min(yMaxFP, clipYMax);
+    if (xMinFP >= xMaxFP || yMinFP >= yMaxFP) {
+        edges.clear();
+        return;
+    }
+    xMin = splashFloor(xMinFP);
+    xMax = splashCeil(xMaxFP) - 1;
+    yMin = splashFloor(yMinFP);
+    yMax = splashCeil(yMaxFP) - 1;
+    clipX0 = std::max(clipXMin, (SplashCoord)xMin);
+    clipX1 = std::min(clipXMax, (SplashCoord)(xMax + 1));
+
+    // two extra cells, for edges on the right border
+    cells.assign(xMax - xMin + 3, 0);
+    line.resize(xMax - xMin + 1);
+}
+
+const unsigned char *SplashAreaScanner::renderLine(int y, int *x0, int *x1)
+{
+    if (y < yMin || y > yMax) {
+        return nullptr;
+    }
+
+    const SplashCoord yTop = y;
+    const SplashCoord yBottom = y + 1;
+    while (nextEdge < edges.size() && edges[nextEdge].y0 < yBottom) {
+        active.push_back(nextEdge++);
+    }
+    for (size_t i = 0; i < active.size();) {
+        const Edge &edge = edges[active[i]];
+        if (edge.y1 <= yTop) {
+            active[i] = active.back();
+            active.pop_back();
+            continue;
+        }
+        const SplashCoord ya = std::max(edge.y0, yTop);
+        const SplashCoord yb = std::min(edge.y1, yBottom);
+        if (yb > ya) {
+            addLine(edge.x0 + (ya - edge.y0) * edge.dxdy, ya - yTop, edge.x0 + (yb - edge.y0) * edge.dxdy, yb - yTop, edge.dir);
+        }
+        ++i;
+    }
+    if (cellMax < cellMin) {
+        return nullptr;
+    }
+
+    // sum up the cells, clearing them for the next line; the coverage
+    // only changes where a cell is non-zero
+    const int lastPixel = std::min(cellMax, xMax - xMin);
+    int first = -1, last = -1;
+    SplashCoord acc = 0;
+    unsigned char c = 0;
+    for (int i = cellMin; i <= lastPixel; ++i) {
+        if (cells[i] != 0) {
+            acc += cells[i];
+            cells[i] = 0;
+            SplashCoord coverage = std::abs(acc);
+            if (eo) {
+                coverage = std::fmod(coverage, (SplashCoord)2);
+                if (coverage > 1) {
+                    coverage = 2 - coverage;
+                }
+            } else if (coverage > 1) {
+                coverage = 1;
+            }
+            c = (unsigned char)(coverage * 255 + 0.5);
+        }
+        line[i] = c;
+        if (c) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    for (int i = lastPixel + 1; i <= cellMax; ++i) {
+        cells[i] = 0;
+    }
+    cellMin = INT_MAX;
+    cellMax = -1;
+
+    if (first < 0) {
+        return nullptr;
+    }
+    *x0 = xMin + first;
+    *x1 = xMin + last;
+    return &line[first];
+}
+
+// Adds the part of an edge between <ya> and <yb> (relative to the
+// current line, 0 <= ya <= yb <= 1).  Parts left or right of the clip
+// rectangle are moved onto its border, which intersects the path
+// with the rectangle.
+void SplashAreaScanner::addLine(SplashCoord xa, SplashCoord ya, SplashCoord xb, SplashCoord yb, SplashCoord dir)
+{
+    for (const SplashCoord border : { clipX0, clipX1 }) {
+        if ((xa < border && xb > border) || (xa > border && xb < border)) {
+            const SplashCoord ym = ya + (border - xa) * (yb - ya) / (xb - xa);
+            addLine(xa, ya, border, ym, dir);
+            addLine(border, ym, xb, yb, dir);
+            return;
+        }
+    }
+    accumulate(std::clamp(xa, clipX0, clipX1), ya, std::clamp(xb, clipX0, clipX1), yb, dir);
+}
+
+// Adds the signed area between the line and the right end of the scan
+// line to the cells: a cell gets the part of the area inside its own
+// pixel, minus what the cells left of it already account for.
+void SplashAreaScanner::accumulate(SplashCoord xa, SplashCoord ya, SplashCoord xb, SplashCoord yb, SplashCoord dir)
+{
+    const SplashCoord d = (yb - ya) * dir;
+    if (d == 0) {
+        return;
+    }
+    xa -= xMin;
+    xb -= xMin;
+    const SplashCoord x0 = std::min(xa, xb);
+    const SplashCoord x1 = std::max(xa, xb);
+    const SplashCoord x0Floor = std::floor(x0);
+    const SplashCoord x1Ceil = std::ceil(x1);
+    const int x0i = (int)x0Floor;
+    const int x1i = (int)x1Ceil;
+
+    if (x1i <= x0i + 1) {
+        // within a single pixel: the average distance to the pixel's
+        // right edge is all that matters
+        const SplashCoord xMid = (SplashCoord)0.5 * (xa + xb) - x0Floor;
+        cells[x0i] += d - d * xMid;
+        cells[x0i + 1] += d * xMid;
+    } else {
+        const SplashCoord s = 1 / (x1 - x0);
+        const SplashCoord x0Frac = x0 - x0Floor;
+        const SplashCoord a0 = (SplashCoord)0.5 * s * (1 - x0Frac) * (1 - x0Frac);
+        const SplashCoord x1Frac = x1 - x1Ceil + 1;
+        const SplashCoord am = (SplashCoord)0.5 * s * x1Frac * x1Frac;
+        cells[x0i] += d * a0;
+        if (x1i == x0i + 2) {
+            cells[x0i + 1] += d * (1 - a0 - am);
+        } else {
+            const SplashCoord a1 = s * ((SplashCoord)1.5 - x0Frac);
+            cells[x0i + 1] += d * (a1 - a0);
+            for (int xi = x0i + 2; xi < x1i - 1; ++xi) {
+                cells[xi] += d * s;
+            }
+            const SplashCoord a2 = a1 + (x1i - x0i - 3) * s;
+            cells[x1i - 1] += d * (1 - a2 - am);
+        }
+        cells[x1i] += d * am;
+    }
+    cellMin = std::min(cellMin, x0i);
+    cellMax = std::max(cellMax, std::max(x0i + 1, x1i));
+}
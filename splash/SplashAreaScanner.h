@@ -0,0 +1,84 @@
+//========================================================================
+//
+// SplashAreaScanner.h
+//
+// This file is licensed under the GPLv2 or later
+//
+// To see a description of the changes please see the Changelog file that
+// came with your tarball or type make ChangeLog if you are building from git
+//
+//========================================================================
+
+#ifndef SPLASHAREASCANNER_H
+#define SPLASHAREASCANNER_H
+
+#include "SplashTypes.h"
+
+#include <vector>
+
+class SplashXPath;
+
+//------------------------------------------------------------------------
+// SplashAreaScanner
+//------------------------------------------------------------------------
+
+// Computes the exact area of each pixel covered by a path, one scan
+// line at a time, as an alternative to supersampling with
+// SplashXPathScanner::renderAALine.  Every edge adds its signed area
+// to the cells it crosses, and a running sum along the line turns
+// those into coverage.  Where subpaths overlap inside a pixel the
+// winding numbers are averaged over the pixel, as with other
+// accumulation rasterizers.
+class SplashAreaScanner
+{
+public:
+    // Create a new SplashAreaScanner object.  <xPath> must be sorted,
+    // and not scaled by aaScale().  The path is intersected with the
+    // clip rectangle (<clipXMin>, <clipYMin>) - (<clipXMax>,
+    // <clipYMax>).
+    SplashAreaScanner(const SplashXPath &xPath, bool eoA, SplashCoord clipXMin, SplashCoord clipYMin, SplashCoord clipXMax, SplashCoord clipYMax);
+
+    SplashAreaScanner(const SplashAreaScanner &) = delete;
+    SplashAreaScanner &operator=(const SplashAreaScanner &) = delete;
+
+    // Return the bounding box of the clipped path, in pixels.  It is
+    // empty (xMin > xMax) if nothing is covered.
+    void getBBox(int *xMinA, int *yMinA, int *xMaxA, int *yMaxA) const
+    {
+        *xMinA = xMin;
+        *yMinA = yMin;
+        *xMaxA = xMax;
+        *yMaxA = yMax;
+    }
+
+    // Computes the coverage of line <y>.  Lines must be rendered in
+    // increasing order.  Returns the coverage (0 = none, 255 = full)
+    // of pixels <x0> to <x1>, with the first value for <x0>, or
+    // nullptr if nothing on the line is covered.  The values stay
+    // valid until the next call.
+    const unsigned char *renderLine(int y, int *x0, int *x1);
+
+private:
+    struct Edge
+    {
+        SplashCoord x0, y0; // top endpoint
+        SplashCoord y1; // bottom y
+        SplashCoord dxdy;
+        SplashCoord dir; // 1 if the edge goes down, -1 if up
+    };
+
+    void addLine(SplashCoord xa, SplashCoord ya, SplashCoord xb, SplashCoord yb, SplashCoord dir);
+    void accumulate(SplashCoord xa, SplashCoord ya, SplashCoord xb, SplashCoord yb, SplashCoord dir);
+
+    bool eo;
+    int xMin, yMin, xMax, yMax;
+    SplashCoord clipX0, clipX1;
+    std::vector<Edge> edges; // sorted by top y
+    size_t nextEdge; // first edge not added to <active> yet
+    std::vector<size_t> active;
+    std::vector<SplashCoord> cells; // signed area, for x = xMin .. xMax + 2
+    int cellMin, cellMax; // range of <cells> touched on the current line
+    std::vector<unsigned char> line;
+};
+
+#endif
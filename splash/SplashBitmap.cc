@@ -368,17 +368,30 @@ void SplashBitmap::setJpegParams(ImgWriter *writer, WriteImgParams *params)
 #endif
 }
 
-SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params)
+void SplashBitmap::setPngParams(ImgWriter *writer, WriteImgParams *params)
+{
+#ifdef ENABLE_LIBPNG
+    if (params) {
+        if (params->pngCompressionLevel >= 0) {
+            static_cast<PNGWriter *>(writer)->setCompressionLevel(params->pngCompressionLevel);
+        }
+        static_cast<PNGWriter *>(writer)->setFilter(static_cast<PNGWriter::Filter>(params->pngFilter));
+        static_cast<PNGWriter *>(writer)->setNumThreads(params->pngThreads);
+    }
+#endif
+}
+
+ImgWriter *SplashBitmap::createImgWriter(SplashImageFileFormat format, SplashColorMode mode, WriteImgParams *params, SplashColorMode *imageWriterFormat)
 {
     ImgWriter *writer;
-    SplashError e;
 
-    SplashColorMode imageWriterFormat = splashModeRGB8;
+    *imageWriterFormat = splashModeRGB8;
 
     switch (format) {
 #ifdef ENABLE_LIBPNG
     case splashFormatPng:
         writer = new PNGWriter();
+        setPngParams(writer, params);
         break;
 #endif
 
@@ -398,11 +411,11 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
         switch (mode) {
         case splashModeMono1:
             writer = new TiffWriter(TiffWriter::MONOCHROME);
-            imageWriterFormat = splashModeMono1;
+            *imageWriterFormat = splashModeMono1;
             break;
         case splashModeMono8:
             writer = new TiffWriter(TiffWriter::GRAY);
-            imageWriterFormat = splashModeMono8;
+            *imageWriterFormat = splashModeMono8;
             break;
         case splashModeRGB8:
         case splashModeBGR8:
@@ -426,10 +439,21 @@ SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, do
         // Not the greatest error message, but users of this function should
         // have already checked whether their desired format is compiled in.
         error(errInternal, -1, "Support for this image type not compiled in");
+        return nullptr;
+    }
+
+    return writer;
+}
+
+SplashError SplashBitmap::writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params)
+{
+    SplashColorMode imageWriterFormat;
+    ImgWriter *writer = createImgWriter(format, mode, params, &imageWriterFormat);
+    if (!writer) {
         return splashErrGeneric;
     }
 
-    e = writeImgFile(writer, f, hDPI, vDPI, imageWriterFormat);
+    SplashError e = writeImgFile(writer, f, hDPI, vDPI, imageWriterFormat);
     delete writer;
     return e;
 }
@@ -664,6 +688,20 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
         return splashErrGeneric;
     }
 
+    const SplashError e = writeImgRows(writer, imageWriterFormat);
+    if (e != splashOk) {
+        return e;
+    }
+
+    if (!writer->close()) {
+        return splashErrGeneric;
+    }
+
+    return splashOk;
+}
+
+SplashError SplashBitmap::writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat)
+{
     switch (mode) {
     case splashModeCMYK8:
         if (writer->supportCMYK()) {
@@ -842,11 +880,7 @@ SplashError SplashBitmap::writeImgFile(ImgWriter *writer, FILE *f, double hDPI,
     } break;
 
     default:
-        // can't happen
-        break;
-    }
-
-    if (!writer->close()) {
+        error(errInternal, -1, "unsupported SplashBitmap mode");
         return splashErrGeneric;
     }
 
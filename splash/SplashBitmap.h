@@ -84,12 +84,26 @@ public:
         bool jpegProgressive = false;
         std::string tiffCompression;
         bool jpegOptimize = false;
+        int pngCompressionLevel = -1; // 0-9, -1 for the default
+        int pngFilter = 0; // a PNGWriter::Filter
+        int pngThreads = 1;
     };
 
     SplashError writeImgFile(SplashImageFileFormat format, const char *fileName, double hDPI, double vDPI, WriteImgParams *params = nullptr);
     SplashError writeImgFile(SplashImageFileFormat format, FILE *f, double hDPI, double vDPI, WriteImgParams *params = nullptr);
     SplashError writeImgFile(ImgWriter *writer, FILE *f, double hDPI, double vDPI, SplashColorMode imageWriterFormat);
 
+    // The writer writeImgFile() uses for <format> and bitmaps of color
+    // mode <mode>, and the format to pass to writeImgRows().  Returns
+    // nullptr if support for <format> is not compiled in.
+    static ImgWriter *createImgWriter(SplashImageFileFormat format, SplashColorMode mode, WriteImgParams *params, SplashColorMode *imageWriterFormat);
+
+    // Write the rows of this bitmap to <writer>, which has been
+    // initialized for an image as wide as the bitmap and at least as
+    // high.  This allows writing an image rendered in several bands, one
+    // bitmap at a time.
+    SplashError writeImgRows(ImgWriter *writer, SplashColorMode imageWriterFormat);
+
     enum ConversionMode
     {
         conversionOpaque,
@@ -123,7 +137,8 @@ private:
 
     friend class Splash;
 
-    void setJpegParams(ImgWriter *writer, WriteImgParams *params);
+    static void setJpegParams(ImgWriter *writer, WriteImgParams *params);
+    static void setPngParams(ImgWriter *writer, WriteImgParams *params);
 };
 
 #endif
@@ -22,6 +22,7 @@
 
 #include <config.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include "goo/gmem.h"
@@ -39,6 +40,235 @@
 
 #define splashClipEO 0x01 // use even-odd rule
 
+// The paths are turned into a mask once there are this many of them, or
+// once they have been tested this many times.
+#define splashClipMaskMinPaths 4
+#define splashClipMaskMinUses 256
+
+// Maximum size of a mask, in bytes.
+#define splashClipMaskMaxSize (32 << 20)
+
+//------------------------------------------------------------------------
+// SplashClipMask
+//------------------------------------------------------------------------
+
+// The intersection of the clip paths, as bits in the coordinates of the
+// scanners (i.e., supersampled when anti-aliasing), laid out like the
+// rows of aaBuf.  Each line (of splashAASize rows when anti-aliasing) is
+// only computed when it's first used.  Lines <yMin> .. <yMax> and bits
+// <xMin> .. <xMax> are covered; everything outside the intersection of
+// the paths' bboxes is known to be outside the clip, anything else
+// has to be checked with the scanners.
+class SplashClipMask
+{
+public:
+    SplashClipMask(const std::vector<std::shared_ptr<SplashXPathScanner>> &scannersA, int aaSizeA, int rectXMin, int rectYMin, int rectXMax, int rectYMax);
+
+    // Returns false if the mask is too big to be worth it.
+    bool isOk() const { return ok; }
+
+    // Clips bits <xa> .. <xb> of the aaBuf rows for line <y>.  Returns
+    // false if the mask doesn't cover them.
+    bool clipAALine(SplashBitmap *aaBuf, int xa, int xb, int y);
+
+    // Tests if bits <xa> .. <xb> of the first row of line <y> are all
+    // inside the paths.  Returns 1 if they are, 0 if not, and -1 if the
+    // mask doesn't cover them.
+    int testSpan(int xa, int xb, int y);
+
+private:
+    const unsigned char *getLine(int y);
+    bool covers(int xa, int xb) const;
+
+    std::vector<std::shared_ptr<SplashXPathScanner>> scanners;
+    int aaSize;
+    bool ok;
+    bool empty; // the paths don't intersect
+    int pathXMin, pathYMin, pathXMax, pathYMax;
+    int xMin, yMin, xMax, yMax;
+    int rowSize;
+    std::vector<std::vector<unsigned char>> lines; // empty until computed
+    std::vector<std::pair<int, int>> spans, pathSpans, tmpSpans;
+};
+
+static inline int floorDiv(int x, int d)
+{
+    return x >= 0 ? x / d : -((d - 1 - x) / d);
+}
+
+SplashClipMask::SplashClipMask(const std::vector<std::shared_ptr<SplashXPathScanner>> &scannersA, int aaSizeA, int rectXMin, int rectYMin, int rectXMax, int rectYMax) : scanners(scannersA), aaSize(aaSizeA), ok(true)
+{
+    int x0, y0, x1, y1;
+
+    scanners[0]->getBBox(&pathXMin, &pathYMin, &pathXMax, &pathYMax);
+    for (size_t i = 1; i < scanners.size(); ++i) {
+        scanners[i]->getBBox(&x0, &y0, &x1, &y1);
+        pathXMin = std::max(pathXMin, x0);
+        pathYMin = std::max(pathYMin, y0);
+        pathXMax = std::min(pathXMax, x1);
+        pathYMax = std::min(pathYMax, y1);
+    }
+    empty = pathXMin > pathXMax || pathYMin > pathYMax;
+    xMin = yMin = 1;
+    xMax = yMax = 0;
+    rowSize = 0;
+    if (empty) {
+        return;
+    }
+
+    // paths may extend far beyond the clip rectangle, but only the
+    // part inside it (plus a pixel for rounding) is ever needed
+    xMin = std::max(pathXMin, (rectXMin - 1) * aaSize) & ~7;
+    xMax = std::min(pathXMax, (rectXMax + 2) * aaSize - 1);
+    yMin = std::max(floorDiv(pathYMin, aaSize), rectYMin - 1);
+    yMax = std::min(floorDiv(pathYMax, aaSize), rectYMax + 1);
+    if (xMin > xMax || yMin > yMax) {
+        // leave everything to the scanners
+        xMin = yMin = 1;
+        xMax = yMax = 0;
+        return;
+    }
+    rowSize = ((xMax - xMin) >> 3) + 1;
+    if ((double)rowSize * aaSize * (yMax - yMin + 1) > splashClipMaskMaxSize) {
+        ok = false;
+        return;
+    }
+    lines.resize(yMax - yMin + 1);
+}
+
+// Returns true if the bits <xa> .. <xb> are either covered by the mask,
+// or outside the paths' bbox.
+bool SplashClipMask::covers(int xa, int xb) const
+{
+    xa = std::max(xa, pathXMin);
+    xb = std::min(xb, pathXMax);
+    return xa > xb || (xa >= xMin && xb <= xMax);
+}
+
+const unsigned char *SplashClipMask::getLine(int y)
+{
+    std::vector<unsigned char> &line = lines[y - yMin];
+    if (!line.empty()) {
+        return line.data();
+    }
+
+    line.resize(aaSize * rowSize, 0);
+    for (int yy = 0; yy < aaSize; ++yy) {
+        const int row = y * aaSize + yy;
+        if (row < pathYMin || row > pathYMax) {
+            continue;
+        }
+
+        // intersect the spans of all the paths
+        spans.clear();
+        spans.emplace_back(xMin, xMax);
+        for (const auto &scanner : scanners) {
+            SplashXPathScanIterator iter(*scanner, row);
+            int x0, x1;
+            pathSpans.clear();
+            while (iter.getNextSpan(&x0, &x1)) {
+                pathSpans.emplace_back(x0, x1);
+            }
+            tmpSpans.clear();
+            size_t i = 0, j = 0;
+            while (i < spans.size() && j < pathSpans.size()) {
+                x0 = std::max(spans[i].first, pathSpans[j].first);
+                x1 = std::min(spans[i].second, pathSpans[j].second);
+                if (x0 <= x1) {
+                    tmpSpans.emplace_back(x0, x1);
+                }
+                if (spans[i].second < pathSpans[j].second) {
+                    ++i;
+                } else {
+                    ++j;
+                }
+            }
+            spans.swap(tmpSpans);
+            if (spans.empty()) {
+                break;
+            }
+        }
+
+        // set the bits
+        unsigned char *p = line.data() + yy * rowSize;
+        for (const auto &span : spans) {
+            const int x0 = span.first - xMin;
+            const int x1 = span.second - xMin;
+            if ((x0 >> 3) == (x1 >> 3)) {
+                p[x0 >> 3] |= (0xff >> (x0 & 7)) & (0xff00 >> ((x1 & 7) + 1));
+            } else {
+                p[x0 >> 3] |= 0xff >> (x0 & 7);
+                memset(p + (x0 >> 3) + 1, 0xff, (x1 >> 3) - (x0 >> 3) - 1);
+                p[x1 >> 3] |= 0xff00 >> ((x1 & 7) + 1);
+            }
+        }
+    }
+    return line.data();
+}
+
+bool SplashClipMask::clipAALine(SplashBitmap *aaBuf, int xa, int xb, int y)
+{
+    xa = std::max(xa, 0);
+    xb = std::min(xb, aaBuf->getWidth() - 1);
+    if (xa > xb) {
+        return true;
+    }
+    const bool outside = empty || (y + 1) * aaSize - 1 < pathYMin || y * aaSize > pathYMax;
+    if (!outside && (y < yMin || y > yMax || !covers(xa, xb))) {
+        return false;
+    }
+    const unsigned char *line = outside ? nullptr : getLine(y);
+
+    // bits of the first and last bytes which must be kept
+    const int byteMin = xa >> 3;
+    const int byteMax = xb >> 3;
+    const unsigned char keepFirst = (unsigned char)(0xff00 >> (xa & 7));
+    const unsigned char keepLast = (unsigned char)(0xff >> ((xb & 7) + 1));
+    // bytes covered by the mask
+    const int maskByteMin = outside ? 0 : std::max(byteMin, xMin >> 3);
+    const int maskByteMax = outside ? -1 : std::min(byteMax, xMax >> 3);
+
+    for (int yy = 0; yy < aaSize; ++yy) {
+        SplashColorPtr p = aaBuf->getDataPtr() + yy * aaBuf->getRowSize();
+        const unsigned char *q = outside ? nullptr : line + yy * rowSize;
+        for (int i = byteMin; i <= byteMax; ++i) {
+            unsigned char m = (i >= maskByteMin && i <= maskByteMax) ? q[i - (xMin >> 3)] : 0;
+            if (i == byteMin) {
+                m |= keepFirst;
+            }
+            if (i == byteMax) {
+                m |= keepLast;
+            }
+            p[i] &= m;
+        }
+    }
+    return true;
+}
+
+int SplashClipMask::testSpan(int xa, int xb, int y)
+{
+    if (empty || y * aaSize < pathYMin || y * aaSize > pathYMax || xa < pathXMin || xb > pathXMax) {
+        return 0;
+    }
+    if (y < yMin || y > yMax || xa < xMin || xb > xMax) {
+        return -1;
+    }
+    const unsigned char *p = getLine(y);
+    xa -= xMin;
+    xb -= xMin;
+    for (int x = xa; x <= xb; ++x) {
+        if (!(x & 7) && x + 7 <= xb) {
+            if (p[x >> 3] != 0xff) {
+                return 0;
+            }
+            x += 7;
+        } else if (!(p[x >> 3] & (0x80 >> (x & 7)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 //------------------------------------------------------------------------
 // SplashClip
 //------------------------------------------------------------------------
@@ -66,6 +296,7 @@ SplashClip::SplashClip(SplashCoord x0, SplashCoord y0, SplashCoord x1, SplashCoo
     yMaxI = splashCeil(yMax) - 1;
     flags = nullptr;
     length = size = 0;
+    maskUses = 0;
 }
 
 SplashClip::SplashClip(const SplashClip *clip)
@@ -85,6 +316,8 @@ SplashClip::SplashClip(const SplashClip *clip)
     size = clip->size;
     flags = (unsigned char *)gmallocn(size, sizeof(unsigned char));
     scanners = clip->scanners;
+    mask = clip->mask;
+    maskUses = clip->maskUses;
     for (i = 0; i < length; ++i) {
         flags[i] = clip->flags[i];
     }
@@ -114,6 +347,7 @@ void SplashClip::resetToRect(SplashCoord x0, SplashCoord y0, SplashCoord x1, Spl
     flags = nullptr;
     scanners = {};
     length = size = 0;
+    resetMask();
 
     if (x0 < x1) {
         xMin = x0;
@@ -217,6 +451,7 @@ SplashError SplashClip::clipToPath(SplashPath *path, SplashCoord *matrix, Splash
         }
         scanners.emplace_back(std::make_shared<SplashXPathScanner>(xPath, eo, yMinAA, yMaxAA));
         ++length;
+        resetMask();
     }
 
     return splashOk;
@@ -255,6 +490,12 @@ SplashClipResult SplashClip::testSpan(int spanXMin, int spanXMax, int spanY)
     if (!((SplashCoord)spanXMin >= xMin && (SplashCoord)(spanXMax + 1) <= xMax && (SplashCoord)spanY >= yMin && (SplashCoord)(spanY + 1) <= yMax)) {
         return splashClipPartial;
     }
+    if (SplashClipMask *m = getMask()) {
+        const int inside = antialias ? m->testSpan(spanXMin * splashAASize, spanXMax * splashAASize + (splashAASize - 1), spanY) : m->testSpan(spanXMin, spanXMax, spanY);
+        if (inside >= 0) {
+            return inside ? splashClipAllInside : splashClipPartial;
+        }
+    }
     if (antialias) {
         for (i = 0; i < length; ++i) {
             if (!scanners[i]->testSpan(spanXMin * splashAASize, spanXMax * splashAASize + (splashAASize - 1), spanY * splashAASize)) {
@@ -273,7 +514,7 @@ SplashClipResult SplashClip::testSpan(int spanXMin, int spanXMax, int spanY)
 
 void SplashClip::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, bool adjustVertLine)
 {
-    int xx0, xx1, xx, yy, i;
+    int xx0, xx1, xx, yy;
     SplashColorPtr p;
 
     // zero out pixels with x < xMin
@@ -319,9 +560,7 @@ void SplashClip::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, bool a
     }
 
     // check the paths
-    for (i = 0; i < length; ++i) {
-        scanners[i]->clipAALine(aaBuf, x0, x1, y);
-    }
+    clipAALineToPaths(aaBuf, x0, x1, y);
     if (*x0 > *x1) {
         *x0 = *x1;
     }
@@ -347,8 +586,26 @@ void SplashClip::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, bool a
     }
 }
 
+void SplashClip::clipAALineToPaths(SplashBitmap *aaBuf, int *x0, int *x1, int y)
+{
+    if (SplashClipMask *m = getMask()) {
+        if (m->clipAALine(aaBuf, *x0 * splashAASize, (*x1 + 1) * splashAASize - 1, y)) {
+            return;
+        }
+    }
+    for (int i = 0; i < length; ++i) {
+        scanners[i]->clipAALine(aaBuf, x0, x1, y);
+    }
+}
+
 bool SplashClip::testClipPaths(int x, int y)
 {
+    if (SplashClipMask *m = getMask()) {
+        const int inside = antialias ? m->testSpan(x * splashAASize, x * splashAASize, y) : m->testSpan(x, x, y);
+        if (inside >= 0) {
+            return inside;
+        }
+    }
     if (antialias) {
         x *= splashAASize;
         y *= splashAASize;
@@ -362,3 +619,26 @@ bool SplashClip::testClipPaths(int x, int y)
 
     return true;
 }
+
+SplashClipMask *SplashClip::getMask()
+{
+    if (!mask) {
+        if (length == 0 || maskUses < 0 || (length < splashClipMaskMinPaths && ++maskUses < splashClipMaskMinUses)) {
+            return nullptr;
+        }
+        mask = std::make_shared<SplashClipMask>(scanners, antialias ? splashAASize : 1, xMinI, yMinI, xMaxI, yMaxI);
+        if (!mask->isOk()) {
+            // don't try again until the paths change
+            mask.reset();
+            maskUses = -1;
+            return nullptr;
+        }
+    }
+    return mask.get();
+}
+
+void SplashClip::resetMask()
+{
+    mask.reset();
+    maskUses = 0;
+}
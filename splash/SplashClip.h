@@ -32,6 +32,7 @@ class SplashPath;
 class SplashXPath;
 class SplashXPathScanner;
 class SplashBitmap;
+class SplashClipMask;
 
 //------------------------------------------------------------------------
 
@@ -100,6 +101,10 @@ public:
     // will update <x0> and <x1>.
     void clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, bool adjustVertLine = false);
 
+    // Like clipAALine, but only clips to the arbitrary paths, not to the
+    // rectangle.
+    void clipAALineToPaths(SplashBitmap *aaBuf, int *x0, int *x1, int y);
+
     // Get the rectangle part of the clip region.
     SplashCoord getXMin() { return xMin; }
     SplashCoord getXMax() { return xMax; }
@@ -119,6 +124,8 @@ protected:
     explicit SplashClip(const SplashClip *clip);
     void grow(int nPaths);
     bool testClipPaths(int x, int y);
+    SplashClipMask *getMask();
+    void resetMask();
 
     bool antialias;
     SplashCoord xMin, yMin, xMax, yMax;
@@ -126,6 +133,11 @@ protected:
     unsigned char *flags;
     std::vector<std::shared_ptr<SplashXPathScanner>> scanners;
     int length, size;
+
+    // The intersection of the paths, built once they have been used
+    // often enough, and shared with copies until the paths change
+    std::shared_ptr<SplashClipMask> mask;
+    int maskUses;
 };
 
 #endif
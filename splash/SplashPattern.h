@@ -101,6 +101,10 @@ public:
 
     virtual void getNonParametrizedTriangle(int i, SplashColorMode mode, double *x0, double *y0, SplashColorPtr color0, double *x1, double *y1, SplashColorPtr color1, double *x2, double *y2, SplashColorPtr color2) = 0;
 
+    // Whether the colors of a non-parametrized triangle are interpolated
+    // between its vertices.  If not, the three colors must be the same.
+    virtual bool interpolatesColors() { return false; }
+
     virtual void getParameterizedColor(double t, SplashColorMode mode, SplashColorPtr c) = 0;
 };
 
@@ -88,6 +88,7 @@ protected:
     int length, size; // length and size of segs array
 
     friend class SplashXPathScanner;
+    friend class SplashAreaScanner;
     friend class SplashClip;
     friend class Splash;
 };
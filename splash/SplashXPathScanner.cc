@@ -39,7 +39,7 @@
 // SplashXPathScanner
 //------------------------------------------------------------------------
 
-SplashXPathScanner::SplashXPathScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax)
+SplashXPathScanner::SplashXPathScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax, Storage *storageA)
 {
     const SplashXPathSeg *seg;
     SplashCoord xMinFP, yMinFP, xMaxFP, yMaxFP;
@@ -47,6 +47,7 @@ SplashXPathScanner::SplashXPathScanner(const SplashXPath &xPath, bool eoA, int c
 
     eo = eoA;
     partialClip = false;
+    storage = storageA;
 
     // compute the bbox
     xMin = yMin = 1;
@@ -112,7 +113,17 @@ SplashXPathScanner::SplashXPathScanner(const SplashXPath &xPath, bool eoA, int c
     computeIntersections(xPath);
 }
 
-SplashXPathScanner::~SplashXPathScanner() { }
+SplashXPathScanner::~SplashXPathScanner()
+{
+    // hand the lines, emptied but with their allocations, back to the
+    // storage for the next scanner
+    if (storage && allIntersections.size() > storage->lines.size()) {
+        for (int y = yMin; y <= yMax; ++y) {
+            allIntersections[y - yMin].clear();
+        }
+        storage->lines = std::move(allIntersections);
+    }
+}
 
 void SplashXPathScanner::getBBoxAA(int *xMinA, int *yMinA, int *xMaxA, int *yMaxA) const
 {
@@ -236,7 +247,14 @@ void SplashXPathScanner::computeIntersections(const SplashXPath &xPath)
     }
 
     // build the list of all intersections
-    allIntersections.resize(yMax - yMin + 1);
+    // (lines left over in the storage past yMax are empty, and unused)
+    if (storage) {
+        allIntersections = std::move(storage->lines);
+        storage->lines.clear();
+    }
+    if (allIntersections.size() < (size_t)(yMax - yMin + 1)) {
+        allIntersections.resize(yMax - yMin + 1);
+    }
 
     for (i = 0; i < xPath.length; ++i) {
         seg = &xPath.segs[i];
@@ -317,7 +335,8 @@ void SplashXPathScanner::computeIntersections(const SplashXPath &xPath)
             }
         }
     }
-    for (auto &line : allIntersections) {
+    for (y = yMin; y <= yMax; ++y) {
+        auto &line = allIntersections[y - yMin];
         std::sort(line.begin(), line.end(), [](const SplashIntersect i0, const SplashIntersect i1) { return i0.x0 < i1.x0; });
     }
 }
@@ -357,7 +376,6 @@ void SplashXPathScanner::renderAALine(SplashBitmap *aaBuf, int *x0, int *x1, int
     unsigned char mask;
     SplashColorPtr p;
 
-    memset(aaBuf->getDataPtr(), 0, aaBuf->getRowSize() * aaBuf->getHeight());
     xxMin = aaBuf->getWidth();
     xxMax = -1;
     if (yMin <= yMax) {
@@ -449,7 +467,7 @@ void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y
         xx = *x0 * splashAASize;
         if (yy >= yyMin && yy <= yyMax) {
             const int intersectionIndex = splashAASize * y + yy - yMin;
-            if (unlikely(intersectionIndex < 0 || (unsigned)intersectionIndex >= allIntersections.size())) {
+            if (unlikely(intersectionIndex < 0 || intersectionIndex > yMax - yMin)) {
                 break;
             }
             const auto &line = allIntersections[intersectionIndex];
@@ -503,7 +521,7 @@ void SplashXPathScanner::clipAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y
             if (xx & 7) {
                 mask = (unsigned char)(0xff00 >> (xx & 7));
                 if ((xx & ~7) == (xx0 & ~7)) {
-                    mask &= 0xff >> (xx0 & 7);
+                    mask |= 0xff >> (xx0 & 7);
                 }
                 *p++ &= mask;
                 xx = (xx & ~7) + 8;
@@ -50,8 +50,27 @@ struct SplashIntersect
 class SplashXPathScanner
 {
 public:
+#ifdef USE_BOOST_HEADERS
+    typedef boost::container::small_vector<SplashIntersect, 4> IntersectionLine;
+#else
+    typedef std::vector<SplashIntersect> IntersectionLine;
+#endif
+
+    // Intersection lines left over by a scanner, so that the next one
+    // can reuse their allocations.  Only one scanner at a time gets
+    // them; the others allocate their own.
+    class Storage
+    {
+    private:
+        std::vector<IntersectionLine> lines;
+
+        friend class SplashXPathScanner;
+    };
+
     // Create a new SplashXPathScanner object.  <xPathA> must be sorted.
-    SplashXPathScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax);
+    // If <storageA> is not null, it is used to allocate the
+    // intersections, and must outlive the scanner.
+    SplashXPathScanner(const SplashXPath &xPath, bool eoA, int clipYMin, int clipYMax, Storage *storageA = nullptr);
 
     ~SplashXPathScanner();
 
@@ -84,8 +103,11 @@ public:
     // path.
     bool testSpan(int x0, int x1, int y) const;
 
-    // Renders one anti-aliased line into <aaBuf>.  Returns the min and
-    // max x coordinates with non-zero pixels in <x0> and <x1>.
+    // Renders one anti-aliased line into <aaBuf>, which must be clear
+    // (all zero) on entry -- only the bits under the path are set, so
+    // the caller only needs to clear what earlier lines touched.
+    // Returns the min and max x coordinates with non-zero pixels in
+    // <x0> and <x1>.
     void renderAALine(SplashBitmap *aaBuf, int *x0, int *x1, int y, bool adjustVertLine = false) const;
 
     // Clips an anti-aliased line by setting pixels to zero.  On entry,
@@ -100,12 +122,8 @@ private:
     bool eo;
     int xMin, yMin, xMax, yMax;
     bool partialClip;
+    Storage *storage;
 
-#ifdef USE_BOOST_HEADERS
-    typedef boost::container::small_vector<SplashIntersect, 4> IntersectionLine;
-#else
-    typedef std::vector<SplashIntersect> IntersectionLine;
-#endif
     std::vector<IntersectionLine> allIntersections;
 
     friend class SplashXPathScanIterator;
@@ -121,11 +139,7 @@ public:
     bool getNextSpan(int *x0, int *x1);
 
 private:
-#ifdef USE_BOOST_HEADERS
-    typedef boost::container::small_vector<SplashIntersect, 4> IntersectionLine;
-#else
-    typedef std::vector<SplashIntersect> IntersectionLine;
-#endif
+    typedef SplashXPathScanner::IntersectionLine IntersectionLine;
     const IntersectionLine &line;
 
     size_t interIdx; // current index into <line>
@@ -0,0 +1,135 @@
+//========================================================================
+//
+// cairo-pattern-text-test.cc
+// A test util to check that CairoOutputDev draws text filled with a
+// pattern in the shape of the glyphs, as it draws text filled with a
+// color, also when it follows other text of the same text object.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include "config.h"
+#include <poppler-config.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "CairoOutputDev.h"
+#include "CairoFontEngine.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+
+#include <cairo.h>
+
+static const int pageWidth = 200;
+static const int pageHeight = 60;
+
+// Page 1 shows blue text followed by red text, page 2 the same with the
+// red text filled with a shading pattern of a single red.
+static std::string makeDocument()
+{
+    const std::string text = "BT /F1 40 Tf 10 15 Td 0 0 1 rg (Ab) Tj ";
+    const std::string colorContent = text + "1 0 0 rg (cd) Tj ET";
+    const std::string patternContent = text + "/Pattern cs /P0 scn (cd) Tj ET";
+
+    std::vector<std::string> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R 4 0 R] /Count 2 /MediaBox [0 0 " + std::to_string(pageWidth) + " " + std::to_string(pageHeight)
+                      + "] /Resources << /Font << /F1 5 0 R >> /Pattern << /P0 6 0 R >> >> >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /Contents 7 0 R >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /Contents 8 0 R >>");
+    objects.push_back("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>");
+    objects.push_back("<< /PatternType 2 /Shading << /ShadingType 2 /ColorSpace /DeviceRGB /Coords [0 0 " + std::to_string(pageWidth)
+                      + " 0] /Function << /FunctionType 2 /Domain [0 1] /C0 [1 0 0] /C1 [1 0 0] /N 1 >> >> >>");
+    objects.push_back("<< /Length " + std::to_string(colorContent.size()) + " >>\nstream\n" + colorContent + "\nendstream");
+    objects.push_back("<< /Length " + std::to_string(patternContent.size()) + " >>\nstream\n" + patternContent + "\nendstream");
+
+    std::string data = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        offsets.push_back(data.size());
+        data += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    const size_t xrefOffset = data.size();
+    data += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        data += entry;
+    }
+    data += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return data;
+}
+
+// Render page <pageNum> of <doc> at 72 dpi on a white background
+static cairo_surface_t *renderPage(PDFDoc *doc, CairoFontEngine *fontEngine, int pageNum)
+{
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, pageWidth, pageHeight);
+    cairo_t *cr = cairo_create(surface);
+    cairo_set_source_rgb(cr, 1, 1, 1);
+    cairo_paint(cr);
+
+    CairoOutputDev cairoOut;
+    cairoOut.startDoc(doc, fontEngine);
+    cairoOut.setCairo(cr);
+    cairoOut.setPrinting(false);
+    doc->displayPageSlice(&cairoOut, pageNum, 72.0, 72.0, 0, true, false, false, -1, -1, -1, -1);
+    cairoOut.setCairo(nullptr);
+
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    return surface;
+}
+
+int main(int argc, char *argv[])
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    const std::string data = makeDocument();
+    PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+    if (!doc.isOk()) {
+        fprintf(stderr, "Error opening the test document\n");
+        return 1;
+    }
+
+    FT_Library ftLib;
+    FT_Init_FreeType(&ftLib);
+    bool ok = true;
+    {
+        CairoFontEngine fontEngine(ftLib);
+        cairo_surface_t *color = renderPage(&doc, &fontEngine, 1);
+        cairo_surface_t *pattern = renderPage(&doc, &fontEngine, 2);
+
+        // the pages differ only by antialiasing, as the pattern is drawn
+        // clipped to the glyphs instead of filling them
+        const unsigned char *colorData = cairo_image_surface_get_data(color);
+        const unsigned char *patternData = cairo_image_surface_get_data(pattern);
+        const int stride = cairo_image_surface_get_stride(color);
+        int inked = 0, different = 0;
+        for (int y = 0; y < pageHeight; ++y) {
+            for (int x = 0; x < pageWidth * 4; ++x) {
+                const int c = colorData[y * stride + x];
+                const int p = patternData[y * stride + x];
+                inked += c < 128;
+                different += abs(c - p) > 48;
+            }
+        }
+        if (inked == 0) {
+            fprintf(stderr, "No text was drawn\n");
+            ok = false;
+        } else if (different > pageWidth * pageHeight / 100) {
+            fprintf(stderr, "The text filled with a pattern differs from the text filled with a color in %d pixel components\n", different);
+            ok = false;
+        }
+
+        cairo_surface_destroy(color);
+        cairo_surface_destroy(pattern);
+    }
+    FT_Done_FreeType(ftLib);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+//========================================================================
+//
+// image-jobs-test.cc
+// A test util to check that ImageOutputDev writes the same image files
+// on several threads, as pdfimages -jobs does, as it does on one.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+#include "../utils/ImageOutputDev.h"
+
+static const int numPages = 6;
+static const int imageSize = 96;
+
+static std::string hexStream(const std::string &dict, const std::string &data)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : data) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0xf];
+    }
+    hex += '>';
+    return "<< " + dict + " /Filter /ASCIIHexDecode /Length " + std::to_string(hex.size()) + " >>\nstream\n" + hex + "\nendstream";
+}
+
+// <bytesPerPixel> bytes of pixel data, different on every page
+static std::string pixels(int page, int bytesPerPixel)
+{
+    std::string data;
+    for (int y = 0; y < imageSize; ++y) {
+        for (int x = 0; x < imageSize * bytesPerPixel; ++x) {
+            data += char(x * 7 + y * 13 + page * 31);
+        }
+    }
+    return data;
+}
+
+// Every page draws an RGB image with a soft mask, and a stencil mask
+static std::string makeDocument()
+{
+    const std::string size = "/Width " + std::to_string(imageSize) + " /Height " + std::to_string(imageSize);
+    std::vector<std::string> objects;
+    std::string kids;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("");
+    for (int page = 0; page < numPages; ++page) {
+        const int num = 3 + 5 * page;
+        kids += std::to_string(num) + " 0 R ";
+        objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 100 100] /Contents " + std::to_string(num + 1) + " 0 R /Resources << /XObject << /Im " + std::to_string(num + 2) + " 0 R /St "
+                          + std::to_string(num + 4) + " 0 R >> >> >>");
+        const std::string content = "q 50 0 0 50 0 0 cm /Im Do Q q 50 0 0 50 50 50 cm /St Do Q";
+        objects.push_back("<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "\nendstream");
+        objects.push_back(hexStream("/Type /XObject /Subtype /Image " + size + " /ColorSpace /DeviceRGB /BitsPerComponent 8 /SMask " + std::to_string(num + 3) + " 0 R", pixels(page, 3)));
+        objects.push_back(hexStream("/Type /XObject /Subtype /Image " + size + " /ColorSpace /DeviceGray /BitsPerComponent 8", pixels(page + numPages, 1)));
+        objects.push_back(hexStream("/Type /XObject /Subtype /Image " + size + " /ImageMask true /BitsPerComponent 1", pixels(page, 1).substr(0, imageSize / 8 * imageSize)));
+    }
+    objects[1] = "<< /Type /Pages /Kids [" + kids + "] /Count " + std::to_string(numPages) + " >>";
+
+    std::string data = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        offsets.push_back(data.size());
+        data += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    const size_t xrefOffset = data.size();
+    data += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        data += entry;
+    }
+    data += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return data;
+}
+
+// Write the images of <doc> to files starting with <fileRoot> on
+// <numThreads> threads, as pdfimages does.
+static bool writeImages(PDFDoc *doc, const std::string &fileRoot, int numThreads)
+{
+    std::vector<char> root(fileRoot.begin(), fileRoot.end());
+    root.push_back('\0');
+    ImageOutputDev imgOut(root.data(), false, false);
+    imgOut.setNumThreads(numThreads);
+    doc->displayPages(&imgOut, 1, doc->getNumPages(), 72, 72, 0, true, false, false);
+    imgOut.waitForImages();
+    if (!imgOut.isOk()) {
+        fprintf(stderr, "Error writing the images to %s on %d threads\n", fileRoot.c_str(), numThreads);
+        return false;
+    }
+    return true;
+}
+
+// Read <fileName> into <contents>, returning false if there is no such file
+static bool readFile(const std::string &fileName, std::string *contents)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        contents->append(buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s OUTPUT-DIR\n", argv[0]);
+        return 1;
+    }
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    const std::string data = makeDocument();
+    PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+    if (!doc.isOk() || doc.getNumPages() != numPages) {
+        fprintf(stderr, "Error opening the test document\n");
+        return 1;
+    }
+
+    const std::string serialRoot = std::string(argv[1]) + "/image-jobs-serial";
+    const std::string jobsRoot = std::string(argv[1]) + "/image-jobs-4";
+    if (!writeImages(&doc, serialRoot, 1) || !writeImages(&doc, jobsRoot, 4)) {
+        return 1;
+    }
+
+    // the image, its soft mask and the stencil mask of every page
+    const int numImages = 3 * numPages;
+    bool ok = true;
+    for (int imgNum = 0; imgNum <= numImages; ++imgNum) {
+        bool found = false;
+        for (const char *ext : { "ppm", "pgm", "pbm" }) {
+            char name[32];
+            snprintf(name, sizeof(name), "-%03d.%s", imgNum, ext);
+            std::string expected, contents;
+            const bool written = readFile(serialRoot + name, &expected);
+            if (readFile(jobsRoot + name, &contents) != written) {
+                fprintf(stderr, "%s%s was %s written on 4 threads\n", jobsRoot.c_str(), name, written ? "not" : "also");
+                ok = false;
+            } else if (contents != expected) {
+                fprintf(stderr, "%s%s differs from %s%s\n", jobsRoot.c_str(), name, serialRoot.c_str(), name);
+                ok = false;
+            }
+            found |= written;
+        }
+        if (found != (imgNum < numImages)) {
+            fprintf(stderr, "Image %d was %s written\n", imgNum, found ? "also" : "not");
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
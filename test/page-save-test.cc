@@ -0,0 +1,116 @@
+//========================================================================
+//
+// page-save-test.cc
+// A test util to check that PDFDoc::savePageAs() writes the same pages
+// through XRef copies of one document, as pdfseparate does, as it does
+// from a new document for every page.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "goo/GooString.h"
+#include "ErrorCodes.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "XRef.h"
+
+// Read <fileName> without the trailer from the file identifiers on, as
+// they are made from the time and the file name, and are binary strings.
+static bool readPDF(const std::string &fileName, std::string *contents)
+{
+    FILE *f = fopen(fileName.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "Error reading %s\n", fileName.c_str());
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        contents->append(buf, n);
+    }
+    fclose(f);
+
+    const size_t id = contents->find("/ID [");
+    if (id != std::string::npos) {
+        const size_t end = contents->find("startxref", id);
+        if (end != std::string::npos) {
+            contents->erase(id, end - id);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s PDF-FILE OUTPUT-DIR\n", argv[0]);
+        return 1;
+    }
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    auto doc = std::make_unique<PDFDoc>(std::make_unique<GooString>(argv[1]));
+    if (!doc->isOk()) {
+        fprintf(stderr, "Error opening %s\n", argv[1]);
+        return 1;
+    }
+    const int numPages = doc->getNumPages();
+    if (numPages < 2) {
+        fprintf(stderr, "%s has less than two pages\n", argv[1]);
+        return 1;
+    }
+
+    const std::string dir = argv[2];
+    auto fileName = [&](const char *prefix, int pageNo) { return dir + "/" + prefix + std::to_string(pageNo) + ".pdf"; };
+
+    // savePageAs changes the document, so each page needs a new one
+    for (int pageNo = 1; pageNo <= numPages; ++pageNo) {
+        PDFDoc pageDoc(std::make_unique<GooString>(argv[1]));
+        if (pageDoc.savePageAs(GooString(fileName("page-save-", pageNo)), pageNo) != errNone) {
+            fprintf(stderr, "Error saving page %d\n", pageNo);
+            return 1;
+        }
+    }
+
+    // all pages at the same time from one document
+    doc->getXRef()->scanSpecialFlags();
+    std::vector<int> results(numPages);
+    std::vector<std::thread> threads;
+    for (int pageNo = 1; pageNo <= numPages; ++pageNo) {
+        threads.emplace_back([&, pageNo] {
+            const std::unique_ptr<XRef> pageXRef(doc->getXRef()->copy());
+            results[pageNo - 1] = doc->savePageAs(GooString(fileName("page-save-xref-", pageNo)), pageNo, pageXRef.get());
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    bool ok = true;
+    for (int pageNo = 1; pageNo <= numPages; ++pageNo) {
+        std::string expected, contents;
+        if (results[pageNo - 1] != errNone) {
+            fprintf(stderr, "Error saving page %d through an XRef copy\n", pageNo);
+            ok = false;
+        } else if (!readPDF(fileName("page-save-", pageNo), &expected) || !readPDF(fileName("page-save-xref-", pageNo), &contents)) {
+            ok = false;
+        } else if (contents != expected) {
+            fprintf(stderr, "Page %d saved through an XRef copy differs from %s\n", pageNo, fileName("page-save-", pageNo).c_str());
+            ok = false;
+        }
+    }
+    if (doc->getXRef()->isModified()) {
+        fprintf(stderr, "Saving pages through XRef copies modified the document\n");
+        ok = false;
+    }
+
+    return ok ? 0 : 1;
+}
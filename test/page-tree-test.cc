@@ -0,0 +1,126 @@
+//========================================================================
+//
+// page-tree-test.cc
+// A test util to check Catalog::findPage() on page trees with wrong
+// /Count values.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "Stream.h"
+
+// Object numbers of the document made by makeDocument()
+static const int firstPageNum = 5;
+
+// A document whose root Pages node has two Pages kids of <pagesPerNode>
+// pages each, the first one claiming <firstNodeCount> pages and the root
+// <rootCount> pages.
+static std::string makeDocument(int pagesPerNode, int firstNodeCount, int rootCount)
+{
+    std::vector<std::string> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R 4 0 R] /Count " + std::to_string(rootCount) + " >>");
+    for (int node = 0; node < 2; ++node) {
+        std::string kids;
+        for (int i = 0; i < pagesPerNode; ++i) {
+            kids += std::to_string(firstPageNum + node * pagesPerNode + i) + " 0 R ";
+        }
+        const int count = node == 0 ? firstNodeCount : pagesPerNode;
+        objects.push_back("<< /Type /Pages /Parent 2 0 R /Kids [" + kids + "] /Count " + std::to_string(count) + " >>");
+    }
+    for (int node = 0; node < 2; ++node) {
+        for (int i = 0; i < pagesPerNode; ++i) {
+            objects.push_back("<< /Type /Page /Parent " + std::to_string(3 + node) + " 0 R /MediaBox [0 0 612 792] >>");
+        }
+    }
+
+    std::string data = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        offsets.push_back(data.size());
+        data += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    const size_t xrefOffset = data.size();
+    data += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        data += entry;
+    }
+    data += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return data;
+}
+
+// Check that the <k>th page (1-based) of the second Pages node of <doc>
+// is found as page <expected>.
+static bool checkFindPage(PDFDoc *doc, int pagesPerNode, int k, int expected, const char *name)
+{
+    const Ref ref = { firstPageNum + pagesPerNode + k - 1, 0 };
+    const int page = doc->findPage(ref);
+    if (page != expected) {
+        fprintf(stderr, "%s: page %d 0 R was found as page %d instead of %d\n", name, ref.num, page, expected);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    globalParams = std::make_unique<GlobalParams>();
+    globalParams->setErrQuiet(true);
+
+    // Enough pages for findPage() to look pages up through their parents
+    const int pagesPerNode = 300;
+    bool ok = true;
+
+    // The /Count of the first node is too large: its kids don't add up to
+    // it, nor the counts of the kids of the root to the root /Count.
+    {
+        const std::string data = makeDocument(pagesPerNode, 500, 2 * pagesPerNode);
+        PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+        ok &= doc.isOk() && checkFindPage(&doc, pagesPerNode, 10, pagesPerNode + 10, "inconsistent counts");
+    }
+
+    // The counts add up, but the first node claims one page less than it
+    // has: the page found through the counts was loaded in order already,
+    // and is another one.
+    {
+        const std::string data = makeDocument(pagesPerNode, pagesPerNode - 1, 2 * pagesPerNode - 1);
+        PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+        bool loaded = doc.isOk();
+        for (int i = 1; loaded && i < pagesPerNode + 10; ++i) {
+            loaded = doc.getPage(i) != nullptr;
+        }
+        ok &= loaded && checkFindPage(&doc, pagesPerNode, 10, pagesPerNode + 10, "consistent counts");
+    }
+
+    // Correct counts
+    {
+        const std::string data = makeDocument(pagesPerNode, pagesPerNode, 2 * pagesPerNode);
+        PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+        ok &= doc.isOk() && checkFindPage(&doc, pagesPerNode, 10, pagesPerNode + 10, "correct counts");
+    }
+
+    // A Pages node isn't a page, even though its first page could be
+    // numbered through the counts
+    {
+        const std::string data = makeDocument(pagesPerNode, pagesPerNode, 2 * pagesPerNode);
+        PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+        const int page = doc.isOk() ? doc.findPage({ 4, 0 }) : -1;
+        if (page != 0) {
+            fprintf(stderr, "pages node: 4 0 R was found as page %d instead of none\n", page);
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -14,20 +14,29 @@
 #include "PDFDoc.h"
 #include "XRef.h"
 #include "goo/GooString.h"
+#include <cstring>
+#include <set>
 #include "utils/parseargs.h"
 
 static bool compareDocuments(PDFDoc *origDoc, PDFDoc *newDoc);
 static bool compareObjects(const Object *objA, const Object *objB);
 
+// Streams that -dedup dropped, as they duplicate another one
+static std::set<int> droppedDuplicates;
+
 static char ownerPassword[33] = "\001";
 static char userPassword[33] = "\001";
 static bool forceIncremental = false;
+static PDFRewriteOptions rewriteOptions;
 static bool checkOutput = false;
 static bool printHelp = false;
 
 static const ArgDesc argDesc[] = { { "-opw", argString, ownerPassword, sizeof(ownerPassword), "owner password (for encrypted files)" },
                                    { "-upw", argString, userPassword, sizeof(userPassword), "user password (for encrypted files)" },
                                    { "-i", argFlag, &forceIncremental, 0, "incremental update mode" },
+                                   { "-objstm", argFlag, &rewriteOptions.useObjectStreams, 0, "pack objects into object streams" },
+                                   { "-compress", argFlag, &rewriteOptions.compressStreams, 0, "compress the streams without filter" },
+                                   { "-dedup", argFlag, &rewriteOptions.deduplicateStreams, 0, "write duplicated streams only once" },
                                    { "-check", argFlag, &checkOutput, 0, "verify the generated document" },
                                    { "-h", argFlag, &printHelp, 0, "print usage information" },
                                    { "-help", argFlag, &printHelp, 0, "print usage information" },
@@ -70,7 +79,12 @@ int main(int argc, char *argv[])
     }
 
     // save it back (in rewrite or incremental update mode)
-    if (doc->saveAs(*doc->getFileName(), forceIncremental ? writeForceIncremental : writeForceRewrite) != 0) {
+    if (forceIncremental && (rewriteOptions.useObjectStreams || rewriteOptions.compressStreams || rewriteOptions.deduplicateStreams)) {
+        fprintf(stderr, "-objstm, -compress and -dedup only apply to rewrites\n");
+        res = 1;
+        goto done;
+    }
+    if (forceIncremental ? doc->saveAs(GooString(argv[2]), writeForceIncremental) != 0 : doc->saveAs(GooString(argv[2]), rewriteOptions) != 0) {
         fprintf(stderr, "Error saving document\n");
         res = 1;
         goto done;
@@ -94,8 +108,30 @@ done:
     return res;
 }
 
-static bool compareDictionaries(Dict *dictA, Dict *dictB)
+// The keys of stream dictionaries that -compress changes
+static bool isFilterKey(const char *key)
+{
+    return strcmp(key, "Length") == 0 || strcmp(key, "Filter") == 0 || strcmp(key, "DecodeParms") == 0;
+}
+
+static bool compareDictionaries(Dict *dictA, Dict *dictB, bool ignoreFilters = false)
 {
+    if (ignoreFilters) {
+        for (int i = 0; i < dictA->getLength(); ++i) {
+            const char *key = dictA->getKey(i);
+            if (!isFilterKey(key) && !compareObjects(&dictA->getValNF(i), &dictB->lookupNF(key))) {
+                return false;
+            }
+        }
+        for (int i = 0; i < dictB->getLength(); ++i) {
+            const char *key = dictB->getKey(i);
+            if (!isFilterKey(key) && !dictA->hasKey(key)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     const int length = dictA->getLength();
     if (dictB->getLength() != length) {
         return false;
@@ -199,7 +235,7 @@ static bool compareObjects(const Object *objA, const Object *objB)
         } else {
             Stream *streamA = objA->getStream();
             Stream *streamB = objB->getStream();
-            if (!compareDictionaries(streamA->getDict(), streamB->getDict())) {
+            if (!compareDictionaries(streamA->getDict(), streamB->getDict(), rewriteOptions.compressStreams)) {
                 return false;
             } else {
                 int c;
@@ -222,7 +258,8 @@ static bool compareObjects(const Object *objA, const Object *objB)
         } else {
             const Ref refA = objA->getRef();
             const Ref refB = objB->getRef();
-            return refA == refB;
+            // references to a dropped duplicate point to the stream kept
+            return refA == refB || (droppedDuplicates.count(refA.num) && !droppedDuplicates.count(refB.num));
         }
     }
     default: {
@@ -242,10 +279,21 @@ static bool compareDocuments(PDFDoc *origDoc, PDFDoc *newDoc)
     origXRef->scanSpecialFlags();
     newXRef->scanSpecialFlags();
 
+    if (origDoc->getNumPages() != newDoc->getNumPages()) {
+        fprintf(stderr, "Different number of pages (%d != %d)\n", origDoc->getNumPages(), newDoc->getNumPages());
+        result = false;
+    }
+
     // Compare XRef tables' size
     const int origNumObjects = origXRef->getNumObjects();
     const int newNumObjects = newXRef->getNumObjects();
-    if (forceIncremental && origXRef->isXRefStream()) {
+    if (rewriteOptions.useObjectStreams) {
+        // The object streams and the XRef stream are appended
+        if (origNumObjects + 2 > newNumObjects) {
+            fprintf(stderr, "XRef table: Unexpected number of entries (%d+2 > %d)\n", origNumObjects, newNumObjects);
+            result = false;
+        }
+    } else if (forceIncremental && origXRef->isXRefStream()) {
         // In case of incremental update, expect a new entry to be appended to store the new XRef stream
         if (origNumObjects + 1 != newNumObjects) {
             fprintf(stderr, "XRef table: Unexpected number of entries (%d+1 != %d)\n", origNumObjects, newNumObjects);
@@ -261,6 +309,13 @@ static bool compareDocuments(PDFDoc *origDoc, PDFDoc *newDoc)
 
     // Compare each XRef entry
     const int numObjects = (origNumObjects < newNumObjects) ? origNumObjects : newNumObjects;
+    if (rewriteOptions.deduplicateStreams) {
+        for (int i = 1; i < numObjects; ++i) {
+            if (origXRef->getEntry(i)->type != xrefEntryFree && newXRef->getEntry(i)->type == xrefEntryFree && !origXRef->getEntry(i)->getFlag(XRefEntry::DontRewrite)) {
+                droppedDuplicates.insert(i);
+            }
+        }
+    }
     for (int i = 0; i < numObjects; ++i) {
         XRefEntryType origType = origXRef->getEntry(i)->type;
         XRefEntryType newType = newXRef->getEntry(i)->type;
@@ -276,6 +331,15 @@ static bool compareDocuments(PDFDoc *origDoc, PDFDoc *newDoc)
             continue; // There's nothing left to check for this entry
         }
 
+        // Check that streams dropped by -dedup were freed correctly
+        if (droppedDuplicates.count(i)) {
+            if (!origXRef->fetch(i, origGenNum).isStream() || origGenNum + 1 != newGenNum) {
+                fprintf(stderr, "XRef entry %u: freed but not a duplicated stream\n", i);
+                result = false;
+            }
+            continue;
+        }
+
         // Compare generation numbers
         // Object num 0 should always have gen 65535 according to specs, but some
         // documents have it set to 0. We always write 65535 in output
@@ -135,6 +135,8 @@ static StrList *gArgsListRoot = nullptr;
 #define LOAD_ONLY_ARG "-loadonly"
 #define PAGE_ARG "-page"
 #define TEXT_ARG "-text"
+#define ZOOM_ARG "-zoom"
+#define AA_ARG "-aa"
 
 /* Should we record timings? True if -timings command-line argument was given. */
 static bool gfTimings = false;
@@ -185,6 +187,22 @@ static int gPageNo = PAGE_NO_NOT_GIVEN;
    profiling load time */
 static bool gfLoadOnly = false;
 
+/* Zoom level in percent the pages are rendered at.
+   Controlled by -zoom command-line argument. */
+static double gZoom = 100.0;
+
+/* How vector anti-aliasing computes the coverage of paths: by supersampling,
+   analytically, or both, in which case every page is rendered in both modes
+   and the times are compared.
+   Controlled by -aa command-line argument. */
+enum AAMode
+{
+    AA_SUPERSAMPLE,
+    AA_ANALYTIC,
+    AA_COMPARE
+};
+static AAMode gAAMode = AA_SUPERSAMPLE;
+
 #define PDF_FILE_DPI 72
 
 #define MAX_FILENAME_SIZE 1024
@@ -590,7 +608,7 @@ static void LogInfo(const char *fmt, ...)
 
 static void PrintUsageAndExit(int argc, char **argv)
 {
-    printf("Usage: pdftest [-preview|-slowpreview] [-loadonly] [-timings] [-text] [-resolution NxM] [-recursive] [-page N] [-out out.txt] pdf-files-to-process\n");
+    printf("Usage: pdftest [-preview|-slowpreview] [-loadonly] [-timings] [-text] [-resolution NxM] [-recursive] [-page N] [-zoom N] [-aa supersample|analytic|compare] [-out out.txt] pdf-files-to-process\n");
     for (int i = 0; i < argc; i++) {
         printf("i=%d, '%s'\n", i, argv[i]);
     }
@@ -633,7 +651,7 @@ static void RenderPdfAsText(const char *fileName)
     }
 
     msTimer.stop();
-    timeInMs = msTimer.getElapsed();
+    timeInMs = msTimer.getElapsed() * 1000;
     LogInfo("load: %.2f ms\n", timeInMs);
 
     pageCount = pdfDoc->getNumPages();
@@ -652,7 +670,7 @@ static void RenderPdfAsText(const char *fileName)
         pdfDoc->displayPage(textOut, curPage, 72, 72, rotate, useMediaBox, crop, doLinks);
         txt = textOut->getText(0.0, 0.0, 10000.0, 10000.0);
         msTimer.stop();
-        timeInMs = msTimer.getElapsed();
+        timeInMs = msTimer.getElapsed() * 1000;
         if (gfTimings) {
             LogInfo("page %d: %.2f ms\n", curPage, timeInMs);
         }
@@ -679,6 +697,8 @@ static void RenderPdf(const char *fileName)
     PdfEnginePoppler *engineSplash = nullptr;
     int pageCount;
     double timeInMs;
+    double totalSupersampleMs = 0;
+    double totalAnalyticMs = 0;
 
 #ifdef COPY_FILE
     // TODO: fails if file already exists and has read-only attribute
@@ -697,7 +717,7 @@ static void RenderPdf(const char *fileName)
         goto Error;
     }
     msTimer.stop();
-    timeInMs = msTimer.getElapsed();
+    timeInMs = msTimer.getElapsed() * 1000;
     LogInfo("load splash: %.2f ms\n", timeInMs);
     pageCount = engineSplash->pageCount();
 
@@ -713,17 +733,37 @@ static void RenderPdf(const char *fileName)
 
         SplashBitmap *bmpSplash = nullptr;
 
-        GooTimer msRenderTimer;
-        bmpSplash = engineSplash->renderBitmap(curPage, 100.0, 0);
-        msRenderTimer.stop();
-        timeInMs = msRenderTimer.getElapsed();
-        if (gfTimings) {
-            if (!bmpSplash) {
-                LogInfo("page splash %d: failed to render\n", curPage);
-            } else {
+        if (gAAMode == AA_COMPARE) {
+            /* alternate which mode goes first, so that the font and image
+               caches filled by the first render favour neither */
+            double modeTimeInMs[2];
+            for (int i = 0; i < 2; i++) {
+                bool analytic = (i + curPage) % 2 == 0;
+                delete bmpSplash;
+                engineSplash->outputDevice()->setAnalyticAntialias(analytic);
+                GooTimer msRenderTimer;
+                bmpSplash = engineSplash->renderBitmap(curPage, gZoom, 0);
+                msRenderTimer.stop();
+                modeTimeInMs[analytic] = msRenderTimer.getElapsed() * 1000;
+            }
+            totalSupersampleMs += modeTimeInMs[0];
+            totalAnalyticMs += modeTimeInMs[1];
+            if (gfTimings && bmpSplash) {
+                LogInfo("page splash %d (%dx%d): supersample %.2f ms, analytic %.2f ms\n", curPage, bmpSplash->getWidth(), bmpSplash->getHeight(), modeTimeInMs[0], modeTimeInMs[1]);
+            }
+        } else {
+            engineSplash->outputDevice()->setAnalyticAntialias(gAAMode == AA_ANALYTIC);
+            GooTimer msRenderTimer;
+            bmpSplash = engineSplash->renderBitmap(curPage, gZoom, 0);
+            msRenderTimer.stop();
+            timeInMs = msRenderTimer.getElapsed() * 1000;
+            if (gfTimings && bmpSplash) {
                 LogInfo("page splash %d (%dx%d): %.2f ms\n", curPage, bmpSplash->getWidth(), bmpSplash->getHeight(), timeInMs);
             }
         }
+        if (gfTimings && !bmpSplash) {
+            LogInfo("page splash %d: failed to render\n", curPage);
+        }
 
         if (ShowPreview()) {
             PreviewBitmapSplash(bmpSplash);
@@ -733,6 +773,9 @@ static void RenderPdf(const char *fileName)
         }
         delete bmpSplash;
     }
+    if (gAAMode == AA_COMPARE) {
+        LogInfo("total splash: supersample %.2f ms, analytic %.2f ms\n", totalSupersampleMs, totalAnalyticMs);
+    }
 Error:
     delete engineSplash;
     LogInfo("finished: %s\n", fileName);
@@ -867,6 +910,30 @@ static void ParseCommandLine(int argc, char **argv)
                 if (gPageNo < 1) {
                     PrintUsageAndExit(argc, argv);
                 }
+            } else if (str_ieq(arg, ZOOM_ARG)) {
+                /* expect a number after that */
+                ++i;
+                if (i == argc) {
+                    PrintUsageAndExit(argc, argv);
+                }
+                gZoom = atof(argv[i]);
+                if (gZoom <= 0) {
+                    PrintUsageAndExit(argc, argv);
+                }
+            } else if (str_ieq(arg, AA_ARG)) {
+                ++i;
+                if (i == argc) {
+                    PrintUsageAndExit(argc, argv);
+                }
+                if (str_ieq(argv[i], "supersample")) {
+                    gAAMode = AA_SUPERSAMPLE;
+                } else if (str_ieq(argv[i], "analytic")) {
+                    gAAMode = AA_ANALYTIC;
+                } else if (str_ieq(argv[i], "compare")) {
+                    gAAMode = AA_COMPARE;
+                } else {
+                    PrintUsageAndExit(argc, argv);
+                }
             } else {
                 /* unknown option */
                 PrintUsageAndExit(argc, argv);
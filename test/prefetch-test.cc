@@ -0,0 +1,247 @@
+//========================================================================
+//
+// prefetch-test.cc
+// A test util to check that PDFDoc::setPrefetchPages() makes the data of
+// the next pages of a linearized document be fetched ahead, and that
+// reading cached data doesn't wait for a slow prefetch.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CachedFile.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "TextOutputDev.h"
+#include "XRef.h"
+
+// Serves byte ranges of a local file, standing in for HTTP, and records
+// the ranges it was asked for.  Each load can be made to take a while.
+class RecordingLoader : public CachedFileLoader
+{
+public:
+    explicit RecordingLoader(FILE *fileA) : file(fileA) { }
+    ~RecordingLoader() override { fclose(file); }
+
+    size_t init(CachedFile *cachedFile) override
+    {
+        fseek(file, 0, SEEK_END);
+        return ftell(file);
+    }
+
+    int load(const std::vector<ByteRange> &ranges, CachedFileWriter *writer) override
+    {
+        loads++;
+        std::this_thread::sleep_for(delay.load());
+        std::vector<char> buf;
+        for (const ByteRange &range : ranges) {
+            // the last chunk may end after the end of the file
+            buf.resize(range.length);
+            fseek(file, range.offset, SEEK_SET);
+            const size_t n = fread(buf.data(), 1, range.length, file);
+            writer->write(buf.data(), n);
+            // recorded once written, so that a range seen here is cached
+            std::lock_guard<std::mutex> lock(mutex);
+            requested.push_back(range);
+        }
+        return 0;
+    }
+
+    void setDelay(std::chrono::milliseconds delayA) { delay = delayA; }
+
+    // The number of calls to load(), counted as they start
+    int loadCount() const { return loads; }
+
+    size_t requestCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requested.size();
+    }
+
+    // Whether every byte in [start, end) was requested
+    bool wasRequested(size_t start, size_t end)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<ByteRange> ranges = requested;
+        std::sort(ranges.begin(), ranges.end(), [](const ByteRange &a, const ByteRange &b) { return a.offset < b.offset; });
+        for (const ByteRange &range : ranges) {
+            if (range.offset <= start && start < range.offset + range.length) {
+                start = range.offset + range.length;
+            }
+        }
+        return start >= end;
+    }
+
+private:
+    FILE *file;
+    std::atomic<std::chrono::milliseconds> delay { std::chrono::milliseconds(0) };
+    std::atomic<int> loads { 0 };
+    std::mutex mutex;
+    std::vector<ByteRange> requested;
+};
+
+static void discardText(void *stream, const char *text, int len) { }
+
+// Check that reading data that is cached doesn't wait for a slow prefetch
+// of other data, and that reading the data being prefetched waits for it
+// instead of loading it again.
+static bool checkSlowPrefetch(const char *fileName)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening %s\n", fileName);
+        return false;
+    }
+    RecordingLoader *loader = new RecordingLoader(file);
+    CachedFile *cachedFile = new CachedFile(loader);
+    bool ok = true;
+
+    const size_t prefetchOffset = 8 * CachedFileChunkSize;
+    char cached[100], buf[100];
+    if (cachedFile->getLength() < prefetchOffset + sizeof(buf) || cachedFile->read(cached, 1, sizeof(cached)) != sizeof(cached)) {
+        fprintf(stderr, "Error reading %s\n", fileName);
+        cachedFile->decRefCnt();
+        return false;
+    }
+
+    const auto delay = std::chrono::seconds(2);
+    loader->setDelay(delay);
+    cachedFile->prefetch({ { prefetchOffset, 4 * CachedFileChunkSize } });
+    while (loader->loadCount() < 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    cachedFile->seek(0, SEEK_SET);
+    if (cachedFile->read(buf, 1, sizeof(buf)) != sizeof(buf) || memcmp(buf, cached, sizeof(buf)) != 0) {
+        fprintf(stderr, "Reading cached data during a prefetch failed\n");
+        ok = false;
+    } else if (std::chrono::steady_clock::now() - start >= delay / 2) {
+        fprintf(stderr, "Reading cached data waited for the prefetch\n");
+        ok = false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    cachedFile->seek(prefetchOffset, SEEK_SET);
+    if (cachedFile->read(buf, 1, sizeof(buf)) != sizeof(buf)) {
+        fprintf(stderr, "Reading prefetched data failed\n");
+        ok = false;
+    } else if (loader->loadCount() != 2) {
+        fprintf(stderr, "Reading data being prefetched loaded it again\n");
+        ok = false;
+    } else if (std::chrono::steady_clock::now() - start < delay / 2) {
+        fprintf(stderr, "Reading data being prefetched didn't wait for it\n");
+        ok = false;
+    }
+
+    cachedFile->decRefCnt();
+    return ok;
+}
+
+// Open <fileName> through a CachedFile reading from <loader>
+static std::unique_ptr<PDFDoc> openDocument(const char *fileName, RecordingLoader **loader)
+{
+    FILE *file = fopen(fileName, "rb");
+    if (!file) {
+        fprintf(stderr, "Error opening %s\n", fileName);
+        return nullptr;
+    }
+    *loader = new RecordingLoader(file);
+    CachedFile *cachedFile = new CachedFile(*loader);
+    auto doc = std::make_unique<PDFDoc>(new CachedFileStream(cachedFile, 0, false, cachedFile->getLength(), Object(objNull)));
+    if (!doc->isOk() || !doc->isLinearized() || doc->getNumPages() != 6) {
+        fprintf(stderr, "%s is not the expected 6 page linearized document\n", fileName);
+        return nullptr;
+    }
+    return doc;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s LINEARIZED-PDF-FILE\n", argv[0]);
+        return 1;
+    }
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    if (!checkSlowPrefetch(argv[1])) {
+        return 1;
+    }
+
+    const int prefetchPages = 2;
+    TextOutputDev textOut(discardText, nullptr, false, 0, false, false);
+
+    // Without prefetching, the data of page 3 is only requested when the
+    // page is displayed
+    {
+        RecordingLoader *loader;
+        std::unique_ptr<PDFDoc> doc = openDocument(argv[1], &loader);
+        if (!doc || !doc->getPage(2)) {
+            return 1;
+        }
+        const size_t requests = loader->requestCount();
+        doc->displayPage(&textOut, 3, 72, 72, 0, true, false, false);
+        if (loader->requestCount() == requests) {
+            fprintf(stderr, "Page 3 was displayed without any request\n");
+            return 1;
+        }
+    }
+
+    RecordingLoader *loader;
+    std::unique_ptr<PDFDoc> doc = openDocument(argv[1], &loader);
+    if (!doc) {
+        return 1;
+    }
+
+    // In the test document, page <k> > 1 is object 2k - 3 followed by
+    // its content stream, in page order.
+    XRef *xref = doc->getXRef();
+    auto pageStart = [xref](int k) { return (size_t)xref->getEntry(2 * k - 3)->offset; };
+    auto pageEnd = [xref](int k) { return (size_t)xref->getEntry(2 * k - 1)->offset; };
+
+    doc->setPrefetchPages(prefetchPages);
+    if (!doc->getPage(2)) {
+        fprintf(stderr, "Error parsing page 2\n");
+        return 1;
+    }
+
+    // The data of the next pages is fetched in the background
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!loader->wasRequested(pageStart(3), pageEnd(2 + prefetchPages))) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            fprintf(stderr, "The data of pages 3 to %d was not fetched\n", 2 + prefetchPages);
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // ... but not the data of the pages after them
+    if (loader->wasRequested(pageStart(6), pageEnd(6))) {
+        fprintf(stderr, "The data of page 6 was fetched before it was needed\n");
+        return 1;
+    }
+
+    // ... so that displaying them doesn't need any other request.  Turn
+    // prefetching off first, as it would fetch the pages after them.
+    doc->setPrefetchPages(0);
+    const size_t requests = loader->requestCount();
+    doc->displayPages(&textOut, 3, 2 + prefetchPages, 72, 72, 0, true, false, false);
+    if (loader->requestCount() != requests) {
+        fprintf(stderr, "Displaying the prefetched pages made %zu more requests\n", loader->requestCount() - requests);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+//========================================================================
+//
+// ps-font-subset-test.cc
+// A test util to check that PSOutputDev::setSubsetFonts() embeds smaller
+// Type 1C fonts that still have the glyphs drawn, including the parts of
+// accented characters.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+
+#include "goo/GooString.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "PSOutputDev.h"
+
+// Convert <fileName> to PostScript in <psFileName> and return the first
+// font resource in it, or an empty string.
+static std::string writeFont(const char *fileName, const std::string &psFileName, bool subset)
+{
+    auto doc = std::make_unique<PDFDoc>(std::make_unique<GooString>(fileName));
+    if (!doc->isOk()) {
+        fprintf(stderr, "Error opening %s\n", fileName);
+        return {};
+    }
+    {
+        std::vector<int> pages = { 1 };
+        PSOutputDev psOut(psFileName.c_str(), doc.get(), nullptr, pages, psModePS);
+        if (!psOut.isOk()) {
+            fprintf(stderr, "Error creating %s\n", psFileName.c_str());
+            return {};
+        }
+        psOut.setSubsetFonts(subset);
+        doc->displayPage(&psOut, 1, 72, 72, 0, false, true, true);
+    }
+
+    FILE *f = fopen(psFileName.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "Error reading %s\n", psFileName.c_str());
+        return {};
+    }
+    std::string ps;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        ps.append(buf, n);
+    }
+    fclose(f);
+
+    const size_t begin = ps.find("%!FontType1");
+    const size_t end = ps.find("%%EndResource", begin);
+    if (begin == std::string::npos || end == std::string::npos) {
+        fprintf(stderr, "No Type 1 font in %s\n", psFileName.c_str());
+        return {};
+    }
+    return ps.substr(begin, end - begin);
+}
+
+// Returns the number of outline points of glyph <name> in <font>, or -1
+// if it has no such glyph or it can't be loaded.
+static int countPoints(FT_Library lib, const std::string &font, const char *name)
+{
+    FT_Face face;
+    if (FT_New_Memory_Face(lib, reinterpret_cast<const FT_Byte *>(font.data()), font.size(), 0, &face)) {
+        return -1;
+    }
+    int points = -1;
+    const FT_UInt gid = FT_Get_Name_Index(face, name);
+    if (gid != 0 && FT_Load_Glyph(face, gid, FT_LOAD_NO_SCALE) == 0) {
+        points = face->glyph->outline.n_points;
+    }
+    FT_Done_Face(face);
+    return points;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s PDF-FILE OUTPUT-DIR\n", argv[0]);
+        return 1;
+    }
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    // the page draws Aacute, a seac of A and acute, and C with a
+    // Type 1C font that also has B, D, E and F
+    const std::string full = writeFont(argv[1], std::string(argv[2]) + "/ps-font-full.ps", false);
+    const std::string subset = writeFont(argv[1], std::string(argv[2]) + "/ps-font-subset.ps", true);
+    if (full.empty() || subset.empty()) {
+        return 1;
+    }
+    if (subset.size() >= full.size()) {
+        fprintf(stderr, "The font subset is %zu bytes, the whole font %zu\n", subset.size(), full.size());
+        return 1;
+    }
+
+    FT_Library lib;
+    if (FT_Init_FreeType(&lib)) {
+        fprintf(stderr, "Error initializing FreeType\n");
+        return 1;
+    }
+    bool ok = true;
+    for (const char *name : { "Aacute", "C", "A", "acute" }) {
+        const int expected = countPoints(lib, full, name);
+        const int points = countPoints(lib, subset, name);
+        if (expected <= 0 || points != expected) {
+            fprintf(stderr, "Glyph %s has %d points in the subset, and %d in the whole font\n", name, points, expected);
+            ok = false;
+        }
+    }
+    for (const char *name : { "B", "D", "E", "F" }) {
+        if (countPoints(lib, subset, name) >= 0) {
+            fprintf(stderr, "Glyph %s is not drawn but is in the subset\n", name);
+            ok = false;
+        }
+    }
+    FT_Done_FreeType(lib);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+//========================================================================
+//
+// ps-raster-pool-test.cc
+// A test util to check that PSOutputDev rasterizes pages on several
+// threads (PSOutputDev::setRasterThreads()) exactly as it does on one.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "goo/GooString.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "PSOutputDev.h"
+
+// Convert every page of <fileName> to PostScript in <psFileName>,
+// rasterizing them on <threads> threads.
+static bool writePS(const char *fileName, const std::string &psFileName, int threads)
+{
+    auto doc = std::make_unique<PDFDoc>(std::make_unique<GooString>(fileName));
+    if (!doc->isOk()) {
+        fprintf(stderr, "Error opening %s\n", fileName);
+        return false;
+    }
+    std::vector<int> pages;
+    for (int i = 1; i <= doc->getNumPages(); ++i) {
+        pages.push_back(i);
+    }
+
+    PSOutputDev psOut(psFileName.c_str(), doc.get(), nullptr, pages, psModePS);
+    if (!psOut.isOk()) {
+        fprintf(stderr, "Error creating %s\n", psFileName.c_str());
+        return false;
+    }
+    psOut.setRasterResolution(72);
+    psOut.setRasterThreads(threads);
+    for (int pg : pages) {
+        doc->displayPage(&psOut, pg, 72, 72, 0, false, true, true);
+    }
+    return true;
+}
+
+// Read <fileName> without the creation date, which may differ between
+// runs.
+static bool readPS(const std::string &fileName, std::string *contents)
+{
+    FILE *f = fopen(fileName.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "Error reading %s\n", fileName.c_str());
+        return false;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "%%CreationDate:", 15) != 0) {
+            contents->append(line);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s PDF-FILE OUTPUT-DIR\n", argv[0]);
+        return 1;
+    }
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    const std::string expectedFileName = std::string(argv[2]) + "/ps-raster-pool-1.ps";
+    std::string expected;
+    if (!writePS(argv[1], expectedFileName, 1) || !readPS(expectedFileName, &expected)) {
+        return 1;
+    }
+    if (expected.find("%%Page: 2 2") == std::string::npos) {
+        fprintf(stderr, "%s has less than two pages\n", argv[1]);
+        return 1;
+    }
+
+    // The workers render their pages at the same time from the same
+    // document, so a race would show up as a difference, if not always.
+    const std::string fileName = std::string(argv[2]) + "/ps-raster-pool-4.ps";
+    for (int run = 0; run < 5; ++run) {
+        std::string contents;
+        if (!writePS(argv[1], fileName, 4) || !readPS(fileName, &contents)) {
+            return 1;
+        }
+        if (contents != expected) {
+            fprintf(stderr, "The pages rasterized on 4 threads differ from %s\n", expectedFileName.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+//========================================================================
+//
+// resource-scan-test.cc
+// A test util to check ResourceScanner on form XObjects that refer to
+// each other.
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "ResourceInfo.h"
+#include "Stream.h"
+
+static std::string stream(const std::string &dict, const std::string &data)
+{
+    return "<< " + dict + " /Length " + std::to_string(data.size()) + " >>\nstream\n" + data + "\nendstream";
+}
+
+static std::string form(const std::string &xObjects)
+{
+    return stream("/Type /XObject /Subtype /Form /BBox [0 0 10 10] /Resources << /XObject << " + xObjects + " >> >>", "");
+}
+
+static std::string image()
+{
+    return stream("/Type /XObject /Subtype /Image /Width 1 /Height 1 /ColorSpace /DeviceGray /BitsPerComponent 8", std::string(1, '\0'));
+}
+
+// Page 1 draws form A and page 2 form B, which draw each other and
+// images 1 and 2.  Page 3 draws form C, which draws itself and image 3.
+static std::string makeDocument()
+{
+    std::vector<std::string> objects;
+    objects.push_back("<< /Type /Catalog /Pages 2 0 R >>");
+    objects.push_back("<< /Type /Pages /Kids [3 0 R 4 0 R 5 0 R] /Count 3 >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 10 10] /Resources << /XObject << /A 6 0 R >> >> >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 10 10] /Resources << /XObject << /B 7 0 R >> >> >>");
+    objects.push_back("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 10 10] /Resources << /XObject << /C 10 0 R >> >> >>");
+    objects.push_back(form("/B 7 0 R /Im2 9 0 R"));
+    objects.push_back(form("/A 6 0 R /Im1 8 0 R"));
+    objects.push_back(image());
+    objects.push_back(image());
+    objects.push_back(form("/C 10 0 R /Im3 11 0 R"));
+    objects.push_back(image());
+
+    std::string data = "%PDF-1.4\n";
+    std::vector<size_t> offsets;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        offsets.push_back(data.size());
+        data += std::to_string(i + 1) + " 0 obj\n" + objects[i] + "\nendobj\n";
+    }
+    const size_t xrefOffset = data.size();
+    data += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        data += entry;
+    }
+    data += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root 1 0 R >>\nstartxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return data;
+}
+
+// Check that the image <num> 0 R was found on <expected> pages.
+static bool checkPages(const ResourceScanner &scanner, int num, const std::vector<int> &expected)
+{
+    for (const ResourceInfo &info : scanner.getResources()) {
+        if (info.getRef() == Ref { num, 0 }) {
+            if (info.getPages() != expected) {
+                std::string pages;
+                for (int pg : info.getPages()) {
+                    pages += " " + std::to_string(pg);
+                }
+                fprintf(stderr, "Image %d 0 R was found on pages%s\n", num, pages.c_str());
+                return false;
+            }
+            return true;
+        }
+    }
+    fprintf(stderr, "Image %d 0 R was not found\n", num);
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    globalParams = std::make_unique<GlobalParams>();
+
+    const std::string data = makeDocument();
+    PDFDoc doc(new MemStream(data.c_str(), 0, data.size(), Object(objNull)));
+    if (!doc.isOk()) {
+        fprintf(stderr, "Error opening the test document\n");
+        return 1;
+    }
+
+    ResourceScanner scanner(&doc);
+    scanner.scan(1, doc.getNumPages());
+
+    bool ok = true;
+    ok &= checkPages(scanner, 8, { 1, 2 });
+    ok &= checkPages(scanner, 9, { 1, 2 });
+    ok &= checkPages(scanner, 11, { 3 });
+    return ok ? 0 : 1;
+}
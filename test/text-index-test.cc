@@ -0,0 +1,117 @@
+//========================================================================
+//
+// text-index-test.cc
+// A test util to check TextIndex::save() and TextIndex::load().
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <config.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "goo/gmem.h"
+#include "goo/GooString.h"
+#include "GlobalParams.h"
+#include "PDFDoc.h"
+#include "TextIndex.h"
+#include "UTF.h"
+
+static std::unique_ptr<PDFDoc> openDocument(const char *fileName)
+{
+    auto doc = std::make_unique<PDFDoc>(std::make_unique<GooString>(fileName));
+    if (!doc->isOk()) {
+        fprintf(stderr, "Error opening %s\n", fileName);
+        return nullptr;
+    }
+    return doc;
+}
+
+static int countMatches(const TextIndex *index, const char *phrase, bool prefix)
+{
+    Unicode *ucs4;
+    const int len = utf8ToUCS4(phrase, &ucs4);
+    const int n = index->find(ucs4, len, prefix).size();
+    gfree(ucs4);
+    return n;
+}
+
+// Index <fileName> and save the index to <indexFileName>.
+static bool createIndex(const char *fileName, const std::string &indexFileName)
+{
+    std::unique_ptr<PDFDoc> doc = openDocument(fileName);
+    if (!doc) {
+        return false;
+    }
+    std::unique_ptr<TextIndex> index = TextIndex::create(doc.get());
+    if (!index->save(indexFileName.c_str(), doc.get())) {
+        fprintf(stderr, "Error saving the index of %s\n", fileName);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 5) {
+        fprintf(stderr, "Usage: %s PDF-FILE ID-LESS-PDF-FILE OTHER-ID-LESS-PDF-FILE OUTPUT-DIR\n", argv[0]);
+        return 1;
+    }
+    const std::string indexFileName = std::string(argv[4]) + "/text-index-test.idx";
+    const std::string idLessIndexFileName = std::string(argv[4]) + "/text-index-test-noid.idx";
+
+    globalParams = std::make_unique<GlobalParams>();
+
+    // Saving and loading gives the same index back.
+    if (!createIndex(argv[1], indexFileName)) {
+        return 1;
+    }
+    std::unique_ptr<PDFDoc> doc = openDocument(argv[1]);
+    if (!doc) {
+        return 1;
+    }
+    std::unique_ptr<TextIndex> created = TextIndex::create(doc.get());
+    std::unique_ptr<TextIndex> loaded = TextIndex::load(indexFileName.c_str(), doc.get());
+    if (!loaded) {
+        fprintf(stderr, "The saved index was not loaded\n");
+        return 1;
+    }
+    if (loaded->getNumPages() != doc->getNumPages() || loaded->getNumWords() != created->getNumWords()) {
+        fprintf(stderr, "The loaded index differs: %d pages, %d words instead of %d pages, %d words\n", loaded->getNumPages(), loaded->getNumWords(), doc->getNumPages(), created->getNumWords());
+        return 1;
+    }
+    for (const char *phrase : { "quick", "lazy dog", "Document Form" }) {
+        const bool prefix = phrase[0] == 'D';
+        if (countMatches(loaded.get(), phrase, prefix) != countMatches(created.get(), phrase, prefix) || countMatches(loaded.get(), phrase, prefix) == 0) {
+            fprintf(stderr, "The loaded index gives other matches for \"%s\"\n", phrase);
+            return 1;
+        }
+    }
+
+    // The index of a document is not taken for another one, be it a
+    // document with an ID or one without, even of the same size.
+    std::unique_ptr<PDFDoc> idLessDoc = openDocument(argv[2]);
+    std::unique_ptr<PDFDoc> otherIdLessDoc = openDocument(argv[3]);
+    if (!idLessDoc || !otherIdLessDoc) {
+        return 1;
+    }
+    if (TextIndex::load(indexFileName.c_str(), idLessDoc.get())) {
+        fprintf(stderr, "The index was loaded for another document\n");
+        return 1;
+    }
+    if (!createIndex(argv[2], idLessIndexFileName)) {
+        return 1;
+    }
+    if (!TextIndex::load(idLessIndexFileName.c_str(), idLessDoc.get())) {
+        fprintf(stderr, "The index of a document without ID was not loaded\n");
+        return 1;
+    }
+    if (TextIndex::load(idLessIndexFileName.c_str(), otherIdLessDoc.get()) || TextIndex::load(idLessIndexFileName.c_str(), doc.get())) {
+        fprintf(stderr, "The index of a document without ID was loaded for another document\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -280,7 +280,6 @@ HtmlPage::HtmlPage(bool rawOrderA)
     pageHeight = 0;
     fontsPageMarker = 0;
     DocName = nullptr;
-    firstPage = -1;
 }
 
 HtmlPage::~HtmlPage()
@@ -852,14 +851,10 @@ int HtmlPage::dumpComplexHeaders(FILE *const file, FILE *&pageFile, int page)
     return 0;
 }
 
-void HtmlPage::dumpComplex(FILE *file, int page, const std::vector<std::string> &backgroundImages)
+void HtmlPage::dumpComplex(FILE *file, int page, const std::string &backgroundImage)
 {
     FILE *pageFile;
 
-    if (firstPage == -1) {
-        firstPage = page;
-    }
-
     if (dumpComplexHeaders(file, pageFile, page)) {
         error(errIO, -1, "Couldn't write headers.");
         return;
@@ -886,8 +881,8 @@ void HtmlPage::dumpComplex(FILE *file, int page, const std::vector<std::string>
 
     fprintf(pageFile, "<div id=\"page%d-div\" style=\"position:relative;width:%dpx;height:%dpx;\">\n", page, pageWidth, pageHeight);
 
-    if (!ignore && (size_t)(page - firstPage) < backgroundImages.size()) {
-        fprintf(pageFile, "<img width=\"%d\" height=\"%d\" src=\"%s\" alt=\"background image\"/>\n", pageWidth, pageHeight, backgroundImages[page - firstPage].c_str());
+    if (!ignore && !backgroundImage.empty()) {
+        fprintf(pageFile, "<img width=\"%d\" height=\"%d\" src=\"%s\" alt=\"background image\"/>\n", pageWidth, pageHeight, backgroundImage.c_str());
     }
 
     for (HtmlString *tmp1 = yxStrings; tmp1; tmp1 = tmp1->yxNext) {
@@ -912,14 +907,14 @@ void HtmlPage::dumpComplex(FILE *file, int page, const std::vector<std::string>
     }
 }
 
-void HtmlPage::dump(FILE *f, int pageNum, const std::vector<std::string> &backgroundImages)
+void HtmlPage::dump(FILE *f, int pageNum, const std::string &backgroundImage)
 {
     if (complexMode || singleHtml) {
         if (xml) {
             dumpAsXML(f, pageNum);
         }
         if (!xml) {
-            dumpComplex(f, pageNum, backgroundImages);
+            dumpComplex(f, pageNum, backgroundImage);
         }
     } else {
         fprintf(f, "<a name=%d></a>", pageNum);
@@ -980,6 +975,27 @@ void HtmlPage::clear()
     links = new HtmlLinks();
 }
 
+void HtmlPage::takeContents(HtmlPage *laidOutPage)
+{
+    std::vector<int> fontMap;
+    for (int i = 0; i < laidOutPage->fonts->size(); ++i) {
+        fontMap.push_back(fonts->AddFont(*laidOutPage->fonts->Get(i)));
+    }
+    for (HtmlString *str = laidOutPage->yxStrings; str; str = str->yxNext) {
+        str->fontpos = fontMap[str->fontpos];
+        str->fonts = fonts;
+    }
+
+    yxStrings = laidOutPage->yxStrings;
+    xyStrings = laidOutPage->xyStrings;
+    laidOutPage->yxStrings = laidOutPage->xyStrings = nullptr;
+    laidOutPage->yxCur1 = laidOutPage->yxCur2 = nullptr;
+    imgList = std::move(laidOutPage->imgList);
+    laidOutPage->imgList.clear();
+    pageWidth = laidOutPage->pageWidth;
+    pageHeight = laidOutPage->pageHeight;
+}
+
 void HtmlPage::setDocName(const char *fname)
 {
     DocName = new GooString(fname);
@@ -1081,6 +1097,7 @@ HtmlOutputDev::HtmlOutputDev(Catalog *catalogA, const char *fileName, const char
     rawOrder = rawOrderA;
     this->doOutline = outline;
     ok = false;
+    layoutOnly = false;
     // this->firstPage = firstPage;
     // pageNum=firstPage;
     // open file
@@ -1184,6 +1201,27 @@ HtmlOutputDev::HtmlOutputDev(Catalog *catalogA, const char *fileName, const char
     ok = true;
 }
 
+HtmlOutputDev::HtmlOutputDev(Catalog *catalogA, const char *fileName, bool rawOrderA)
+{
+    catalog = catalogA;
+    fContentsFrame = nullptr;
+    page = nullptr;
+    docTitle = new GooString();
+    dumpJPEG = true;
+    rawOrder = rawOrderA;
+    doOutline = false;
+    needClose = false;
+    layoutOnly = true;
+    pageNum = 0;
+    maxPageWidth = 0;
+    maxPageHeight = 0;
+    docPage = nullptr;
+    pages = new HtmlPage(rawOrder);
+    pages->setDocName(fileName);
+    Docname = new GooString(fileName);
+    ok = true;
+}
+
 HtmlOutputDev::~HtmlOutputDev()
 {
     delete Docname;
@@ -1233,8 +1271,16 @@ void HtmlOutputDev::startPage(int pageNumA, GfxState *state, XRef *xref)
 #endif
 
     pageNum = pageNumA;
-    const std::string str = gbasename(Docname->c_str());
     pages->clear();
+    writePageLink();
+
+    pages->pageWidth = static_cast<int>(state->getPageWidth());
+    pages->pageHeight = static_cast<int>(state->getPageHeight());
+}
+
+void HtmlOutputDev::writePageLink()
+{
+    const std::string str = gbasename(Docname->c_str());
     if (!noframes) {
         if (fContentsFrame) {
             if (complexMode) {
@@ -1245,9 +1291,6 @@ void HtmlOutputDev::startPage(int pageNumA, GfxState *state, XRef *xref)
             fprintf(fContentsFrame, " target=\"contents\" >Page %d</a><br/>\n", pageNum);
         }
     }
-
-    pages->pageWidth = static_cast<int>(state->getPageWidth());
-    pages->pageHeight = static_cast<int>(state->getPageHeight());
 }
 
 void HtmlOutputDev::endPage()
@@ -1259,7 +1302,38 @@ void HtmlOutputDev::endPage()
 
     pages->conv();
     pages->coalesce();
-    pages->dump(page, pageNum, backgroundImages);
+
+    if (layoutOnly) {
+        finishedPage.reset(pages);
+        pages = new HtmlPage(rawOrder);
+        pages->setDocName(Docname->c_str());
+        return;
+    }
+    dumpPage();
+}
+
+void HtmlOutputDev::writePage(std::unique_ptr<HtmlPage> laidOutPage, int pageNumA)
+{
+    pageNum = pageNumA;
+    pages->clear();
+    writePageLink();
+
+    pages->takeContents(laidOutPage.get());
+    dumpPage();
+}
+
+void HtmlOutputDev::dumpPage()
+{
+    std::string backgroundImage;
+    if (!backgroundImages.empty()) {
+        backgroundImage = std::move(backgroundImages.front());
+        backgroundImages.pop_front();
+    }
+    pages->dump(page, pageNum, backgroundImage);
+    // hand the page over now, rather than when the buffer happens to fill
+    if (page) {
+        fflush(page);
+    }
 
     // I don't yet know what to do in the case when there are pages of different
     // sizes and we want complex output: running ghostscript many times
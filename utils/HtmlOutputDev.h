@@ -37,6 +37,8 @@
 #define HTMLOUTPUTDEV_H
 
 #include <cstdio>
+#include <deque>
+#include <memory>
 #include "goo/gbasename.h"
 #include "GfxFont.h"
 #include "OutputDev.h"
@@ -150,7 +152,13 @@ public:
     // number of images on the current page
     int getNumImages() { return imgList.size(); }
 
-    void dump(FILE *f, int pageNum, const std::vector<std::string> &backgroundImages);
+    void dump(FILE *f, int pageNum, const std::string &backgroundImage);
+
+    // Move the strings and images of <laidOutPage>, which was laid out
+    // with a font table of its own, to this page.  Its fonts are added
+    // to this page's font table in the order it added them, so the font
+    // numbers are the same as if this page had been laid out directly.
+    void takeContents(HtmlPage *laidOutPage);
 
     // Clear the page.
     void clear();
@@ -171,7 +179,7 @@ private:
 
     void setDocName(const char *fname);
     void dumpAsXML(FILE *f, int page);
-    void dumpComplex(FILE *f, int page, const std::vector<std::string> &backgroundImages);
+    void dumpComplex(FILE *f, int page, const std::string &backgroundImage);
     int dumpComplexHeaders(FILE *const file, FILE *&pageFile, int page);
 
     // marks the position of the fonts that belong to current page (for noframes)
@@ -183,7 +191,6 @@ private:
     GooString *DocName;
     int pageWidth;
     int pageHeight;
-    int firstPage; // used to begin the numeration of pages
 
     friend class HtmlOutputDev;
 };
@@ -222,6 +229,12 @@ public:
     // stream order.
     HtmlOutputDev(Catalog *catalogA, const char *fileName, const char *title, const char *author, const char *keywords, const char *subject, const char *date, bool rawOrder, int firstPage = 1, bool outline = false);
 
+    // Create a device that only lays pages out, for converting pages in
+    // parallel: nothing is written, endPage() keeps the finished page
+    // for takePage() instead.  <fileName> is the base name of the
+    // output, used to name image files.
+    HtmlOutputDev(Catalog *catalogA, const char *fileName, bool rawOrder);
+
     // Destructor.
     ~HtmlOutputDev() override;
 
@@ -261,8 +274,17 @@ public:
 
     // add a background image to the list of background images,
     // as this seems to be done outside other processing. takes ownership of img.
+    // Each page written takes the oldest one, so they can be added one
+    // at a time, just before their page is displayed.
     void addBackgroundImage(const std::string &img);
 
+    // Take the page laid out by the last endPage() of a layout device.
+    std::unique_ptr<HtmlPage> takePage() { return std::move(finishedPage); }
+
+    // Write <laidOutPage>, page <pageNumA> as laid out by a layout
+    // device.  Pages have to be written in order.
+    void writePage(std::unique_ptr<HtmlPage> laidOutPage, int pageNumA);
+
     //----- update text state
     void updateFont(GfxState *state) override;
 
@@ -290,6 +312,8 @@ private:
     GooString *getLinkDest(AnnotLink *link);
     void dumpMetaVars(FILE *);
     void doFrame(int firstPage);
+    void writePageLink();
+    void dumpPage();
     bool newHtmlOutlineLevel(FILE *output, const std::vector<OutlineItem *> *outlines, int level = 1);
     void newXmlOutlineLevel(FILE *output, const std::vector<OutlineItem *> *outlines);
     int getOutlinePageNum(OutlineItem *item);
@@ -306,6 +330,8 @@ private:
     bool rawOrder; // keep text in content stream order
     bool doOutline; // output document outline
     bool ok; // set up ok?
+    bool layoutOnly; // lay pages out for takePage() without writing them
+    std::unique_ptr<HtmlPage> finishedPage; // last page laid out, if layoutOnly
     bool dumpJPEG;
     int pageNum;
     int maxPageWidth;
@@ -315,7 +341,7 @@ private:
     std::vector<HtmlMetaVar *> glMetaVars;
     Catalog *catalog;
     Page *docPage;
-    std::vector<std::string> backgroundImages;
+    std::deque<std::string> backgroundImages;
     friend class HtmlPage;
 };
 
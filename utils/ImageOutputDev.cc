@@ -42,13 +42,18 @@
 #include <cstddef>
 #include <cctype>
 #include <cmath>
+#include <cstring>
+#include <string>
 #include "goo/gmem.h"
 #include "goo/NetPBMWriter.h"
 #include "goo/PNGWriter.h"
 #include "goo/TiffWriter.h"
 #include "Error.h"
+#include "Gfx.h"
 #include "GfxState.h"
 #include "Object.h"
+#include "Page.h"
+#include "PDFDoc.h"
 #include "Stream.h"
 #include "JBIG2Stream.h"
 #include "ImageOutputDev.h"
@@ -71,6 +76,12 @@ ImageOutputDev::ImageOutputDev(char *fileRootA, bool pageNamesA, bool listImages
     imgNum = 0;
     pageNum = 0;
     errorCode = 0;
+    dedupImages = false;
+    scanning = false;
+    xref = nullptr;
+    numThreads = 1;
+    jobsDone = false;
+    workerErrorCode = 0;
     if (listImages) {
         printf("page   num  type   width height color comp bpc  enc interp  object ID x-ppi y-ppi size ratio\n");
         printf("--------------------------------------------------------------------------------------------\n");
@@ -79,6 +90,7 @@ ImageOutputDev::ImageOutputDev(char *fileRootA, bool pageNamesA, bool listImages
 
 ImageOutputDev::~ImageOutputDev()
 {
+    waitForImages();
     if (!listImages) {
         gfree(fileName);
         gfree(fileRoot);
@@ -94,6 +106,25 @@ void ImageOutputDev::setFilename(const char *fileExt)
     }
 }
 
+// Is the image drawn an image XObject that can be fetched again?  Gfx
+// passes no ref for inline images, which have no identity to dedupe on.
+static bool isImageXObject(Object *ref, bool inlineImg)
+{
+    return !inlineImg && ref && ref->isRef();
+}
+
+// Returns the number of the first image written or listed for <ref>
+// and <imageType>, or -1 if this is the first one, or the image isn't
+// an XObject.
+int ImageOutputDev::lookupImage(Object *ref, bool inlineImg, ImageType imageType)
+{
+    if (!isImageXObject(ref, inlineImg)) {
+        return -1;
+    }
+    const auto [it, inserted] = imageNums.try_emplace({ ref->getRef(), imageType }, imgNum);
+    return inserted ? -1 : it->second;
+}
+
 // Print a floating point number between 0 - 9999 using 4 characters
 // eg '1.23', '12.3', ' 123', '1234'
 //
@@ -128,7 +159,8 @@ void ImageOutputDev::listImage(GfxState *state, Object *ref, Stream *str, int wi
     const char *enc;
     int components, bpc;
 
-    printf("%4d %5d ", pageNum, imgNum);
+    const int firstNum = dedupImages ? lookupImage(ref, inlineImg, imageType) : -1;
+    printf("%4d %5d ", pageNum, firstNum >= 0 ? firstNum : imgNum);
     type = "";
     switch (imageType) {
     case imgImage:
@@ -230,20 +262,25 @@ void ImageOutputDev::listImage(GfxState *state, Object *ref, Stream *str, int wi
         printf("[none]     ");
     }
 
-    const double *mat = state->getCTM();
-    double width2 = sqrt(mat[0] * mat[0] + mat[1] * mat[1]);
-    double height2 = sqrt(mat[2] * mat[2] + mat[3] * mat[3]);
-    double xppi = fabs(width * 72.0 / width2);
-    double yppi = fabs(height * 72.0 / height2);
-    if (xppi < 1.0) {
-        printf("%5.3f ", xppi);
-    } else {
-        printf("%5.0f ", xppi);
-    }
-    if (yppi < 1.0) {
-        printf("%5.3f ", yppi);
+    if (scanning) {
+        // the image isn't placed on the page, so there is no resolution
+        printf("    -     - ");
     } else {
-        printf("%5.0f ", yppi);
+        const double *mat = state->getCTM();
+        double width2 = sqrt(mat[0] * mat[0] + mat[1] * mat[1]);
+        double height2 = sqrt(mat[2] * mat[2] + mat[3] * mat[3]);
+        double xppi = fabs(width * 72.0 / width2);
+        double yppi = fabs(height * 72.0 / height2);
+        if (xppi < 1.0) {
+            printf("%5.3f ", xppi);
+        } else {
+            printf("%5.0f ", xppi);
+        }
+        if (yppi < 1.0) {
+            printf("%5.3f ", yppi);
+        } else {
+            printf("%5.0f ", yppi);
+        }
     }
 
     Goffset embedSize = -1;
@@ -295,7 +332,9 @@ void ImageOutputDev::listImage(GfxState *state, Object *ref, Stream *str, int wi
         printf("   - \n");
     }
 
-    ++imgNum;
+    if (firstNum < 0) {
+        ++imgNum;
+    }
 }
 
 long ImageOutputDev::getInlineImageLength(Stream *str, int width, int height, GfxImageColorMap *colorMap)
@@ -698,6 +737,234 @@ void ImageOutputDev::writeImage(GfxState *state, Object *ref, Stream *str, int w
     }
 }
 
+void ImageOutputDev::saveImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool inlineImg, ImageType imageType)
+{
+    if (dedupImages && lookupImage(ref, inlineImg, imageType) >= 0) {
+        return;
+    }
+    if (!(numThreads > 1 && isImageXObject(ref, inlineImg) && xref && queueImage(ref, width, height, colorMap, imageType))) {
+        writeImage(state, ref, str, width, height, colorMap, inlineImg);
+    }
+}
+
+// Hand the image to a worker thread.  The worker fetches the XObject
+// again through an XRef of its own, so it gets streams of its own to
+// decode; only the color map has to be copied.  Returns false if there
+// are no workers to hand it to.
+bool ImageOutputDev::queueImage(Object *ref, int width, int height, GfxImageColorMap *colorMap, ImageType imageType)
+{
+    if (workers.empty()) {
+        // copied here, while the document's XRef isn't read by anyone else
+        std::vector<std::unique_ptr<XRef>> workerXRefs;
+        for (int i = 0; i < numThreads; ++i) {
+            workerXRefs.emplace_back(xref->copy());
+            if (!workerXRefs.back()) {
+                numThreads = 1;
+                return false;
+            }
+        }
+        jobsDone = false;
+        for (std::unique_ptr<XRef> &workerXRef : workerXRefs) {
+            workers.emplace_back(&ImageOutputDev::imageWorker, this, std::move(workerXRef));
+        }
+    }
+
+    ImageJob job;
+    job.ref = ref->getRef();
+    job.imageType = imageType;
+    job.width = width;
+    job.height = height;
+    job.colorMap.reset(colorMap ? colorMap->copy() : nullptr);
+    job.pageNum = pageNum;
+    job.imgNum = imgNum;
+    // every image written uses one number, see writeImage()
+    ++imgNum;
+
+    {
+        std::unique_lock<std::mutex> lock(jobMutex);
+        jobCond.wait(lock, [&] { return jobs.size() < 2 * workers.size(); });
+        jobs.push_back(std::move(job));
+    }
+    jobCond.notify_all();
+    return true;
+}
+
+void ImageOutputDev::waitForImages()
+{
+    if (workers.empty()) {
+        return;
+    }
+
+    {
+        std::scoped_lock lock { jobMutex };
+        jobsDone = true;
+    }
+    jobCond.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    if (workerErrorCode != 0) {
+        errorCode = workerErrorCode;
+    }
+}
+
+// The stream of the mask of <imageType> of the image with dictionary
+// <dict>, found the same way Gfx::doImage() does.
+static Object lookupMaskStream(Dict *dict, ImageOutputDev::ImageType imageType)
+{
+    Object maskObj = dict->lookup("Mask");
+    if (imageType == ImageOutputDev::imgMask) {
+        return maskObj;
+    }
+    if (maskObj.isStream()) {
+        Dict *maskDict = maskObj.streamGetDict();
+        Object obj = maskDict->lookup("ImageMask");
+        if (obj.isNull()) {
+            obj = maskDict->lookup("IM");
+        }
+        if (maskDict->lookup("Type").isName("XObject") && maskDict->lookup("Subtype").isName("Image") && !obj.isBool()) {
+            return maskObj;
+        }
+    }
+    return dict->lookup("SMask");
+}
+
+void ImageOutputDev::imageWorker(std::unique_ptr<XRef> workerXRef)
+{
+    // each worker writes through an ImageOutputDev of its own, for the
+    // file name buffer and the error code
+    ImageOutputDev out(fileRoot, pageNames, false);
+    out.enablePNG(outputPNG);
+    out.enableTiff(outputTiff);
+    out.enableJpeg(dumpJPEG);
+    out.enableJpeg2000(dumpJP2);
+    out.enableJBig2(dumpJBIG2);
+    out.enableCCITT(dumpCCITT);
+    out.enablePrintFilenames(printFilenames);
+
+    while (true) {
+        ImageJob job;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobCond.wait(lock, [&] { return !jobs.empty() || jobsDone; });
+            if (jobs.empty()) {
+                break;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        jobCond.notify_all();
+
+        Object refObj(job.ref);
+        Object imageObj = workerXRef->fetch(job.ref);
+        if (!imageObj.isStream()) {
+            continue;
+        }
+        Object maskObj;
+        Stream *str = imageObj.getStream();
+        if (job.imageType == imgMask || job.imageType == imgSmask) {
+            maskObj = lookupMaskStream(imageObj.streamGetDict(), job.imageType);
+            if (!maskObj.isStream()) {
+                continue;
+            }
+            str = maskObj.getStream();
+        }
+
+        out.pageNum = job.pageNum;
+        out.imgNum = job.imgNum;
+        out.writeImage(nullptr, &refObj, str, job.width, job.height, job.colorMap.get(), false);
+    }
+
+    if (!out.isOk()) {
+        std::scoped_lock lock { jobMutex };
+        workerErrorCode = out.getErrorCode();
+    }
+}
+
+// Draw the XObject <name> of the current resources, as "/<name> Do".
+static void doXObject(Gfx *gfx, const char *name)
+{
+    std::string content = "/";
+    for (const char *p = name; *p; ++p) {
+        const unsigned char c = *p;
+        if (c <= 0x20 || c >= 0x7f || strchr("()<>[]{}/%#", c)) {
+            char hex[4];
+            sprintf(hex, "#%02x", c);
+            content += hex;
+        } else {
+            content += c;
+        }
+    }
+    content += " Do";
+
+    Object str(static_cast<Stream *>(new MemStream(content.data(), 0, content.size(), Object(objNull))));
+    gfx->display(&str);
+}
+
+void ImageOutputDev::scanResources(Gfx *gfx, Dict *resDict, std::set<Ref> *visited)
+{
+    // forms and tiling patterns have resources of their own
+    auto scanSubResources = [&](Object *obj) {
+        Object resObj = obj->streamGetDict()->lookup("Resources");
+        if (resObj.isDict()) {
+            gfx->pushResources(resObj.getDict());
+            scanResources(gfx, resObj.getDict(), visited);
+            gfx->popResources();
+        }
+    };
+
+    Object xObjects = resDict->lookup("XObject");
+    if (xObjects.isDict()) {
+        for (int i = 0; i < xObjects.dictGetLength(); ++i) {
+            const Object &xObjectRef = xObjects.dictGetValNF(i);
+            if (xObjectRef.isRef() && !visited->insert(xObjectRef.getRef()).second) {
+                continue;
+            }
+            Object xObject = xObjects.dictGetVal(i);
+            if (!xObject.isStream()) {
+                continue;
+            }
+            Object subtype = xObject.streamGetDict()->lookup("Subtype");
+            if (subtype.isName("Image")) {
+                doXObject(gfx, xObjects.dictGetKey(i));
+            } else if (subtype.isName("Form")) {
+                scanSubResources(&xObject);
+            }
+        }
+    }
+
+    Object patterns = resDict->lookup("Pattern");
+    if (patterns.isDict()) {
+        for (int i = 0; i < patterns.dictGetLength(); ++i) {
+            const Object &patternRef = patterns.dictGetValNF(i);
+            if (patternRef.isRef() && !visited->insert(patternRef.getRef()).second) {
+                continue;
+            }
+            Object pattern = patterns.dictGetVal(i);
+            if (pattern.isStream()) {
+                scanSubResources(&pattern);
+            }
+        }
+    }
+}
+
+void ImageOutputDev::scanPageResources(PDFDoc *doc, int pg)
+{
+    Page *page = doc->getPage(pg);
+    if (!page || !page->getResourceDict()) {
+        return;
+    }
+
+    // the Gfx calls startPage()
+    std::unique_ptr<Gfx> gfx(page->createGfx(this, 72, 72, 0, true, false, -1, -1, -1, -1, false, nullptr, nullptr));
+    std::set<Ref> visited;
+    scanning = true;
+    scanResources(gfx.get(), page->getResourceDict(), &visited);
+    scanning = false;
+}
+
 bool ImageOutputDev::tilingPatternFill(GfxState *state, Gfx *gfx, Catalog *cat, GfxTilingPattern *tPat, const double *mat, int x0, int y0, int x1, int y1, double xStep, double yStep)
 {
     return true;
@@ -709,7 +976,7 @@ void ImageOutputDev::drawImageMask(GfxState *state, Object *ref, Stream *str, in
     if (listImages) {
         listImage(state, ref, str, width, height, nullptr, interpolate, inlineImg, imgStencil);
     } else {
-        writeImage(state, ref, str, width, height, nullptr, inlineImg);
+        saveImage(state, ref, str, width, height, nullptr, inlineImg, imgStencil);
     }
 }
 
@@ -718,7 +985,7 @@ void ImageOutputDev::drawImage(GfxState *state, Object *ref, Stream *str, int wi
     if (listImages) {
         listImage(state, ref, str, width, height, colorMap, interpolate, inlineImg, imgImage);
     } else {
-        writeImage(state, ref, str, width, height, colorMap, inlineImg);
+        saveImage(state, ref, str, width, height, colorMap, inlineImg, imgImage);
     }
 }
 
@@ -728,8 +995,8 @@ void ImageOutputDev::drawMaskedImage(GfxState *state, Object *ref, Stream *str,
         listImage(state, ref, str, width, height, colorMap, interpolate, false, imgImage);
         listImage(state, ref, maskStr, maskWidth, maskHeight, nullptr, maskInterpolate, false, imgMask);
     } else {
-        writeImage(state, ref, str, width, height, colorMap, false);
-        writeImage(state, ref, maskStr, maskWidth, maskHeight, nullptr, false);
+        saveImage(state, ref, str, width, height, colorMap, false, imgImage);
+        saveImage(state, ref, maskStr, maskWidth, maskHeight, nullptr, false, imgMask);
     }
 }
 
@@ -740,7 +1007,7 @@ void ImageOutputDev::drawSoftMaskedImage(GfxState *state, Object *ref, Stream *s
         listImage(state, ref, str, width, height, colorMap, interpolate, false, imgImage);
         listImage(state, ref, maskStr, maskWidth, maskHeight, maskColorMap, maskInterpolate, false, imgSmask);
     } else {
-        writeImage(state, ref, str, width, height, colorMap, false);
-        writeImage(state, ref, maskStr, maskWidth, maskHeight, maskColorMap, false);
+        saveImage(state, ref, str, width, height, colorMap, false, imgImage);
+        saveImage(state, ref, maskStr, maskWidth, maskHeight, maskColorMap, false, imgSmask);
     }
 }
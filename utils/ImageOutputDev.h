@@ -33,11 +33,21 @@
 
 #include "poppler/poppler-config.h"
 
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 #include "goo/ImgWriter.h"
 #include "OutputDev.h"
 
+class Gfx;
 class GfxState;
+class PDFDoc;
 
 //------------------------------------------------------------------------
 // ImageOutputDev
@@ -94,6 +104,26 @@ public:
     // Print filenames to stdout after writing
     void enablePrintFilenames(bool filenames) { printFilenames = filenames; }
 
+    // Write each image XObject only once, the first time it is drawn.
+    // When listing, later uses are listed with the number of the image
+    // they repeat.
+    void enableDedup(bool dedup) { dedupImages = dedup; }
+
+    // Decode and write image XObjects on <n> threads, while the pages
+    // are being scanned for more images.  Call waitForImages() before
+    // looking at the error code.
+    void setNumThreads(int n) { numThreads = n; }
+
+    // Wait until all the images queued for the worker threads are
+    // written.
+    void waitForImages();
+
+    // Find the images of page <pg> by walking its resources, and those
+    // of the forms and patterns they use, instead of running its content
+    // stream.  Every image XObject in the resources is found whether
+    // the page draws it or not, and inline images are not found at all.
+    void scanPageResources(PDFDoc *doc, int pg);
+
     // Get the error code
     // 0 = No error, 1 = Error opening a PDF file, 2 = Error opening an output file, 3 = Error related to PDF permissions, 99 = Other error.
     int getErrorCode() const { return errorCode; }
@@ -114,7 +144,11 @@ public:
     bool needNonText() override { return true; }
 
     // Start a page
-    void startPage(int pageNumA, GfxState *state, XRef *xref) override { pageNum = pageNumA; }
+    void startPage(int pageNumA, GfxState *state, XRef *xrefA) override
+    {
+        pageNum = pageNumA;
+        xref = xrefA;
+    }
 
     //---- get info about output device
 
@@ -136,9 +170,24 @@ public:
                              bool maskInterpolate) override;
 
 private:
+    // An image XObject, or its mask, to be written by a worker thread.
+    struct ImageJob
+    {
+        Ref ref; // the image XObject
+        ImageType imageType;
+        int width, height;
+        std::unique_ptr<GfxImageColorMap> colorMap;
+        int pageNum, imgNum;
+    };
+
     // Sets the output filename with a given file extension
     void setFilename(const char *fileExt);
+    int lookupImage(Object *ref, bool inlineImg, ImageType imageType);
     void listImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool interpolate, bool inlineImg, ImageType imageType);
+    void saveImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool inlineImg, ImageType imageType);
+    bool queueImage(Object *ref, int width, int height, GfxImageColorMap *colorMap, ImageType imageType);
+    void imageWorker(std::unique_ptr<XRef> workerXRef);
+    void scanResources(Gfx *gfx, Dict *resDict, std::set<Ref> *visited);
     void writeImage(GfxState *state, Object *ref, Stream *str, int width, int height, GfxImageColorMap *colorMap, bool inlineImg);
     void writeRawImage(Stream *str, const char *ext);
     void writeImageFile(ImgWriter *writer, ImageFormat format, const char *ext, Stream *str, int width, int height, GfxImageColorMap *colorMap);
@@ -158,6 +207,19 @@ private:
     int pageNum; // current page number
     int imgNum; // current image number
     int errorCode; // code for any error creating the output files
+    bool dedupImages; // set to write every image XObject only once
+    std::map<std::pair<Ref, int>, int> imageNums; // (XObject, image type) -> number of its first image
+    bool scanning; // set while scanning page resources
+    XRef *xref; // xref of the current page
+
+    // worker threads
+    int numThreads;
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::condition_variable jobCond;
+    std::deque<ImageJob> jobs; // images waiting for a worker
+    bool jobsDone; // set when no more images will be queued
+    int workerErrorCode; // error code reported by a worker
 };
 
 #endif
@@ -0,0 +1,94 @@
+//========================================================================
+//
+// pagejobs.h
+//
+// This file is licensed under the GPLv2 or later
+//
+// To see a description of the changes please see the Changelog file that
+// came with your tarball or type make ChangeLog if you are building from git
+//
+//========================================================================
+
+#ifndef PAGEJOBS_H
+#define PAGEJOBS_H
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Calls <work> for every page in [<first>, <last>] on up to <nThreads>
+// worker threads, and <emit> with each result from the calling thread,
+// in page order.  <work> also gets the index of the worker thread
+// (0..nThreads-1) so callers can keep per thread state, such as an
+// OutputDev, without locking.  Only a few pages per thread are worked
+// on ahead of the page being emitted, so memory use stays bounded
+// whatever the page count.  With a single thread everything runs
+// sequentially on the calling thread.
+template<typename Result>
+void runOrderedPageJobs(int first, int last, int nThreads, const std::function<Result(int page, int thread)> &work, const std::function<void(int page, Result &result)> &emit)
+{
+    if (nThreads <= 1 || first >= last) {
+        for (int page = first; page <= last; ++page) {
+            Result result = work(page, 0);
+            emit(page, result);
+        }
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::map<int, Result> done;
+    int nextPage = first; // next page to hand out to a worker
+    int nextEmit = first; // next page to emit
+    const int window = 4 * nThreads;
+
+    auto worker = [&](int thread) {
+        while (true) {
+            int page;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return nextPage > last || nextPage < nextEmit + window; });
+                if (nextPage > last) {
+                    return;
+                }
+                page = nextPage++;
+            }
+            Result result = work(page, thread);
+            {
+                std::scoped_lock lock { mutex };
+                done.emplace(page, std::move(result));
+            }
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads);
+    for (int i = 0; i < nThreads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+
+    while (nextEmit <= last) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return done.find(nextEmit) != done.end(); });
+            result = std::move(done.extract(nextEmit).mapped());
+        }
+        emit(nextEmit, result);
+        {
+            std::scoped_lock lock { mutex };
+            ++nextEmit;
+        }
+        cond.notify_all();
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+#endif
@@ -66,6 +66,9 @@ static bool dumpCCITT = false;
 static bool allFormats = false;
 static bool pageNames = false;
 static bool printFilenames = false;
+static bool dedupImages = false;
+static bool scanResources = false;
+static int numJobs = 1;
 static char ownerPassword[33] = "\001";
 static char userPassword[33] = "\001";
 static bool quiet = false;
@@ -90,6 +93,9 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-upw", argString, userPassword, sizeof(userPassword), "user password (for encrypted files)" },
                                    { "-p", argFlag, &pageNames, 0, "include page numbers in output file names" },
                                    { "-print-filenames", argFlag, &printFilenames, 0, "print image filenames to stdout" },
+                                   { "-dedup", argFlag, &dedupImages, 0, "write images used several times only once" },
+                                   { "-resources", argFlag, &scanResources, 0, "find images in the page resources instead of the page contents" },
+                                   { "-jobs", argInt, &numJobs, 0, "number of threads writing images" },
                                    { "-q", argFlag, &quiet, 0, "don't print any messages or errors" },
                                    { "-v", argFlag, &printVersion, 0, "print copyright and version info" },
                                    { "-h", argFlag, &printHelp, 0, "print usage information" },
@@ -192,7 +198,16 @@ int main(int argc, char *argv[])
             imgOut->enableCCITT(dumpCCITT);
         }
         imgOut->enablePrintFilenames(printFilenames);
-        doc->displayPages(imgOut, firstPage, lastPage, 72, 72, 0, true, false, false);
+        imgOut->enableDedup(dedupImages);
+        imgOut->setNumThreads(numJobs);
+        if (scanResources) {
+            for (int pg = firstPage; pg <= lastPage; ++pg) {
+                imgOut->scanPageResources(doc.get(), pg);
+            }
+        } else {
+            doc->displayPages(imgOut, firstPage, lastPage, 72, 72, 0, true, false, false);
+        }
+        imgOut->waitForImages();
     }
     const int exitCode = imgOut->isOk() ? 0 : imgOut->getErrorCode();
     delete imgOut;
@@ -67,6 +67,7 @@
 #include "Error.h"
 #include "DateInfo.h"
 #include "JSInfo.h"
+#include "ResourceInfo.h"
 #include "StructTreeRoot.h"
 #include "StructElement.h"
 #include "Win32Console.h"
@@ -89,6 +90,7 @@ static bool printStructure = false;
 static bool printStructureText = false;
 static bool printDests = false;
 static bool printUrls = false;
+static bool printResources = false;
 
 static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to convert" },
                                    { "-l", argInt, &lastPage, 0, "last page to convert" },
@@ -102,6 +104,7 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-rawdates", argFlag, &rawDates, 0, "print the undecoded date strings directly from the PDF file" },
                                    { "-dests", argFlag, &printDests, 0, "print all named destinations in the PDF" },
                                    { "-url", argFlag, &printUrls, 0, "print all URLs inside PDF objects (does not scan text content)" },
+                                   { "-resources", argFlag, &printResources, 0, "print the fonts, images, color spaces and shadings used by the pages" },
                                    { "-enc", argString, textEncName, sizeof(textEncName), "output text encoding name" },
                                    { "-listenc", argFlag, &printEnc, 0, "list available encodings" },
                                    { "-opw", argString, ownerPassword, sizeof(ownerPassword), "owner password (for encrypted files)" },
@@ -428,6 +431,59 @@ static void printUrlList(PDFDoc *doc)
     }
 }
 
+// Prints a sorted page list with runs of pages as ranges, e.g. "1-3,5".
+static void printPageRanges(const std::vector<int> &pages)
+{
+    for (size_t i = 0; i < pages.size(); ++i) {
+        size_t j = i;
+        while (j + 1 < pages.size() && pages[j + 1] == pages[j] + 1) {
+            ++j;
+        }
+        printf("%s%d", i > 0 ? "," : "", pages[i]);
+        if (j > i) {
+            printf("-%d", pages[j]);
+        }
+        i = j;
+    }
+}
+
+static void printResourceList(PDFDoc *doc)
+{
+    static const char *kindNames[] = { "font", "image", "colorspace", "shading" };
+
+    ResourceScanner scanner(doc);
+    scanner.scan(firstPage, lastPage);
+
+    printf("kind       name                                 type            details           object ID pages\n");
+    printf("---------- ------------------------------------ --------------- ----------------- --------- -----\n");
+    for (const ResourceInfo &res : scanner.getResources()) {
+        std::string name = res.getName();
+        std::string details;
+        switch (res.getKind()) {
+        case ResourceInfo::font:
+            if (!res.getFontName().empty()) {
+                name = res.getFontName();
+            }
+            details = res.getEmbedded() ? "emb" : "";
+            break;
+        case ResourceInfo::image:
+            details = std::to_string(res.getWidth()) + "x" + std::to_string(res.getHeight()) + " " + std::to_string(res.getBitsPerComponent()) + "bpc";
+            break;
+        case ResourceInfo::colorSpace:
+        case ResourceInfo::shading:
+            break;
+        }
+        printf("%-10s %-36s %-15s %-17s", kindNames[res.getKind()], name.c_str(), res.getType().c_str(), details.c_str());
+        if (res.getRef() != Ref::INVALID()) {
+            printf(" %6d %2d ", res.getRef().num, res.getRef().gen);
+        } else {
+            printf(" [direct] ");
+        }
+        printPageRanges(res.getPages());
+        printf("\n");
+    }
+}
+
 static void printPdfSubtype(PDFDoc *doc, const UnicodeMap *uMap)
 {
     const Object info = doc->getDocInfo();
@@ -1027,6 +1083,8 @@ int main(int argc, char *argv[])
         printDestinations(doc.get(), uMap);
     } else if (printUrls) {
         printUrlList(doc.get());
+    } else if (printResources) {
+        printResourceList(doc.get());
     } else {
         // print info
         long long filesize = 0;
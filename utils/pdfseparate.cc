@@ -27,15 +27,19 @@
 #include "ErrorCodes.h"
 #include "GlobalParams.h"
 #include "Win32Console.h"
+#include "pagejobs.h"
+#include <algorithm>
 #include <cctype>
 
 static int firstPage = 0;
 static int lastPage = 0;
+static int numThreads = 1;
 static bool printVersion = false;
 static bool printHelp = false;
 
 static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to extract" },
                                    { "-l", argInt, &lastPage, 0, "last page to extract" },
+                                   { "-j", argInt, &numThreads, 0, "number of pages to extract in parallel (default is 1)" },
                                    { "-v", argFlag, &printVersion, 0, "print copyright and version info" },
                                    { "-h", argFlag, &printHelp, 0, "print usage information" },
                                    { "-help", argFlag, &printHelp, 0, "print usage information" },
@@ -45,7 +49,6 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
 
 static bool extractPages(const char *srcFileName, const char *destFileName)
 {
-    char pathName[4096];
     PDFDoc *doc = new PDFDoc(std::make_unique<GooString>(srcFileName));
 
     if (!doc->isOk()) {
@@ -117,19 +120,37 @@ static bool extractPages(const char *srcFileName, const char *destFileName)
     }
     free(auxDestFileName);
 
-    for (int pageNo = firstPage; pageNo <= lastPage; pageNo++) {
-        snprintf(pathName, sizeof(pathName) - 1, destFileName, pageNo);
-        PDFDoc *pagedoc = new PDFDoc(std::make_unique<GooString>(srcFileName));
-        int errCode = pagedoc->savePageAs(GooString(pathName), pageNo);
-        if (errCode != errNone) {
-            delete doc;
-            delete pagedoc;
-            return false;
-        }
-        delete pagedoc;
+    // savePageAs changes the objects it reads, so every page is saved
+    // through its own copy of the XRef, which also lets pages be saved in
+    // parallel from this one document.  The special flags are scanned once
+    // here and copied along with the entries.
+    doc->getXRef()->scanSpecialFlags();
+    numThreads = std::min(numThreads, lastPage - firstPage + 1);
+    if (numThreads < 1) {
+        numThreads = 1;
     }
+    bool ok = true;
+    runOrderedPageJobs<int>(
+            firstPage, lastPage, numThreads,
+            [&](int pageNo, int) {
+                if (numThreads == 1 && !ok) { // stop at the first failure, as before
+                    return (int)errNone;
+                }
+                char pathName[4096];
+                snprintf(pathName, sizeof(pathName) - 1, destFileName, pageNo);
+                const std::unique_ptr<XRef> pageXRef(doc->getXRef()->copy());
+                if (!pageXRef) {
+                    return (int)errOpenFile;
+                }
+                return doc->savePageAs(GooString(pathName), pageNo, pageXRef.get());
+            },
+            [&](int, int &errCode) {
+                if (errCode != errNone) {
+                    ok = false;
+                }
+            });
     delete doc;
-    return true;
+    return ok;
 }
 
 static constexpr int kOtherError = 99;
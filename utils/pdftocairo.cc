@@ -71,6 +71,7 @@
 #include "CairoOutputDev.h"
 #include "Win32Console.h"
 #include "numberofcharacters.h"
+#include "pngoptions.h"
 #ifdef USE_CMS
 #    include <lcms2.h>
 #endif
@@ -145,6 +146,11 @@ static int jpegQuality = -1;
 static bool jpegProgressive = false;
 static bool jpegOptimize = false;
 
+static GooString pngOpt;
+#ifdef ENABLE_LIBPNG
+static PngOptions pngOptions;
+#endif
+
 static GooString printer;
 static GooString printOpt;
 #ifdef CAIRO_HAS_WIN32_SURFACE
@@ -154,6 +160,7 @@ static bool setupdlg = false;
 static const ArgDesc argDesc[] = {
 #ifdef ENABLE_LIBPNG
     { "-png", argFlag, &png, 0, "generate a PNG file" },
+    { "-pngopt", argGooString, &pngOpt, 0, "png options, with format <opt1>=<val1>[,<optN>=<valN>]*" },
 #endif
 #ifdef ENABLE_LIBJPEG
     { "-jpeg", argFlag, &jpeg, 0, "generate a JPEG file" },
@@ -359,6 +366,12 @@ static void writePageImage(GooString *filename)
             writer = new PNGWriter(PNGWriter::RGB);
         }
 
+        if (pngOptions.compressionLevel >= 0) {
+            static_cast<PNGWriter *>(writer)->setCompressionLevel(pngOptions.compressionLevel);
+        }
+        static_cast<PNGWriter *>(writer)->setFilter(static_cast<PNGWriter::Filter>(pngOptions.filter));
+        static_cast<PNGWriter *>(writer)->setNumThreads(pngOptions.threads);
+
 #    ifdef USE_CMS
         if (icc_data) {
             cmsUInt8Number profileID[17];
@@ -1031,6 +1044,18 @@ int main(int argc, char *argv[])
         }
     }
 
+#ifdef ENABLE_LIBPNG
+    if (pngOpt.getLength() > 0) {
+        if (!png) {
+            fprintf(stderr, "Error: -pngopt may only be used with png output.\n");
+            exit(99);
+        }
+        if (!parsePngOptions(pngOpt, &pngOptions)) {
+            exit(99);
+        }
+    }
+#endif
+
     if (strlen(tiffCompressionStr) > 0 && !tiff) {
         fprintf(stderr, "Error: -tiffcompression may only be used with tiff output.\n");
         exit(99);
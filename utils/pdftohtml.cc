@@ -47,6 +47,10 @@
 #    include <dirent.h>
 #endif
 #include <ctime>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
 #include "parseargs.h"
 #include "goo/GooString.h"
 #include "goo/gbase64.h"
@@ -73,6 +77,7 @@
 #include "Win32Console.h"
 #include "InMemoryFile.h"
 #include "UTF.h"
+#include "pagejobs.h"
 
 static int firstPage = 1;
 static int lastPage = 0;
@@ -100,6 +105,7 @@ bool fontFullName = false;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static bool printVersion = false;
+static int numThreads = 1;
 
 static std::unique_ptr<GooString> getInfoString(Dict *infoDict, const char *key);
 static GooString *getInfoDate(Dict *infoDict, const char *key);
@@ -137,6 +143,7 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-nodrm", argFlag, &noDrm, 0, "override document DRM settings" },
                                    { "-wbt", argFP, &wordBreakThreshold, 0, "word break threshold (default 10 percent)" },
                                    { "-fontfullname", argFlag, &fontFullName, 0, "outputs font full name" },
+                                   { "-j", argInt, &numThreads, 0, "number of pages to convert concurrently (default is 1)" },
                                    {} };
 
 class SplashOutputDevNoText : public SplashOutputDev
@@ -156,6 +163,30 @@ public:
 
 SplashOutputDevNoText::~SplashOutputDevNoText() = default;
 
+// Renders the background of page <pg> and writes it to an image file, or
+// to a data URL with -dataurls.  Returns what the HTML should refer to
+// the image by, or an empty string if it couldn't be written.  Set
+// <copyXRef> when other threads render pages of <doc> at the same time.
+static std::string renderBackground(PDFDoc *doc, SplashOutputDev *splashOut, int pg, const GooString *htmlFileName, SplashImageFileFormat format, bool copyXRef)
+{
+    InMemoryFile imf;
+    doc->displayPage(splashOut, pg, 72 * scale, 72 * scale, 0, true, false, false, nullptr, nullptr, nullptr, nullptr, copyXRef);
+    SplashBitmap *bitmap = splashOut->getBitmap();
+
+    const std::string imgFileName = GooString::format("{0:s}{1:03d}.{2:s}", htmlFileName->c_str(), pg, extension);
+    auto f1 = dataUrls ? imf.open("wb") : fopen(imgFileName.c_str(), "wb");
+    if (!f1) {
+        fprintf(stderr, "Could not open %s\n", imgFileName.c_str());
+        return {};
+    }
+    bitmap->writeImgFile(format, f1, 72 * scale, 72 * scale);
+    fclose(f1);
+    if (dataUrls) {
+        return std::string((format == splashFormatJpeg) ? "data:image/jpeg;base64," : "data:image/png;base64,") + gbase64Encode(imf.getBuffer());
+    }
+    return gbasename(imgFileName.c_str());
+}
+
 int main(int argc, char *argv[])
 {
     std::unique_ptr<PDFDoc> doc;
@@ -167,7 +198,6 @@ int main(int argc, char *argv[])
     GooString *date = nullptr;
     GooString *htmlFileName = nullptr;
     HtmlOutputDev *htmlOut = nullptr;
-    SplashOutputDev *splashOut = nullptr;
     bool doOutline;
     bool ok;
     std::optional<GooString> ownerPW, userPW;
@@ -339,41 +369,71 @@ int main(int argc, char *argv[])
         delete date;
     }
 
-    if ((complexMode || singleHtml) && !xml && !ignore) {
+    if (htmlOut->isOk()) {
         // White paper color
         SplashColor color;
         color[0] = color[1] = color[2] = 255;
         // If the user specified "jpg" use JPEG, otherwise PNG
-        SplashImageFileFormat format = strcmp(extension, "jpg") ? splashFormatPng : splashFormatJpeg;
+        const SplashImageFileFormat format = strcmp(extension, "jpg") ? splashFormatPng : splashFormatJpeg;
+        const bool backgrounds = (complexMode || singleHtml) && !xml && !ignore;
 
-        splashOut = new SplashOutputDevNoText(splashModeRGB8, 4, false, color);
-        splashOut->startDoc(doc.get());
+        numThreads = std::min(numThreads, lastPage - firstPage + 1);
+        if (numThreads < 1) {
+            numThreads = 1;
+        }
 
-        for (int pg = firstPage; pg <= lastPage; ++pg) {
-            InMemoryFile imf;
-            doc->displayPage(splashOut, pg, 72 * scale, 72 * scale, 0, true, false, false);
-            SplashBitmap *bitmap = splashOut->getBitmap();
+        // Each page's background is rendered just before the page is laid
+        // out, so the page can be written as soon as both are done.
+        std::vector<std::unique_ptr<SplashOutputDev>> splashOuts;
+        if (backgrounds) {
+            for (int i = 0; i < numThreads; ++i) {
+                splashOuts.push_back(std::make_unique<SplashOutputDevNoText>(splashModeRGB8, 4, false, color));
+                splashOuts.back()->startDoc(doc.get());
+            }
+        }
 
-            const std::string imgFileName = GooString::format("{0:s}{1:03d}.{2:s}", htmlFileName->c_str(), pg, extension);
-            auto f1 = dataUrls ? imf.open("wb") : fopen(imgFileName.c_str(), "wb");
-            if (!f1) {
-                fprintf(stderr, "Could not open %s\n", imgFileName.c_str());
-                continue;
+        if (numThreads > 1) {
+            // Pages are laid out on per thread HtmlOutputDevs and written,
+            // in order, by htmlOut
+            struct LaidOutPage
+            {
+                std::string background;
+                std::unique_ptr<HtmlPage> page;
+            };
+            std::vector<std::unique_ptr<HtmlOutputDev>> layoutOuts;
+            for (int i = 0; i < numThreads; ++i) {
+                layoutOuts.push_back(std::make_unique<HtmlOutputDev>(doc->getCatalog(), htmlFileName->c_str(), rawOrder));
             }
-            bitmap->writeImgFile(format, f1, 72 * scale, 72 * scale);
-            fclose(f1);
-            if (dataUrls) {
-                htmlOut->addBackgroundImage(std::string((format == splashFormatJpeg) ? "data:image/jpeg;base64," : "data:image/png;base64,") + gbase64Encode(imf.getBuffer()));
-            } else {
-                htmlOut->addBackgroundImage(gbasename(imgFileName.c_str()));
+            runOrderedPageJobs<LaidOutPage>(
+                    firstPage, lastPage, numThreads,
+                    [&](int pg, int thread) {
+                        LaidOutPage result;
+                        if (backgrounds) {
+                            result.background = renderBackground(doc.get(), splashOuts[thread].get(), pg, htmlFileName, format, true);
+                        }
+                        doc->displayPage(layoutOuts[thread].get(), pg, 72 * scale, 72 * scale, 0, true, false, false, nullptr, nullptr, nullptr, nullptr, true);
+                        result.page = layoutOuts[thread]->takePage();
+                        return result;
+                    },
+                    [&](int pg, LaidOutPage &result) {
+                        if (!result.background.empty()) {
+                            htmlOut->addBackgroundImage(result.background);
+                        }
+                        if (result.page) {
+                            htmlOut->writePage(std::move(result.page), pg);
+                        }
+                    });
+        } else {
+            for (int pg = firstPage; pg <= lastPage; ++pg) {
+                if (backgrounds) {
+                    const std::string background = renderBackground(doc.get(), splashOuts[0].get(), pg, htmlFileName, format, false);
+                    if (!background.empty()) {
+                        htmlOut->addBackgroundImage(background);
+                    }
+                }
+                doc->displayPage(htmlOut, pg, 72 * scale, 72 * scale, 0, true, false, false);
             }
         }
-
-        delete splashOut;
-    }
-
-    if (htmlOut->isOk()) {
-        doc->displayPages(htmlOut, firstPage, lastPage, 72 * scale, 72 * scale, 0, true, false, false);
         htmlOut->dumpDocOutline(doc.get());
     }
 
@@ -50,15 +50,24 @@
 #    include <fcntl.h> // for O_BINARY
 #    include <io.h> // for _setmode
 #endif
+#include <algorithm>
+#include <condition_variable>
 #include <cstdio>
 #include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "parseargs.h"
+#include "goo/gfile.h"
 #include "goo/gmem.h"
 #include "goo/GooString.h"
 #include "GlobalParams.h"
 #include "Object.h"
 #include "PDFDoc.h"
 #include "PDFDocFactory.h"
+#include "goo/ImgWriter.h"
+#include "goo/NetPBMWriter.h"
 #include "splash/SplashBitmap.h"
 #include "splash/Splash.h"
 #include "splash/SplashErrorCodes.h"
@@ -66,6 +75,7 @@
 #include "Win32Console.h"
 #include "numberofcharacters.h"
 #include "sanitychecks.h"
+#include "pngoptions.h"
 
 // Uncomment to build pdftoppm with pthreads
 // You may also have to change the buildsystem to
@@ -124,14 +134,19 @@ static GooString jpegOpt;
 static int jpegQuality = -1;
 static bool jpegProgressive = false;
 static bool jpegOptimize = false;
+static GooString pngOpt;
+static PngOptions pngOptions;
+static int bandHeight = 0;
 static bool overprint = false;
 static bool splashOverprintPreview = false;
 static char enableFreeTypeStr[16] = "";
 static bool enableFreeType = true;
 static char antialiasStr[16] = "";
 static char vectorAntialiasStr[16] = "";
+static char analyticAntialiasStr[16] = "";
 static bool fontAntialias = true;
 static bool vectorAntialias = true;
+static bool analyticAntialias = false;
 static char ownerPassword[33] = "";
 static char userPassword[33] = "";
 static char TiffCompressionStr[16] = "";
@@ -177,8 +192,10 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
 #endif
                                    { "-sep", argString, sep, sizeof(sep), "single character separator between name and page number, default - " },
                                    { "-forcenum", argFlag, &forceNum, 0, "force page number even if there is only one page " },
+                                   { "-band", argInt, &bandHeight, 0, "render and write each page in bands of this many pixel rows" },
 #ifdef ENABLE_LIBPNG
                                    { "-png", argFlag, &png, 0, "generate a PNG file" },
+                                   { "-pngopt", argGooString, &pngOpt, 0, "png options, with format <opt1>=<val1>[,<optN>=<valN>]*" },
 #endif
 #ifdef ENABLE_LIBJPEG
                                    { "-jpeg", argFlag, &jpeg, 0, "generate a JPEG file" },
@@ -195,6 +212,7 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
 
                                    { "-aa", argString, antialiasStr, sizeof(antialiasStr), "enable font anti-aliasing: yes, no" },
                                    { "-aaVector", argString, vectorAntialiasStr, sizeof(vectorAntialiasStr), "enable vector anti-aliasing: yes, no" },
+                                   { "-aaAnalytic", argString, analyticAntialiasStr, sizeof(analyticAntialiasStr), "compute exact vector anti-aliasing coverage: yes, no" },
 
                                    { "-opw", argString, ownerPassword, sizeof(ownerPassword), "owner password (for encrypted files)" },
                                    { "-upw", argString, userPassword, sizeof(userPassword), "user password (for encrypted files)" },
@@ -280,6 +298,84 @@ static bool parseJpegOptions()
 
 static auto annotDisplayDecideCbk = [](Annot *annot, void *user_data) { return !hideAnnotations; };
 
+// Render the <w>x<h> slice at (<x>, <y>) in bands of bandHeight rows and
+// write it to <f>.  Each band is handed to another thread for encoding
+// while the next one renders, and only a few bands are kept in memory
+// instead of the whole page.
+static bool savePageBands(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x, int y, int w, int h, FILE *f, SplashBitmap::WriteImgParams *params)
+{
+    doc->displayPageSlice(splashOut, pg, x_resolution, y_resolution, 0, !useCropBox, false, false, x, y, w, std::min(bandHeight, h), nullptr, nullptr, annotDisplayDecideCbk, nullptr);
+    std::unique_ptr<SplashBitmap> band(splashOut->takeBitmap());
+
+    std::unique_ptr<ImgWriter> writer;
+    SplashColorMode imageWriterFormat = splashModeRGB8;
+    if (png || jpeg || jpegcmyk || tiff) {
+        const SplashImageFileFormat format = png ? splashFormatPng : jpeg ? splashFormatJpeg : jpegcmyk ? splashFormatJpegCMYK : splashFormatTiff;
+        writer.reset(SplashBitmap::createImgWriter(format, band->getMode(), params, &imageWriterFormat));
+    } else if (band->getMode() == splashModeMono1) {
+        writer = std::make_unique<NetPBMWriter>(NetPBMWriter::MONOCHROME);
+        imageWriterFormat = splashModeMono1;
+    } else if (band->getMode() == splashModeMono8) {
+        writer = std::make_unique<NetPBMWriter>(NetPBMWriter::GRAY);
+        imageWriterFormat = splashModeMono8;
+    } else {
+        writer = std::make_unique<NetPBMWriter>(NetPBMWriter::RGB);
+    }
+    if (!writer || !writer->init(f, band->getWidth(), h, x_resolution, y_resolution)) {
+        return false;
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<SplashBitmap>> queue;
+    bool finished = false;
+    bool ok = true; // only touched by the encoder until it is joined
+
+    std::thread encoder([&] {
+        while (true) {
+            std::unique_ptr<SplashBitmap> bitmap;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return !queue.empty() || finished; });
+                if (queue.empty()) {
+                    return;
+                }
+                bitmap = std::move(queue.front());
+                queue.pop_front();
+            }
+            cond.notify_all();
+            if (ok && bitmap->writeImgRows(writer.get(), imageWriterFormat) != splashOk) {
+                ok = false;
+            }
+        }
+    });
+
+    // at most two bands wait for the encoder
+    auto push = [&](std::unique_ptr<SplashBitmap> bitmap) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return queue.size() < 2; });
+            queue.push_back(std::move(bitmap));
+        }
+        cond.notify_all();
+    };
+
+    push(std::move(band));
+    for (int by = y + bandHeight; by < y + h; by += bandHeight) {
+        doc->displayPageSlice(splashOut, pg, x_resolution, y_resolution, 0, !useCropBox, false, false, x, by, w, std::min(bandHeight, y + h - by), nullptr, nullptr, annotDisplayDecideCbk, nullptr);
+        push(std::unique_ptr<SplashBitmap>(splashOut->takeBitmap()));
+    }
+
+    {
+        std::scoped_lock lock { mutex };
+        finished = true;
+    }
+    cond.notify_all();
+    encoder.join();
+
+    return writer->close() && ok;
+}
+
 static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x, int y, int w, int h, double pg_w, double pg_h, char *ppmFile)
 {
     if (w == 0) {
@@ -290,21 +386,48 @@ static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x
     }
     w = (x + w > pg_w ? (int)ceil(pg_w - x) : w);
     h = (y + h > pg_h ? (int)ceil(pg_h - y) : h);
-    doc->displayPageSlice(splashOut, pg, x_resolution, y_resolution, 0, !useCropBox, false, false, x, y, w, h, nullptr, nullptr, annotDisplayDecideCbk, nullptr);
-
-    SplashBitmap *bitmap = splashOut->getBitmap();
 
     SplashBitmap::WriteImgParams params;
     params.jpegQuality = jpegQuality;
     params.jpegProgressive = jpegProgressive;
     params.jpegOptimize = jpegOptimize;
     params.tiffCompression = TiffCompressionStr;
+    params.pngCompressionLevel = pngOptions.compressionLevel;
+    params.pngFilter = pngOptions.filter;
+    params.pngThreads = pngOptions.threads;
+
+    if (bandHeight > 0 && h > bandHeight) {
+        if (ppmFile != nullptr) {
+            FILE *f = openFile(ppmFile, "wb");
+            const bool written = f && savePageBands(doc, splashOut, pg, x, y, w, h, f, &params);
+            if (f) {
+                fclose(f);
+            }
+            if (!written) {
+                fprintf(stderr, "Could not write image to %s; exiting\n", ppmFile);
+                exit(EXIT_FAILURE);
+            }
+        } else {
+#if defined(_WIN32) || defined(__CYGWIN__)
+            _setmode(fileno(stdout), O_BINARY);
+#endif
+            savePageBands(doc, splashOut, pg, x, y, w, h, stdout, &params);
+        }
+        if (progress) {
+            fprintf(stderr, "%d %d %s\n", pg, lastPage, ppmFile != nullptr ? ppmFile : "");
+        }
+        return;
+    }
+
+    doc->displayPageSlice(splashOut, pg, x_resolution, y_resolution, 0, !useCropBox, false, false, x, y, w, h, nullptr, nullptr, annotDisplayDecideCbk, nullptr);
+
+    SplashBitmap *bitmap = splashOut->getBitmap();
 
     if (ppmFile != nullptr) {
         SplashError e;
 
         if (png) {
-            e = bitmap->writeImgFile(splashFormatPng, ppmFile, x_resolution, y_resolution);
+            e = bitmap->writeImgFile(splashFormatPng, ppmFile, x_resolution, y_resolution, &params);
         } else if (jpeg) {
             e = bitmap->writeImgFile(splashFormatJpeg, ppmFile, x_resolution, y_resolution, &params);
         } else if (jpegcmyk) {
@@ -324,7 +447,7 @@ static void savePageSlice(PDFDoc *doc, SplashOutputDev *splashOut, int pg, int x
 #endif
 
         if (png) {
-            bitmap->writeImgFile(splashFormatPng, stdout, x_resolution, y_resolution);
+            bitmap->writeImgFile(splashFormatPng, stdout, x_resolution, y_resolution, &params);
         } else if (jpeg) {
             bitmap->writeImgFile(splashFormatJpeg, stdout, x_resolution, y_resolution, &params);
         } else if (tiff) {
@@ -379,6 +502,7 @@ static void processPageJobs()
                                                          4, false, *pageJob.paperColor, true, thinLineMode, splashOverprintPreview);
         splashOut->setFontAntialias(fontAntialias);
         splashOut->setVectorAntialias(vectorAntialias);
+        splashOut->setAnalyticAntialias(analyticAntialias);
         splashOut->setEnableFreeType(enableFreeType);
 #    ifdef USE_CMS
         splashOut->setDisplayProfile(displayprofile);
@@ -457,6 +581,11 @@ int main(int argc, char *argv[])
             fprintf(stderr, "Bad '-aaVector' value on command line\n");
         }
     }
+    if (analyticAntialiasStr[0]) {
+        if (!GlobalParams::parseYesNo2(analyticAntialiasStr, &analyticAntialias)) {
+            fprintf(stderr, "Bad '-aaAnalytic' value on command line\n");
+        }
+    }
 
     if (jpegOpt.getLength() > 0) {
         if (!jpeg) {
@@ -465,6 +594,15 @@ int main(int argc, char *argv[])
         parseJpegOptions();
     }
 
+    if (pngOpt.getLength() > 0) {
+        if (!png) {
+            fprintf(stderr, "Warning: -pngopt only valid with png output.\n");
+        }
+        if (!parsePngOptions(pngOpt, &pngOptions)) {
+            return kOtherError;
+        }
+    }
+
     // read config file
     globalParams = std::make_unique<GlobalParams>();
     if (enableFreeTypeStr[0]) {
@@ -602,6 +740,7 @@ int main(int argc, char *argv[])
 
     splashOut->setFontAntialias(fontAntialias);
     splashOut->setVectorAntialias(vectorAntialias);
+    splashOut->setAnalyticAntialias(analyticAntialias);
     splashOut->setEnableFreeType(enableFreeType);
 #    ifdef USE_CMS
     splashOut->setDisplayProfile(displayprofile);
@@ -99,12 +99,14 @@ static bool doForm = false;
 static bool doOPI = false;
 #endif
 static int splashResolution = 0;
+static int rasterThreads = 1;
 static bool psBinary = false;
 static bool noEmbedT1Fonts = false;
 static bool noEmbedTTFonts = false;
 static bool noEmbedCIDPSFonts = false;
 static bool noEmbedCIDTTFonts = false;
 static bool fontPassthrough = false;
+static bool subsetFonts = false;
 static bool optimizeColorSpace = false;
 static bool passLevel1CustomColor = false;
 static char rasterAntialiasStr[16] = "";
@@ -153,12 +155,14 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-opi", argFlag, &doOPI, 0, "generate OPI comments" },
 #endif
                                    { "-r", argInt, &splashResolution, 0, "resolution for rasterization, in DPI (default is 300)" },
+                                   { "-j", argInt, &rasterThreads, 0, "number of threads rasterizing pages" },
                                    { "-binary", argFlag, &psBinary, 0, "write binary data in Level 1 PostScript" },
                                    { "-noembt1", argFlag, &noEmbedT1Fonts, 0, "don't embed Type 1 fonts" },
                                    { "-noembtt", argFlag, &noEmbedTTFonts, 0, "don't embed TrueType fonts" },
                                    { "-noembcidps", argFlag, &noEmbedCIDPSFonts, 0, "don't embed CID PostScript fonts" },
                                    { "-noembcidtt", argFlag, &noEmbedCIDTTFonts, 0, "don't embed CID TrueType fonts" },
                                    { "-passfonts", argFlag, &fontPassthrough, 0, "don't substitute missing fonts" },
+                                   { "-subsetfonts", argFlag, &subsetFonts, 0, "embed only the used glyphs of TrueType and CID fonts" },
                                    { "-aaRaster", argString, rasterAntialiasStr, sizeof(rasterAntialiasStr), "enable anti-aliasing on rasterization: yes, no" },
                                    { "-rasterize", argString, forceRasterizeStr, sizeof(forceRasterizeStr), "control rasterization: always, never, whenneeded" },
                                    { "-processcolorformat", argGooString, &processcolorformatname, 0, "color format that is used during rasterization and transparency reduction: MONO8, RGB8, CMYK8" },
@@ -467,6 +471,7 @@ int main(int argc, char *argv[])
     if (splashResolution > 0) {
         psOut->setRasterResolution(splashResolution);
     }
+    psOut->setRasterThreads(rasterThreads);
     if (processcolorformatspecified) {
         psOut->setProcessColorFormat(processcolorformat);
     }
@@ -481,6 +486,7 @@ int main(int argc, char *argv[])
     psOut->setEmbedCIDPostScript(!noEmbedCIDPSFonts);
     psOut->setEmbedCIDTrueType(!noEmbedCIDTTFonts);
     psOut->setFontPassthrough(fontPassthrough);
+    psOut->setSubsetFonts(subsetFonts);
     psOut->setPreloadImagesForms(preload);
     psOut->setOptimizeColorSpace(optimizeColorSpace);
     psOut->setPassLevel1CustomColor(passLevel1CustomColor);
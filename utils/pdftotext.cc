@@ -41,14 +41,22 @@
 
 #include "config.h"
 #include <poppler-config.h>
+#if defined(_WIN32) || defined(__CYGWIN__)
+#    include <fcntl.h> // for O_BINARY
+#    include <io.h> // for _setmode
+#endif
+#include <algorithm>
+#include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstddef>
 #include <cstring>
 #include "parseargs.h"
 #include "printencodings.h"
+#include "pagejobs.h"
 #include "goo/GooString.h"
 #include "goo/gmem.h"
+#include "goo/gfile.h"
 #include "GlobalParams.h"
 #include "Object.h"
 #include "Stream.h"
@@ -67,15 +75,17 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <memory>
+#include <vector>
 #include "Win32Console.h"
 #include "DateInfo.h"
 #include <cfloat>
 
 static void printInfoString(FILE *f, Dict *infoDict, const char *key, const char *text1, const char *text2, const UnicodeMap *uMap);
 static void printInfoDate(FILE *f, Dict *infoDict, const char *key, const char *text1, const char *text2);
-void printDocBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last);
-void printWordBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last);
-void printTSVBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last);
+void printDocBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last);
+void printWordBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last);
+void printTSVBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last);
 
 static int firstPage = 1;
 static int lastPage = 0;
@@ -103,6 +113,7 @@ static bool printVersion = false;
 static bool printHelp = false;
 static bool printEnc = false;
 static bool tsvMode = false;
+static int numThreads = 1;
 
 static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to convert" },
                                    { "-l", argInt, &lastPage, 0, "last page to convert" },
@@ -124,6 +135,7 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-bbox", argFlag, &bbox, 0, "output bounding box for each word and page size to html. Sets -htmlmeta" },
                                    { "-bbox-layout", argFlag, &bboxLayout, 0, "like -bbox but with extra layout bounding box data.  Sets -htmlmeta" },
                                    { "-cropbox", argFlag, &useCropBox, 0, "use the crop box rather than media box" },
+                                   { "-j", argInt, &numThreads, 0, "number of pages to extract concurrently (default is 1)" },
                                    { "-colspacing", argFP, &colspacing, 0,
                                      "how much spacing we allow after a word before considering adjacent text to be a new column, as a fraction of the font size (default is 0.7, old releases had a 0.3 default)" },
                                    { "-opw", argString, ownerPassword, sizeof(ownerPassword), "owner password (for encrypted files)" },
@@ -136,6 +148,21 @@ static const ArgDesc argDesc[] = { { "-f", argInt, &firstPage, 0, "first page to
                                    { "-?", argFlag, &printHelp, 0, "print usage information" },
                                    {} };
 
+// The output of one page, built by the thread that extracted it and
+// written out in page order.
+struct PageOutput
+{
+    std::string text;
+    bool noWords = false; // -bbox: the page has no words
+    bool hasBBox = false; // -tsv: the page has text, xMin/yMin is its last box
+    double xMin = 0, yMin = 0;
+};
+
+static void appendToString(void *stream, const char *text, int len)
+{
+    static_cast<std::string *>(stream)->append(text, len);
+}
+
 static std::string myStringReplace(const std::string &inString, const std::string &oldToken, const std::string &newToken)
 {
     std::string result = inString;
@@ -187,6 +214,10 @@ int main(int argc, char *argv[])
         error(errCommandLine, -1, "Bogus value provided for -colspacing");
         return 99;
     }
+    if (numThreads < 1) {
+        error(errCommandLine, -1, "Bogus value provided for -j");
+        return 99;
+    }
     if (!ok || (argc < 2 && !printEnc) || argc > 3 || printVersion || printHelp) {
         fprintf(stderr, "pdftotext version %s\n", PACKAGE_VERSION);
         fprintf(stderr, "%s\n", popplerCopyright);
@@ -330,21 +361,36 @@ int main(int argc, char *argv[])
         }
     }
 
-    // write text file
-    if (htmlMeta && bbox) { // htmlMeta && is superfluous but makes gcc happier
-        TextOutputDev textOut(nullptr, physLayout, fixedPitch, rawOrder, htmlMeta, discardDiag);
-
-        if (textOut.isOk()) {
-            textOut.setTextEOL(textEOL);
-            textOut.setMinColSpacing1(colspacing);
-            if (noPageBreaks) {
-                textOut.setTextPageBreaks(false);
-            }
-            if (bboxLayout) {
-                printDocBBox(f, doc.get(), &textOut, firstPage, lastPage);
+    // one output device per thread, each page is laid out by a single one
+    numThreads = std::min(numThreads, lastPage - firstPage + 1);
+    auto makeTextOutputDevs = [&](bool setOptions, std::vector<std::string> *streams) {
+        std::vector<std::unique_ptr<TextOutputDev>> textOuts;
+        for (int i = 0; i < numThreads; ++i) {
+            std::unique_ptr<TextOutputDev> textOut;
+            if (streams) {
+                textOut = std::make_unique<TextOutputDev>(&appendToString, &(*streams)[i], physLayout, fixedPitch, rawOrder, discardDiag);
             } else {
-                printWordBBox(f, doc.get(), &textOut, firstPage, lastPage);
+                textOut = std::make_unique<TextOutputDev>(nullptr, physLayout, fixedPitch, rawOrder, htmlMeta, discardDiag);
+            }
+            if (setOptions) {
+                textOut->setTextEOL(textEOL);
+                textOut->setMinColSpacing1(colspacing);
+                if (noPageBreaks) {
+                    textOut->setTextPageBreaks(false);
+                }
             }
+            textOuts.push_back(std::move(textOut));
+        }
+        return textOuts;
+    };
+
+    // write text file
+    if (htmlMeta && bbox) { // htmlMeta && is superfluous but makes gcc happier
+        const std::vector<std::unique_ptr<TextOutputDev>> textOuts = makeTextOutputDevs(true, nullptr);
+        if (bboxLayout) {
+            printDocBBox(f, doc.get(), textOuts, firstPage, lastPage);
+        } else {
+            printWordBBox(f, doc.get(), textOuts, firstPage, lastPage);
         }
         if (f != stdout) {
             fclose(f);
@@ -352,7 +398,7 @@ int main(int argc, char *argv[])
     } else {
 
         if (tsvMode) {
-            TextOutputDev textOut(nullptr, physLayout, fixedPitch, rawOrder, htmlMeta, discardDiag);
+            const std::vector<std::unique_ptr<TextOutputDev>> textOuts = makeTextOutputDevs(false, nullptr);
             if (!textFileName->cmp("-")) {
                 f = stdout;
             } else {
@@ -361,7 +407,42 @@ int main(int argc, char *argv[])
                     return 2;
                 }
             }
-            printTSVBBox(f, doc.get(), &textOut, firstPage, lastPage);
+            printTSVBBox(f, doc.get(), textOuts, firstPage, lastPage);
+            if (f != stdout) {
+                fclose(f);
+            }
+        } else if (numThreads > 1) {
+            // every thread dumps the text of its pages to a string of its
+            // own, which is handed over to the writer once the page is done
+            std::vector<std::string> pageTexts(numThreads);
+            const std::vector<std::unique_ptr<TextOutputDev>> textOuts = makeTextOutputDevs(true, &pageTexts);
+
+            if (!textFileName->cmp("-")) {
+                f = stdout;
+#if defined(_WIN32) || defined(__CYGWIN__)
+                // keep DOS from munging the end-of-line characters
+                _setmode(fileno(stdout), O_BINARY);
+#endif
+            } else if (!(f = openFile(textFileName->c_str(), htmlMeta ? "ab" : "wb"))) {
+                error(errIO, -1, "Couldn't open text file '{0:t}'", textFileName.get());
+                return 2;
+            }
+
+            const bool slice = w != 0 || h != 0 || x != 0 || y != 0;
+            runOrderedPageJobs<PageOutput>(
+                    firstPage, lastPage, numThreads,
+                    [&](int page, int thread) {
+                        if (slice) {
+                            doc->displayPageSlice(textOuts[thread].get(), page, resolution, resolution, 0, true, false, false, x, y, w, h, nullptr, nullptr, nullptr, nullptr, true);
+                        } else {
+                            doc->displayPage(textOuts[thread].get(), page, resolution, resolution, 0, true, false, false, nullptr, nullptr, nullptr, nullptr, true);
+                        }
+                        PageOutput out;
+                        out.text.swap(pageTexts[thread]);
+                        return out;
+                    },
+                    [&](int page, PageOutput &out) { fwrite(out.text.data(), 1, out.text.size(), f); });
+
             if (f != stdout) {
                 fclose(f);
             }
@@ -472,7 +553,32 @@ static void printInfoDate(FILE *f, Dict *infoDict, const char *key, const char *
     }
 }
 
-static void printLine(FILE *f, const TextLine *line)
+// Appends printf style formatted output to <s>.
+static void appendf(std::string *s, const char *format, ...) GCC_PRINTF_FORMAT(2, 3);
+
+static void appendf(std::string *s, const char *format, ...)
+{
+    char buf[256];
+    va_list args;
+
+    va_start(args, format);
+    const int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+    if (n < (int)sizeof(buf)) {
+        s->append(buf, n);
+        return;
+    }
+    std::vector<char> bigBuf(n + 1);
+    va_start(args, format);
+    vsnprintf(bigBuf.data(), bigBuf.size(), format, args);
+    va_end(args);
+    s->append(bigBuf.data(), n);
+}
+
+static void printLine(std::string *out, const TextLine *line)
 {
     double xMin, yMin, xMax, yMax;
     double lineXMin = 0, lineYMin = 0, lineXMax = 0, lineYMax = 0;
@@ -501,43 +607,53 @@ static void printLine(FILE *f, const TextLine *line)
         wordXML << "          <word xMin=\"" << xMin << "\" yMin=\"" << yMin << "\" xMax=\"" << xMax << "\" yMax=\"" << yMax << "\">" << myString << "</word>\n";
         delete wordText;
     }
-    fprintf(f, "        <line xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">\n", lineXMin, lineYMin, lineXMax, lineYMax);
-    fputs(wordXML.str().c_str(), f);
-    fputs("        </line>\n", f);
+    appendf(out, "        <line xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">\n", lineXMin, lineYMin, lineXMax, lineYMax);
+    out->append(wordXML.str().c_str());
+    out->append("        </line>\n");
 }
 
-void printDocBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last)
+static PageOutput printDocBBoxPage(PDFDoc *doc, TextOutputDev *textOut, int page)
 {
+    PageOutput out;
     double xMin, yMin, xMax, yMax;
     const TextFlow *flow;
     const TextBlock *blk;
     const TextLine *line;
 
-    fprintf(f, "<doc>\n");
-    for (int page = first; page <= last; ++page) {
-        const double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
-        const double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
-        fprintf(f, "  <page width=\"%f\" height=\"%f\">\n", wid, hgt);
-        doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false);
-        for (flow = textOut->getFlows(); flow; flow = flow->getNext()) {
-            fprintf(f, "    <flow>\n");
-            for (blk = flow->getBlocks(); blk; blk = blk->getNext()) {
-                blk->getBBox(&xMin, &yMin, &xMax, &yMax);
-                fprintf(f, "      <block xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">\n", xMin, yMin, xMax, yMax);
-                for (line = blk->getLines(); line; line = line->getNext()) {
-                    printLine(f, line);
-                }
-                fprintf(f, "      </block>\n");
+    const double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
+    const double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
+    appendf(&out.text, "  <page width=\"%f\" height=\"%f\">\n", wid, hgt);
+    doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false, nullptr, nullptr, nullptr, nullptr, true);
+    for (flow = textOut->getFlows(); flow; flow = flow->getNext()) {
+        out.text.append("    <flow>\n");
+        for (blk = flow->getBlocks(); blk; blk = blk->getNext()) {
+            blk->getBBox(&xMin, &yMin, &xMax, &yMax);
+            appendf(&out.text, "      <block xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">\n", xMin, yMin, xMax, yMax);
+            for (line = blk->getLines(); line; line = line->getNext()) {
+                printLine(&out.text, line);
             }
-            fprintf(f, "    </flow>\n");
+            out.text.append("      </block>\n");
         }
-        fprintf(f, "  </page>\n");
+        out.text.append("    </flow>\n");
     }
+    out.text.append("  </page>\n");
+    return out;
+}
+
+void printDocBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last)
+{
+    fprintf(f, "<doc>\n");
+    runOrderedPageJobs<PageOutput>(
+            first, last, textOuts.size(), [&](int page, int thread) { return printDocBBoxPage(doc, textOuts[thread].get(), page); },
+            [&](int page, PageOutput &out) { fwrite(out.text.data(), 1, out.text.size(), f); });
     fprintf(f, "</doc>\n");
 }
 
-void printTSVBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last)
+// The ###PAGE### line is left to the caller: it repeats the position of
+// the last box of the previous page that had text.
+static PageOutput printTSVPage(PDFDoc *doc, TextOutputDev *textOut, int page)
 {
+    PageOutput out;
     double xMin = 0, yMin = 0, xMax = 0, yMax = 0;
     const TextFlow *flow;
     const TextBlock *blk;
@@ -547,96 +663,124 @@ void printTSVBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int l
     int lineNum = 0;
     int flowNum = 0;
     int wordNum = 0;
-    const int pageLevel = 1;
     const int blockLevel = 3;
     const int lineLevel = 4;
     const int wordLevel = 5;
     const int metaConf = -1;
     const int wordConf = 100;
 
-    fputs("level\tpage_num\tpar_num\tblock_num\tline_num\tword_num\tleft\ttop\twidth\theight\tconf\ttext\n", f);
-
-    for (int page = first; page <= last; ++page) {
-        const double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
-        const double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
+    doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false, nullptr, nullptr, nullptr, nullptr, true);
 
-        fprintf(f, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###PAGE###\n", pageLevel, page, flowNum, blockNum, lineNum, wordNum, xMin, yMin, wid, hgt, metaConf);
-        doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false);
+    for (flow = textOut->getFlows(); flow; flow = flow->getNext()) {
+        // flow->getBBox(&xMin, &yMin, &xMax, &yMax);
+        // fprintf(f, "%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t\n", page,flowNum,blockNum,lineNum,wordNum,xMin,yMin,wid, hgt);
 
-        for (flow = textOut->getFlows(); flow; flow = flow->getNext()) {
-            // flow->getBBox(&xMin, &yMin, &xMax, &yMax);
-            // fprintf(f, "%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t\n", page,flowNum,blockNum,lineNum,wordNum,xMin,yMin,wid, hgt);
+        for (blk = flow->getBlocks(); blk; blk = blk->getNext()) {
+            blk->getBBox(&xMin, &yMin, &xMax, &yMax);
+            appendf(&out.text, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###FLOW###\n", blockLevel, page, flowNum, blockNum, lineNum, wordNum, xMin, yMin, xMax - xMin, yMax - yMin, metaConf);
 
-            for (blk = flow->getBlocks(); blk; blk = blk->getNext()) {
-                blk->getBBox(&xMin, &yMin, &xMax, &yMax);
-                fprintf(f, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###FLOW###\n", blockLevel, page, flowNum, blockNum, lineNum, wordNum, xMin, yMin, xMax - xMin, yMax - yMin, metaConf);
+            for (line = blk->getLines(); line; line = line->getNext()) {
 
-                for (line = blk->getLines(); line; line = line->getNext()) {
+                double lxMin = 1E+37, lyMin = 1E+37;
+                double lxMax = 0, lyMax = 0;
+                GooString *lineWordsBuffer = new GooString();
 
-                    double lxMin = 1E+37, lyMin = 1E+37;
-                    double lxMax = 0, lyMax = 0;
-                    GooString *lineWordsBuffer = new GooString();
-
-                    for (word = line->getWords(); word; word = word->getNext()) {
-                        word->getBBox(&xMin, &yMin, &xMax, &yMax);
-                        if (lxMin > xMin) {
-                            lxMin = xMin;
-                        }
-                        if (lxMax < xMax) {
-                            lxMax = xMax;
-                        }
-                        if (lyMin > yMin) {
-                            lyMin = yMin;
-                        }
-                        if (lyMax < yMax) {
-                            lyMax = yMax;
-                        }
-
-                        lineWordsBuffer->appendf("{0:d}\t{1:d}\t{2:d}\t{3:d}\t{4:d}\t{5:d}\t{6:.2f}\t{7:.2f}\t{8:.2f}\t{9:.2f}\t{10:d}\t{11:t}\n", wordLevel, page, flowNum, blockNum, lineNum, wordNum, xMin, yMin, xMax - xMin, yMax - yMin,
-                                                 wordConf, word->getText());
-                        wordNum++;
+                for (word = line->getWords(); word; word = word->getNext()) {
+                    word->getBBox(&xMin, &yMin, &xMax, &yMax);
+                    if (lxMin > xMin) {
+                        lxMin = xMin;
+                    }
+                    if (lxMax < xMax) {
+                        lxMax = xMax;
+                    }
+                    if (lyMin > yMin) {
+                        lyMin = yMin;
+                    }
+                    if (lyMax < yMax) {
+                        lyMax = yMax;
                     }
 
-                    // Print Link Bounding Box info
-                    fprintf(f, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###LINE###\n", lineLevel, page, flowNum, blockNum, lineNum, 0, lxMin, lyMin, lxMax - lxMin, lyMax - lyMin, metaConf);
-                    fprintf(f, "%s", lineWordsBuffer->c_str());
-                    delete lineWordsBuffer;
-                    wordNum = 0;
-                    lineNum++;
+                    lineWordsBuffer->appendf("{0:d}\t{1:d}\t{2:d}\t{3:d}\t{4:d}\t{5:d}\t{6:.2f}\t{7:.2f}\t{8:.2f}\t{9:.2f}\t{10:d}\t{11:t}\n", wordLevel, page, flowNum, blockNum, lineNum, wordNum, xMin, yMin, xMax - xMin, yMax - yMin,
+                                             wordConf, word->getText());
+                    wordNum++;
                 }
-                lineNum = 0;
-                blockNum++;
+
+                // Print Link Bounding Box info
+                appendf(&out.text, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###LINE###\n", lineLevel, page, flowNum, blockNum, lineNum, 0, lxMin, lyMin, lxMax - lxMin, lyMax - lyMin, metaConf);
+                out.text.append(lineWordsBuffer->c_str());
+                delete lineWordsBuffer;
+                wordNum = 0;
+                lineNum++;
             }
-            blockNum = 0;
-            flowNum++;
+            lineNum = 0;
+            blockNum++;
+            out.hasBBox = true;
         }
-        flowNum = 0;
+        blockNum = 0;
+        flowNum++;
     }
+    out.xMin = xMin;
+    out.yMin = yMin;
+    return out;
 }
 
-void printWordBBox(FILE *f, PDFDoc *doc, TextOutputDev *textOut, int first, int last)
+void printTSVBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last)
 {
-    fprintf(f, "<doc>\n");
-    for (int page = first; page <= last; ++page) {
-        double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
-        double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
-        fprintf(f, "  <page width=\"%f\" height=\"%f\">\n", wid, hgt);
-        doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false);
-        std::unique_ptr<TextWordList> wordlist = textOut->makeWordList();
-        const int word_length = wordlist != nullptr ? wordlist->getLength() : 0;
-        TextWord *word;
-        double xMinA, yMinA, xMaxA, yMaxA;
-        if (word_length == 0) {
-            fprintf(stderr, "no word list\n");
-        }
+    double xMin = 0, yMin = 0;
+    const int pageLevel = 1;
+    const int metaConf = -1;
 
-        for (int i = 0; i < word_length; ++i) {
-            word = wordlist->get(i);
-            word->getBBox(&xMinA, &yMinA, &xMaxA, &yMaxA);
-            const std::string myString = myXmlTokenReplace(word->getText()->c_str());
-            fprintf(f, "    <word xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">%s</word>\n", xMinA, yMinA, xMaxA, yMaxA, myString.c_str());
-        }
-        fprintf(f, "  </page>\n");
+    fputs("level\tpage_num\tpar_num\tblock_num\tline_num\tword_num\tleft\ttop\twidth\theight\tconf\ttext\n", f);
+
+    runOrderedPageJobs<PageOutput>(
+            first, last, textOuts.size(), [&](int page, int thread) { return printTSVPage(doc, textOuts[thread].get(), page); },
+            [&](int page, PageOutput &out) {
+                const double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
+                const double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
+
+                fprintf(f, "%d\t%d\t%d\t%d\t%d\t%d\t%f\t%f\t%f\t%f\t%d\t###PAGE###\n", pageLevel, page, 0, 0, 0, 0, xMin, yMin, wid, hgt, metaConf);
+                fwrite(out.text.data(), 1, out.text.size(), f);
+                if (out.hasBBox) {
+                    xMin = out.xMin;
+                    yMin = out.yMin;
+                }
+            });
+}
+
+static PageOutput printWordBBoxPage(PDFDoc *doc, TextOutputDev *textOut, int page)
+{
+    PageOutput out;
+    double wid = useCropBox ? doc->getPageCropWidth(page) : doc->getPageMediaWidth(page);
+    double hgt = useCropBox ? doc->getPageCropHeight(page) : doc->getPageMediaHeight(page);
+    appendf(&out.text, "  <page width=\"%f\" height=\"%f\">\n", wid, hgt);
+    doc->displayPage(textOut, page, resolution, resolution, 0, !useCropBox, useCropBox, false, nullptr, nullptr, nullptr, nullptr, true);
+    std::unique_ptr<TextWordList> wordlist = textOut->makeWordList();
+    const int word_length = wordlist != nullptr ? wordlist->getLength() : 0;
+    TextWord *word;
+    double xMinA, yMinA, xMaxA, yMaxA;
+    out.noWords = word_length == 0;
+
+    for (int i = 0; i < word_length; ++i) {
+        word = wordlist->get(i);
+        word->getBBox(&xMinA, &yMinA, &xMaxA, &yMaxA);
+        const std::unique_ptr<GooString> wordText(word->getText());
+        const std::string myString = myXmlTokenReplace(wordText->c_str());
+        appendf(&out.text, "    <word xMin=\"%f\" yMin=\"%f\" xMax=\"%f\" yMax=\"%f\">%s</word>\n", xMinA, yMinA, xMaxA, yMaxA, myString.c_str());
     }
+    out.text.append("  </page>\n");
+    return out;
+}
+
+void printWordBBox(FILE *f, PDFDoc *doc, const std::vector<std::unique_ptr<TextOutputDev>> &textOuts, int first, int last)
+{
+    fprintf(f, "<doc>\n");
+    runOrderedPageJobs<PageOutput>(
+            first, last, textOuts.size(), [&](int page, int thread) { return printWordBBoxPage(doc, textOuts[thread].get(), page); },
+            [&](int page, PageOutput &out) {
+                if (out.noWords) {
+                    fprintf(stderr, "no word list\n");
+                }
+                fwrite(out.text.data(), 1, out.text.size(), f);
+            });
     fprintf(f, "</doc>\n");
 }
@@ -24,15 +24,20 @@
 #include "parseargs.h"
 #include "config.h"
 #include <poppler-config.h>
+#include <algorithm>
+#include <string>
 #include <vector>
+#include "pagejobs.h"
 
+static int numThreads = 1;
 static bool printVersion = false;
 static bool printHelp = false;
 
-static const ArgDesc argDesc[] = { { "-v", argFlag, &printVersion, 0, "print copyright and version info" }, { "-h", argFlag, &printHelp, 0, "print usage information" }, { "-help", argFlag, &printHelp, 0, "print usage information" },
+static const ArgDesc argDesc[] = { { "-j", argInt, &numThreads, 0, "number of threads writing the objects of the source files (default is 1)" },
+                                   { "-v", argFlag, &printVersion, 0, "print copyright and version info" }, { "-h", argFlag, &printHelp, 0, "print usage information" }, { "-help", argFlag, &printHelp, 0, "print usage information" },
                                    { "--help", argFlag, &printHelp, 0, "print usage information" },         { "-?", argFlag, &printHelp, 0, "print usage information" }, {} };
 
-static void doMergeNameTree(PDFDoc *doc, XRef *srcXRef, XRef *countRef, int oldRefNum, int newRefNum, Dict *srcNameTree, Dict *mergeNameTree, int numOffset)
+static void doMergeNameTree(PDFDoc *doc, XRef *srcXRef, std::vector<bool> *markedObjects, int oldRefNum, int newRefNum, Dict *srcNameTree, Dict *mergeNameTree, int numOffset)
 {
     Object mergeNameArray = mergeNameTree->lookup("Names");
     Object srcNameArray = srcNameTree->lookup("Names");
@@ -74,7 +79,7 @@ static void doMergeNameTree(PDFDoc *doc, XRef *srcXRef, XRef *countRef, int oldR
             j += 2;
         }
         srcNameTree->set("Names", Object(newNameArray));
-        doc->markPageObjects(mergeNameTree, srcXRef, countRef, numOffset, oldRefNum, newRefNum);
+        doc->markPageObjects(mergeNameTree, srcXRef, markedObjects, numOffset, oldRefNum, newRefNum);
     } else if (srcNameArray.isNull() && mergeNameArray.isArray()) {
         Array *newNameArray = new Array(srcXRef);
         for (int i = 0; i < mergeNameArray.arrayGetLength() - 1; i += 2) {
@@ -86,21 +91,21 @@ static void doMergeNameTree(PDFDoc *doc, XRef *srcXRef, XRef *countRef, int oldR
             }
         }
         srcNameTree->add("Names", Object(newNameArray));
-        doc->markPageObjects(mergeNameTree, srcXRef, countRef, numOffset, oldRefNum, newRefNum);
+        doc->markPageObjects(mergeNameTree, srcXRef, markedObjects, numOffset, oldRefNum, newRefNum);
     }
 }
 
-static void doMergeNameDict(PDFDoc *doc, XRef *srcXRef, XRef *countRef, int oldRefNum, int newRefNum, Dict *srcNameDict, Dict *mergeNameDict, int numOffset)
+static void doMergeNameDict(PDFDoc *doc, XRef *srcXRef, std::vector<bool> *markedObjects, int oldRefNum, int newRefNum, Dict *srcNameDict, Dict *mergeNameDict, int numOffset)
 {
     for (int i = 0; i < mergeNameDict->getLength(); i++) {
         const char *key = mergeNameDict->getKey(i);
         Object mergeNameTree = mergeNameDict->lookup(key);
         Object srcNameTree = srcNameDict->lookup(key);
         if (srcNameTree.isDict() && mergeNameTree.isDict()) {
-            doMergeNameTree(doc, srcXRef, countRef, oldRefNum, newRefNum, srcNameTree.getDict(), mergeNameTree.getDict(), numOffset);
+            doMergeNameTree(doc, srcXRef, markedObjects, oldRefNum, newRefNum, srcNameTree.getDict(), mergeNameTree.getDict(), numOffset);
         } else if (srcNameTree.isNull() && mergeNameTree.isDict()) {
             Object newNameTree(new Dict(srcXRef));
-            doMergeNameTree(doc, srcXRef, countRef, oldRefNum, newRefNum, newNameTree.getDict(), mergeNameTree.getDict(), numOffset);
+            doMergeNameTree(doc, srcXRef, markedObjects, oldRefNum, newRefNum, newNameTree.getDict(), mergeNameTree.getDict(), numOffset);
             srcNameDict->add(key, std::move(newNameTree));
         }
     }
@@ -134,7 +139,9 @@ int main(int argc, char *argv[])
     unsigned int numOffset = 0;
     std::vector<Object> pages;
     std::vector<unsigned int> offsets;
-    XRef *yRef, *countRef;
+    std::vector<unsigned int> docOffsets; // first object number of each source file, with -j
+    XRef *yRef;
+    std::vector<bool> markedObjects;
     FILE *f;
     OutStream *outStr;
     int i;
@@ -192,7 +199,6 @@ int main(int argc, char *argv[])
     outStr = new FileOutStream(f, 0);
 
     yRef = new XRef();
-    countRef = new XRef();
     yRef->add(0, 65535, 0, false);
     PDFDoc::writeHeader(outStr, majorVersion, minorVersion);
 
@@ -206,7 +212,6 @@ int main(int argc, char *argv[])
         if (!catObj.isDict()) {
             fclose(f);
             delete yRef;
-            delete countRef;
             delete outStr;
             error(errSyntaxError, -1, "XRef's Catalog is not a dictionary.");
             return -1;
@@ -216,15 +221,15 @@ int main(int argc, char *argv[])
         afObj = catDict->lookupNF("AcroForm").copy();
         Ref *refPage = docs[0]->getCatalog()->getPageRef(1);
         if (!afObj.isNull() && refPage) {
-            docs[0]->markAcroForm(&afObj, yRef, countRef, 0, refPage->num, refPage->num);
+            docs[0]->markAcroForm(&afObj, yRef, &markedObjects, 0, refPage->num, refPage->num);
         }
         ocObj = catDict->lookupNF("OCProperties").copy();
         if (!ocObj.isNull() && ocObj.isDict() && refPage) {
-            docs[0]->markPageObjects(ocObj.getDict(), yRef, countRef, 0, refPage->num, refPage->num);
+            docs[0]->markPageObjects(ocObj.getDict(), yRef, &markedObjects, 0, refPage->num, refPage->num);
         }
         names = catDict->lookup("Names");
         if (!names.isNull() && names.isDict() && refPage) {
-            docs[0]->markPageObjects(names.getDict(), yRef, countRef, 0, refPage->num, refPage->num);
+            docs[0]->markPageObjects(names.getDict(), yRef, &markedObjects, 0, refPage->num, refPage->num);
         }
         if (intents.isArray() && intents.arrayGetLength() > 0) {
             for (i = 1; i < (int)docs.size(); i++) {
@@ -274,7 +279,7 @@ int main(int argc, char *argv[])
             for (j = intents.arrayGetLength() - 1; j >= 0; j--) {
                 Object intent = intents.arrayGet(j, 0);
                 if (intent.isDict()) {
-                    docs[0]->markPageObjects(intent.getDict(), yRef, countRef, numOffset, 0, 0);
+                    docs[0]->markPageObjects(intent.getDict(), yRef, &markedObjects, numOffset, 0, 0);
                 } else {
                     intents.arrayRemove(j);
                 }
@@ -295,7 +300,6 @@ int main(int argc, char *argv[])
             if (!docs[i]->replacePageDict(j, docs[i]->getCatalog()->getPage(j)->getRotate(), docs[i]->getCatalog()->getPage(j)->getMediaBox(), cropBox)) {
                 fclose(f);
                 delete yRef;
-                delete countRef;
                 delete outStr;
                 error(errSyntaxError, -1, "PDFDoc::replacePageDict failed.");
                 return -1;
@@ -309,17 +313,16 @@ int main(int argc, char *argv[])
             }
             pages.push_back(std::move(page));
             offsets.push_back(numOffset);
-            docs[i]->markPageObjects(pageDict, yRef, countRef, numOffset, refPage->num, refPage->num);
+            docs[i]->markPageObjects(pageDict, yRef, &markedObjects, numOffset, refPage->num, refPage->num);
             Object annotsObj = pageDict->lookupNF("Annots").copy();
             if (!annotsObj.isNull()) {
-                docs[i]->markAnnotations(&annotsObj, yRef, countRef, numOffset, refPage->num, refPage->num);
+                docs[i]->markAnnotations(&annotsObj, yRef, &markedObjects, numOffset, refPage->num, refPage->num);
             }
         }
         Object pageCatObj = docs[i]->getXRef()->getCatalog();
         if (!pageCatObj.isDict()) {
             fclose(f);
             delete yRef;
-            delete countRef;
             delete outStr;
             error(errSyntaxError, -1, "XRef's Catalog is not a dictionary.");
             return -1;
@@ -330,7 +333,7 @@ int main(int argc, char *argv[])
             if (!names.isDict()) {
                 names = Object(new Dict(yRef));
             }
-            doMergeNameDict(docs[i].get(), yRef, countRef, 0, 0, names.getDict(), pageNames.getDict(), numOffset);
+            doMergeNameDict(docs[i].get(), yRef, &markedObjects, 0, 0, names.getDict(), pageNames.getDict(), numOffset);
         }
         Object pageForm = pageCatDict->lookup("AcroForm");
         if (i > 0 && !pageForm.isNull() && pageForm.isDict()) {
@@ -340,16 +343,53 @@ int main(int argc, char *argv[])
                 if (!doMergeFormDict(afObj.getDict(), pageForm.getDict(), numOffset)) {
                     fclose(f);
                     delete yRef;
-                    delete countRef;
                     delete outStr;
                     return -1;
                 }
             }
         }
-        objectsCount += docs[i]->writePageObjects(outStr, yRef, numOffset, true);
+        if (numThreads > 1) {
+            docOffsets.push_back(numOffset);
+        } else {
+            objectsCount += docs[i]->writePageObjects(outStr, yRef, numOffset, true);
+        }
         numOffset = yRef->getNumObjects() + 1;
     }
 
+    if (numThreads > 1) {
+        // The objects of each source file were all marked above and only
+        // depend on that file, so they are written to memory in parallel
+        // and appended here in order, moving their offsets by where they
+        // end up in the output.
+        struct WrittenObjects
+        {
+            std::string data;
+            unsigned int count = 0;
+        };
+        docOffsets.push_back(numOffset);
+        runOrderedPageJobs<WrittenObjects>(
+                0, (int)docs.size() - 1, std::min(numThreads, (int)docs.size()),
+                [&](int doc, int) {
+                    StringOutStream mem;
+                    WrittenObjects written;
+                    written.count = docs[doc]->writePageObjects(&mem, yRef, docOffsets[doc], true, docOffsets[doc + 1]);
+                    written.data = mem.takeString();
+                    return written;
+                },
+                [&](int doc, WrittenObjects &written) {
+                    const Goffset base = outStr->getPos();
+                    outStr->write(std::span(reinterpret_cast<unsigned char *>(written.data.data()), written.data.size()));
+                    const int endNum = std::min(docOffsets[doc + 1], (unsigned int)yRef->getNumObjects());
+                    for (int n = docOffsets[doc]; n < endNum; n++) {
+                        XRefEntry *entry = yRef->getEntry(n);
+                        if (entry->type != xrefEntryFree) {
+                            entry->offset += base;
+                        }
+                    }
+                    objectsCount += written.count;
+                });
+    }
+
     rootNum = yRef->getNumObjects() + 1;
     yRef->add(rootNum, 0, outStr->getPos(), true);
     outStr->printf("%d 0 obj\n", rootNum);
@@ -426,6 +466,5 @@ int main(int argc, char *argv[])
     delete outStr;
     fclose(f);
     delete yRef;
-    delete countRef;
     return 0;
 }
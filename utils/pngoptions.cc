@@ -0,0 +1,76 @@
+//========================================================================
+//
+// pngoptions.cc
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "goo/GooString.h"
+#include "parseargs.h"
+#include "pngoptions.h"
+
+bool parsePngOptions(const GooString &pngOpt, PngOptions *options)
+{
+    // pngOpt format is: <opt1>=<val1>,<opt2>=<val2>,...
+    const char *nextOpt = pngOpt.c_str();
+    while (nextOpt && *nextOpt) {
+        const char *comma = strchr(nextOpt, ',');
+        GooString opt;
+        if (comma) {
+            opt.Set(nextOpt, static_cast<int>(comma - nextOpt));
+            nextOpt = comma + 1;
+        } else {
+            opt.Set(nextOpt);
+            nextOpt = nullptr;
+        }
+        // here opt is "<optN>=<valN> "
+        const char *equal = strchr(opt.c_str(), '=');
+        if (!equal) {
+            fprintf(stderr, "Unknown png option \"%s\"\n", opt.c_str());
+            return false;
+        }
+        const int iequal = static_cast<int>(equal - opt.c_str());
+        GooString value(&opt, iequal + 1, opt.getLength() - iequal - 1);
+        opt.del(iequal, opt.getLength() - iequal);
+        // here opt is "<optN>" and value is "<valN>"
+
+        if (opt.cmp("compression") == 0) {
+            if (!isInt(value.c_str())) {
+                fprintf(stderr, "Invalid png compression level\n");
+                return false;
+            }
+            options->compressionLevel = atoi(value.c_str());
+            if (options->compressionLevel < 0 || options->compressionLevel > 9) {
+                fprintf(stderr, "png compression level must be between 0 and 9\n");
+                return false;
+            }
+        } else if (opt.cmp("filter") == 0) {
+            // in the order of PNGWriter::Filter
+            static const char *filterNames[] = { "default", "none", "sub", "up", "average", "paeth", "adaptive" };
+            options->filter = -1;
+            for (int i = 0; i < (int)(sizeof(filterNames) / sizeof(filterNames[0])); ++i) {
+                if (value.cmp(filterNames[i]) == 0) {
+                    options->filter = i;
+                }
+            }
+            if (options->filter < 0) {
+                fprintf(stderr, "png filter must be one of \"none\", \"sub\", \"up\", \"average\", \"paeth\" or \"adaptive\"\n");
+                return false;
+            }
+        } else if (opt.cmp("threads") == 0) {
+            if (!isInt(value.c_str()) || atoi(value.c_str()) < 1) {
+                fprintf(stderr, "Invalid number of png threads\n");
+                return false;
+            }
+            options->threads = atoi(value.c_str());
+        } else {
+            fprintf(stderr, "Unknown png option \"%s\"\n", opt.c_str());
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+//========================================================================
+//
+// pngoptions.h
+//
+// This file is licensed under the GPLv2 or later
+//
+//========================================================================
+
+#ifndef PNGOPTIONS_H
+#define PNGOPTIONS_H
+
+class GooString;
+
+struct PngOptions
+{
+    int compressionLevel = -1; // 0-9, -1 for the default
+    int filter = 0; // a PNGWriter::Filter
+    int threads = 1;
+};
+
+/*
+ * Parse the -pngopt argument of pdftoppm and pdftocairo, with format
+ * <opt1>=<val1>[,<optN>=<valN>]*, into <options>.  Prints an error and
+ * returns false on an unknown option or a bad value.
+ */
+bool parsePngOptions(const GooString &pngOpt, PngOptions *options);
+
+#endif